@@ -8,177 +8,258 @@
  *
  * @version 1.0 - Original source from Paul Bourke
  * @version 1.1 - Added min/max macros and change signature for Conrecline
+ * @version 1.2 - Added cell validity mask
+ * @version 1.3 - Contour moved to a template over the segment sink (conrec.hpp)
  *
  */
 
+#include "conrec.h"
+
 #ifndef MIN
 #define MIN(a, b) (((a) < (b)) ? (a) : (b))
 #endif
 #ifndef MAX
 #define MAX(a, b) (((a) > (b)) ? (a) : (b))
 #endif
+
+#include "conrec_triangle.h"
+
 /*
-   Derivation from the fortran version of CONREC by Paul Bourke
-   d               ! matrix of data to contour
-   ilb,iub,jlb,jub ! index bounds of data matrix
-   x               ! data matrix column coordinates
-   y               ! data matrix row coordinates
+   Contour over an unstructured triangle mesh using the same
+   classification as the triangles of Contour.
+   d               ! nodal values
+   valid           ! optional nodal validity (non-zero is valid)
+   x,y             ! nodal coordinates
+   triangles       ! vertex indices, three per triangle
+   nt              ! number of triangles
    nc              ! number of contour levels
    z               ! contour levels in increasing order
+
+   Each line is reported with the mesh vertices between which its end
+   points lie (equal if the end point is on a vertex), such that lines
+   can be joined through shared mesh edges.
 */
-void Contour(double** d, int ilb, int iub, int jlb, int jub, double* x, double* y, int nc,
-  double* z, void (*ConrecLine)(double, double, double, double, int))
+void ContourMesh(const double* d, const unsigned char* valid, const double* x, const double* y,
+  const size_t* triangles, size_t nt, int nc, const double* z,
+  void (*MeshLine)(const double* xy, const size_t* ends, int level, void* user), void* user)
 {
-#define xsect(p1, p2) (h[p2] * xh[p1] - h[p1] * xh[p2]) / (h[p2] - h[p1])
-#define ysect(p1, p2) (h[p2] * yh[p1] - h[p1] * yh[p2]) / (h[p2] - h[p1])
-
-  int m1, m2, m3, case_value;
-  double dmin, dmax, x1 = 0, x2 = 0, y1 = 0, y2 = 0;
-  int i, j, k, m;
-  double h[5];
-  int sh[5];
-  double xh[5], yh[5];
-  int im[4] = { 0, 1, 1, 0 }, jm[4] = { 0, 0, 1, 1 };
-  int castab[3][3][3] = { { { 0, 0, 8 }, { 0, 2, 5 }, { 7, 6, 9 } },
-    { { 0, 3, 4 }, { 1, 3, 1 }, { 4, 3, 0 } }, { { 9, 6, 7 }, { 5, 2, 0 }, { 8, 0, 0 } } };
-  double temp1, temp2;
-
-  for (j = (jub - 1); j >= jlb; j--)
+  size_t t, vertices[3], mends[4];
+  int k, m;
+  double dmin, dmax, h[3], xh[3], yh[3], xy[4];
+  int sh[3], ends[4];
+
+  for (t = 0; t < nt; t++)
   {
-    for (i = ilb; i <= iub - 1; i++)
+    for (m = 0; m < 3; m++)
+      vertices[m] = triangles[3 * t + m];
+    if (valid && !(valid[vertices[0]] && valid[vertices[1]] && valid[vertices[2]]))
+      continue;
+    dmin = MIN(d[vertices[0]], MIN(d[vertices[1]], d[vertices[2]]));
+    dmax = MAX(d[vertices[0]], MAX(d[vertices[1]], d[vertices[2]]));
+    if (dmax < z[0] || dmin > z[nc - 1])
+      continue;
+    for (m = 0; m < 3; m++)
+    {
+      xh[m] = x[vertices[m]];
+      yh[m] = y[vertices[m]];
+    }
+    for (k = 0; k < nc; k++)
     {
-      temp1 = MIN(d[i][j], d[i][j + 1]);
-      temp2 = MIN(d[i + 1][j], d[i + 1][j + 1]);
-      dmin = MIN(temp1, temp2);
-      temp1 = MAX(d[i][j], d[i][j + 1]);
-      temp2 = MAX(d[i + 1][j], d[i + 1][j + 1]);
-      dmax = MAX(temp1, temp2);
-      if (dmax < z[0] || dmin > z[nc - 1])
+      if (z[k] < dmin || z[k] > dmax)
         continue;
-      for (k = 0; k < nc; k++)
+      for (m = 0; m < 3; m++)
+      {
+        h[m] = d[vertices[m]] - z[k];
+        if (h[m] > 0.0)
+          sh[m] = 1;
+        else if (h[m] < 0.0)
+          sh[m] = -1;
+        else
+          sh[m] = 0;
+      }
+      if (ConrecTriangle(h, sh, xh, yh, 0, 1, 2, xy, ends) == 0)
+        continue;
+      for (m = 0; m < 4; m++)
+        mends[m] = vertices[ends[m]];
+      MeshLine(xy, mends, k, user);
+    } /* k - contour */
+  }   /* t */
+}
+
+/*
+   3D counterpart of Contour using marching tetrahedra.
+   d               ! volume to contour, row-major (nz, ny, nx)
+   valid           ! optional sample validity (non-zero is valid)
+   nz,ny,nx        ! dimensions of volume
+   klb,kub         ! range of cubes along z to process, [klb, kub)
+   z,y,x           ! coordinates along each dimension
+   nc              ! number of contour levels
+   levels          ! contour levels in increasing order
+
+   Each cube is split into six tetrahedra sharing the diagonal from
+   corner 0 to corner 7, where corner c has offsets (c & 1, (c >> 1) &
+   1, (c >> 2) & 1) along (x, y, z). The split is the same for all
+   cubes, so faces shared by neighbouring cubes are split identically
+   and every intersected lattice edge has a unique identifier,
+
+     e = (sample index of lower end) * 8 + (direction bits - 1)
+
+   which is passed along with each triangle for joining vertices. A
+   vertex on a sample equal to the level is shared by all its edges,
+   it is identified by the sample itself,
+
+     e = (sample index) * 8 + 7
+
+   and triangles collapsed by such vertices are dropped. The triangles
+   are oriented with their normals towards lower values.
+*/
+void Isosurface(const double* d, const unsigned char* valid, int nz, int ny, int nx, int klb,
+  int kub, const double* z, const double* y, const double* x, int nc, const double* levels,
+  void (*IsoTriangle)(const double* p, const size_t* e, int level, void* user), void* user)
+{
+  static const int tets[6][4] = { { 0, 1, 3, 7 }, { 0, 1, 5, 7 }, { 0, 2, 3, 7 },
+    { 0, 2, 6, 7 }, { 0, 4, 5, 7 }, { 0, 4, 6, 7 } };
+  /* Triangles (pairs of tetrahedron vertices) for one or two vertices inside */
+  static const int tri1[3][2] = { { 0, 1 }, { 0, 2 }, { 0, 3 } };
+  static const int tri2[2][3][2] = { { { 0, 2 }, { 0, 3 }, { 1, 3 } },
+    { { 0, 2 }, { 1, 3 }, { 1, 2 } } };
+
+  int i, j, k, l, m, t, c, n, a, b;
+  double v[8], h[4], pc[8][3], p[9], dir[3], nrm[3], u[3], w[3], s;
+  size_t index[8], e[3], tmp;
+  int order[4], inside;
+  const int (*tri)[2];
+  double dmin, dmax;
+
+  for (k = klb; k < kub && k < nz - 1; k++)
+  {
+    for (i = 0; i < ny - 1; i++)
+    {
+      for (j = 0; j < nx - 1; j++)
       {
-        if (z[k] < dmin || z[k] > dmax)
+        for (c = 0; c < 8; c++)
+        {
+          index[c] = ((size_t)(k + ((c >> 2) & 1)) * ny + (i + ((c >> 1) & 1))) * nx +
+            (j + (c & 1));
+        }
+        if (valid)
+        {
+          for (c = 0; c < 8; c++)
+            if (!valid[index[c]])
+              break;
+          if (c < 8)
+            continue;
+        }
+        dmin = dmax = v[0] = d[index[0]];
+        for (c = 1; c < 8; c++)
+        {
+          v[c] = d[index[c]];
+          dmin = MIN(dmin, v[c]);
+          dmax = MAX(dmax, v[c]);
+        }
+        if (dmax < levels[0] || dmin > levels[nc - 1])
           continue;
-        for (m = 4; m >= 0; m--)
+        for (c = 0; c < 8; c++)
         {
-          if (m > 0)
-          {
-            h[m] = d[i + im[m - 1]][j + jm[m - 1]] - z[k];
-            xh[m] = x[i + im[m - 1]];
-            yh[m] = y[j + jm[m - 1]];
-          }
-          else
-          {
-            h[0] = 0.25 * (h[1] + h[2] + h[3] + h[4]);
-            xh[0] = 0.50 * (x[i] + x[i + 1]);
-            yh[0] = 0.50 * (y[j] + y[j + 1]);
-          }
-          if (h[m] > 0.0)
-            sh[m] = 1;
-          else if (h[m] < 0.0)
-            sh[m] = -1;
-          else
-            sh[m] = 0;
+          pc[c][0] = x[j + (c & 1)];
+          pc[c][1] = y[i + ((c >> 1) & 1)];
+          pc[c][2] = z[k + ((c >> 2) & 1)];
         }
-
-        /*
-           Note: at this stage the relative heights of the corners and the
-           centre are in the h array, and the corresponding coordinates are
-           in the xh and yh arrays. The centre of the box is indexed by 0
-           and the 4 corners by 1 to 4 as shown below.
-           Each triangle is then indexed by the parameter m, and the 3
-           vertices of each triangle are indexed by parameters m1,m2,and m3.
-           It is assumed that the centre of the box is always vertex 2
-           though this isimportant only when all 3 vertices lie exactly on
-           the same contour level, in which case only the side of the box
-           is drawn.
-              vertex 4 +-------------------+ vertex 3
-                       | \               / |
-                       |   \    m-3    /   |
-                       |     \       /     |
-                       |       \   /       |
-                       |  m=2    X   m=2   |       the centre is vertex 0
-                       |       /   \       |
-                       |     /       \     |
-                       |   /    m=1    \   |
-                       | /               \ |
-              vertex 1 +-------------------+ vertex 2
-        */
-        /* Scan each triangle in the box */
-        for (m = 1; m <= 4; m++)
+        for (l = 0; l < nc; l++)
         {
-          m1 = m;
-          m2 = 0;
-          if (m != 4)
-            m3 = m + 1;
-          else
-            m3 = 1;
-          if ((case_value = castab[sh[m1] + 1][sh[m2] + 1][sh[m3] + 1]) == 0)
+          if (levels[l] < dmin || levels[l] > dmax)
             continue;
-          switch (case_value)
+          for (t = 0; t < 6; t++)
           {
-            case 1: /* Line between vertices 1 and 2 */
-              x1 = xh[m1];
-              y1 = yh[m1];
-              x2 = xh[m2];
-              y2 = yh[m2];
-              break;
-            case 2: /* Line between vertices 2 and 3 */
-              x1 = xh[m2];
-              y1 = yh[m2];
-              x2 = xh[m3];
-              y2 = yh[m3];
-              break;
-            case 3: /* Line between vertices 3 and 1 */
-              x1 = xh[m3];
-              y1 = yh[m3];
-              x2 = xh[m1];
-              y2 = yh[m1];
-              break;
-            case 4: /* Line between vertex 1 and side 2-3 */
-              x1 = xh[m1];
-              y1 = yh[m1];
-              x2 = xsect(m2, m3);
-              y2 = ysect(m2, m3);
-              break;
-            case 5: /* Line between vertex 2 and side 3-1 */
-              x1 = xh[m2];
-              y1 = yh[m2];
-              x2 = xsect(m3, m1);
-              y2 = ysect(m3, m1);
-              break;
-            case 6: /* Line between vertex 3 and side 1-2 */
-              x1 = xh[m3];
-              y1 = yh[m3];
-              x2 = xsect(m1, m2);
-              y2 = ysect(m1, m2);
-              break;
-            case 7: /* Line between sides 1-2 and 2-3 */
-              x1 = xsect(m1, m2);
-              y1 = ysect(m1, m2);
-              x2 = xsect(m2, m3);
-              y2 = ysect(m2, m3);
-              break;
-            case 8: /* Line between sides 2-3 and 3-1 */
-              x1 = xsect(m2, m3);
-              y1 = ysect(m2, m3);
-              x2 = xsect(m3, m1);
-              y2 = ysect(m3, m1);
-              break;
-            case 9: /* Line between sides 3-1 and 1-2 */
-              x1 = xsect(m3, m1);
-              y1 = ysect(m3, m1);
-              x2 = xsect(m1, m2);
-              y2 = ysect(m1, m2);
-              break;
-            default:
-              break;
-          }
-
-          /* Finally draw the line */
-          ConrecLine(x1, y1, x2, y2, k);
-        } /* m */
-      }   /* k - contour */
-    }     /* i */
-  }       /* j */
+            /* Order tetrahedron vertices with inside (above level) first */
+            n = 0;
+            for (m = 0; m < 4; m++)
+            {
+              h[m] = v[tets[t][m]] - levels[l];
+              if (h[m] > 0.0)
+                order[n++] = m;
+            }
+            if (n == 0 || n == 4)
+              continue;
+            inside = n;
+            for (m = 0; m < 4; m++)
+              if (!(h[m] > 0.0))
+                order[n++] = m;
+
+            /* Direction from inside towards outside */
+            dir[0] = dir[1] = dir[2] = 0.0;
+            for (m = 0; m < 4; m++)
+            {
+              s = (m < inside) ? -1.0 / inside : 1.0 / (4 - inside);
+              dir[0] += s * pc[tets[t][order[m]]][0];
+              dir[1] += s * pc[tets[t][order[m]]][1];
+              dir[2] += s * pc[tets[t][order[m]]][2];
+            }
+
+            for (n = 0; n < (inside == 2 ? 2 : 1); n++)
+            {
+              tri = (inside == 2) ? tri2[n] : tri1;
+              for (m = 0; m < 3; m++)
+              {
+                /* Single vertex on its own side is always first */
+                if (inside == 3)
+                {
+                  a = order[3];
+                  b = order[tri[m][1] - 1];
+                }
+                else
+                {
+                  a = order[tri[m][0]];
+                  b = order[tri[m][1]];
+                }
+                a = tets[t][a];
+                b = tets[t][b];
+                /* The outside end may be on the level */
+                if (v[a] == levels[l] || v[b] == levels[l])
+                {
+                  c = (v[a] == levels[l]) ? a : b;
+                  p[3 * m + 0] = pc[c][0];
+                  p[3 * m + 1] = pc[c][1];
+                  p[3 * m + 2] = pc[c][2];
+                  e[m] = index[c] * 8 + 7;
+                  continue;
+                }
+                s = (v[a] - levels[l]) / (v[a] - v[b]);
+                p[3 * m + 0] = pc[a][0] + s * (pc[b][0] - pc[a][0]);
+                p[3 * m + 1] = pc[a][1] + s * (pc[b][1] - pc[a][1]);
+                p[3 * m + 2] = pc[a][2] + s * (pc[b][2] - pc[a][2]);
+                /* Lower end of edge is the common subset of corner bits */
+                e[m] = index[a & b] * 8 + (size_t)((a ^ b) - 1);
+              }
+              if (e[0] == e[1] || e[1] == e[2] || e[0] == e[2])
+                continue;
+
+              /* Orient normal towards lower values */
+              for (m = 0; m < 3; m++)
+              {
+                u[m] = p[3 + m] - p[m];
+                w[m] = p[6 + m] - p[m];
+              }
+              nrm[0] = u[1] * w[2] - u[2] * w[1];
+              nrm[1] = u[2] * w[0] - u[0] * w[2];
+              nrm[2] = u[0] * w[1] - u[1] * w[0];
+              if (nrm[0] * dir[0] + nrm[1] * dir[1] + nrm[2] * dir[2] < 0.0)
+              {
+                for (m = 0; m < 3; m++)
+                {
+                  s = p[3 + m];
+                  p[3 + m] = p[6 + m];
+                  p[6 + m] = s;
+                }
+                tmp = e[1];
+                e[1] = e[2];
+                e[2] = tmp;
+              }
+              IsoTriangle(p, e, l, user);
+            } /* n - triangle */
+          }   /* t - tetrahedron */
+        }     /* l - contour */
+      }       /* j */
+    }         /* i */
+  }           /* k */
 }
@@ -8,13 +8,31 @@
  *
  */
 #pragma once
+#include <stddef.h>
+
 #ifdef __cplusplus
 extern "C"
 {
 #endif
 
-  void Contour(double** d, int ilb, int iub, int jlb, int jub, double* x, double* y, int nc,
-    double* z, void (*ConrecLine)(double, double, double, double, int));
+  /*
+     Contour lines over the triangles of an unstructured mesh with
+     nodal values d. Each line is reported with its end points and the
+     mesh vertices between which they lie.
+  */
+  void ContourMesh(const double* d, const unsigned char* valid, const double* x, const double* y,
+    const size_t* triangles, size_t nt, int nc, const double* z,
+    void (*MeshLine)(const double* xy, const size_t* ends, int level, void* user), void* user);
+
+  /*
+     Marching tetrahedra over the cubes [klb, kub) along z of the
+     row-major volume d with dimensions (nz, ny, nx). Each triangle is
+     reported with its vertices (x, y, z) and the identifiers of the
+     lattice edges they lie on, which are unique within the volume.
+  */
+  void Isosurface(const double* d, const unsigned char* valid, int nz, int ny, int nx, int klb,
+    int kub, const double* z, const double* y, const double* x, int nc, const double* levels,
+    void (*IsoTriangle)(const double* p, const size_t* e, int level, void* user), void* user);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,206 @@
+/**
+ * @file   conrec.hpp
+ * @brief  CONREC kernel for rectilinear grids as a template over the
+ *         segment sink, such that emitting a line can be inlined
+ *
+ */
+#pragma once
+#include <stdint.h>
+
+#include "conrec_triangle.h"
+
+/* Same semantics as the MIN and MAX macros of conrec.c */
+inline double ConrecMin(double a, double b)
+{
+  return (a < b) ? a : b;
+}
+
+inline double ConrecMax(double a, double b)
+{
+  return (a > b) ? a : b;
+}
+
+/* Sinks taking the end points of ConrecTriangle and the cell get
+   them, the others just the coordinates */
+template <typename Sink>
+inline auto ConrecEmit(Sink& sink, const double* xy, const int* ends, int i, int j, int k, int)
+  -> decltype(sink(xy, ends, i, j, k), void())
+{
+  sink(xy, ends, i, j, k);
+}
+
+template <typename Sink>
+inline void ConrecEmit(Sink& sink, const double* xy, const int*, int, int, int k, long)
+{
+  sink(xy[0], xy[1], xy[2], xy[3], k);
+}
+
+/* Width of the column strips walked by Contour(), such that two rows
+   of a strip stay in cache */
+const int ConrecBlockColumns = 8192;
+
+/*
+   Derivation from the fortran version of CONREC by Paul Bourke
+   d               ! matrix of data to contour
+   ilb,iub,jlb,jub ! index bounds of data matrix
+   x               ! data matrix column coordinates
+   y               ! data matrix row coordinates
+   nc              ! number of contour levels
+   z               ! contour levels in increasing order
+   mask            ! optional cell validity, see below
+   sink            ! called as sink(x1, y1, x2, y2, level) for each line,
+                   ! or as sink(xy, ends, i, j, level) with the output
+                   ! of ConrecTriangle for cell (i, j) if it takes that
+   poll            ! called as poll() before each row of a strip, false stops
+
+   The cells are walked row by row, reading the two rows d[i] and
+   d[i + 1] contiguously. Rows wider than ConrecBlockColumns are split
+   into strips that are walked one at a time, so each row is read from
+   memory once.
+
+   mask is an optional cell validity bitmap. For each row i, mask[i]
+   points to words where bit (j - jlb) is set if cell (i, j) can be
+   contoured. A NULL row pointer skips the entire row and a NULL mask
+   contours all cells.
+*/
+template <typename Sink, typename Poll>
+void Contour(const double* const* d, const uint64_t* const* mask, int ilb, int iub, int jlb,
+  int jub, const double* x, const double* y, int nc, const double* z, Sink&& sink, Poll&& poll)
+{
+  int m1, m2, m3;
+  double dmin, dmax, xy[4] = { 0.0, 0.0, 0.0, 0.0 };
+  int ends[4] = { 0, 0, 0, 0 };
+  int i, j, k, m;
+  double h[5], v[5];
+  int sh[5];
+  double xh[5], yh[5];
+  int jb, je;
+  double temp1, temp2;
+  const double* d0;
+  const double* d1;
+  const uint64_t* bits = nullptr;
+  uint64_t word;
+  int jj;
+
+  for (jb = jlb; jb <= jub - 1; jb += ConrecBlockColumns)
+  {
+    je = (jub - jb > ConrecBlockColumns) ? jb + ConrecBlockColumns : jub;
+    for (i = ilb; i <= iub - 1; i++)
+    {
+      if (!poll())
+        return;
+      if (mask)
+      {
+        /* Skip rows without any valid cells */
+        if (!(bits = mask[i]))
+          continue;
+      }
+      /* Rolling row pointers */
+      d0 = d[i];
+      d1 = d[i + 1];
+      for (j = jb; j <= je - 1; j++)
+      {
+        if (bits)
+        {
+          jj = j - jlb;
+          word = bits[jj >> 6];
+          if (word == 0)
+          {
+            /* Skip to next word */
+            j += 63 - (jj & 63);
+            continue;
+          }
+          if (!((word >> (jj & 63)) & 1))
+            continue;
+        }
+        /* Corners in the order of the triangles below */
+        v[1] = d0[j];
+        v[2] = d1[j];
+        v[3] = d1[j + 1];
+        v[4] = d0[j + 1];
+        temp1 = ConrecMin(v[1], v[4]);
+        temp2 = ConrecMin(v[2], v[3]);
+        dmin = ConrecMin(temp1, temp2);
+        temp1 = ConrecMax(v[1], v[4]);
+        temp2 = ConrecMax(v[2], v[3]);
+        dmax = ConrecMax(temp1, temp2);
+        if (dmax < z[0] || dmin > z[nc - 1])
+          continue;
+        xh[1] = x[i];
+        yh[1] = y[j];
+        xh[2] = x[i + 1];
+        yh[2] = y[j];
+        xh[3] = x[i + 1];
+        yh[3] = y[j + 1];
+        xh[4] = x[i];
+        yh[4] = y[j + 1];
+        xh[0] = 0.50 * (x[i] + x[i + 1]);
+        yh[0] = 0.50 * (y[j] + y[j + 1]);
+        for (k = 0; k < nc; k++)
+        {
+          if (z[k] < dmin || z[k] > dmax)
+            continue;
+          for (m = 4; m >= 0; m--)
+          {
+            if (m > 0)
+              h[m] = v[m] - z[k];
+            else
+              h[0] = 0.25 * (h[1] + h[2] + h[3] + h[4]);
+            if (h[m] > 0.0)
+              sh[m] = 1;
+            else if (h[m] < 0.0)
+              sh[m] = -1;
+            else
+              sh[m] = 0;
+          }
+
+          /*
+             Note: at this stage the relative heights of the corners and the
+             centre are in the h array, and the corresponding coordinates are
+             in the xh and yh arrays. The centre of the box is indexed by 0
+             and the 4 corners by 1 to 4 as shown below.
+             Each triangle is then indexed by the parameter m, and the 3
+             vertices of each triangle are indexed by parameters m1,m2,and m3.
+             It is assumed that the centre of the box is always vertex 2
+             though this isimportant only when all 3 vertices lie exactly on
+             the same contour level, in which case only the side of the box
+             is drawn.
+                vertex 4 +-------------------+ vertex 3
+                         | \               / |
+                         |   \    m-3    /   |
+                         |     \       /     |
+                         |       \   /       |
+                         |  m=2    X   m=2   |       the centre is vertex 0
+                         |       /   \       |
+                         |     /       \     |
+                         |   /    m=1    \   |
+                         | /               \ |
+                vertex 1 +-------------------+ vertex 2
+          */
+          /* Scan each triangle in the box */
+          for (m = 1; m <= 4; m++)
+          {
+            m1 = m;
+            m2 = 0;
+            if (m != 4)
+              m3 = m + 1;
+            else
+              m3 = 1;
+            if (ConrecTriangle(h, sh, xh, yh, m1, m2, m3, xy, ends) == 0)
+              continue;
+
+            /* Finally draw the line */
+            ConrecEmit(sink, xy, ends, i, j, k, 0);
+          } /* m */
+        }   /* k - contour */
+      }     /* j */
+    }       /* i */
+  }         /* jb - strip */
+}
+
+template <typename Sink>
+void Contour(const double* const* d, const uint64_t* const* mask, int ilb, int iub, int jlb,
+  int jub, const double* x, const double* y, int nc, const double* z, Sink&& sink)
+{
+  Contour(d, mask, ilb, iub, jlb, jub, x, y, nc, z, sink, []() { return true; });
+}
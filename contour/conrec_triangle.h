@@ -0,0 +1,134 @@
+/**
+ * @file   conrec_triangle.h
+ * @brief  Contour line through a single triangle, shared by the
+ *         CONREC kernels in conrec.c and conrec.hpp
+ *
+ */
+#pragma once
+
+/* Case of a triangle given the signs (-1, 0 or 1) of its relative heights */
+static inline int ConrecTriangleCase(int s1, int s2, int s3)
+{
+  static const int castab[3][3][3] = { { { 0, 0, 8 }, { 0, 2, 5 }, { 7, 6, 9 } },
+    { { 0, 3, 4 }, { 1, 3, 1 }, { 4, 3, 0 } }, { { 9, 6, 7 }, { 5, 2, 0 }, { 8, 0, 0 } } };
+  return castab[s1 + 1][s2 + 1][s3 + 1];
+}
+
+/* Coordinate c where the level crosses the side between vertices p1 and p2 */
+static inline double ConrecTriangleSect(const double* h, const double* c, int p1, int p2)
+{
+  return (h[p2] * c[p1] - h[p1] * c[p2]) / (h[p2] - h[p1]);
+}
+
+/*
+   Line through the triangle with vertices m1, m2 and m3, given
+   relative heights h, their signs sh and coordinates xh and yh.
+   Returns the case value (0 if no line) and writes the end points of
+   the line to xy. The vertices between which each end point lies are
+   written to ends (ends[0], ends[1] for the first end point and
+   ends[2], ends[3] for the second), equal if it is on a vertex.
+   Without a line, xy is zero and all ends are m1.
+*/
+static inline int ConrecTriangle(const double* h, const int* sh, const double* xh, const double* yh,
+  int m1, int m2, int m3, double* xy, int* ends)
+{
+  int case_value = ConrecTriangleCase(sh[m1], sh[m2], sh[m3]);
+  switch (case_value)
+  {
+    case 1: /* Line between vertices 1 and 2 */
+      xy[0] = xh[m1];
+      xy[1] = yh[m1];
+      xy[2] = xh[m2];
+      xy[3] = yh[m2];
+      ends[0] = m1;
+      ends[1] = m1;
+      ends[2] = m2;
+      ends[3] = m2;
+      break;
+    case 2: /* Line between vertices 2 and 3 */
+      xy[0] = xh[m2];
+      xy[1] = yh[m2];
+      xy[2] = xh[m3];
+      xy[3] = yh[m3];
+      ends[0] = m2;
+      ends[1] = m2;
+      ends[2] = m3;
+      ends[3] = m3;
+      break;
+    case 3: /* Line between vertices 3 and 1 */
+      xy[0] = xh[m3];
+      xy[1] = yh[m3];
+      xy[2] = xh[m1];
+      xy[3] = yh[m1];
+      ends[0] = m3;
+      ends[1] = m3;
+      ends[2] = m1;
+      ends[3] = m1;
+      break;
+    case 4: /* Line between vertex 1 and side 2-3 */
+      xy[0] = xh[m1];
+      xy[1] = yh[m1];
+      xy[2] = ConrecTriangleSect(h, xh, m2, m3);
+      xy[3] = ConrecTriangleSect(h, yh, m2, m3);
+      ends[0] = m1;
+      ends[1] = m1;
+      ends[2] = m2;
+      ends[3] = m3;
+      break;
+    case 5: /* Line between vertex 2 and side 3-1 */
+      xy[0] = xh[m2];
+      xy[1] = yh[m2];
+      xy[2] = ConrecTriangleSect(h, xh, m3, m1);
+      xy[3] = ConrecTriangleSect(h, yh, m3, m1);
+      ends[0] = m2;
+      ends[1] = m2;
+      ends[2] = m3;
+      ends[3] = m1;
+      break;
+    case 6: /* Line between vertex 3 and side 1-2 */
+      xy[0] = xh[m3];
+      xy[1] = yh[m3];
+      xy[2] = ConrecTriangleSect(h, xh, m1, m2);
+      xy[3] = ConrecTriangleSect(h, yh, m1, m2);
+      ends[0] = m3;
+      ends[1] = m3;
+      ends[2] = m1;
+      ends[3] = m2;
+      break;
+    case 7: /* Line between sides 1-2 and 2-3 */
+      xy[0] = ConrecTriangleSect(h, xh, m1, m2);
+      xy[1] = ConrecTriangleSect(h, yh, m1, m2);
+      xy[2] = ConrecTriangleSect(h, xh, m2, m3);
+      xy[3] = ConrecTriangleSect(h, yh, m2, m3);
+      ends[0] = m1;
+      ends[1] = m2;
+      ends[2] = m2;
+      ends[3] = m3;
+      break;
+    case 8: /* Line between sides 2-3 and 3-1 */
+      xy[0] = ConrecTriangleSect(h, xh, m2, m3);
+      xy[1] = ConrecTriangleSect(h, yh, m2, m3);
+      xy[2] = ConrecTriangleSect(h, xh, m3, m1);
+      xy[3] = ConrecTriangleSect(h, yh, m3, m1);
+      ends[0] = m2;
+      ends[1] = m3;
+      ends[2] = m3;
+      ends[3] = m1;
+      break;
+    case 9: /* Line between sides 3-1 and 1-2 */
+      xy[0] = ConrecTriangleSect(h, xh, m3, m1);
+      xy[1] = ConrecTriangleSect(h, yh, m3, m1);
+      xy[2] = ConrecTriangleSect(h, xh, m1, m2);
+      xy[3] = ConrecTriangleSect(h, yh, m1, m2);
+      ends[0] = m3;
+      ends[1] = m1;
+      ends[2] = m1;
+      ends[3] = m2;
+      break;
+    default: /* No line, the outputs are still written */
+      xy[0] = xy[1] = xy[2] = xy[3] = 0.0;
+      ends[0] = ends[1] = ends[2] = ends[3] = m1;
+      break;
+  }
+  return case_value;
+}
@@ -19,15 +19,32 @@
 
 #include <cmath>
 #include <contour/conrec.h>
+#include <contour/contour.hpp>
+#include <contour/contour_alloc.hpp>
+#include <contour/contour_result.h>
+#include <contour/contour_trace.hpp>
+#include <contour/contour_visit.hpp>
 #include <cstddef>
 #include <memory>
 
 #include <array> // must be after initializer list
+#include <atomic>
+#include <deque>
 #include <initializer_list>
 #include <list>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <unordered_map>
 #include <vector>
 
 #include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <limits>
 
 #if defined(__GNUC__) && defined(SPS_DEBUG)
 #if !defined(__CYGWIN__)
@@ -47,19 +64,58 @@ void ContourInit()
 #endif
 }
 
+void contour_options_init(contour_options_t* pOptions)
+{
+  pOptions->pMask = nullptr;
+  pOptions->bNaNIsMissing = 0;
+  pOptions->nThreads = 0;
+  pOptions->nMaxBytes = 0;
+  pOptions->pProgress = nullptr;
+  pOptions->pProgressUser = nullptr;
+  pOptions->pCancel = nullptr;
+  pOptions->pAffine = nullptr;
+  pOptions->pTransform = nullptr;
+  pOptions->pTransformUser = nullptr;
+  pOptions->iRowBegin = 0;
+  pOptions->iRowEnd = 0;
+  pOptions->iColumnBegin = 0;
+  pOptions->iColumnEnd = 0;
+  pOptions->pClip = nullptr;
+  pOptions->eEngine = CONTOUR_ENGINE_STITCH;
+  pOptions->eLevels = CONTOUR_LEVELS_NICE;
+  pOptions->dLevelInterval = 0.0;
+}
+
 template <typename T>
 using point2_t = std::array<T, 2>;
 
 template <typename T>
 using line2_t = std::array<point2_t<T>, 2>;
 
-// Global variables
-std::vector<std::list<line2_t<double>>> g_segments;
-double g_dx = 0.0;
-double g_dy = 0.0;
-
 template <typename T>
-inline bool operator==(point2_t<T>, point2_t<T>);
+using point3_t = std::array<T, 3>;
+
+using index_map_t = std::unordered_map<size_t, size_t, std::hash<size_t>, std::equal_to<size_t>,
+  contour_stl_allocator<std::pair<const size_t, size_t>>>;
+
+// Tolerances for matching the ends of segments when connecting them
+struct point_tolerance_t
+{
+  double dx;
+  double dy;
+
+  bool same(const point2_t<double>& p1, const point2_t<double>& p2) const
+  {
+    return ((p1[0] - p2[0]) < dy && (p2[0] - p1[0]) < dy) &&
+      ((p1[1] - p2[1]) < dx && (p2[1] - p1[1]) < dx);
+  }
+};
+
+// Tolerances of a grid, a small fraction of its first spacing
+inline point_tolerance_t grid_tolerance(const double* pY, const double* pX)
+{
+  return { 0.0001 * fabs(pX[1] - pX[0]), 0.0001 * fabs(pY[1] - pY[0]) };
+}
 
 template <typename T>
 inline bool operator!=(point2_t<T>, point2_t<T>);
@@ -81,13 +137,6 @@ template class array<point2_t<float>, 2>;
 template class array<point2_t<double>, 2>;
 }
 
-template <>
-inline bool operator==(point2_t<double> p1, point2_t<double> p2)
-{
-  return ((p1[0] - p2[0]) < g_dy && (p2[0] - p1[0]) < g_dy) &&
-    ((p1[1] - p2[1]) < g_dx && (p2[1] - p1[1]) < g_dx);
-}
-
 template <>
 inline bool operator!=(point2_t<double> p1, point2_t<double> p2)
 {
@@ -107,335 +156,2221 @@ inline bool operator<(const line2_t<double>& p1, const line2_t<double>& p2)
   return (p1[0] < p2[0]);
 }
 
-// Used by old Fortran subroutine - x is major index
-void segment_add(double x1, double y1, double x2, double y2, int level)
+template <typename T>
+int pack_output(const contour_list<contour_list<point2_t<double>>>& polygons, T** ppOutY,
+  size_t* nOutY, T** ppOutX, size_t* nOutX, size_t** nOutLengths, size_t* nOutSegments,
+  const contour_options_t* pOptions);
+
+int sort_segments(contour_vector<contour_list<line2_t<double>>>* segments,
+  const point_tolerance_t& tolerance, contour_list<contour_list<point2_t<double>>>* polygons,
+  size_t** nLevelSegments, size_t* pnLevels, contour_progress_t* pProgress = nullptr,
+  unsigned int nThreads = 1);
+
+unsigned int thread_count(const contour_options_t* pOptions);
+
+size_t stitch_level(contour_list<line2_t<double>>* segments, const point_tolerance_t& tolerance,
+  contour_list<contour_list<point2_t<double>>>* polygons, contour_progress_t* pProgress = nullptr);
+
+// Levels are connected in chunks of at most this many consecutive
+// segments. Segments are extracted row by row, so a chunk covers a
+// band of the grid.
+const size_t nConnectChunk = 512;
+
+// Ends and number of points of a polyline of a chunk, to be joined
+struct join_piece_t
 {
-  g_segments[level].push_back({ { { y1, x1 }, { y2, x2 } } });
-}
+  point2_t<double> front;
+  point2_t<double> back;
+  size_t nPoints;
+};
 
-void pack_output(const std::list<std::list<point2_t<double>>>& polygons, double** ppOutY,
-  size_t* nOutY, double** ppOutX, size_t* nOutX, size_t** nOutLengths, size_t* nOutSegments);
+// Piece of a joined polyline, in the order of the points
+struct join_step_t
+{
+  size_t iPiece;
+  bool bReversed;  // Points of the piece are reversed
+  bool bDropFirst; // First point (after reversal) is shared with the previous piece
+  bool bDropLast;  // Last point (after reversal) is shared with the next piece
+  bool bEnd;       // Last piece of the joined polyline
+};
 
-void sort_segments(std::vector<std::list<line2_t<double>>>* segments,
-  std::list<std::list<point2_t<double>>>* polygons, size_t** nLevelSegments, size_t* pnLevels);
+size_t plan_join(const contour_vector<join_piece_t>& pieces, size_t nChunks,
+  const point_tolerance_t& tolerance, contour_vector<join_step_t>* steps);
 
-// Another version for sorting
-void sort_segments2(std::vector<std::list<line2_t<double>>>* segments,
-  std::list<std::list<point2_t<double>>>* polygons, size_t** nLevelSegments, size_t* pnLevels);
+size_t connect_level(contour_list<line2_t<double>>* segments, const point_tolerance_t& tolerance,
+  contour_list<contour_list<point2_t<double>>>* polygons);
 
-int contours_internal(const double* pData, const size_t nYdata, const size_t nXdata,
-  const double* pY, const double* pX, const double* pLevels, const size_t nLevels, double** ppOutY,
-  double** ppOutX, size_t* nCoordinates, size_t** nOutLengths)
+// Quantizer for grid-aligned coordinates
+struct quantizer_t
 {
+  double x0;
+  double y0;
+  double xScale;
+  double yScale;
+};
 
-  int retval = -1;
-  // Clear old segments
-  g_segments.clear();
-  g_segments.resize(nLevels);
+int pack_output_quantized(const contour_list<contour_list<point2_t<double>>>& polygons,
+  const quantizer_t& quantizer, int** ppOutY, size_t* nOutY, int** ppOutX, size_t* nOutX,
+  size_t** nOutLengths, size_t* nOutSegments);
 
-  // Establish row pointers
-  double** ppData = new double*[nYdata];
-  for (size_t iY = 0; iY < nYdata; iY++)
-  {
-    ppData[iY] = const_cast<double*>(&pData[iY * nXdata]);
-  }
+int pack_output_encoded(const contour_list<contour_list<point2_t<double>>>& polygons,
+  const quantizer_t& quantizer, unsigned char** ppOutBytes, size_t* nOutBytes,
+  size_t** nOutLengths, size_t* nOutSegments);
 
-  int ilb = 0;
-  int iub = static_cast<int>(nYdata) - 1;
-  int jlb = 0;
-  int jub = static_cast<int>(nXdata) - 1;
+// Another version for sorting
+void sort_segments2(contour_vector<contour_list<line2_t<double>>>* segments,
+  const point_tolerance_t& tolerance, contour_list<contour_list<point2_t<double>>>* polygons,
+  size_t** nLevelSegments, size_t* pnLevels);
 
-  // Data is accessed according to ppData[i][j]
-  Contour(ppData, ilb, iub, jlb, jub, const_cast<double*>(pY), const_cast<double*>(pX),
-    static_cast<int>(nLevels), const_cast<double*>(pLevels), segment_add);
+int extract_segments(const double* pData, const size_t nYdata, const size_t nXdata,
+  const double* pY, const double* pX, const double* pLevels, const size_t nLevels,
+  const contour_options_t* pOptions, contour_vector<contour_list<line2_t<double>>>* segments)
+{
+  segments->clear();
+  segments->resize(nLevels);
 
-  delete[] ppData;
+  return contours_visit(pData, nYdata, nXdata, pY, nYdata, pX, nXdata, pLevels, nLevels, pOptions,
+    [segments](double x1, double y1, double x2, double y2, int level)
+    { (*segments)[level].push_back({ { { x1, y1 }, { x2, y2 } } }); });
+}
 
-  // For output - can be omitted for sorted algorithm
-  *nOutLengths = static_cast<size_t*>(malloc(nLevels * sizeof(size_t)));
+int contours_callback(const double* pData, const size_t nYdata, const size_t nXdata,
+  const double* pY, const size_t nY, const double* pX, const size_t nX, const double* pLevels,
+  const size_t nLevels, const contour_options_t* pOptions,
+  void (*pCallback)(double x1, double y1, double x2, double y2, int level, void* pUser),
+  void* pUser)
+{
+  if (!pCallback)
+  {
+    return -1;
+  }
+  return contour_nothrow(
+    [&]()
+    {
+      return contours_visit(pData, nYdata, nXdata, pY, nY, pX, nX, pLevels, nLevels, pOptions,
+        [pCallback, pUser](double x1, double y1, double x2, double y2, int level)
+        { pCallback(x1, y1, x2, y2, level, pUser); });
+    });
+}
 
-  if (*nOutLengths)
+// Writes output vertices in order, applying the transforms of the
+// options. Vertices for the callback are staged in small chunks, so
+// they are transformed and converted while still in cache.
+template <typename T>
+class vertex_writer_t
+{
+public:
+  vertex_writer_t(const contour_options_t* pOptions, T* pOutX, T* pOutY)
+    : m_pAffine(pOptions ? pOptions->pAffine : nullptr)
+    , m_pTransform(pOptions ? pOptions->pTransform : nullptr)
+    , m_pUser(pOptions ? pOptions->pTransformUser : nullptr)
+    , m_pOutX(pOutX)
+    , m_pOutY(pOutY)
+    , m_iPoint(0)
+    , m_nStaged(0)
   {
-    *nCoordinates = 0;
-    size_t iPoint = 0;
-    size_t nSegments;
+  }
 
-    for (size_t iLevel = 0; iLevel < nLevels; iLevel++)
+  void put(double x, double y)
+  {
+    if (m_pAffine)
     {
-      nSegments = g_segments[iLevel].size();
-      (*nOutLengths)[iLevel] = nSegments;
-      (*nCoordinates) += 2 * nSegments;
+      const double* a = m_pAffine;
+      const double x2 = a[0] * x + a[1] * y + a[2];
+      y = a[3] * x + a[4] * y + a[5];
+      x = x2;
     }
+    if (m_pTransform)
+    {
+      m_x[m_nStaged] = x;
+      m_y[m_nStaged] = y;
+      if (++m_nStaged == nChunk)
+      {
+        flush();
+      }
+      return;
+    }
+    m_pOutX[m_iPoint] = static_cast<T>(x);
+    m_pOutY[m_iPoint] = static_cast<T>(y);
+    m_iPoint++;
+  }
 
-    *ppOutX = static_cast<double*>(malloc((*nCoordinates) * sizeof(double)));
-    *ppOutY = static_cast<double*>(malloc((*nCoordinates) * sizeof(double)));
-
-    if (*ppOutX && *ppOutY)
+  // Must be called after the last vertex
+  void flush()
+  {
+    if (m_nStaged)
     {
-      for (size_t iLevel = 0; iLevel < nLevels; iLevel++)
+      m_pTransform(m_x, m_y, m_nStaged, m_pUser);
+      for (size_t i = 0; i < m_nStaged; i++)
       {
-        nSegments = g_segments[iLevel].size();
-        for (auto it : g_segments[iLevel])
-        {
-          (*ppOutX)[iPoint] = it[0][0];
-          (*ppOutY)[iPoint] = it[0][1];
-          iPoint++;
-          (*ppOutX)[iPoint] = it[1][0];
-          (*ppOutY)[iPoint] = it[1][1];
-          iPoint++;
-        }
+        m_pOutX[m_iPoint] = static_cast<T>(m_x[i]);
+        m_pOutY[m_iPoint] = static_cast<T>(m_y[i]);
+        m_iPoint++;
       }
-      retval = 0;
+      m_nStaged = 0;
     }
   }
-  return retval;
-}
 
-int contours(const double* pData, const size_t nYdata, const size_t nXdata, const double* pY,
-  const size_t nY, const double* pX, const size_t nX, const double* pLevels, const size_t nLevels,
-  double** ppOutY, size_t* nOutY, double** ppOutX, size_t* nOutX, size_t** nOutLengths,
-  size_t* nOutSegments)
-{
-  int retval = 0;
-  if (nXdata != nX || nYdata != nY || nLevels == 0 || nX == 0 || nY == 0)
+  // Vertices put so far, including staged ones
+  size_t size() const
   {
-    retval = -1;
-    *ppOutX = nullptr;
-    *nOutX = 0;
-    *ppOutY = nullptr;
-    *nOutY = 0;
-    *nOutLengths = nullptr;
-    *nOutSegments = 0;
+    return m_iPoint + m_nStaged;
   }
-  else
+
+  // Continue writing to moved output arrays
+  void rebind(T* pOutX, T* pOutY)
   {
-    size_t nCoordinates;
-    retval = contours_internal(
-      pData, nYdata, nXdata, pY, pX, pLevels, nLevels, ppOutY, ppOutX, &nCoordinates, nOutLengths);
+    m_pOutX = pOutX;
+    m_pOutY = pOutY;
+  }
 
-    *nOutX = nCoordinates;
-    *nOutY = nCoordinates;
-    *nOutSegments = nLevels;
+  // Drop written vertices beyond nPoints, must be called after flush()
+  void truncate(size_t nPoints)
+  {
+    m_iPoint = std::min(m_iPoint, nPoints);
   }
-  return retval;
-}
 
-int contours_sorted(const double* pData, const size_t nYdata, const size_t nXdata, const double* pY,
-  const size_t nY, const double* pX, const size_t nX, const double* pLevels, const size_t nLevels,
-  double** ppOutY, size_t* nOutY, double** ppOutX, size_t* nOutX, size_t** nOutLengths,
-  size_t* nOutSegments, // Length of segments
-  size_t** nLevelSegments, size_t* nLevels2)
-{ // Segments per level
-  // Return value
-  int retval = 0;
-  if (nXdata != nX || nYdata != nY || nLevels == 0 || nX == 0 || nY == 0)
+private:
+  static const size_t nChunk = 256;
+
+  const double* m_pAffine;
+  contour_transform_callback_t m_pTransform;
+  void* m_pUser;
+  T* m_pOutX;
+  T* m_pOutY;
+  size_t m_iPoint;
+  size_t m_nStaged;
+  double m_x[nChunk];
+  double m_y[nChunk];
+};
+
+// Temporary file, created on first use and removed when closed
+class spill_file_t
+{
+public:
+  spill_file_t()
+    : m_pFile(nullptr)
+    , m_nBytes(0)
   {
-    retval = -1;
-    *ppOutX = nullptr;
-    *nOutX = 0;
-    *ppOutY = nullptr;
-    *nOutY = 0;
-    *nOutLengths = nullptr;
-    *nOutSegments = 0;
-    *nLevelSegments = nullptr;
-    *nLevels2 = 0;
   }
-  else
+
+  ~spill_file_t()
   {
-    // TODO(JEM): Re-use stuff from contours_internal
+    if (m_pFile)
+    {
+      fclose(m_pFile);
+    }
+  }
 
-    // Clear old segments
-    g_segments.clear();
-    g_segments.resize(nLevels);
+  spill_file_t(const spill_file_t&) = delete;
+  spill_file_t& operator=(const spill_file_t&) = delete;
 
-    // Establish row pointers
-    double** ppData = new double*[nYdata];
-    for (size_t iY = 0; iY < nYdata; iY++)
+  // Append bytes, returns false on error
+  bool append(const void* pBytes, size_t nBytes, uint64_t* pOffset)
+  {
+    if (!m_pFile)
     {
-      ppData[iY] = const_cast<double*>(&pData[iY * nXdata]);
+      m_pFile = tmpfile();
     }
+    if (!m_pFile || seek(m_nBytes) != 0 || fwrite(pBytes, 1, nBytes, m_pFile) != nBytes)
+    {
+      return false;
+    }
+    *pOffset = m_nBytes;
+    m_nBytes += nBytes;
+    return true;
+  }
 
-    int ilb = 0;
-    int iub = static_cast<int>(nYdata) - 1;
-    int jlb = 0;
-    int jub = static_cast<int>(nXdata) - 1;
-
-    // Segment lengths vary - if we knew the kind, we could improve the ordering
-    g_dy = 0.0001 * fabs(pY[1] - pY[0]);
-    g_dx = 0.0001 * fabs(pX[1] - pX[0]);
+  bool read(uint64_t offset, void* pBytes, size_t nBytes)
+  {
+    return m_pFile && seek(offset) == 0 && fread(pBytes, 1, nBytes, m_pFile) == nBytes;
+  }
 
-    // Data is accessed according to ppData[i][j]
-    Contour(ppData, ilb, iub, jlb, jub, const_cast<double*>(pY), const_cast<double*>(pX),
-      static_cast<int>(nLevels), const_cast<double*>(pLevels), segment_add);
+  // Reuse the file from the start, later appends overwrite the bytes
+  void clear()
+  {
+    m_nBytes = 0;
+  }
 
-    delete[] ppData;
+private:
+  int seek(uint64_t offset)
+  {
+#ifdef _WIN32
+    return _fseeki64(m_pFile, static_cast<__int64>(offset), SEEK_SET);
+#else
+    return fseeko(m_pFile, static_cast<off_t>(offset), SEEK_SET);
+#endif
+  }
 
-    // Sort segments:
-    std::list<std::list<point2_t<double>>> polygons;
+  FILE* m_pFile;
+  uint64_t m_nBytes;
+};
 
-    sort_segments(&g_segments, &polygons, nLevelSegments, nLevels2);
+// Segments per level, written to a spill file in runs whenever the
+// buffered segments exceed a memory budget
+class segment_spill_t
+{
+public:
+  segment_spill_t(size_t nLevels, size_t nMaxBytes)
+    // Buffers may hold twice their size after growing
+    : m_nMaxSegments(std::max<size_t>(1, nMaxBytes / (2 * sizeof(line2_t<double>))))
+    , m_nBuffered(0)
+    , m_bGood(true)
+    , m_buffers(nLevels)
+    , m_runs(nLevels)
+    , m_counts(nLevels, 0)
+  {
+  }
 
-    // Create output
-    pack_output(polygons, ppOutY, nOutY, ppOutX, nOutX, nOutLengths, nOutSegments);
+  void add(int level, const line2_t<double>& segment)
+  {
+    m_buffers[level].push_back(segment);
+    m_counts[level]++;
+    if (++m_nBuffered >= m_nMaxSegments)
+    {
+      flush();
+    }
   }
-  return retval;
-}
 
-void pack_output(const std::list<std::list<point2_t<double>>>& polygons, double** ppOutY,
-  size_t* nOutY, double** ppOutX, size_t* nOutX, size_t** nOutLengths, size_t* nOutSegments)
-{
-  // Create output
-  size_t nCoordinates = 0;
+  bool good() const
+  {
+    return m_bGood;
+  }
 
-  size_t nSegments = polygons.size();
-  for (auto it2 : polygons)
+  size_t count(size_t iLevel) const
   {
-    nCoordinates += it2.size();
+    return m_counts[iLevel];
   }
 
-  *nOutX = nCoordinates;
-  *nOutY = nCoordinates;
-  *nOutSegments = nSegments;
+  // Pass the segments of a level to f in the order added, releasing them
+  template <typename F>
+  bool drain(size_t iLevel, F&& f)
+  {
+    const size_t nChunk = 4096;
+    contour_vector<line2_t<double>> chunk;
+    for (const run_t& run : m_runs[iLevel])
+    {
+      for (size_t iFirst = 0; iFirst < run.nSegments; iFirst += nChunk)
+      {
+        chunk.resize(std::min(nChunk, run.nSegments - iFirst));
+        if (!m_file.read(run.offset + iFirst * sizeof(line2_t<double>), chunk.data(),
+              chunk.size() * sizeof(line2_t<double>)))
+        {
+          return false;
+        }
+        for (const auto& segment : chunk)
+        {
+          f(segment);
+        }
+      }
+    }
+    for (const auto& segment : m_buffers[iLevel])
+    {
+      f(segment);
+    }
+    contour_vector<line2_t<double>>().swap(m_buffers[iLevel]);
+    m_runs[iLevel].clear();
+    return true;
+  }
 
-  *ppOutX = static_cast<double*>(malloc(nCoordinates * sizeof(double)));
-  *ppOutY = static_cast<double*>(malloc(nCoordinates * sizeof(double)));
-  *nOutLengths = static_cast<size_t*>(malloc(nSegments * sizeof(size_t)));
+private:
+  struct run_t
+  {
+    uint64_t offset;
+    size_t nSegments;
+  };
 
-  size_t iPoint = 0;
-  size_t iSegment = 0;
-  for (auto it2 : polygons)
+  void flush()
   {
-    (*nOutLengths)[iSegment] = it2.size();
-    for (auto it3 : it2)
+    for (size_t iLevel = 0; iLevel < m_buffers.size(); iLevel++)
     {
-      (*ppOutX)[iPoint] = it3[0];
-      (*ppOutY)[iPoint] = it3[1];
-      iPoint++;
+      auto& buffer = m_buffers[iLevel];
+      if (!buffer.empty())
+      {
+        run_t run = { 0, buffer.size() };
+        m_bGood = m_bGood &&
+          m_file.append(buffer.data(), buffer.size() * sizeof(line2_t<double>), &run.offset);
+        m_runs[iLevel].push_back(run);
+        contour_vector<line2_t<double>>().swap(buffer);
+      }
     }
-    iSegment++;
+    m_nBuffered = 0;
   }
-}
 
-void sort_segments(std::vector<std::list<line2_t<double>>>* segments,
-  std::list<std::list<point2_t<double>>>* polygons, size_t** nLevelSegments, size_t* pnLevels)
+  size_t m_nMaxSegments;
+  size_t m_nBuffered;
+  bool m_bGood;
+  spill_file_t m_file;
+  contour_vector<contour_vector<line2_t<double>>> m_buffers;
+  contour_vector<contour_vector<run_t>> m_runs;
+  contour_vector<size_t> m_counts;
+};
+
+int spill_segments(const double* pData, const size_t nYdata, const size_t nXdata,
+  const double* pY, const double* pX, const double* pLevels, const size_t nLevels,
+  const contour_options_t* pOptions, segment_spill_t* spill)
 {
-  size_t nLevels = segments->size();
-  *nLevelSegments = static_cast<size_t*>(malloc(nLevels * sizeof(size_t)));
-  *pnLevels = nLevels;
+  return contours_visit(pData, nYdata, nXdata, pY, nYdata, pX, nXdata, pLevels, nLevels, pOptions,
+    [spill](double x1, double y1, double x2, double y2, int level)
+    { spill->add(level, { { { x1, y1 }, { x2, y2 } } }); });
+}
 
-  for (size_t iLevel = 0; iLevel < nLevels; iLevel++)
+// Same output as contours_internal, spilling segments beyond pOptions->nMaxBytes
+template <typename T>
+int contours_spilled(const double* pData, const size_t nYdata, const size_t nXdata,
+  const double* pY, const double* pX, const double* pLevels, const size_t nLevels,
+  const contour_options_t* pOptions, T** ppOutY, T** ppOutX, size_t* nCoordinates,
+  size_t** nOutLengths)
+{
+  segment_spill_t spill(nLevels, pOptions->nMaxBytes);
+  const int retval =
+    spill_segments(pData, nYdata, nXdata, pY, pX, pLevels, nLevels, pOptions, &spill);
+  if (retval != 0)
   {
-    size_t nPolygons = 0;
-    auto it0 = (*segments)[iLevel].begin();
+    *ppOutX = nullptr;
+    *ppOutY = nullptr;
+    *nOutLengths = nullptr;
+    *nCoordinates = 0;
+    return retval;
+  }
 
-    while (it0 != (*segments)[iLevel].end())
+  *nCoordinates = 0;
+  *nOutLengths = contour_alloc_array<size_t>(nLevels);
+  if (*nOutLengths)
+  {
+    for (size_t iLevel = 0; iLevel < nLevels; iLevel++)
     {
-      auto seg = *it0;
+      (*nOutLengths)[iLevel] = spill.count(iLevel);
+      *nCoordinates += 2 * spill.count(iLevel);
+    }
+  }
+  *ppOutX = contour_alloc_array<T>(*nCoordinates);
+  *ppOutY = contour_alloc_array<T>(*nCoordinates);
+
+  bool bGood = spill.good() && *nOutLengths && ((*ppOutX && *ppOutY) || *nCoordinates == 0);
+  vertex_writer_t<T> writer(pOptions, *ppOutX, *ppOutY);
+  for (size_t iLevel = 0; bGood && iLevel < nLevels; iLevel++)
+  {
+    bGood = spill.drain(iLevel,
+      [&writer](const line2_t<double>& segment)
+      {
+        writer.put(segment[0][0], segment[0][1]);
+        writer.put(segment[1][0], segment[1][1]);
+      });
+  }
+  if (bGood)
+  {
+    writer.flush();
+  }
 
-      it0 = (*segments)[iLevel].erase(it0);
+  if (!bGood)
+  {
+    contour_deallocate(*ppOutX);
+    contour_deallocate(*ppOutY);
+    contour_deallocate(*nOutLengths);
+    *ppOutX = nullptr;
+    *ppOutY = nullptr;
+    *nOutLengths = nullptr;
+    *nCoordinates = 0;
+    return -1;
+  }
+  return 0;
+}
 
-      // Polygon with one edge
-      std::list<point2_t<double>> polygon;
-      polygon.push_back(seg[0]);
-      polygon.push_back(seg[1]);
+// Same output as sorted_polygons followed by pack_output. A level is
+// drained from the spill in chunks of consecutive segments as they are
+// split by sort_segments(). The polylines of each chunk are spilled as
+// pieces, joined by their ends as planned by plan_join(), and the
+// joined polylines spilled until they are packed.
+template <typename T>
+int contours_sorted_spilled(const double* pData, const size_t nYdata, const size_t nXdata,
+  const double* pY, const double* pX, const double* pLevels, const size_t nLevels,
+  const contour_options_t* pOptions, T** ppOutY, size_t* nOutY, T** ppOutX, size_t* nOutX,
+  size_t** nOutLengths, size_t* nOutSegments, size_t** nLevelSegments, size_t* nLevels2)
+{
+  const point_tolerance_t tolerance = grid_tolerance(pY, pX);
 
-      // Add polygon to list
-      polygons->push_back(polygon);
+  segment_spill_t spill(nLevels, pOptions->nMaxBytes);
+  const int retval =
+    spill_segments(pData, nYdata, nXdata, pY, pX, pLevels, nLevels, pOptions, &spill);
 
-      // Check for more edges
-      auto it1 = it0;
+  contour_progress_t progress(pOptions);
+  size_t nSegments = 0;
+  for (size_t iLevel = 0; iLevel < nLevels; iLevel++)
+  {
+    nSegments += spill.count(iLevel);
+  }
+  progress.begin(CONTOUR_PHASE_CONNECT, nSegments);
 
-      while (true)
+  // Pieces and joined polylines as (x, y) pairs
+  spill_file_t pieceFile;
+  spill_file_t polylines;
+  contour_vector<size_t> lengths;
+  contour_vector<size_t> levelSegments(nLevels);
+  contour_vector<join_piece_t> pieces;
+  contour_vector<uint64_t> offsets;
+  contour_vector<join_step_t> steps;
+  contour_vector<point2_t<double>> points;
+  contour_list<line2_t<double>> chunk;
+  size_t nDone = 0;
+  bool bGood = retval == 0 && spill.good();
+  for (size_t iLevel = 0; bGood && iLevel < nLevels; iLevel++)
+  {
+    pieceFile.clear();
+    pieces.clear();
+    offsets.clear();
+    size_t nChunks = 0;
+    auto connect = [&]()
+    {
+      contour_list<contour_list<point2_t<double>>> polygons;
+      nDone += chunk.size();
+      stitch_level(&chunk, tolerance, &polygons);
+      nChunks++;
+      for (const auto& polygon : polygons)
       {
-        size_t nSegmentsLeft = (*segments)[iLevel].size();
-
-        while (it1 != (*segments)[iLevel].end())
-        {
-          auto& poly = polygons->back();
-          seg = *it1;
-          if (seg[0] == poly.back())
-          {
-            poly.push_back(seg[1]);
-            (*segments)[iLevel].erase(it1);
-            it1 = (*segments)[iLevel].begin();
-            break; // Start again at the beginning
-          }
-          else if (seg[1] == poly.back())
-          {
-            poly.push_back(seg[0]);
-            (*segments)[iLevel].erase(it1);
-            it1 = (*segments)[iLevel].begin();
-            break; // Start again at the beginning
-          }
-          else if (seg[0] == poly.front())
-          {
-            poly.push_front(seg[1]);
-            (*segments)[iLevel].erase(it1);
-            it1 = (*segments)[iLevel].begin();
-            break; // Start again at the beginning
-          }
-          else if (seg[1] == poly.front())
-          {
-            poly.push_front(seg[0]);
-            (*segments)[iLevel].erase(it1);
-            it1 = (*segments)[iLevel].begin();
-            break; // Start again at the beginning
-          }
-          else
-          {
-            it1++;
-          }
-        }
-        if (nSegmentsLeft == (*segments)[iLevel].size())
+        points.assign(polygon.begin(), polygon.end());
+        uint64_t offset = 0;
+        bGood = bGood &&
+          pieceFile.append(points.data(), points.size() * sizeof(point2_t<double>), &offset);
+        pieces.push_back({ polygon.front(), polygon.back(), polygon.size() });
+        offsets.push_back(offset);
+      }
+      bGood = bGood && progress.update(nDone);
+    };
+    const bool bDrained = spill.drain(iLevel,
+      [&](const line2_t<double>& segment)
+      {
+        chunk.push_back(segment);
+        if (chunk.size() == nConnectChunk && bGood)
         {
-          // Done with polygon
-          nPolygons++;
-          break;
+          connect();
         }
-      }
-      if (!(*segments)[iLevel].empty())
+      });
+    bGood = bGood && bDrained;
+    if (bGood && (!chunk.empty() || nChunks == 0))
+    {
+      connect();
+    }
+    chunk.clear();
+
+    steps.clear();
+    levelSegments[iLevel] = bGood ? plan_join(pieces, nChunks, tolerance, &steps) : 0;
+    size_t nPoints = 0;
+    for (size_t iStep = 0; bGood && iStep < steps.size(); iStep++)
+    {
+      const join_step_t& step = steps[iStep];
+      const join_piece_t& piece = pieces[step.iPiece];
+      points.resize(piece.nPoints);
+      bGood = pieceFile.read(
+        offsets[step.iPiece], points.data(), piece.nPoints * sizeof(point2_t<double>));
+      if (step.bReversed)
       {
-        // Old iterator may point to element, which has been
-        // erased, so we cannot simply increment it
-        it0 = (*segments)[iLevel].begin();
+        std::reverse(points.begin(), points.end());
       }
-      else
+      const size_t iBegin = step.bDropFirst ? 1 : 0;
+      const size_t iEnd = piece.nPoints - (step.bDropLast ? 1 : 0);
+      uint64_t offset = 0;
+      bGood = bGood &&
+        polylines.append(
+          points.data() + iBegin, (iEnd - iBegin) * sizeof(point2_t<double>), &offset);
+      nPoints += iEnd - iBegin;
+      if (step.bEnd)
       {
-        break;
+        lengths.push_back(nPoints);
+        nPoints = 0;
       }
     }
-    (*nLevelSegments)[iLevel] = nPolygons;
   }
-}
+  contour_vector<point2_t<double>>().swap(points);
+  bGood = bGood && progress.update(nSegments);
 
-// Algorithm from Bjorn Harpe
-class CContour
-{
-public:
-  CContour()
-    : m_contour()
-    , m_begin()
-    , m_end()
+  size_t nCoordinates = 0;
+  for (size_t length : lengths)
   {
+    nCoordinates += length;
   }
-  int add_vector(const point2_t<double>& p1, const point2_t<double>& p2)
+
+  *ppOutX = contour_alloc_array<T>(nCoordinates);
+  *ppOutY = contour_alloc_array<T>(nCoordinates);
+  *nOutLengths = contour_alloc_array<size_t>(lengths.size());
+  *nLevelSegments = contour_alloc_array<size_t>(nLevels);
+  bGood = bGood && ((*ppOutX && *ppOutY) || nCoordinates == 0) &&
+    (*nOutLengths || lengths.empty()) && *nLevelSegments;
+
+  // Stream the polylines into the output
+  const size_t nChunk = 8192;
+  points.clear();
+  vertex_writer_t<T> writer(pOptions, *ppOutX, *ppOutY);
+  for (size_t iFirst = 0; bGood && iFirst < nCoordinates; iFirst += nChunk)
   {
-    point2_t<double> v;
-    v[0] = p2[0] - p1[0];
-    v[1] = p2[1] - p1[1];
-    if (m_contour.empty())
+    points.resize(std::min(nChunk, nCoordinates - iFirst));
+    bGood = polylines.read(iFirst * sizeof(point2_t<double>), points.data(),
+      points.size() * sizeof(point2_t<double>));
+    for (size_t iPoint = 0; bGood && iPoint < points.size(); iPoint++)
     {
-      m_begin = p1;
+      writer.put(points[iPoint][0], points[iPoint][1]);
     }
-    m_contour.push_back(v);
-    m_end = p2;
-    return 0;
+  }
+  if (bGood)
+  {
+    writer.flush();
   }
 
-  int reverse()
+  if (!bGood)
   {
-#if 0 // defined(_MSC_VER) && (_MSC_VER >= 1914)
-    point2_t<double> temp;
+    contour_deallocate(*ppOutX);
+    contour_deallocate(*ppOutY);
+    contour_deallocate(*nOutLengths);
+    contour_deallocate(*nLevelSegments);
+    *ppOutX = nullptr;
+    *nOutX = 0;
+    *ppOutY = nullptr;
+    *nOutY = 0;
+    *nOutLengths = nullptr;
+    *nOutSegments = 0;
+    *nLevelSegments = nullptr;
+    *nLevels2 = 0;
+    return retval != 0 ? retval : progress.cancelled() ? CONTOUR_CANCELLED : -1;
+  }
+
+  std::copy(lengths.begin(), lengths.end(), *nOutLengths);
+  std::copy(levelSegments.begin(), levelSegments.end(), *nLevelSegments);
+  *nOutX = nCoordinates;
+  *nOutY = nCoordinates;
+  *nOutSegments = lengths.size();
+  *nLevels2 = nLevels;
+  return 0;
+}
+
+// Receives the traced lines of level_tracer_t, dropping repeated
+// points and clipping to the clip box of the options, and writes the
+// polylines directly to output arrays grown as needed
+template <typename T>
+class traced_output_t
+{
+public:
+  explicit traced_output_t(const contour_options_t* pOptions)
+    : m_pClip(pOptions ? pOptions->pClip : nullptr)
+    , m_writer(pOptions, nullptr, nullptr)
+    , m_pX(nullptr)
+    , m_pY(nullptr)
+    , m_nCapacity(0)
+    , m_bGood(true)
+    , m_bOpen(false)
+    , m_bFirst(false)
+    , m_bFromStart(false)
+    , m_iFirstPolyline(0)
+    , m_iFirstPoint(0)
+    , m_x(0.0)
+    , m_y(0.0)
+  {
+  }
+
+  ~traced_output_t()
+  {
+    contour_deallocate(m_pX);
+    contour_deallocate(m_pY);
+  }
+
+  void begin()
+  {
+    m_bFirst = true;
+    m_bFromStart = false;
+    m_iFirstPolyline = m_lengths.size();
+    m_iFirstPoint = m_writer.size();
+  }
+
+  void put(double x, double y, uint64_t)
+  {
+    if (m_bFirst)
+    {
+      if (!m_pClip || (x >= m_pClip[0] && x <= m_pClip[2] && y >= m_pClip[1] && y <= m_pClip[3]))
+      {
+        start(x, y);
+        m_bFromStart = true;
+      }
+    }
+    else if (x == m_x && y == m_y)
+    {
+      return;
+    }
+    else if (!m_pClip)
+    {
+      append(x, y);
+    }
+    else
+    {
+      double x1 = m_x;
+      double y1 = m_y;
+      double x2 = x;
+      double y2 = y;
+      if (clip_segment(m_pClip, &x1, &y1, &x2, &y2))
+      {
+        if (!m_bOpen || x1 != m_x || y1 != m_y)
+        {
+          finish();
+          start(x1, y1);
+        }
+        append(x2, y2);
+        if (x2 != x || y2 != y)
+        {
+          finish();
+        }
+      }
+      else
+      {
+        finish();
+      }
+    }
+    m_bFirst = false;
+    m_x = x;
+    m_y = y;
+  }
+
+  void end(bool bClosed)
+  {
+    const bool bOpen = m_bOpen;
+    finish();
+
+    // Join the ends of a closed line split by the clip box
+    const size_t nPolylines = m_lengths.size() - m_iFirstPolyline;
+    if (bClosed && bOpen && m_bFromStart && nPolylines > 1 && m_bGood)
+    {
+      m_writer.flush();
+      const size_t nPoints = m_writer.size();
+      const size_t nLast = m_lengths.back();
+      m_lengths.pop_back();
+      std::rotate(m_pX + m_iFirstPoint, m_pX + nPoints - nLast, m_pX + nPoints - 1);
+      std::rotate(m_pY + m_iFirstPoint, m_pY + nPoints - nLast, m_pY + nPoints - 1);
+      m_writer.truncate(nPoints - 1);
+      m_lengths[m_iFirstPolyline] += nLast - 1;
+    }
+  }
+
+  bool good() const
+  {
+    return m_bGood;
+  }
+
+  // Polylines so far
+  size_t polylines() const
+  {
+    return m_lengths.size();
+  }
+
+  // Move the output to the caller, shrinking the arrays. Returns false,
+  // leaving the outputs untouched, if the lengths cannot be allocated.
+  bool release(T** ppOutY, size_t* nOutY, T** ppOutX, size_t* nOutX, size_t** nOutLengths,
+    size_t* nOutSegments)
+  {
+    size_t* pLengths = contour_alloc_array<size_t>(m_lengths.size());
+    if (!pLengths)
+    {
+      return false;
+    }
+    std::copy(m_lengths.begin(), m_lengths.end(), pLengths);
+    *nOutLengths = pLengths;
+    *nOutSegments = m_lengths.size();
+
+    m_writer.flush();
+    const size_t nPoints = m_writer.size();
+    shrink(&m_pX, nPoints);
+    shrink(&m_pY, nPoints);
+    *ppOutX = m_pX;
+    *ppOutY = m_pY;
+    *nOutX = nPoints;
+    *nOutY = nPoints;
+    m_pX = nullptr;
+    m_pY = nullptr;
+    return true;
+  }
+
+private:
+  void start(double x, double y)
+  {
+    m_bOpen = true;
+    m_lengths.push_back(0);
+    append(x, y);
+  }
+
+  void append(double x, double y)
+  {
+    if (m_writer.size() == m_nCapacity)
+    {
+      grow();
+    }
+    if (m_bGood)
+    {
+      m_writer.put(x, y);
+      m_lengths.back()++;
+    }
+  }
+
+  // Close the current polyline, dropping it if it has a single point
+  void finish()
+  {
+    if (m_bOpen && m_lengths.back() < 2)
+    {
+      m_bFromStart = m_bFromStart && m_lengths.size() - 1 > m_iFirstPolyline;
+      m_writer.flush();
+      m_writer.truncate(m_writer.size() - m_lengths.back());
+      m_lengths.pop_back();
+    }
+    m_bOpen = false;
+  }
+
+  void grow()
+  {
+    const size_t nCapacity = std::max<size_t>(4096, 2 * m_nCapacity);
+    T* pX = resize(m_pX, nCapacity);
+    if (pX)
+    {
+      m_pX = pX;
+    }
+    T* pY = pX ? resize(m_pY, nCapacity) : nullptr;
+    if (pY)
+    {
+      m_pY = pY;
+    }
+    m_bGood = pX && pY;
+    if (m_bGood)
+    {
+      m_nCapacity = nCapacity;
+      m_writer.rebind(m_pX, m_pY);
+    }
+  }
+
+  // Reallocate, copying if the allocator cannot resize
+  T* resize(T* p, size_t n)
+  {
+    T* pResized =
+      p ? static_cast<T*>(contour_reallocate(p, n * sizeof(T), alignof(T))) : nullptr;
+    if (!pResized)
+    {
+      pResized = contour_alloc_array<T>(n);
+      if (pResized && p)
+      {
+        std::copy(p, p + std::min(n, m_nCapacity), pResized);
+        contour_deallocate(p);
+      }
+    }
+    return pResized;
+  }
+
+  static void shrink(T** pp, size_t n)
+  {
+    T* p = *pp ? static_cast<T*>(contour_reallocate(*pp, n * sizeof(T), alignof(T))) : nullptr;
+    if (p)
+    {
+      *pp = p;
+    }
+  }
+
+  const double* m_pClip;
+  vertex_writer_t<T> m_writer;
+  T* m_pX;
+  T* m_pY;
+  size_t m_nCapacity;
+  contour_vector<size_t> m_lengths;
+  bool m_bGood;
+  bool m_bOpen;
+  bool m_bFirst;
+  bool m_bFromStart;
+  size_t m_iFirstPolyline;
+  size_t m_iFirstPoint;
+  double m_x;
+  double m_y;
+};
+
+// Same output layout as sorted_polygons followed by pack_output,
+// tracing the lines of each level without storing any segments
+template <typename T>
+int contours_sorted_traced(const double* pData, const size_t nYdata, const size_t nXdata,
+  const double* pY, const double* pX, const double* pLevels, const size_t nLevels,
+  const contour_options_t* pOptions, T** ppOutY, size_t* nOutY, T** ppOutX, size_t* nOutX,
+  size_t** nOutLengths, size_t* nOutSegments, size_t** nLevelSegments, size_t* nLevels2)
+{
+  *ppOutX = nullptr;
+  *nOutX = 0;
+  *ppOutY = nullptr;
+  *nOutY = 0;
+  *nOutLengths = nullptr;
+  *nOutSegments = 0;
+  *nLevelSegments = nullptr;
+  *nLevels2 = 0;
+
+  cell_window_t window;
+  if (!get_cell_window(nYdata, nXdata, pOptions, &window))
+  {
+    return -1;
+  }
+  const double* pClip = pOptions->pClip;
+  if (pClip)
+  {
+    clip_cell_range(pY, pClip[1], pClip[3], &window.iRowBegin, &window.iRowEnd);
+    clip_cell_range(pX, pClip[0], pClip[2], &window.iColumnBegin, &window.iColumnEnd);
+  }
+
+  cell_mask_t mask;
+  const bool bMask = build_cell_mask(pData, nXdata, window, pOptions, &mask);
+
+  contour_vector<const double*> rows(nYdata);
+  for (size_t iY = window.iRowBegin; iY < window.iRowEnd; iY++)
+  {
+    rows[iY] = &pData[iY * nXdata];
+  }
+
+  // Polled before each row of each level
+  const size_t nLines = window.rows() * nLevels;
+  contour_progress_t progress(pOptions);
+  progress.begin(CONTOUR_PHASE_EXTRACT, nLines);
+  size_t nLinesDone = 0;
+
+  contour_vector<uint64_t> visited;
+  contour_vector<size_t> levelSegments(nLevels);
+  level_tracer_t tracer(
+    rows.data(), bMask ? mask.rows.data() : nullptr, window, pY, pX, &visited);
+  traced_output_t<T> output(pOptions);
+  for (size_t iLevel = 0; iLevel < nLevels && output.good(); iLevel++)
+  {
+    const size_t nPolylines = output.polylines();
+    if (!tracer.trace(pLevels[iLevel],
+          [&progress, &nLinesDone]() { return progress.update(nLinesDone++); }, output))
+    {
+      return CONTOUR_CANCELLED;
+    }
+    levelSegments[iLevel] = output.polylines() - nPolylines;
+  }
+  if (!output.good())
+  {
+    return -1;
+  }
+  if (!progress.update(nLines))
+  {
+    return CONTOUR_CANCELLED;
+  }
+
+  // The vertex arrays of the output are freed with it on failure
+  size_t* pLevelSegments = contour_alloc_array<size_t>(nLevels);
+  if (!pLevelSegments)
+  {
+    return -1;
+  }
+  if (!output.release(ppOutY, nOutY, ppOutX, nOutX, nOutLengths, nOutSegments))
+  {
+    contour_deallocate(pLevelSegments);
+    return -1;
+  }
+  std::copy(levelSegments.begin(), levelSegments.end(), pLevelSegments);
+  *nLevelSegments = pLevelSegments;
+  *nLevels2 = nLevels;
+  return 0;
+}
+
+template <typename T>
+int contours_internal(const double* pData, const size_t nYdata, const size_t nXdata,
+  const double* pY, const double* pX, const double* pLevels, const size_t nLevels,
+  const contour_options_t* pOptions, T** ppOutY, T** ppOutX, size_t* nCoordinates,
+  size_t** nOutLengths)
+{
+
+  contour_vector<contour_list<line2_t<double>>> segments;
+  int retval =
+    extract_segments(pData, nYdata, nXdata, pY, pX, pLevels, nLevels, pOptions, &segments);
+  if (retval != 0)
+  {
+    *ppOutX = nullptr;
+    *ppOutY = nullptr;
+    *nOutLengths = nullptr;
+    *nCoordinates = 0;
+    return retval;
+  }
+
+  size_t nCoordinates2 = 0;
+  for (size_t iLevel = 0; iLevel < nLevels; iLevel++)
+  {
+    nCoordinates2 += 2 * segments[iLevel].size();
+  }
+
+  // For output - can be omitted for sorted algorithm
+  *nOutLengths = contour_alloc_array<size_t>(nLevels);
+  *ppOutX = contour_alloc_array<T>(nCoordinates2);
+  *ppOutY = contour_alloc_array<T>(nCoordinates2);
+  if (!*nOutLengths || !*ppOutX || !*ppOutY)
+  {
+    contour_deallocate(*ppOutX);
+    contour_deallocate(*ppOutY);
+    contour_deallocate(*nOutLengths);
+    *ppOutX = nullptr;
+    *ppOutY = nullptr;
+    *nOutLengths = nullptr;
+    *nCoordinates = 0;
+    return -1;
+  }
+
+  vertex_writer_t<T> writer(pOptions, *ppOutX, *ppOutY);
+  for (size_t iLevel = 0; iLevel < nLevels; iLevel++)
+  {
+    (*nOutLengths)[iLevel] = segments[iLevel].size();
+    for (const auto& it : segments[iLevel])
+    {
+      writer.put(it[0][0], it[0][1]);
+      writer.put(it[1][0], it[1][1]);
+    }
+  }
+  writer.flush();
+  *nCoordinates = nCoordinates2;
+  return 0;
+}
+
+int contours(const double* pData, const size_t nYdata, const size_t nXdata, const double* pY,
+  const size_t nY, const double* pX, const size_t nX, const double* pLevels, const size_t nLevels,
+  double** ppOutY, size_t* nOutY, double** ppOutX, size_t* nOutX, size_t** nOutLengths,
+  size_t* nOutSegments)
+{
+  return contours_ex(pData, nYdata, nXdata, pY, nY, pX, nX, pLevels, nLevels, nullptr, ppOutY,
+    nOutY, ppOutX, nOutX, nOutLengths, nOutSegments);
+}
+
+template <typename T>
+int contours_ex_impl(const double* pData, const size_t nYdata, const size_t nXdata,
+  const double* pY, const size_t nY, const double* pX, const size_t nX, const double* pLevels,
+  const size_t nLevels, const contour_options_t* pOptions, T** ppOutY, size_t* nOutY, T** ppOutX,
+  size_t* nOutX, size_t** nOutLengths, size_t* nOutSegments)
+{
+  int retval = 0;
+  if (nXdata != nX || nYdata != nY || nLevels == 0 || nX == 0 || nY == 0)
+  {
+    retval = -1;
+    *ppOutX = nullptr;
+    *nOutX = 0;
+    *ppOutY = nullptr;
+    *nOutY = 0;
+    *nOutLengths = nullptr;
+    *nOutSegments = 0;
+  }
+  else
+  {
+    size_t nCoordinates = 0;
+    if (pOptions && pOptions->nMaxBytes)
+    {
+      retval = contours_spilled(pData, nYdata, nXdata, pY, pX, pLevels, nLevels, pOptions, ppOutY,
+        ppOutX, &nCoordinates, nOutLengths);
+    }
+    else
+    {
+      retval = contours_internal(pData, nYdata, nXdata, pY, pX, pLevels, nLevels, pOptions,
+        ppOutY, ppOutX, &nCoordinates, nOutLengths);
+    }
+
+    // Both leave the arrays NULL on failure
+    *nOutX = nCoordinates;
+    *nOutY = nCoordinates;
+    *nOutSegments = retval == 0 ? nLevels : 0;
+  }
+  return retval;
+}
+
+int contours_ex(const double* pData, const size_t nYdata, const size_t nXdata, const double* pY,
+  const size_t nY, const double* pX, const size_t nX, const double* pLevels, const size_t nLevels,
+  const contour_options_t* pOptions, double** ppOutY, size_t* nOutY, double** ppOutX, size_t* nOutX,
+  size_t** nOutLengths, size_t* nOutSegments)
+{
+  return contour_nothrow(
+    [&]()
+    {
+      return contours_ex_impl(pData, nYdata, nXdata, pY, nY, pX, nX, pLevels, nLevels, pOptions,
+        ppOutY, nOutY, ppOutX, nOutX, nOutLengths, nOutSegments);
+    },
+    ppOutY, nOutY, ppOutX, nOutX, nOutLengths, nOutSegments);
+}
+
+int contours_float(const double* pData, const size_t nYdata, const size_t nXdata, const double* pY,
+  const size_t nY, const double* pX, const size_t nX, const double* pLevels, const size_t nLevels,
+  const contour_options_t* pOptions, float** ppOutY, size_t* nOutY, float** ppOutX, size_t* nOutX,
+  size_t** nOutLengths, size_t* nOutSegments)
+{
+  return contour_nothrow(
+    [&]()
+    {
+      return contours_ex_impl(pData, nYdata, nXdata, pY, nY, pX, nX, pLevels, nLevels, pOptions,
+        ppOutY, nOutY, ppOutX, nOutX, nOutLengths, nOutSegments);
+    },
+    ppOutY, nOutY, ppOutX, nOutX, nOutLengths, nOutSegments);
+}
+
+int sorted_polygons(const double* pData, const size_t nYdata, const size_t nXdata,
+  const double* pY, const double* pX, const double* pLevels, const size_t nLevels,
+  const contour_options_t* pOptions, contour_list<contour_list<point2_t<double>>>* polygons,
+  size_t** nLevelSegments, size_t* nLevels2)
+{
+  contour_vector<contour_list<line2_t<double>>> segments;
+  int retval =
+    extract_segments(pData, nYdata, nXdata, pY, pX, pLevels, nLevels, pOptions, &segments);
+  if (retval != 0)
+  {
+    *nLevelSegments = nullptr;
+    *nLevels2 = 0;
+    return retval;
+  }
+
+  contour_progress_t progress(pOptions);
+  return sort_segments(&segments, grid_tolerance(pY, pX), polygons, nLevelSegments, nLevels2,
+    &progress, thread_count(pOptions));
+}
+
+int contours_sorted(const double* pData, const size_t nYdata, const size_t nXdata, const double* pY,
+  const size_t nY, const double* pX, const size_t nX, const double* pLevels, const size_t nLevels,
+  double** ppOutY, size_t* nOutY, double** ppOutX, size_t* nOutX, size_t** nOutLengths,
+  size_t* nOutSegments, // Length of segments
+  size_t** nLevelSegments, size_t* nLevels2)
+{ // Segments per level
+  return contours_sorted_ex(pData, nYdata, nXdata, pY, nY, pX, nX, pLevels, nLevels, nullptr,
+    ppOutY, nOutY, ppOutX, nOutX, nOutLengths, nOutSegments, nLevelSegments, nLevels2);
+}
+
+template <typename T>
+int contours_sorted_ex_impl(const double* pData, const size_t nYdata, const size_t nXdata,
+  const double* pY, const size_t nY, const double* pX, const size_t nX, const double* pLevels,
+  const size_t nLevels, const contour_options_t* pOptions, T** ppOutY, size_t* nOutY, T** ppOutX,
+  size_t* nOutX, size_t** nOutLengths, size_t* nOutSegments, size_t** nLevelSegments,
+  size_t* nLevels2)
+{
+  // Return value
+  int retval = 0;
+  if (nXdata != nX || nYdata != nY || nLevels == 0 || nX == 0 || nY == 0)
+  {
+    retval = -1;
+    *ppOutX = nullptr;
+    *nOutX = 0;
+    *ppOutY = nullptr;
+    *nOutY = 0;
+    *nOutLengths = nullptr;
+    *nOutSegments = 0;
+    *nLevelSegments = nullptr;
+    *nLevels2 = 0;
+  }
+  else if (pOptions && pOptions->eEngine == CONTOUR_ENGINE_TRACE)
+  {
+    retval = contours_sorted_traced(pData, nYdata, nXdata, pY, pX, pLevels, nLevels, pOptions,
+      ppOutY, nOutY, ppOutX, nOutX, nOutLengths, nOutSegments, nLevelSegments, nLevels2);
+  }
+  else if (pOptions && pOptions->nMaxBytes)
+  {
+    retval = contours_sorted_spilled(pData, nYdata, nXdata, pY, pX, pLevels, nLevels, pOptions,
+      ppOutY, nOutY, ppOutX, nOutX, nOutLengths, nOutSegments, nLevelSegments, nLevels2);
+  }
+  else
+  {
+    // Sort segments:
+    contour_list<contour_list<point2_t<double>>> polygons;
+
+    retval = sorted_polygons(pData, nYdata, nXdata, pY, pX, pLevels, nLevels, pOptions,
+      &polygons, nLevelSegments, nLevels2);
+
+    if (retval == 0)
+    {
+      // Create output
+      retval =
+        pack_output(polygons, ppOutY, nOutY, ppOutX, nOutX, nOutLengths, nOutSegments, pOptions);
+      if (retval != 0)
+      {
+        contour_deallocate(*nLevelSegments);
+        *nLevelSegments = nullptr;
+        *nLevels2 = 0;
+      }
+    }
+    else
+    {
+      *ppOutX = nullptr;
+      *nOutX = 0;
+      *ppOutY = nullptr;
+      *nOutY = 0;
+      *nOutLengths = nullptr;
+      *nOutSegments = 0;
+    }
+  }
+  return retval;
+}
+
+int contours_sorted_ex(const double* pData, const size_t nYdata, const size_t nXdata,
+  const double* pY, const size_t nY, const double* pX, const size_t nX, const double* pLevels,
+  const size_t nLevels, const contour_options_t* pOptions, double** ppOutY, size_t* nOutY,
+  double** ppOutX, size_t* nOutX, size_t** nOutLengths, size_t* nOutSegments,
+  size_t** nLevelSegments, size_t* nLevels2)
+{
+  return contour_nothrow(
+    [&]()
+    {
+      return contours_sorted_ex_impl(pData, nYdata, nXdata, pY, nY, pX, nX, pLevels, nLevels,
+        pOptions, ppOutY, nOutY, ppOutX, nOutX, nOutLengths, nOutSegments, nLevelSegments,
+        nLevels2);
+    },
+    ppOutY, nOutY, ppOutX, nOutX, nOutLengths, nOutSegments, nLevelSegments, nLevels2);
+}
+
+int contours_sorted_float(const double* pData, const size_t nYdata, const size_t nXdata,
+  const double* pY, const size_t nY, const double* pX, const size_t nX, const double* pLevels,
+  const size_t nLevels, const contour_options_t* pOptions, float** ppOutY, size_t* nOutY,
+  float** ppOutX, size_t* nOutX, size_t** nOutLengths, size_t* nOutSegments,
+  size_t** nLevelSegments, size_t* nLevels2)
+{
+  return contour_nothrow(
+    [&]()
+    {
+      return contours_sorted_ex_impl(pData, nYdata, nXdata, pY, nY, pX, nX, pLevels, nLevels,
+        pOptions, ppOutY, nOutY, ppOutX, nOutX, nOutLengths, nOutSegments, nLevelSegments,
+        nLevels2);
+    },
+    ppOutY, nOutY, ppOutX, nOutX, nOutLengths, nOutSegments, nLevelSegments, nLevels2);
+}
+
+// State of a level of a result
+enum level_state_t : char
+{
+  LEVEL_PENDING,
+  LEVEL_STITCHED,
+  // Connecting ran out of memory after consuming the segments
+  LEVEL_FAILED
+};
+
+// Extracted segments, connected per level on request
+struct contour_result
+{
+  point_tolerance_t tolerance;
+  contour_vector<contour_list<line2_t<double>>> segments;
+  contour_vector<level_state_t> states;
+
+  // Polylines of a level, packed
+  struct level_t
+  {
+    contour_vector<double> y;
+    contour_vector<double> x;
+    contour_vector<size_t> starts;
+  };
+  contour_vector<level_t> levels;
+};
+
+// Connect and pack the segments of a level, if not done already. Returns
+// nullptr if the level is invalid or could not be connected.
+const contour_result::level_t* result_level(contour_result_t* pResult, size_t iLevel) noexcept
+{
+  if (iLevel >= pResult->levels.size())
+  {
+    return nullptr;
+  }
+  contour_result::level_t& level = pResult->levels[iLevel];
+  if (pResult->states[iLevel] == LEVEL_PENDING)
+  {
+    try
+    {
+      contour_list<contour_list<point2_t<double>>> polygons;
+      connect_level(&pResult->segments[iLevel], pResult->tolerance, &polygons);
+
+      size_t nCoordinates = 0;
+      for (const auto& polygon : polygons)
+      {
+        nCoordinates += polygon.size();
+      }
+      level.y.reserve(nCoordinates);
+      level.x.reserve(nCoordinates);
+      level.starts.reserve(polygons.size() + 1);
+      level.starts.push_back(0);
+      for (const auto& polygon : polygons)
+      {
+        for (const auto& point : polygon)
+        {
+          level.x.push_back(point[0]);
+          level.y.push_back(point[1]);
+        }
+        level.starts.push_back(level.x.size());
+      }
+      pResult->states[iLevel] = LEVEL_STITCHED;
+    }
+    catch (const std::exception&)
+    {
+      // Connecting consumes the segments, so the level cannot be retried
+      pResult->segments[iLevel].clear();
+      contour_vector<double>().swap(level.y);
+      contour_vector<double>().swap(level.x);
+      contour_vector<size_t>().swap(level.starts);
+      pResult->states[iLevel] = LEVEL_FAILED;
+    }
+  }
+  return pResult->states[iLevel] == LEVEL_STITCHED ? &level : nullptr;
+}
+
+contour_result_t* contour_result_create(const double* pData, const size_t nYdata,
+  const size_t nXdata, const double* pY, const size_t nY, const double* pX, const size_t nX,
+  const double* pLevels, const size_t nLevels, const contour_options_t* pOptions)
+{
+  if (nXdata != nX || nYdata != nY || nLevels == 0 || nX == 0 || nY == 0)
+  {
+    return nullptr;
+  }
+
+  contour_result_t* pResult = nullptr;
+  try
+  {
+    pResult = contour_new<contour_result_t>();
+    pResult->tolerance = grid_tolerance(pY, pX);
+
+    if (extract_segments(
+          pData, nYdata, nXdata, pY, pX, pLevels, nLevels, pOptions, &pResult->segments) != 0)
+    {
+      contour_delete(pResult);
+      return nullptr;
+    }
+    pResult->states.assign(nLevels, LEVEL_PENDING);
+    pResult->levels.resize(nLevels);
+  }
+  catch (const std::exception&)
+  {
+    contour_delete(pResult);
+    return nullptr;
+  }
+  return pResult;
+}
+
+void contour_result_destroy(contour_result_t* pResult)
+{
+  contour_delete(pResult);
+}
+
+size_t contour_result_levels(const contour_result_t* pResult)
+{
+  return pResult->levels.size();
+}
+
+size_t contour_result_polylines(contour_result_t* pResult, size_t iLevel)
+{
+  const contour_result::level_t* level = result_level(pResult, iLevel);
+  if (!level)
+  {
+    return 0;
+  }
+  return level->starts.size() - 1;
+}
+
+int contour_result_polyline(contour_result_t* pResult, size_t iLevel, size_t iPolyline,
+  const double** ppY, const double** ppX, size_t* nPoints)
+{
+  const contour_result::level_t* level = result_level(pResult, iLevel);
+  if (!level || iPolyline + 1 >= level->starts.size())
+  {
+    return -1;
+  }
+  *ppY = level->y.data() + level->starts[iPolyline];
+  *ppX = level->x.data() + level->starts[iPolyline];
+  *nPoints = level->starts[iPolyline + 1] - level->starts[iPolyline];
+  return 0;
+}
+
+int contour_result_level(contour_result_t* pResult, size_t iLevel, double** ppOutY,
+  size_t* nOutY, double** ppOutX, size_t* nOutX, size_t** nOutLengths, size_t* nOutSegments)
+{
+  *ppOutY = nullptr;
+  *nOutY = 0;
+  *ppOutX = nullptr;
+  *nOutX = 0;
+  *nOutLengths = nullptr;
+  *nOutSegments = 0;
+  const contour_result::level_t* level = result_level(pResult, iLevel);
+  if (!level)
+  {
+    return -1;
+  }
+  const size_t nCoordinates = level->x.size();
+  const size_t nPolylines = level->starts.size() - 1;
+
+  *ppOutY = contour_alloc_array<double>(std::max<size_t>(1, nCoordinates));
+  *ppOutX = contour_alloc_array<double>(std::max<size_t>(1, nCoordinates));
+  *nOutLengths = contour_alloc_array<size_t>(std::max<size_t>(1, nPolylines));
+  if (!*ppOutY || !*ppOutX || !*nOutLengths)
+  {
+    contour_deallocate(*ppOutY);
+    contour_deallocate(*ppOutX);
+    contour_deallocate(*nOutLengths);
+    *ppOutY = nullptr;
+    *ppOutX = nullptr;
+    *nOutLengths = nullptr;
+    return -1;
+  }
+
+  std::copy(level->y.begin(), level->y.end(), *ppOutY);
+  std::copy(level->x.begin(), level->x.end(), *ppOutX);
+  for (size_t iPolyline = 0; iPolyline < nPolylines; iPolyline++)
+  {
+    (*nOutLengths)[iPolyline] = level->starts[iPolyline + 1] - level->starts[iPolyline];
+  }
+  *nOutY = nCoordinates;
+  *nOutX = nCoordinates;
+  *nOutSegments = nPolylines;
+  return 0;
+}
+
+// Setup quantizer, returns false if the grid cannot be represented
+bool quantizer_init(const double* pY, const size_t nY, const double* pX, const size_t nX,
+  const unsigned int nFractionBits, quantizer_t* quantizer)
+{
+  const unsigned int nMaxFractionBits = 24;
+  if (nX < 2 || nY < 2 || nFractionBits > nMaxFractionBits)
+  {
+    return false;
+  }
+
+  const double dx = pX[1] - pX[0];
+  const double dy = pY[1] - pY[0];
+  if (dx == 0.0 || dy == 0.0)
+  {
+    return false;
+  }
+  const double xScale = std::ldexp(1.0, nFractionBits) / dx;
+  const double yScale = std::ldexp(1.0, nFractionBits) / dy;
+
+  // Vertices lie within the extents of the coordinates, which need not
+  // be uniformly spaced. The quantized values and their differences
+  // must fit an int.
+  const auto extent = [](const double* p, size_t n)
+  {
+    const auto range = std::minmax_element(p, p + n);
+    return *range.second - *range.first;
+  };
+  const double qMax =
+    std::max(extent(pX, nX) * std::fabs(xScale), extent(pY, nY) * std::fabs(yScale));
+  if (!(qMax < static_cast<double>(std::numeric_limits<int>::max())))
+  {
+    return false;
+  }
+
+  quantizer->x0 = pX[0];
+  quantizer->y0 = pY[0];
+  quantizer->xScale = xScale;
+  quantizer->yScale = yScale;
+  return true;
+}
+
+inline int quantize(double value, double origin, double scale)
+{
+  return static_cast<int>(std::lround((value - origin) * scale));
+}
+
+int contours_sorted_quantized_impl(const double* pData, const size_t nYdata, const size_t nXdata,
+  const double* pY, const size_t nY, const double* pX, const size_t nX, const double* pLevels,
+  const size_t nLevels, const unsigned int nFractionBits, int** ppOutY, size_t* nOutY, int** ppOutX,
+  size_t* nOutX, size_t** nOutLengths, size_t* nOutSegments, size_t** nLevelSegments,
+  size_t* nLevels2)
+{
+  int retval = 0;
+  quantizer_t quantizer;
+  if (nXdata != nX || nYdata != nY || nLevels == 0 ||
+    !quantizer_init(pY, nY, pX, nX, nFractionBits, &quantizer))
+  {
+    retval = -1;
+    *ppOutX = nullptr;
+    *nOutX = 0;
+    *ppOutY = nullptr;
+    *nOutY = 0;
+    *nOutLengths = nullptr;
+    *nOutSegments = 0;
+    *nLevelSegments = nullptr;
+    *nLevels2 = 0;
+  }
+  else
+  {
+    contour_list<contour_list<point2_t<double>>> polygons;
+
+    retval = sorted_polygons(pData, nYdata, nXdata, pY, pX, pLevels, nLevels, nullptr, &polygons,
+      nLevelSegments, nLevels2);
+    if (retval == 0)
+    {
+      retval = pack_output_quantized(
+        polygons, quantizer, ppOutY, nOutY, ppOutX, nOutX, nOutLengths, nOutSegments);
+    }
+    else
+    {
+      *ppOutX = nullptr;
+      *nOutX = 0;
+      *ppOutY = nullptr;
+      *nOutY = 0;
+      *nOutLengths = nullptr;
+      *nOutSegments = 0;
+    }
+    if (retval != 0)
+    {
+      contour_deallocate(*nLevelSegments);
+      *nLevelSegments = nullptr;
+      *nLevels2 = 0;
+    }
+  }
+  return retval;
+}
+
+int contours_sorted_quantized(const double* pData, const size_t nYdata, const size_t nXdata,
+  const double* pY, const size_t nY, const double* pX, const size_t nX, const double* pLevels,
+  const size_t nLevels, const unsigned int nFractionBits, int** ppOutY, size_t* nOutY,
+  int** ppOutX, size_t* nOutX, size_t** nOutLengths, size_t* nOutSegments,
+  size_t** nLevelSegments, size_t* nLevels2)
+{
+  return contour_nothrow(
+    [&]()
+    {
+      return contours_sorted_quantized_impl(pData, nYdata, nXdata, pY, nY, pX, nX, pLevels, nLevels,
+        nFractionBits, ppOutY, nOutY, ppOutX, nOutX, nOutLengths, nOutSegments, nLevelSegments,
+        nLevels2);
+    },
+    ppOutY, nOutY, ppOutX, nOutX, nOutLengths, nOutSegments, nLevelSegments, nLevels2);
+}
+
+int contours_sorted_encoded_impl(const double* pData, const size_t nYdata, const size_t nXdata,
+  const double* pY, const size_t nY, const double* pX, const size_t nX, const double* pLevels,
+  const size_t nLevels, const unsigned int nFractionBits, unsigned char** ppOutBytes,
+  size_t* nOutBytes, size_t** nOutLengths, size_t* nOutSegments, size_t** nLevelSegments,
+  size_t* nLevels2)
+{
+  int retval = 0;
+  quantizer_t quantizer;
+  if (nXdata != nX || nYdata != nY || nLevels == 0 ||
+    !quantizer_init(pY, nY, pX, nX, nFractionBits, &quantizer))
+  {
+    retval = -1;
+    *ppOutBytes = nullptr;
+    *nOutBytes = 0;
+    *nOutLengths = nullptr;
+    *nOutSegments = 0;
+    *nLevelSegments = nullptr;
+    *nLevels2 = 0;
+  }
+  else
+  {
+    contour_list<contour_list<point2_t<double>>> polygons;
+
+    retval = sorted_polygons(pData, nYdata, nXdata, pY, pX, pLevels, nLevels, nullptr, &polygons,
+      nLevelSegments, nLevels2);
+    if (retval == 0)
+    {
+      retval =
+        pack_output_encoded(polygons, quantizer, ppOutBytes, nOutBytes, nOutLengths, nOutSegments);
+    }
+    else
+    {
+      *ppOutBytes = nullptr;
+      *nOutBytes = 0;
+      *nOutLengths = nullptr;
+      *nOutSegments = 0;
+    }
+    if (retval != 0)
+    {
+      contour_deallocate(*nLevelSegments);
+      *nLevelSegments = nullptr;
+      *nLevels2 = 0;
+    }
+  }
+  return retval;
+}
+
+int contours_sorted_encoded(const double* pData, const size_t nYdata, const size_t nXdata,
+  const double* pY, const size_t nY, const double* pX, const size_t nX, const double* pLevels,
+  const size_t nLevels, const unsigned int nFractionBits, unsigned char** ppOutBytes,
+  size_t* nOutBytes, size_t** nOutLengths, size_t* nOutSegments, size_t** nLevelSegments,
+  size_t* nLevels2)
+{
+  return contour_nothrow(
+    [&]()
+    {
+      return contours_sorted_encoded_impl(pData, nYdata, nXdata, pY, nY, pX, nX, pLevels, nLevels,
+        nFractionBits, ppOutBytes, nOutBytes, nOutLengths, nOutSegments, nLevelSegments, nLevels2);
+    },
+    ppOutBytes, nOutBytes, nOutLengths, nOutSegments, nLevelSegments, nLevels2);
+}
+
+// Returns -1 with all outputs cleared if an array cannot be allocated
+template <typename T>
+int pack_output(const contour_list<contour_list<point2_t<double>>>& polygons, T** ppOutY,
+  size_t* nOutY, T** ppOutX, size_t* nOutX, size_t** nOutLengths, size_t* nOutSegments,
+  const contour_options_t* pOptions)
+{
+  // Create output
+  size_t nCoordinates = 0;
+
+  size_t nSegments = polygons.size();
+  for (const auto& it2 : polygons)
+  {
+    nCoordinates += it2.size();
+  }
+
+  *ppOutX = contour_alloc_array<T>(nCoordinates);
+  *ppOutY = contour_alloc_array<T>(nCoordinates);
+  *nOutLengths = contour_alloc_array<size_t>(nSegments);
+  if (!*ppOutX || !*ppOutY || !*nOutLengths)
+  {
+    contour_deallocate(*ppOutX);
+    contour_deallocate(*ppOutY);
+    contour_deallocate(*nOutLengths);
+    *ppOutX = nullptr;
+    *nOutX = 0;
+    *ppOutY = nullptr;
+    *nOutY = 0;
+    *nOutLengths = nullptr;
+    *nOutSegments = 0;
+    return -1;
+  }
+
+  *nOutX = nCoordinates;
+  *nOutY = nCoordinates;
+  *nOutSegments = nSegments;
+
+  vertex_writer_t<T> writer(pOptions, *ppOutX, *ppOutY);
+  size_t iSegment = 0;
+  for (const auto& it2 : polygons)
+  {
+    (*nOutLengths)[iSegment] = it2.size();
+    for (const auto& it3 : it2)
+    {
+      writer.put(it3[0], it3[1]);
+    }
+    iSegment++;
+  }
+  writer.flush();
+  return 0;
+}
+
+// Returns -1 with all outputs cleared if an array cannot be allocated
+int pack_output_quantized(const contour_list<contour_list<point2_t<double>>>& polygons,
+  const quantizer_t& quantizer, int** ppOutY, size_t* nOutY, int** ppOutX, size_t* nOutX,
+  size_t** nOutLengths, size_t* nOutSegments)
+{
+  size_t nCoordinates = 0;
+
+  size_t nSegments = polygons.size();
+  for (const auto& it2 : polygons)
+  {
+    nCoordinates += it2.size();
+  }
+
+  *ppOutX = contour_alloc_array<int>(nCoordinates);
+  *ppOutY = contour_alloc_array<int>(nCoordinates);
+  *nOutLengths = contour_alloc_array<size_t>(nSegments);
+  if (!*ppOutX || !*ppOutY || !*nOutLengths)
+  {
+    contour_deallocate(*ppOutX);
+    contour_deallocate(*ppOutY);
+    contour_deallocate(*nOutLengths);
+    *ppOutX = nullptr;
+    *nOutX = 0;
+    *ppOutY = nullptr;
+    *nOutY = 0;
+    *nOutLengths = nullptr;
+    *nOutSegments = 0;
+    return -1;
+  }
+
+  *nOutX = nCoordinates;
+  *nOutY = nCoordinates;
+  *nOutSegments = nSegments;
+
+  size_t iPoint = 0;
+  size_t iSegment = 0;
+  for (const auto& it2 : polygons)
+  {
+    (*nOutLengths)[iSegment] = it2.size();
+    for (const auto& it3 : it2)
+    {
+      (*ppOutX)[iPoint] = quantize(it3[0], quantizer.x0, quantizer.xScale);
+      (*ppOutY)[iPoint] = quantize(it3[1], quantizer.y0, quantizer.yScale);
+      iPoint++;
+    }
+    iSegment++;
+  }
+  return 0;
+}
+
+// Zigzag + LEB128 varint, returns pointer past the last byte written
+inline unsigned char* varint_write(unsigned char* pOut, int value)
+{
+  unsigned int zigzag =
+    (static_cast<unsigned int>(value) << 1) ^ static_cast<unsigned int>(value >> 31);
+  while (zigzag >= 0x80)
+  {
+    *pOut++ = static_cast<unsigned char>(zigzag | 0x80);
+    zigzag >>= 7;
+  }
+  *pOut++ = static_cast<unsigned char>(zigzag);
+  return pOut;
+}
+
+// Returns -1 with all outputs cleared if a buffer cannot be allocated
+int pack_output_encoded(const contour_list<contour_list<point2_t<double>>>& polygons,
+  const quantizer_t& quantizer, unsigned char** ppOutBytes, size_t* nOutBytes,
+  size_t** nOutLengths, size_t* nOutSegments)
+{
+  // A 32-bit varint never exceeds 5 bytes
+  const size_t nMaxVarintBytes = 5;
+
+  size_t nCoordinates = 0;
+
+  size_t nSegments = polygons.size();
+  for (const auto& it2 : polygons)
+  {
+    nCoordinates += it2.size();
+  }
+
+  // Encode directly into a worst-case buffer, shrink when done
+  *nOutLengths = contour_alloc_array<size_t>(nSegments);
+  unsigned char* pBytes =
+    contour_alloc_array<unsigned char>(2 * nMaxVarintBytes * nCoordinates + 1);
+  if (!pBytes || !*nOutLengths)
+  {
+    contour_deallocate(pBytes);
+    contour_deallocate(*nOutLengths);
+    *ppOutBytes = nullptr;
+    *nOutBytes = 0;
+    *nOutLengths = nullptr;
+    *nOutSegments = 0;
+    return -1;
+  }
+
+  unsigned char* pOut = pBytes;
+  size_t iSegment = 0;
+  for (const auto& it2 : polygons)
+  {
+    (*nOutLengths)[iSegment] = it2.size();
+    int qx = 0;
+    int qy = 0;
+    for (const auto& it3 : it2)
+    {
+      int x = quantize(it3[0], quantizer.x0, quantizer.xScale);
+      int y = quantize(it3[1], quantizer.y0, quantizer.yScale);
+      pOut = varint_write(pOut, x - qx);
+      pOut = varint_write(pOut, y - qy);
+      qx = x;
+      qy = y;
+    }
+    iSegment++;
+  }
+
+  *nOutSegments = nSegments;
+  *nOutBytes = static_cast<size_t>(pOut - pBytes);
+  unsigned char* pShrunk =
+    static_cast<unsigned char*>(contour_reallocate(pBytes, *nOutBytes + 1, alignof(unsigned char)));
+  *ppOutBytes = pShrunk ? pShrunk : pBytes;
+  return 0;
+}
+
+// Queues of tasks, one per thread. A thread takes tasks from the front
+// of its own queue and steals from the back of the others when it runs
+// out.
+class work_queues_t
+{
+public:
+  explicit work_queues_t(size_t nQueues)
+    : m_queues(nQueues)
+  {
+  }
+
+  void push(size_t iQueue, size_t task)
+  {
+    std::lock_guard<std::mutex> lock(m_queues[iQueue].mutex);
+    m_queues[iQueue].tasks.push_back(task);
+  }
+
+  bool pop(size_t iQueue, size_t* task)
+  {
+    const size_t nQueues = m_queues.size();
+    for (size_t i = 0; i < nQueues; i++)
+    {
+      queue_t& queue = m_queues[(iQueue + i) % nQueues];
+      std::lock_guard<std::mutex> lock(queue.mutex);
+      if (!queue.tasks.empty())
+      {
+        if (i == 0)
+        {
+          *task = queue.tasks.front();
+          queue.tasks.pop_front();
+        }
+        else
+        {
+          *task = queue.tasks.back();
+          queue.tasks.pop_back();
+        }
+        return true;
+      }
+    }
+    return false;
+  }
+
+private:
+  struct queue_t
+  {
+    std::mutex mutex;
+    std::deque<size_t, contour_stl_allocator<size_t>> tasks;
+  };
+  contour_vector<queue_t> m_queues;
+};
+
+// Run f(i) for each i < n, f(0) on the calling thread and the others on
+// threads of their own. Exceptions must not escape a thread, so returns
+// false if a task threw or a thread could not be started.
+template <typename F>
+bool run_parallel(size_t n, F&& f)
+{
+  std::atomic<bool> bFailed(false);
+  auto task = [&](size_t i)
+  {
+    try
+    {
+      f(i);
+    }
+    catch (const std::exception&)
+    {
+      bFailed = true;
+    }
+  };
+
+  contour_vector<std::thread> threads;
+  try
+  {
+    // Growing the vector must not throw while threads are running
+    threads.reserve(n);
+    for (size_t i = 1; i < n; i++)
+    {
+      threads.emplace_back(task, i);
+    }
+  }
+  catch (const std::exception&)
+  {
+    bFailed = true;
+  }
+  if (!bFailed)
+  {
+    task(0);
+  }
+  for (auto& thread : threads)
+  {
+    thread.join();
+  }
+  return !bFailed;
+}
+
+// Join the polylines of consecutive chunks of a level at matching ends,
+// given their ends, returns the number of joined polylines. The pieces
+// are visited in chunk order and each is extended at its back and then
+// its front, using the first matching piece, so the result only
+// depends on the chunks. Joining is only planned here, so the points
+// of the pieces can be stored anywhere.
+size_t plan_join(const contour_vector<join_piece_t>& pieces, size_t nChunks,
+  const point_tolerance_t& tolerance, contour_vector<join_step_t>* steps)
+{
+  const auto closed =
+    [&tolerance](const point2_t<double>& front, const point2_t<double>& back, size_t nPoints)
+  { return nPoints > 2 && tolerance.same(front, back); };
+
+  // Ends of open pieces, bucketed by the tolerance, so matching ends
+  // are in the same or a neighbouring bucket
+  const bool bJoin = nChunks > 1 && tolerance.dx > 0.0 && tolerance.dy > 0.0;
+  auto bucket = [&tolerance](const point2_t<double>& p, int di, int dj)
+  {
+    const int64_t i = static_cast<int64_t>(std::floor(p[0] / tolerance.dy)) + di;
+    const int64_t j = static_cast<int64_t>(std::floor(p[1] / tolerance.dx)) + dj;
+    return static_cast<uint64_t>(i) * 0x9E3779B97F4A7C15ull ^ static_cast<uint64_t>(j);
+  };
+  auto finite = [](const point2_t<double>& p)
+  { return std::isfinite(p[0]) && std::isfinite(p[1]); };
+  std::unordered_multimap<uint64_t, size_t, std::hash<uint64_t>, std::equal_to<uint64_t>,
+    contour_stl_allocator<std::pair<const uint64_t, size_t>>>
+    ends;
+  for (size_t iPiece = 0; bJoin && iPiece < pieces.size(); iPiece++)
+  {
+    const join_piece_t& piece = pieces[iPiece];
+    if (!closed(piece.front, piece.back, piece.nPoints) && finite(piece.front) &&
+      finite(piece.back))
+    {
+      ends.emplace(bucket(piece.front, 0, 0), 2 * iPiece);
+      ends.emplace(bucket(piece.back, 0, 0), 2 * iPiece + 1);
+    }
+  }
+
+  contour_vector<unsigned char> used(pieces.size(), 0);
+  const bool bEnds = !ends.empty();
+
+  // First unused end matching p, as 2 * piece + (0 for front, 1 for back)
+  auto match = [&](const point2_t<double>& p, size_t* end)
+  {
+    bool bFound = false;
+    for (int di = -1; di <= 1; di++)
+    {
+      for (int dj = -1; dj <= 1; dj++)
+      {
+        auto range = ends.equal_range(bucket(p, di, dj));
+        for (auto it = range.first; it != range.second; ++it)
+        {
+          const size_t candidate = it->second;
+          const join_piece_t& piece = pieces[candidate / 2];
+          if (!used[candidate / 2] && (!bFound || candidate < *end) &&
+            tolerance.same((candidate & 1) ? piece.back : piece.front, p))
+          {
+            *end = candidate;
+            bFound = true;
+          }
+        }
+      }
+    }
+    return bFound;
+  };
+
+  size_t nPolylines = 0;
+  contour_vector<join_step_t> front;
+  for (size_t iPiece = 0; iPiece < pieces.size(); iPiece++)
+  {
+    if (used[iPiece])
+    {
+      continue;
+    }
+    used[iPiece] = 1;
+    point2_t<double> first = pieces[iPiece].front;
+    point2_t<double> last = pieces[iPiece].back;
+    size_t nPoints = pieces[iPiece].nPoints;
+    const size_t iFirstStep = steps->size();
+    steps->push_back({ iPiece, false, false, false, false });
+    size_t end = 0;
+    while (bEnds && !closed(first, last, nPoints) && finite(last) && match(last, &end))
+    {
+      const join_piece_t& next = pieces[end / 2];
+      used[end / 2] = 1;
+      const bool bReversed = (end & 1) != 0;
+      last = bReversed ? next.front : next.back;
+      nPoints += next.nPoints - 1;
+      steps->push_back({ end / 2, bReversed, true, false, false });
+    }
+    front.clear();
+    while (bEnds && !closed(first, last, nPoints) && finite(first) && match(first, &end))
+    {
+      const join_piece_t& previous = pieces[end / 2];
+      used[end / 2] = 1;
+      const bool bReversed = (end & 1) == 0;
+      first = bReversed ? previous.back : previous.front;
+      nPoints += previous.nPoints - 1;
+      front.push_back({ end / 2, bReversed, false, true, false });
+    }
+    steps->insert(steps->begin() + iFirstStep, front.rbegin(), front.rend());
+    steps->back().bEnd = true;
+    nPolylines++;
+  }
+  return nPolylines;
+}
+
+// Join the polylines of consecutive chunks of a level as planned by
+// plan_join(), returns the number of polylines
+size_t join_chunks(contour_vector<contour_list<contour_list<point2_t<double>>>>* chunks,
+  const point_tolerance_t& tolerance, contour_list<contour_list<point2_t<double>>>* polygons)
+{
+  typedef contour_list<point2_t<double>> polyline_t;
+  contour_vector<polyline_t> lines;
+  contour_vector<join_piece_t> pieces;
+  for (auto& chunk : *chunks)
+  {
+    for (auto& line : chunk)
+    {
+      pieces.push_back({ line.front(), line.back(), line.size() });
+      lines.push_back(std::move(line));
+    }
+    chunk.clear();
+  }
+
+  contour_vector<join_step_t> steps;
+  const size_t nPolygons = plan_join(pieces, chunks->size(), tolerance, &steps);
+  bool bNew = true;
+  for (const join_step_t& step : steps)
+  {
+    if (bNew)
+    {
+      polygons->emplace_back();
+    }
+    polyline_t& line = lines[step.iPiece];
+    if (step.bReversed)
+    {
+      line.reverse();
+    }
+    if (step.bDropFirst)
+    {
+      line.pop_front();
+    }
+    if (step.bDropLast)
+    {
+      line.pop_back();
+    }
+    polygons->back().splice(polygons->back().end(), line);
+    bNew = step.bEnd;
+  }
+  return nPolygons;
+}
+
+// Connect the segments of a level on the calling thread, giving the
+// same polylines as sort_segments()
+size_t connect_level(contour_list<line2_t<double>>* segments, const point_tolerance_t& tolerance,
+  contour_list<contour_list<point2_t<double>>>* polygons)
+{
+  const size_t nChunks =
+    std::max<size_t>(1, (segments->size() + nConnectChunk - 1) / nConnectChunk);
+  contour_vector<contour_list<contour_list<point2_t<double>>>> chunkPolygons(nChunks);
+  for (size_t iChunk = 0; iChunk < nChunks; iChunk++)
+  {
+    contour_list<line2_t<double>> chunk;
+    auto last = segments->begin();
+    std::advance(last, std::min(nConnectChunk, segments->size()));
+    chunk.splice(chunk.end(), *segments, segments->begin(), last);
+    stitch_level(&chunk, tolerance, &chunkPolygons[iChunk]);
+  }
+  return join_chunks(&chunkPolygons, tolerance, polygons);
+}
+
+int sort_segments(contour_vector<contour_list<line2_t<double>>>* segments,
+  const point_tolerance_t& tolerance, contour_list<contour_list<point2_t<double>>>* polygons,
+  size_t** nLevelSegments, size_t* pnLevels, contour_progress_t* pProgress, unsigned int nThreads)
+{
+  size_t nLevels = segments->size();
+  *nLevelSegments = contour_alloc_array<size_t>(nLevels);
+  if (!*nLevelSegments)
+  {
+    *pnLevels = 0;
+    return -1;
+  }
+  *pnLevels = nLevels;
+
+  size_t nSegments = 0;
+  for (const auto& level : *segments)
+  {
+    nSegments += level.size();
+  }
+  if (pProgress)
+  {
+    pProgress->begin(CONTOUR_PHASE_CONNECT, nSegments);
+  }
+
+  // Split the levels into chunks of consecutive segments, each a task
+  typedef contour_list<contour_list<point2_t<double>>> polygons_t;
+  contour_vector<contour_vector<contour_list<line2_t<double>>>> chunks(nLevels);
+  contour_vector<contour_vector<polygons_t>> chunkPolygons(nLevels);
+  contour_vector<std::pair<size_t, size_t>> tasks;
+  for (size_t iLevel = 0; iLevel < nLevels; iLevel++)
+  {
+    contour_list<line2_t<double>>& level = (*segments)[iLevel];
+    const size_t nChunks = std::max<size_t>(1, (level.size() + nConnectChunk - 1) / nConnectChunk);
+    chunks[iLevel].resize(nChunks);
+    chunkPolygons[iLevel].resize(nChunks);
+    for (size_t iChunk = 0; iChunk < nChunks; iChunk++)
+    {
+      auto last = level.begin();
+      std::advance(last, std::min(nConnectChunk, level.size()));
+      chunks[iLevel][iChunk].splice(chunks[iLevel][iChunk].end(), level, level.begin(), last);
+      tasks.emplace_back(iLevel, iChunk);
+    }
+  }
+
+  // Deal the largest tasks first, levels vary a lot in size
+  std::stable_sort(tasks.begin(), tasks.end(),
+    [&chunks](const std::pair<size_t, size_t>& a, const std::pair<size_t, size_t>& b)
+    { return chunks[a.first][a.second].size() > chunks[b.first][b.second].size(); });
+  const size_t nWorkers = std::max<size_t>(1, std::min<size_t>(nThreads, tasks.size()));
+  work_queues_t queues(nWorkers);
+  for (size_t iTask = 0; iTask < tasks.size(); iTask++)
+  {
+    queues.push(iTask % nWorkers, iTask);
+  }
+
+  contour_vector<polygons_t> levelPolygons(nLevels);
+  contour_vector<std::atomic<size_t>> chunksLeft(nLevels);
+  for (size_t iLevel = 0; iLevel < nLevels; iLevel++)
+  {
+    chunksLeft[iLevel] = chunks[iLevel].size();
+  }
+  std::atomic<size_t> nDone(0);
+  std::atomic<bool> bCancelled(false);
+  std::atomic<bool> bFailed(false);
+
+  // The last chunk of a level to finish joins the level. Every worker
+  // polls the cancellation flag, but progress is only reported from the
+  // calling thread, which is worker 0. A worker running out of memory
+  // stops the others.
+  auto work = [&](size_t iWorker)
+  {
+    try
+    {
+      size_t iTask;
+      while (!bCancelled && queues.pop(iWorker, &iTask))
+      {
+        if (pProgress && pProgress->cancel_requested())
+        {
+          bCancelled = true;
+          break;
+        }
+        const size_t iLevel = tasks[iTask].first;
+        const size_t iChunk = tasks[iTask].second;
+        const size_t nChunkSegments = chunks[iLevel][iChunk].size();
+        stitch_level(&chunks[iLevel][iChunk], tolerance, &chunkPolygons[iLevel][iChunk]);
+        if (--chunksLeft[iLevel] == 0)
+        {
+          (*nLevelSegments)[iLevel] =
+            join_chunks(&chunkPolygons[iLevel], tolerance, &levelPolygons[iLevel]);
+        }
+        nDone += nChunkSegments;
+        if (iWorker == 0 && pProgress && !pProgress->update(nDone))
+        {
+          bCancelled = true;
+        }
+      }
+    }
+    catch (const std::exception&)
+    {
+      bFailed = true;
+      bCancelled = true;
+    }
+  };
+
+  if (!run_parallel(nWorkers, work))
+  {
+    bFailed = true;
+  }
+
+  if (bFailed || bCancelled || (pProgress && !pProgress->update(nSegments)))
+  {
+    contour_deallocate(*nLevelSegments);
+    *nLevelSegments = nullptr;
+    *pnLevels = 0;
+    polygons->clear();
+    return bFailed ? -1 : CONTOUR_CANCELLED;
+  }
+
+  // Concatenate in level order
+  for (auto& level : levelPolygons)
+  {
+    polygons->splice(polygons->end(), level);
+  }
+  return 0;
+}
+
+// Connect the segments of a single level, returns the number of polygons.
+// Progress is reported per connected segment and on cancellation the
+// polygons are incomplete.
+size_t stitch_level(contour_list<line2_t<double>>* segments, const point_tolerance_t& tolerance,
+  contour_list<contour_list<point2_t<double>>>* polygons, contour_progress_t* pProgress)
+{
+  size_t nPolygons = 0;
+  const size_t nSegments = segments->size();
+  const size_t nDone = pProgress ? pProgress->done() : 0;
+  auto it0 = segments->begin();
+
+  while (it0 != segments->end())
+  {
+    auto seg = *it0;
+
+    it0 = segments->erase(it0);
+
+    // Polygon with one edge
+    contour_list<point2_t<double>> polygon;
+    polygon.push_back(seg[0]);
+    polygon.push_back(seg[1]);
+
+    // Add polygon to list
+    polygons->push_back(polygon);
+
+    // Check for more edges
+    auto it1 = it0;
+
+    while (true)
+    {
+      size_t nSegmentsLeft = segments->size();
+      if (pProgress && !pProgress->update(nDone + nSegments - nSegmentsLeft))
+      {
+        return nPolygons;
+      }
+
+      while (it1 != segments->end())
+      {
+        auto& poly = polygons->back();
+        seg = *it1;
+        if (tolerance.same(seg[0], poly.back()))
+        {
+          poly.push_back(seg[1]);
+          segments->erase(it1);
+          it1 = segments->begin();
+          break; // Start again at the beginning
+        }
+        else if (tolerance.same(seg[1], poly.back()))
+        {
+          poly.push_back(seg[0]);
+          segments->erase(it1);
+          it1 = segments->begin();
+          break; // Start again at the beginning
+        }
+        else if (tolerance.same(seg[0], poly.front()))
+        {
+          poly.push_front(seg[1]);
+          segments->erase(it1);
+          it1 = segments->begin();
+          break; // Start again at the beginning
+        }
+        else if (tolerance.same(seg[1], poly.front()))
+        {
+          poly.push_front(seg[0]);
+          segments->erase(it1);
+          it1 = segments->begin();
+          break; // Start again at the beginning
+        }
+        else
+        {
+          it1++;
+        }
+      }
+      if (nSegmentsLeft == segments->size())
+      {
+        // Done with polygon
+        nPolygons++;
+        break;
+      }
+    }
+    if (!segments->empty())
+    {
+      // Old iterator may point to element, which has been
+      // erased, so we cannot simply increment it
+      it0 = segments->begin();
+    }
+    else
+    {
+      break;
+    }
+  }
+  return nPolygons;
+}
+
+// Algorithm from Bjorn Harpe
+class CContour
+{
+public:
+  CContour()
+    : m_contour()
+    , m_begin()
+    , m_end()
+  {
+  }
+  int add_vector(const point2_t<double>& p1, const point2_t<double>& p2)
+  {
+    point2_t<double> v;
+    v[0] = p2[0] - p1[0];
+    v[1] = p2[1] - p1[1];
+    if (m_contour.empty())
+    {
+      m_begin = p1;
+    }
+    m_contour.push_back(v);
+    m_end = p2;
+    return 0;
+  }
+
+  int reverse()
+  {
+#if 0 // defined(_MSC_VER) && (_MSC_VER >= 1914)
+    point2_t<double> temp;
     temp    = m_begin;
     m_begin = m_end;
     m_end   = temp;
@@ -444,253 +2379,1724 @@ public:
     std::swap(m_begin, m_end);
 #endif
 
-    std::vector<point2_t<double>> tmp;
-    auto it = m_contour.begin();
-    while (it != m_contour.end())
+    contour_vector<point2_t<double>> tmp;
+    auto it = m_contour.begin();
+    while (it != m_contour.end())
+    {
+      (*it)[0] *= -1.0;
+      (*it)[1] *= -1.0;
+      tmp.insert(tmp.begin(), (*it));
+      it++;
+    }
+    m_contour = tmp;
+    return 0;
+  }
+
+  int merge(const CContour& c)
+  {
+    m_contour.insert(m_contour.end(), c.m_contour.begin(), c.m_contour.end());
+    m_end = c.m_end;
+    return 0;
+  }
+  point2_t<double> end()
+  {
+    return m_end;
+  }
+  point2_t<double> begin()
+  {
+    return m_begin;
+  }
+  int condense(double difference = 0.000000001)
+  {
+    /*
+      at this time we potentially have multiple SVectors in the contour vector that
+      are colinear and could be condensed into one SVector with, to determine if two
+      successive vectors are colinear we take each vector and divide the y component
+      of the vector by the x component, giving us the slope. we pass in a difference
+      if the difference between th two slopes is less than the difference that we
+      pass in and since we already know that both segments share a common point they
+      can obviously be condensed. in the sample code on this page this is evident it
+      the bounding rectangle. another possibility is modifying the code to allow
+      point intersections on the plane. In this instance we may have multiple
+      identical vectors with no magnitude that can be reduced to a single data point.
+    */
+
+    double m1, m2;
+    auto it = m_contour.begin();
+    auto jt = it + 1;
+    while (jt != m_contour.end())
+    {
+      if (((*jt)[0]) && ((*it)[0]))
+      {
+        m1 = (*jt)[1] / (*jt)[0];
+        m2 = (*it)[1] / (*jt)[0];
+      }
+      else if (((*jt)[1]) && ((*it)[1]))
+      {
+        m1 = (*jt)[0] / (*jt)[1];
+        m2 = (*it)[0] / (*jt)[1];
+      }
+      else
+      {
+        it++;
+        jt++;
+        continue;
+      }
+      if ((m1 - m2 < difference) && (m2 - m1 < difference))
+      {
+        (*it)[1] += (*jt)[1];
+        (*it)[0] += (*jt)[0];
+        jt = m_contour.erase(jt);
+      }
+      else
+      {
+        it++;
+        jt++;
+      }
+    }
+    return 0;
+  }
+
+  ~CContour()
+  {
+    m_contour.clear();
+  }
+
+  contour_vector<point2_t<double>> m_contour;
+  point2_t<double> m_begin;
+  point2_t<double> m_end;
+};
+
+int merge(contour_vector<CContour>* contours, const point_tolerance_t& tolerance)
+{
+  int c = 0;
+  if (contours->size() < 2)
+  {
+    return c;
+  }
+
+  auto it = contours->begin();
+  auto jt = it;
+  /*
+  using two iterators we walk through the entire vector testing to
+  see if some combination of the start and end points match. If we
+  find matching points the two vectorsrs are merged. since when we go
+  thru the vector once we are garanteed that all vectors that can
+  connect to that oone have been merged we only have to merge the
+  vector less the processed nodes at the begining. every merge does
+  force jt back to the beginning of the search tho since a merge will
+  change either the start or the end of the vector
+  */
+  while (it != contours->end())
+  {
+    jt = it + 1;
+    while (jt != contours->end())
+    {
+      if (tolerance.same((*it).end(), (*jt).begin()))
+      {
+        /*
+          if the end of *it matches the start ot *jt we can copy
+          *jt to the end of *it and remove jt, the erase funtion
+          does us a favour and increments the iterator to the
+          next element so we continue to test the next element
+        */
+        (*it).merge(*jt);
+        contours->erase(jt);
+        jt = it + 1;
+        c++;
+      }
+      else if (tolerance.same((*jt).end(), (*it).begin()))
+      {
+        /*
+          similarily if the end of *jt matches the start ot *it we can copy
+          *it to the end of *jt and remove it,replacing it with jt, we then
+          neet to update it to point at the just inserted record.
+        */
+        (*jt).merge(*it);
+        (*it) = (*jt);
+        contours->erase(jt);
+        jt = it + 1;
+        c++;
+      }
+      else if (tolerance.same((*it).end(), (*jt).end()))
+      {
+        /*
+          if both segments end at the same point we reverse one and merge
+          it to the other, then remove the one we merged.
+        */
+        (*jt).reverse();
+        (*it).merge(*jt);
+        contours->erase(jt);
+        jt = it + 1;
+        c++;
+      }
+      else if (tolerance.same((*it).begin(), (*jt).begin()))
+      {
+        /*
+          if both segments start at the same point reverse it, then merge
+          it with jt, removing jt and reseting jt to the start of the search
+          sequence
+        */
+        (*it).reverse();
+        (*it).merge(*jt);
+        jt = contours->erase(jt);
+        c++;
+      }
+      else
+      {
+        jt++;
+      }
+    }
+    it++;
+  }
+  return c;
+}
+
+// Bjorn Harpe (not good either)
+void sort_segments2(contour_vector<contour_list<line2_t<double>>>* segments,
+  const point_tolerance_t& tolerance, contour_list<contour_list<point2_t<double>>>* polygons,
+  size_t** nLevelSegments, size_t* pnLevels)
+{
+  size_t nLevels = segments->size();
+  *nLevelSegments = contour_alloc_array<size_t>(nLevels);
+  *pnLevels = nLevels;
+
+  size_t nContours = 0;
+  int c = 0;
+
+  polygons->clear();
+
+  for (size_t iLevel = 0; iLevel < nLevels; iLevel++)
+  {
+    auto& segment = (*segments)[iLevel];
+    //  random access iterator is needed
+    //  std::sort(segment.begin(), segment.end());
+
+    contour_vector<CContour> contours;
+
+    segment.sort();
+    while (!segment.empty())
+    {
+      nContours++;
+      auto it = segment.begin();
+      CContour polygon;
+      auto seg = *it;
+      polygon.add_vector(seg[0], seg[1]);
+      it = segment.erase(it);
+      while (it != segment.end())
+      {
+        if (tolerance.same((*it)[0], polygon.end()))
+        {
+          polygon.add_vector((*it)[0], (*it)[1]);
+          segment.erase(it);
+          it = segment.begin();
+        }
+        else
+        {
+          it++;
+        }
+      }
+      contours.push_back(polygon);
+    }
+    c -= merge(&contours, tolerance);
+    auto it0 = contours.begin();
+    while (it0 != contours.end())
+    {
+      (*it0).condense();
+      it0++;
+    }
+
+    size_t nContoursAtLevel = 0;
+
+    // Move contours to output - dump
+    for (auto tmp : contours)
+    {
+      contour_list<point2_t<double>> nextContour;
+      auto p0 = tmp.begin();
+      nextContour.push_back(p0);
+      auto it1 = tmp.m_contour.begin();
+      while (it1 != tmp.m_contour.end())
+      {
+        p0[0] += (*it1)[0];
+        p0[1] += (*it1)[1];
+        nextContour.push_back(p0);
+        it1++;
+      }
+      polygons->push_back(nextContour);
+      nContoursAtLevel++;
+    }
+    (*nLevelSegments)[iLevel] = nContoursAtLevel;
+  }
+}
+
+// Line segment on a triangle mesh with the mesh edges (or vertices)
+// its end points lie on
+struct mesh_segment_t
+{
+  line2_t<double> line;
+  std::array<std::pair<size_t, size_t>, 2> keys;
+};
+
+struct mesh_segments_t
+{
+  contour_vector<contour_vector<mesh_segment_t>> levels;
+  // Lines along mesh edges are reported by both triangles
+  std::set<std::pair<size_t, size_t>, std::less<std::pair<size_t, size_t>>,
+    contour_stl_allocator<std::pair<size_t, size_t>>>
+    edgeLines;
+  // Exceptions must not unwind through the C caller
+  bool bFailed = false;
+};
+
+void mesh_segment_insert(mesh_segments_t* segments, const double* xy, const size_t* ends, int level)
+{
+  mesh_segment_t segment;
+  segment.line = { { { xy[0], xy[1] }, { xy[2], xy[3] } } };
+  segment.keys[0] = std::make_pair(std::min(ends[0], ends[1]), std::max(ends[0], ends[1]));
+  segment.keys[1] = std::make_pair(std::min(ends[2], ends[3]), std::max(ends[2], ends[3]));
+  if (ends[0] == ends[1] && ends[2] == ends[3])
+  {
+    // Level is included to keep lines for all levels
+    const size_t nLevels = segments->levels.size();
+    const auto edge =
+      std::make_pair(std::min(ends[0], ends[2]) * nLevels + level, std::max(ends[0], ends[2]));
+    if (!segments->edgeLines.insert(edge).second)
+    {
+      return;
+    }
+  }
+  segments->levels[level].push_back(segment);
+}
+
+void mesh_segment_add(const double* xy, const size_t* ends, int level, void* user)
+{
+  mesh_segments_t* segments = static_cast<mesh_segments_t*>(user);
+  if (segments->bFailed)
+  {
+    return;
+  }
+  try
+  {
+    mesh_segment_insert(segments, xy, ends, level);
+  }
+  catch (const std::exception&)
+  {
+    segments->bFailed = true;
+  }
+}
+
+// Join segments sharing mesh edges into polylines. Closed polylines
+// repeat their first point as for sort_segments().
+size_t stitch_mesh_segments(const contour_vector<mesh_segment_t>& segments,
+  contour_list<contour_list<point2_t<double>>>* polygons)
+{
+  const size_t nSegments = segments.size();
+
+  // End points sorted by key, equal keys are adjacent
+  contour_vector<size_t> ends(2 * nSegments);
+  for (size_t iEnd = 0; iEnd < ends.size(); iEnd++)
+  {
+    ends[iEnd] = iEnd;
+  }
+  auto key = [&](size_t iEnd) { return segments[iEnd / 2].keys[iEnd % 2]; };
+  std::sort(ends.begin(), ends.end(), [&](size_t a, size_t b) { return key(a) < key(b); });
+
+  contour_vector<size_t> position(ends.size());
+  for (size_t iPosition = 0; iPosition < ends.size(); iPosition++)
+  {
+    position[ends[iPosition]] = iPosition;
+  }
+
+  contour_vector<bool> used(nSegments, false);
+
+  // Unused end point sharing the key of iEnd
+  auto next = [&](size_t iEnd) -> size_t
+  {
+    const auto k = key(iEnd);
+    for (size_t iPosition = position[iEnd]; iPosition-- > 0 && key(ends[iPosition]) == k;)
+    {
+      if (!used[ends[iPosition] / 2])
+      {
+        return ends[iPosition];
+      }
+    }
+    for (size_t iPosition = position[iEnd] + 1;
+         iPosition < ends.size() && key(ends[iPosition]) == k; iPosition++)
+    {
+      if (!used[ends[iPosition] / 2])
+      {
+        return ends[iPosition];
+      }
+    }
+    return ends.size();
+  };
+
+  auto walk = [&](size_t iEnd)
+  {
+    contour_list<point2_t<double>> polygon;
+    used[iEnd / 2] = true;
+    polygon.push_back(segments[iEnd / 2].line[iEnd % 2]);
+    iEnd ^= 1;
+    polygon.push_back(segments[iEnd / 2].line[iEnd % 2]);
+    while ((iEnd = next(iEnd)) != ends.size())
+    {
+      used[iEnd / 2] = true;
+      iEnd ^= 1;
+      polygon.push_back(segments[iEnd / 2].line[iEnd % 2]);
+    }
+    polygons->push_back(std::move(polygon));
+  };
+
+  size_t nPolygons = 0;
+
+  // Open polylines start at end points not shared with other segments
+  for (size_t iPosition = 0; iPosition < ends.size(); iPosition++)
+  {
+    const size_t iEnd = ends[iPosition];
+    const bool bShared = (iPosition > 0 && key(ends[iPosition - 1]) == key(iEnd)) ||
+      (iPosition + 1 < ends.size() && key(ends[iPosition + 1]) == key(iEnd));
+    if (!bShared && !used[iEnd / 2])
+    {
+      walk(iEnd);
+      nPolygons++;
+    }
+  }
+
+  // Remaining segments form closed polylines
+  for (size_t iSegment = 0; iSegment < nSegments; iSegment++)
+  {
+    if (!used[iSegment])
+    {
+      walk(2 * iSegment);
+      nPolygons++;
+    }
+  }
+  return nPolygons;
+}
+
+template <typename T>
+int contours_mesh_impl(const double* pData, const size_t nData, const double* pY, const size_t nY,
+  const double* pX, const size_t nX, const size_t* pTriangles, const size_t nTriangleIndices,
+  const double* pLevels, const size_t nLevels, const contour_options_t* pOptions, T** ppOutY,
+  size_t* nOutY, T** ppOutX, size_t* nOutX, size_t** nOutLengths, size_t* nOutSegments,
+  size_t** nLevelSegments, size_t* nLevels2)
+{
+  *ppOutX = nullptr;
+  *nOutX = 0;
+  *ppOutY = nullptr;
+  *nOutY = 0;
+  *nOutLengths = nullptr;
+  *nOutSegments = 0;
+  *nLevelSegments = nullptr;
+  *nLevels2 = 0;
+
+  if (nData != nX || nData != nY || nLevels == 0 || nData == 0 || nTriangleIndices % 3 != 0 ||
+    std::any_of(pTriangles, pTriangles + nTriangleIndices,
+      [&](size_t index) { return index >= nData; }))
+  {
+    return -1;
+  }
+
+  // Vertex validity
+  contour_vector<unsigned char> valid;
+  const unsigned char* pValid = pOptions ? pOptions->pMask : nullptr;
+  if (pOptions && pOptions->bNaNIsMissing)
+  {
+    valid.resize(nData);
+    for (size_t iVertex = 0; iVertex < nData; iVertex++)
+    {
+      valid[iVertex] = (!pValid || pValid[iVertex]) && !std::isnan(pData[iVertex]);
+    }
+    pValid = valid.data();
+  }
+
+  mesh_segments_t segments;
+  segments.levels.resize(nLevels);
+
+  ContourMesh(pData, pValid, pX, pY, pTriangles, nTriangleIndices / 3, static_cast<int>(nLevels),
+    pLevels, mesh_segment_add, &segments);
+  if (segments.bFailed)
+  {
+    return -1;
+  }
+
+  contour_vector<size_t> levelSegments(nLevels);
+  contour_list<contour_list<point2_t<double>>> polygons;
+  for (size_t iLevel = 0; iLevel < nLevels; iLevel++)
+  {
+    levelSegments[iLevel] = stitch_mesh_segments(segments.levels[iLevel], &polygons);
+    contour_vector<mesh_segment_t>().swap(segments.levels[iLevel]);
+  }
+
+  *nLevelSegments = contour_alloc_array<size_t>(nLevels);
+  if (!*nLevelSegments)
+  {
+    return -1;
+  }
+  const int retval =
+    pack_output(polygons, ppOutY, nOutY, ppOutX, nOutX, nOutLengths, nOutSegments, pOptions);
+  if (retval != 0)
+  {
+    contour_deallocate(*nLevelSegments);
+    *nLevelSegments = nullptr;
+    return retval;
+  }
+  std::copy(levelSegments.begin(), levelSegments.end(), *nLevelSegments);
+  *nLevels2 = nLevels;
+  return 0;
+}
+
+int contours_mesh(const double* pData, const size_t nData, const double* pY, const size_t nY,
+  const double* pX, const size_t nX, const size_t* pTriangles, const size_t nTriangleIndices,
+  const double* pLevels, const size_t nLevels, const contour_options_t* pOptions, double** ppOutY,
+  size_t* nOutY, double** ppOutX, size_t* nOutX, size_t** nOutLengths, size_t* nOutSegments,
+  size_t** nLevelSegments, size_t* nLevels2)
+{
+  return contour_nothrow(
+    [&]()
+    {
+      return contours_mesh_impl(pData, nData, pY, nY, pX, nX, pTriangles, nTriangleIndices, pLevels,
+        nLevels, pOptions, ppOutY, nOutY, ppOutX, nOutX, nOutLengths, nOutSegments, nLevelSegments,
+        nLevels2);
+    },
+    ppOutY, nOutY, ppOutX, nOutX, nOutLengths, nOutSegments, nLevelSegments, nLevels2);
+}
+
+int contours_mesh_float(const double* pData, const size_t nData, const double* pY, const size_t nY,
+  const double* pX, const size_t nX, const size_t* pTriangles, const size_t nTriangleIndices,
+  const double* pLevels, const size_t nLevels, const contour_options_t* pOptions, float** ppOutY,
+  size_t* nOutY, float** ppOutX, size_t* nOutX, size_t** nOutLengths, size_t* nOutSegments,
+  size_t** nLevelSegments, size_t* nLevels2)
+{
+  return contour_nothrow(
+    [&]()
+    {
+      return contours_mesh_impl(pData, nData, pY, nY, pX, nX, pTriangles, nTriangleIndices, pLevels,
+        nLevels, pOptions, ppOutY, nOutY, ppOutX, nOutX, nOutLengths, nOutSegments, nLevelSegments,
+        nLevels2);
+    },
+    ppOutY, nOutY, ppOutX, nOutX, nOutLengths, nOutSegments, nLevelSegments, nLevels2);
+}
+
+// Isosurface mesh for one slab of cubes
+struct iso_slab_t
+{
+  contour_vector<index_map_t> edges;
+  contour_vector<contour_vector<point3_t<double>>> vertices;
+  contour_vector<contour_vector<size_t>> vertexEdges;
+  contour_vector<contour_vector<size_t>> indices;
+  // Exceptions must not unwind through the C caller
+  bool bFailed = false;
+};
+
+void iso_triangle_insert(iso_slab_t* slab, const double* p, const size_t* e, int level)
+{
+  auto& edges = slab->edges[level];
+  auto& vertices = slab->vertices[level];
+  for (size_t iVertex = 0; iVertex < 3; iVertex++)
+  {
+    auto it = edges.emplace(e[iVertex], vertices.size());
+    if (it.second)
+    {
+      vertices.push_back({ { p[3 * iVertex], p[3 * iVertex + 1], p[3 * iVertex + 2] } });
+      slab->vertexEdges[level].push_back(e[iVertex]);
+    }
+    slab->indices[level].push_back(it.first->second);
+  }
+}
+
+void iso_triangle_add(const double* p, const size_t* e, int level, void* user)
+{
+  iso_slab_t* slab = static_cast<iso_slab_t*>(user);
+  if (slab->bFailed)
+  {
+    return;
+  }
+  try
+  {
+    iso_triangle_insert(slab, p, e, level);
+  }
+  catch (const std::exception&)
+  {
+    slab->bFailed = true;
+  }
+}
+
+unsigned int thread_count(const contour_options_t* pOptions)
+{
+  unsigned int nThreads = pOptions ? pOptions->nThreads : 0;
+  if (nThreads == 0)
+  {
+    nThreads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  return nThreads;
+}
+
+// Statistics of a range of columns
+struct statistics_t
+{
+  contour_vector<double> lengths;
+  contour_vector<double> areas;
+};
+
+// Add the band areas of a triangle of area T with values a <= b <= c
+inline void triangle_band_areas(double a, double b, double c, double T, const double* z, int nc,
+  double* areas)
+{
+  // Levels in (a, c) cross the triangle
+  const int kA = static_cast<int>(std::upper_bound(z, z + nc, a) - z);
+  const int kC = static_cast<int>(std::lower_bound(z, z + nc, c) - z);
+  if (kC <= kA)
+  {
+    areas[kA] += T;
+    return;
+  }
+
+  // Area above each crossing level, from the triangle cut off at a or c
+  double above = T;
+  for (int k = kA; k < kC; k++)
+  {
+    double aboveK;
+    if (z[k] <= b)
+    {
+      aboveK = T - T * (z[k] - a) * (z[k] - a) / ((b - a) * (c - a));
+    }
+    else
+    {
+      aboveK = T * (c - z[k]) * (c - z[k]) / ((c - a) * (c - b));
+    }
+    areas[k] += above - aboveK;
+    above = aboveK;
+  }
+  areas[kC] += above;
+}
+
+// Accumulate the band areas of the cells (i, j) of a window for i in
+// [ilb, iub), using the four triangles of CONREC, and correct the
+// lengths for segments along cell edges
+void cell_statistics(const double* const* d, const uint64_t* const* mask,
+  const cell_window_t& window, int ilb, int iub, const double* x, const double* y, int nc,
+  const double* z, statistics_t* stats)
+{
+  const int imin = static_cast<int>(window.iRowBegin);
+  const int imax = static_cast<int>(window.iRowEnd) - 1;
+  const int jlb = static_cast<int>(window.iColumnBegin);
+  const int jub = static_cast<int>(window.iColumnEnd) - 1;
+  double h[4];
+  double* areas = stats->areas.data();
+  int k = 0;
+
+  auto valid = [&](int i, int j)
+  {
+    return i >= imin && i < imax && j >= jlb && j < jub &&
+      (!mask || (mask[i] && ((mask[i][(j - jlb) >> 6] >> ((j - jlb) & 63)) & 1)));
+  };
+
+  for (int i = ilb; i < iub; i++)
+  {
+    const uint64_t* bits = mask ? mask[i] : nullptr;
+    if (mask && !bits)
     {
-      (*it)[0] *= -1.0;
-      (*it)[1] *= -1.0;
-      tmp.insert(tmp.begin(), (*it));
-      it++;
+      continue;
     }
-    m_contour = tmp;
-    return 0;
+    const double* d0 = d[i];
+    const double* d1 = d[i + 1];
+    const double dx = fabs(x[i + 1] - x[i]);
+    for (int j = jlb; j < jub; j++)
+    {
+      if (bits && !((bits[(j - jlb) >> 6] >> ((j - jlb) & 63)) & 1))
+      {
+        continue;
+      }
+      // Corners in the order of Contour()
+      h[0] = d0[j];
+      h[1] = d1[j];
+      h[2] = d1[j + 1];
+      h[3] = d0[j + 1];
+      const double dy = fabs(y[j + 1] - y[j]);
+      const double T = 0.25 * dx * dy;
+
+      // A cell edge at a level is emitted by both cells sharing it,
+      // so count half of it from each
+      if (h[0] == h[1] || h[1] == h[2] || h[2] == h[3] || h[3] == h[0])
+      {
+        const int iNeighbour[4] = { i, i + 1, i, i - 1 };
+        const int jNeighbour[4] = { j - 1, j, j + 1, j };
+        for (int m = 0; m < 4; m++)
+        {
+          const double level = h[m];
+          if (level == h[(m + 1) & 3] && std::binary_search(z, z + nc, level) &&
+            valid(iNeighbour[m], jNeighbour[m]))
+          {
+            const size_t kLevel = std::lower_bound(z, z + nc, level) - z;
+            stats->lengths[kLevel] -= 0.5 * ((m & 1) ? dy : dx);
+          }
+        }
+      }
+
+      // Most cells are not crossed by any level
+      const double dmin = std::min(std::min(h[0], h[1]), std::min(h[2], h[3]));
+      const double dmax = std::max(std::max(h[0], h[1]), std::max(h[2], h[3]));
+      // Neighbouring cells are mostly in the same band
+      if (!((k == 0 || z[k - 1] <= dmin) && (k == nc || dmin < z[k])))
+      {
+        k = static_cast<int>(std::upper_bound(z, z + nc, dmin) - z);
+      }
+      if (k == nc || z[k] >= dmax)
+      {
+        areas[k] += 4.0 * T;
+        continue;
+      }
+
+      const double h0 = 0.25 * (h[0] + h[1] + h[2] + h[3]);
+      for (int m = 0; m < 4; m++)
+      {
+        double a = h[m];
+        double b = h0;
+        double c = h[(m + 1) & 3];
+        if (a > b)
+        {
+          std::swap(a, b);
+        }
+        if (b > c)
+        {
+          std::swap(b, c);
+        }
+        if (a > b)
+        {
+          std::swap(a, b);
+        }
+        triangle_band_areas(a, b, c, T, z, nc, areas);
+      }
+    }
+  }
+}
+
+int contours_statistics_impl(const double* pData, const size_t nYdata, const size_t nXdata,
+  const double* pY, const size_t nY, const double* pX, const size_t nX, const double* pLevels,
+  const size_t nLevels, const contour_options_t* pOptions, double** ppOutLengths,
+  size_t* nOutLengths, double** ppOutAreas, size_t* nOutAreas)
+{
+  *ppOutLengths = nullptr;
+  *nOutLengths = 0;
+  *ppOutAreas = nullptr;
+  *nOutAreas = 0;
+
+  if (nXdata != nX || nYdata != nY || nLevels == 0 || nX == 0 || nY == 0)
+  {
+    return -1;
+  }
+
+  cell_window_t window;
+  if (!get_cell_window(nYdata, nXdata, pOptions, &window))
+  {
+    return -1;
+  }
+
+  cell_mask_t mask;
+  const bool bMask = build_cell_mask(pData, nXdata, window, pOptions, &mask);
+
+  contour_vector<const double*> rows(nYdata);
+  for (size_t iY = window.iRowBegin; iY < window.iRowEnd; iY++)
+  {
+    rows[iY] = &pData[iY * nXdata];
+  }
+
+  // Split the rows of cells of the window into ranges, one per thread
+  const size_t nRows = window.rows();
+  const size_t nColumns = window.columns();
+  const size_t nRanges = std::max<size_t>(1, std::min<size_t>(thread_count(pOptions), nRows));
+  contour_vector<statistics_t> ranges(nRanges);
+
+  // Blocks of about 64k samples are walked twice while in cache, once
+  // by the kernel for the lengths and once for the areas and corrections
+  const int nBlock = static_cast<int>(std::max<size_t>(1, 65536 / std::max<size_t>(1, nColumns)));
+  const uint64_t* const* pMask = bMask ? mask.rows.data() : nullptr;
+
+  auto accumulate = [&](size_t iRange)
+  {
+    statistics_t& stats = ranges[iRange];
+    stats.lengths.assign(nLevels, 0.0);
+    stats.areas.assign(nLevels + 1, 0.0);
+    const int iBegin = static_cast<int>(window.iRowBegin + iRange * nRows / nRanges);
+    const int iEnd = static_cast<int>(window.iRowBegin + (iRange + 1) * nRows / nRanges);
+
+    for (int ilb = iBegin; ilb < iEnd; ilb += nBlock)
+    {
+      const int iub = std::min(ilb + nBlock, iEnd);
+      Contour(rows.data(), pMask, ilb, iub, static_cast<int>(window.iColumnBegin),
+        static_cast<int>(window.iColumnEnd) - 1, pY, pX, static_cast<int>(nLevels), pLevels,
+        [&stats](double x1, double y1, double x2, double y2, int level)
+        { stats.lengths[level] += std::sqrt((x2 - x1) * (x2 - x1) + (y2 - y1) * (y2 - y1)); });
+      cell_statistics(rows.data(), pMask, window, ilb, iub, pY, pX, static_cast<int>(nLevels),
+        pLevels, &stats);
+    }
+  };
+
+  if (!run_parallel(nRanges, accumulate))
+  {
+    return -1;
+  }
+
+  *ppOutLengths = contour_alloc_array<double>(nLevels);
+  *ppOutAreas = contour_alloc_array<double>(nLevels + 1);
+  if (!*ppOutLengths || !*ppOutAreas)
+  {
+    contour_deallocate(*ppOutLengths);
+    contour_deallocate(*ppOutAreas);
+    *ppOutLengths = nullptr;
+    *ppOutAreas = nullptr;
+    return -1;
+  }
+
+  // Reduce in a fixed order
+  std::fill(*ppOutLengths, *ppOutLengths + nLevels, 0.0);
+  std::fill(*ppOutAreas, *ppOutAreas + nLevels + 1, 0.0);
+  for (const auto& stats : ranges)
+  {
+    for (size_t iLevel = 0; iLevel < nLevels; iLevel++)
+    {
+      (*ppOutLengths)[iLevel] += stats.lengths[iLevel];
+    }
+    for (size_t iBand = 0; iBand <= nLevels; iBand++)
+    {
+      (*ppOutAreas)[iBand] += stats.areas[iBand];
+    }
+  }
+  *nOutLengths = nLevels;
+  *nOutAreas = nLevels + 1;
+  return 0;
+}
+
+int contours_statistics(const double* pData, const size_t nYdata, const size_t nXdata,
+  const double* pY, const size_t nY, const double* pX, const size_t nX, const double* pLevels,
+  const size_t nLevels, const contour_options_t* pOptions, double** ppOutLengths,
+  size_t* nOutLengths, double** ppOutAreas, size_t* nOutAreas)
+{
+  return contour_nothrow(
+    [&]()
+    {
+      return contours_statistics_impl(pData, nYdata, nXdata, pY, nY, pX, nX, pLevels, nLevels,
+        pOptions, ppOutLengths, nOutLengths, ppOutAreas, nOutAreas);
+    },
+    ppOutLengths, nOutLengths, ppOutAreas, nOutAreas);
+}
+
+// Order preserving map of doubles to unsigned integers
+inline uint64_t ordered_bits(double value)
+{
+  uint64_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  return (bits >> 63) ? ~bits : bits | (uint64_t(1) << 63);
+}
+
+inline double ordered_value(uint64_t bits)
+{
+  bits = (bits >> 63) ? bits & ~(uint64_t(1) << 63) : ~bits;
+  double value;
+  std::memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+// Samples are binned by their sign, exponent and leading 4 bits of the
+// mantissa, so the bins cover all doubles without knowing the range
+// of the data up front
+const int nLevelBinBits = 16;
+const size_t nLevelBins = size_t(1) << nLevelBinBits;
+
+inline size_t level_bin(double value)
+{
+  return static_cast<size_t>(ordered_bits(value) >> (64 - nLevelBinBits));
+}
+
+// Sub-bins of the bins holding quantiles
+const size_t nLevelSubBins = 4096;
+
+// Samples of a range of rows
+struct level_sweep_t
+{
+  double lower;
+  double upper;
+  size_t nSamples;
+  contour_vector<size_t> histogram;
+};
+
+// Multiples of an interval strictly between lower and upper, the
+// interval is m p or m / p to keep decimal levels exact. Returns
+// false if there are more than nMax.
+bool level_multiples(double lower, double upper, double m, double p, bool bDivide, size_t nMax,
+  contour_vector<double>* levels)
+{
+  const double step = bDivide ? m / p : m * p;
+  const double k0 = std::floor(lower / step) + 1.0;
+  const double k1 = std::ceil(upper / step) - 1.0;
+  if (!std::isfinite(k0) || !std::isfinite(k1) || k1 - k0 + 1.0 > static_cast<double>(nMax))
+  {
+    return false;
+  }
+  levels->clear();
+  for (double k = k0; k <= k1; k++)
+  {
+    const double level = bDivide ? k * m / p : k * m * p;
+    if (level > lower && level < upper)
+    {
+      levels->push_back(level);
+    }
+  }
+  return true;
+}
+
+// Levels at multiples of an interval, or of the smallest round
+// interval giving at most nMax levels if interval is 0
+bool nice_levels(
+  double lower, double upper, size_t nMax, double interval, contour_vector<double>* levels)
+{
+  if (interval > 0.0)
+  {
+    // Decimal intervals are scaled to integers, so 0.3 gives 0.9 and not
+    // 0.89999999999999991
+    double p = 1.0;
+    while (p < 1e15 && std::fabs(interval * p - std::round(interval * p)) > 1e-9 * interval * p)
+    {
+      p *= 10.0;
+    }
+    const double m = p < 1e15 ? std::round(interval * p) : interval;
+    return level_multiples(lower, upper, m, p < 1e15 ? p : 1.0, true, nMax, levels) &&
+      !levels->empty();
+  }
+
+  const double mantissas[4] = { 1.0, 2.0, 2.5, 5.0 };
+  const int e0 = static_cast<int>(std::floor(std::log10((upper - lower) / (nMax + 1))));
+  for (int e = e0; e <= e0 + 2; e++)
+  {
+    const double p = std::pow(10.0, std::abs(e));
+    if (!std::isfinite(p))
+    {
+      return false;
+    }
+    for (double m : mantissas)
+    {
+      if (level_multiples(lower, upper, m, p, e < 0, nMax, levels))
+      {
+        return !levels->empty();
+      }
+    }
+  }
+  return false;
+}
+
+// Levels chosen from the valid, finite samples of the window of the
+// options, clipped if the coordinates are given. The range of the
+// samples of each row of the window is returned, which is infinite for
+// rows with valid samples that are not finite.
+int choose_levels(const double* pData, const size_t nYdata, const size_t nXdata,
+  const double* pY, const double* pX, const size_t nLevels, const contour_options_t* pOptions,
+  contour_vector<double>* levels, cell_window_t* window, contour_vector<double>* rowLower,
+  contour_vector<double>* rowUpper)
+{
+  if (!pData || nLevels == 0 || nXdata == 0 || nYdata == 0 ||
+    !get_cell_window(nYdata, nXdata, pOptions, window))
+  {
+    return -1;
+  }
+  const double* pClip = pOptions ? pOptions->pClip : nullptr;
+  if (pClip && pY && pX)
+  {
+    clip_cell_range(pY, pClip[1], pClip[3], &window->iRowBegin, &window->iRowEnd);
+    clip_cell_range(pX, pClip[0], pClip[2], &window->iColumnBegin, &window->iColumnEnd);
+  }
+
+  const size_t nRows = window->iRowEnd - window->iRowBegin;
+  const size_t iX0 = window->iColumnBegin;
+  const size_t iX1 = window->iColumnEnd;
+  const unsigned char* pMask = pOptions ? pOptions->pMask : nullptr;
+  const bool bNaN = pOptions && pOptions->bNaNIsMissing;
+  const double inf = std::numeric_limits<double>::infinity();
+  rowLower->assign(nRows, inf);
+  rowUpper->assign(nRows, -inf);
+
+  // Visit the valid, finite samples of a row, returns false if the row
+  // has valid samples that are not finite
+  auto visit_row = [&](size_t iY, auto&& f)
+  {
+    const double* pRow = &pData[iY * nXdata];
+    const unsigned char* pRowMask = pMask ? &pMask[iY * nXdata] : nullptr;
+    bool bFinite = true;
+    for (size_t iX = iX0; iX < iX1; iX++)
+    {
+      const double value = pRow[iX];
+      if (pRowMask && !pRowMask[iX])
+      {
+        continue;
+      }
+      if (!std::isfinite(value))
+      {
+        bFinite = bFinite && bNaN && std::isnan(value);
+        continue;
+      }
+      f(value);
+    }
+    return bFinite;
+  };
+
+  // Split the rows into ranges, one per thread, each with its own
+  // histogram of 512 kB
+  const size_t nSamples = nRows * (iX1 - iX0);
+  const size_t nThreads = thread_count(pOptions);
+  const size_t nRanges =
+    std::max<size_t>(1, std::min<size_t>({ nThreads, nRows, nSamples / nLevelBins }));
+  auto row_begin = [&](size_t iRange) { return window->iRowBegin + iRange * nRows / nRanges; };
+
+  // Range and histogram of the samples, with the range of each row
+  contour_vector<level_sweep_t> sweeps(nRanges);
+  const bool bSwept = run_parallel(nRanges,
+    [&](size_t iRange)
+    {
+      level_sweep_t& sweep = sweeps[iRange];
+      sweep.lower = inf;
+      sweep.upper = -inf;
+      sweep.nSamples = 0;
+      sweep.histogram.assign(nLevelBins, 0);
+      size_t* pHistogram = sweep.histogram.data();
+      for (size_t iY = row_begin(iRange); iY < row_begin(iRange + 1); iY++)
+      {
+        double lower = inf;
+        double upper = -inf;
+        size_t nRowSamples = 0;
+        const bool bFinite = visit_row(iY,
+          [&](double value)
+          {
+            lower = std::min(lower, value);
+            upper = std::max(upper, value);
+            pHistogram[level_bin(value)]++;
+            nRowSamples++;
+          });
+        sweep.lower = std::min(sweep.lower, lower);
+        sweep.upper = std::max(sweep.upper, upper);
+        sweep.nSamples += nRowSamples;
+        (*rowLower)[iY - window->iRowBegin] = bFinite ? lower : -inf;
+        (*rowUpper)[iY - window->iRowBegin] = bFinite ? upper : inf;
+      }
+    });
+  if (!bSwept)
+  {
+    return -1;
+  }
+
+  // Reduce in a fixed order
+  level_sweep_t& total = sweeps[0];
+  for (size_t iRange = 1; iRange < nRanges; iRange++)
+  {
+    total.lower = std::min(total.lower, sweeps[iRange].lower);
+    total.upper = std::max(total.upper, sweeps[iRange].upper);
+    total.nSamples += sweeps[iRange].nSamples;
+    for (size_t iBin = 0; iBin < nLevelBins; iBin++)
+    {
+      total.histogram[iBin] += sweeps[iRange].histogram[iBin];
+    }
+  }
+  if (!(total.upper > total.lower))
+  {
+    return -1;
+  }
+
+  const contour_level_mode_t eMode = pOptions ? pOptions->eLevels : CONTOUR_LEVELS_NICE;
+  if (eMode != CONTOUR_LEVELS_QUANTILE)
+  {
+    const double interval = pOptions ? pOptions->dLevelInterval : 0.0;
+    return nice_levels(total.lower, total.upper, nLevels, interval, levels) ? 0 : -1;
+  }
+
+  // Level k is at the k / (nLevels + 1) quantile. Find the bin holding
+  // each quantile and the number of samples below the bin.
+  const double nTotal = static_cast<double>(total.nSamples);
+  contour_vector<double> targets(nLevels);
+  contour_vector<size_t> targetBins(nLevels);
+  contour_vector<size_t> binsBelow(nLevels);
+  size_t iBin = 0;
+  size_t nBelow = 0;
+  for (size_t iLevel = 0; iLevel < nLevels; iLevel++)
+  {
+    targets[iLevel] = nTotal * static_cast<double>(iLevel + 1) / static_cast<double>(nLevels + 1);
+    while (static_cast<double>(nBelow + total.histogram[iBin]) < targets[iLevel])
+    {
+      nBelow += total.histogram[iBin++];
+    }
+    targetBins[iLevel] = iBin;
+    binsBelow[iLevel] = nBelow;
+  }
+
+  // Split the bins holding quantiles into sub-bins over their part of
+  // the data range
+  contour_vector<size_t> bins(targetBins.begin(), targetBins.end());
+  bins.erase(std::unique(bins.begin(), bins.end()), bins.end());
+  const size_t nBins = bins.size();
+  contour_vector<int> slots(nLevelBins, -1);
+  contour_vector<double> subLower(nBins);
+  contour_vector<double> subWidth(nBins);
+  for (size_t iSlot = 0; iSlot < nBins; iSlot++)
+  {
+    const uint64_t bits = static_cast<uint64_t>(bins[iSlot]) << (64 - nLevelBinBits);
+    const uint64_t mask = (uint64_t(1) << (64 - nLevelBinBits)) - 1;
+    const double lower = std::max(total.lower, ordered_value(bits));
+    const double upper = std::min(total.upper, ordered_value(bits | mask));
+    slots[bins[iSlot]] = static_cast<int>(iSlot);
+    subLower[iSlot] = lower;
+    subWidth[iSlot] = (upper - lower) / nLevelSubBins;
+  }
+
+  // Histograms of the bins, only rows with samples in them are visited
+  contour_vector<contour_vector<size_t>> subHistograms(nRanges);
+  const bool bCounted = run_parallel(nRanges,
+    [&](size_t iRange)
+    {
+      contour_vector<size_t>& histogram = subHistograms[iRange];
+      histogram.assign(nBins * nLevelSubBins, 0);
+      for (size_t iY = row_begin(iRange); iY < row_begin(iRange + 1); iY++)
+      {
+        const double lower = (*rowLower)[iY - window->iRowBegin];
+        const double upper = (*rowUpper)[iY - window->iRowBegin];
+        if (lower > upper ||
+          (std::isfinite(lower) && std::isfinite(upper) &&
+            std::lower_bound(bins.begin(), bins.end(), level_bin(lower)) ==
+              std::upper_bound(bins.begin(), bins.end(), level_bin(upper))))
+        {
+          continue;
+        }
+        visit_row(iY,
+          [&](double value)
+          {
+            const int iSlot = slots[level_bin(value)];
+            if (iSlot >= 0)
+            {
+              const double sub = subWidth[iSlot] > 0.0
+                ? std::floor((value - subLower[iSlot]) / subWidth[iSlot])
+                : 0.0;
+              const size_t iSub = static_cast<size_t>(
+                std::min(std::max(sub, 0.0), static_cast<double>(nLevelSubBins - 1)));
+              histogram[iSlot * nLevelSubBins + iSub]++;
+            }
+          });
+      }
+    });
+  if (!bCounted)
+  {
+    return -1;
+  }
+  for (size_t iRange = 1; iRange < nRanges; iRange++)
+  {
+    for (size_t i = 0; i < nBins * nLevelSubBins; i++)
+    {
+      subHistograms[0][i] += subHistograms[iRange][i];
+    }
+  }
+
+  // Interpolate the quantiles within their sub-bins
+  levels->clear();
+  for (size_t iLevel = 0; iLevel < nLevels; iLevel++)
+  {
+    const size_t iSlot = static_cast<size_t>(slots[targetBins[iLevel]]);
+    const size_t* pSub = &subHistograms[0][iSlot * nLevelSubBins];
+    double nSubBelow = static_cast<double>(binsBelow[iLevel]);
+    size_t iSub = 0;
+    while (iSub + 1 < nLevelSubBins && nSubBelow + pSub[iSub] < targets[iLevel])
+    {
+      nSubBelow += pSub[iSub++];
+    }
+    const double fraction =
+      pSub[iSub] ? std::min(1.0, (targets[iLevel] - nSubBelow) / pSub[iSub]) : 0.0;
+    const double level = subLower[iSlot] + (iSub + fraction) * subWidth[iSlot];
+    if (levels->empty() || level > levels->back())
+    {
+      levels->push_back(level);
+    }
+  }
+  return levels->empty() ? -1 : 0;
+}
+
+int contour_levels_impl(const double* pData, const size_t nYdata, const size_t nXdata,
+  const size_t nLevels, const contour_options_t* pOptions, double** ppOutLevels, size_t* nOutLevels)
+{
+  *ppOutLevels = nullptr;
+  *nOutLevels = 0;
+
+  contour_vector<double> levels;
+  cell_window_t window;
+  contour_vector<double> rowLower;
+  contour_vector<double> rowUpper;
+  int retval = choose_levels(pData, nYdata, nXdata, nullptr, nullptr, nLevels, pOptions, &levels,
+    &window, &rowLower, &rowUpper);
+  if (retval != 0)
+  {
+    return retval;
+  }
+
+  *ppOutLevels = contour_alloc_array<double>(levels.size());
+  if (!*ppOutLevels)
+  {
+    return -1;
+  }
+  std::copy(levels.begin(), levels.end(), *ppOutLevels);
+  *nOutLevels = levels.size();
+  return 0;
+}
+
+int contour_levels(const double* pData, const size_t nYdata, const size_t nXdata,
+  const size_t nLevels, const contour_options_t* pOptions, double** ppOutLevels,
+  size_t* nOutLevels)
+{
+  return contour_nothrow(
+    [&]()
+    {
+      return contour_levels_impl(pData, nYdata, nXdata, nLevels, pOptions, ppOutLevels, nOutLevels);
+    },
+    ppOutLevels, nOutLevels);
+}
+
+int contours_sorted_auto(const double* pData, const size_t nYdata, const size_t nXdata,
+  const double* pY, const size_t nY, const double* pX, const size_t nX, const size_t nLevels,
+  const contour_options_t* pOptions, double** ppOutLevels, size_t* nOutLevels, double** ppOutY,
+  size_t* nOutY, double** ppOutX, size_t* nOutX, size_t** nOutLengths, size_t* nOutSegments,
+  size_t** nLevelSegments, size_t* nLevels2)
+{
+  *ppOutLevels = nullptr;
+  *nOutLevels = 0;
+  *ppOutX = nullptr;
+  *nOutX = 0;
+  *ppOutY = nullptr;
+  *nOutY = 0;
+  *nOutLengths = nullptr;
+  *nOutSegments = 0;
+  *nLevelSegments = nullptr;
+  *nLevels2 = 0;
+
+  if (nXdata != nX || nYdata != nY)
+  {
+    return -1;
+  }
+
+  contour_vector<double> levels;
+  cell_window_t window;
+  contour_vector<double> rowLower;
+  contour_vector<double> rowUpper;
+  int retval = choose_levels(
+    pData, nYdata, nXdata, pY, pX, nLevels, pOptions, &levels, &window, &rowLower, &rowUpper);
+  if (retval != 0)
+  {
+    return retval;
+  }
+
+  contour_options_t options;
+  if (pOptions)
+  {
+    options = *pOptions;
+  }
+  else
+  {
+    contour_options_init(&options);
+  }
+
+  // Skip the rows of cells at the top and bottom of the window, which
+  // no level passes through
+  size_t iFirst = window.rows();
+  size_t iLast = 0;
+  for (size_t iRow = 0; iRow < window.rows(); iRow++)
+  {
+    const double lower = std::min(rowLower[iRow], rowLower[iRow + 1]);
+    const double upper = std::max(rowUpper[iRow], rowUpper[iRow + 1]);
+    auto it = std::lower_bound(levels.begin(), levels.end(), lower);
+    if (it != levels.end() && *it <= upper)
+    {
+      iFirst = std::min(iFirst, iRow);
+      iLast = iRow;
+    }
+  }
+  if (iFirst < window.rows())
+  {
+    options.iRowBegin = window.iRowBegin + iFirst;
+    options.iRowEnd = window.iRowBegin + iLast + 2;
+  }
+
+  retval = contours_sorted_ex(pData, nYdata, nXdata, pY, nY, pX, nX, levels.data(), levels.size(),
+    &options, ppOutY, nOutY, ppOutX, nOutX, nOutLengths, nOutSegments, nLevelSegments, nLevels2);
+  if (retval != 0)
+  {
+    return retval;
+  }
+
+  *ppOutLevels = contour_alloc_array<double>(levels.size());
+  if (!*ppOutLevels)
+  {
+    contour_deallocate(*ppOutY);
+    contour_deallocate(*ppOutX);
+    contour_deallocate(*nOutLengths);
+    contour_deallocate(*nLevelSegments);
+    *ppOutX = nullptr;
+    *nOutX = 0;
+    *ppOutY = nullptr;
+    *nOutY = 0;
+    *nOutLengths = nullptr;
+    *nOutSegments = 0;
+    *nLevelSegments = nullptr;
+    *nLevels2 = 0;
+    return -1;
+  }
+  std::copy(levels.begin(), levels.end(), *ppOutLevels);
+  *nOutLevels = levels.size();
+  return 0;
+}
+
+// Vertices and indices of a level of contours_indexed(), where points
+// with the same cell_point_key() share a vertex. The first coordinates
+// computed for a key are kept.
+struct indexed_level_t
+{
+  index_map_t keys;
+  contour_vector<point2_t<double>> vertices;
+  contour_vector<uint32_t> indices;
+  size_t iStrip = 0;
+
+  // Indices wrap beyond 32 bits, contours_indexed() then fails
+  uint32_t vertex(uint64_t key, double x, double y)
+  {
+    auto it = keys.emplace(static_cast<size_t>(key), vertices.size());
+    if (it.second)
+    {
+      vertices.push_back({ { x, y } });
+    }
+    return static_cast<uint32_t>(it.first->second);
+  }
+
+  // Polylines receiver of level_tracer_t, writing strips ended by the
+  // restart index. Repeated vertices are dropped.
+  void begin()
+  {
+    iStrip = indices.size();
+  }
+
+  void put(double x, double y, uint64_t key)
+  {
+    const uint32_t index = vertex(key, x, y);
+    if (indices.size() == iStrip || indices.back() != index)
+    {
+      indices.push_back(index);
+    }
+  }
+
+  void end(bool)
+  {
+    if (indices.size() - iStrip < 2)
+    {
+      indices.resize(iStrip);
+    }
+    else
+    {
+      indices.push_back(CONTOUR_RESTART_INDEX);
+    }
+  }
+};
+
+template <typename T>
+int contours_indexed_impl(const double* pData, const size_t nYdata, const size_t nXdata,
+  const double* pY, const size_t nY, const double* pX, const size_t nX, const double* pLevels,
+  const size_t nLevels, const contour_options_t* pOptions, contour_topology_t eTopology,
+  T** ppOutVertices, size_t* nOutVertices, uint32_t** ppOutIndices, size_t* nOutIndices,
+  size_t** nOutLengths, size_t* nOutLevels)
+{
+  *ppOutVertices = nullptr;
+  *nOutVertices = 0;
+  *ppOutIndices = nullptr;
+  *nOutIndices = 0;
+  *nOutLengths = nullptr;
+  *nOutLevels = 0;
+
+  if (nXdata != nX || nYdata != nY || nLevels == 0 || nX == 0 || nY == 0)
+  {
+    return -1;
+  }
+  if (eTopology != CONTOUR_TOPOLOGY_LINES && eTopology != CONTOUR_TOPOLOGY_STRIPS)
+  {
+    return -1;
+  }
+  // Clipping would create vertices without a cell edge
+  if (pOptions && pOptions->pClip)
+  {
+    return -1;
   }
 
-  int merge(const CContour& c)
+  cell_window_t window;
+  if (!get_cell_window(nYdata, nXdata, pOptions, &window))
   {
-    m_contour.insert(m_contour.end(), c.m_contour.begin(), c.m_contour.end());
-    m_end = c.m_end;
-    return 0;
+    return -1;
   }
-  point2_t<double> end()
+
+  cell_mask_t mask;
+  const bool bMask = build_cell_mask(pData, nXdata, window, pOptions, &mask);
+  const uint64_t* const* pMask = bMask ? mask.rows.data() : nullptr;
+
+  contour_vector<const double*> rows(nYdata);
+  for (size_t iY = window.iRowBegin; iY < window.iRowEnd; iY++)
   {
-    return m_end;
+    rows[iY] = &pData[iY * nXdata];
   }
-  point2_t<double> begin()
+
+  contour_vector<indexed_level_t> levels(nLevels);
+  contour_progress_t progress(pOptions);
+  size_t nLinesDone = 0;
+  size_t nLines = 0;
+  if (eTopology == CONTOUR_TOPOLOGY_LINES)
   {
-    return m_begin;
+    // The kernel polls before each row of each strip of columns
+    const size_t nStrips = (window.columns() + ConrecBlockColumns - 1) / ConrecBlockColumns;
+    nLines = window.rows() * nStrips;
+    progress.begin(CONTOUR_PHASE_EXTRACT, nLines);
+
+    // CONREC reports the row coordinate first and numbers the centre 0
+    Contour(rows.data(), pMask, static_cast<int>(window.iRowBegin),
+      static_cast<int>(window.iRowEnd) - 1, static_cast<int>(window.iColumnBegin),
+      static_cast<int>(window.iColumnEnd) - 1, pY, pX, static_cast<int>(nLevels), pLevels,
+      [&levels, nXdata](const double* xy, const int* ends, int i, int j, int k)
+      {
+        indexed_level_t& level = levels[k];
+        for (int iEnd = 0; iEnd < 2; iEnd++)
+        {
+          const uint64_t key = cell_point_key(static_cast<size_t>(i), static_cast<size_t>(j),
+            nXdata, (ends[2 * iEnd] + 4) % 5, (ends[2 * iEnd + 1] + 4) % 5);
+          level.indices.push_back(level.vertex(key, xy[2 * iEnd + 1], xy[2 * iEnd]));
+        }
+      },
+      [&progress, &nLinesDone]() { return progress.update(nLinesDone++); });
+    if (progress.cancelled())
+    {
+      return CONTOUR_CANCELLED;
+    }
   }
-  int condense(double difference = 0.000000001)
+  else
   {
-    /*
-      at this time we potentially have multiple SVectors in the contour vector that
-      are colinear and could be condensed into one SVector with, to determine if two
-      successive vectors are colinear we take each vector and divide the y component
-      of the vector by the x component, giving us the slope. we pass in a difference
-      if the difference between th two slopes is less than the difference that we
-      pass in and since we already know that both segments share a common point they
-      can obviously be condensed. in the sample code on this page this is evident it
-      the bounding rectangle. another possibility is modifying the code to allow
-      point intersections on the plane. In this instance we may have multiple
-      identical vectors with no magnitude that can be reduced to a single data point.
-    */
+    // Polled before each row of each level
+    nLines = window.rows() * nLevels;
+    progress.begin(CONTOUR_PHASE_EXTRACT, nLines);
 
-    double m1, m2;
-    auto it = m_contour.begin();
-    auto jt = it + 1;
-    while (jt != m_contour.end())
+    contour_vector<uint64_t> visited;
+    level_tracer_t tracer(rows.data(), pMask, window, pY, pX, &visited);
+    for (size_t iLevel = 0; iLevel < nLevels; iLevel++)
     {
-      if (((*jt)[0]) && ((*it)[0]))
-      {
-        m1 = (*jt)[1] / (*jt)[0];
-        m2 = (*it)[1] / (*jt)[0];
-      }
-      else if (((*jt)[1]) && ((*it)[1]))
-      {
-        m1 = (*jt)[0] / (*jt)[1];
-        m2 = (*it)[0] / (*jt)[1];
-      }
-      else
-      {
-        it++;
-        jt++;
-        continue;
-      }
-      if ((m1 - m2 < difference) && (m2 - m1 < difference))
-      {
-        (*it)[1] += (*jt)[1];
-        (*it)[0] += (*jt)[0];
-        jt = m_contour.erase(jt);
-      }
-      else
+      if (!tracer.trace(pLevels[iLevel],
+            [&progress, &nLinesDone]() { return progress.update(nLinesDone++); },
+            levels[iLevel]))
       {
-        it++;
-        jt++;
+        return CONTOUR_CANCELLED;
       }
+      levels[iLevel].keys.clear();
     }
-    return 0;
   }
-
-  ~CContour()
+  if (!progress.update(nLines))
   {
-    m_contour.clear();
+    return CONTOUR_CANCELLED;
   }
 
-  std::vector<point2_t<double>> m_contour;
-  point2_t<double> m_begin;
-  point2_t<double> m_end;
-};
+  size_t nVertices = 0;
+  size_t nIndices = 0;
+  for (const auto& level : levels)
+  {
+    nVertices += level.vertices.size();
+    nIndices += level.indices.size();
+  }
+  // The restart index is not a vertex
+  if (nVertices >= CONTOUR_RESTART_INDEX)
+  {
+    return -1;
+  }
 
-int merge(std::vector<CContour>* contours)
-{
-  int c = 0;
-  if (contours->size() < 2)
+  *ppOutVertices = contour_alloc_array<T>(2 * nVertices);
+  *ppOutIndices = contour_alloc_array<uint32_t>(nIndices);
+  *nOutLengths = contour_alloc_array<size_t>(nLevels);
+  if ((nVertices && !*ppOutVertices) || (nIndices && !*ppOutIndices) || !*nOutLengths)
   {
-    return c;
+    contour_deallocate(*ppOutVertices);
+    contour_deallocate(*ppOutIndices);
+    contour_deallocate(*nOutLengths);
+    *ppOutVertices = nullptr;
+    *ppOutIndices = nullptr;
+    *nOutLengths = nullptr;
+    return -1;
   }
 
-  auto it = contours->begin();
-  auto jt = it;
-  /*
-  using two iterators we walk through the entire vector testing to
-  see if some combination of the start and end points match. If we
-  find matching points the two vectorsrs are merged. since when we go
-  thru the vector once we are garanteed that all vectors that can
-  connect to that oone have been merged we only have to merge the
-  vector less the processed nodes at the begining. every merge does
-  force jt back to the beginning of the search tho since a merge will
-  change either the start or the end of the vector
-  */
-  while (it != contours->end())
+  // Transform the vertices in chunks and interleave them
+  const size_t nChunk = 4096;
+  contour_vector<T> x(nChunk);
+  contour_vector<T> y(nChunk);
+  vertex_writer_t<T> writer(pOptions, x.data(), y.data());
+  size_t iVertex = 0;
+  size_t iIndex = 0;
+  auto drain = [&]()
   {
-    jt = it + 1;
-    while (jt != contours->end())
+    writer.flush();
+    for (size_t i = 0; i < writer.size(); i++, iVertex++)
     {
-      if ((*it).end() == (*jt).begin())
-      {
-        /*
-          if the end of *it matches the start ot *jt we can copy
-          *jt to the end of *it and remove jt, the erase funtion
-          does us a favour and increments the iterator to the
-          next element so we continue to test the next element
-        */
-        (*it).merge(*jt);
-        contours->erase(jt);
-        jt = it + 1;
-        c++;
-      }
-      else if ((*jt).end() == (*it).begin())
-      {
-        /*
-          similarily if the end of *jt matches the start ot *it we can copy
-          *it to the end of *jt and remove it,replacing it with jt, we then
-          neet to update it to point at the just inserted record.
-        */
-        (*jt).merge(*it);
-        (*it) = (*jt);
-        contours->erase(jt);
-        jt = it + 1;
-        c++;
-      }
-      else if ((*it).end() == ((*jt).end()))
-      {
-        /*
-          if both segments end at the same point we reverse one and merge
-          it to the other, then remove the one we merged.
-        */
-        (*jt).reverse();
-        (*it).merge(*jt);
-        contours->erase(jt);
-        jt = it + 1;
-        c++;
-      }
-      else if ((*it).begin() == ((*jt).begin()))
-      {
-        /*
-          if both segments start at the same point reverse it, then merge
-          it with jt, removing jt and reseting jt to the start of the search
-          sequence
-        */
-        (*it).reverse();
-        (*it).merge(*jt);
-        jt = contours->erase(jt);
-        c++;
-      }
-      else
+      (*ppOutVertices)[2 * iVertex] = x[i];
+      (*ppOutVertices)[2 * iVertex + 1] = y[i];
+    }
+    writer.truncate(0);
+  };
+  for (size_t iLevel = 0; iLevel < nLevels; iLevel++)
+  {
+    const uint32_t iFirst = static_cast<uint32_t>(iVertex + writer.size());
+    for (const auto& vertex : levels[iLevel].vertices)
+    {
+      writer.put(vertex[0], vertex[1]);
+      if (writer.size() == nChunk)
       {
-        jt++;
+        drain();
       }
     }
-    it++;
+    for (uint32_t index : levels[iLevel].indices)
+    {
+      (*ppOutIndices)[iIndex++] = index == CONTOUR_RESTART_INDEX ? index : iFirst + index;
+    }
+    (*nOutLengths)[iLevel] = levels[iLevel].indices.size();
+    contour_vector<point2_t<double>>().swap(levels[iLevel].vertices);
+    contour_vector<uint32_t>().swap(levels[iLevel].indices);
   }
-  return c;
+  drain();
+
+  *nOutVertices = 2 * nVertices;
+  *nOutIndices = nIndices;
+  *nOutLevels = nLevels;
+  return 0;
 }
 
-// Bjorn Harpe (not good either)
-void sort_segments2(std::vector<std::list<line2_t<double>>>* segments,
-  std::list<std::list<point2_t<double>>>* polygons, size_t** nLevelSegments, size_t* pnLevels)
+int contours_indexed(const double* pData, const size_t nYdata, const size_t nXdata,
+  const double* pY, const size_t nY, const double* pX, const size_t nX, const double* pLevels,
+  const size_t nLevels, const contour_options_t* pOptions, contour_topology_t eTopology,
+  double** ppOutVertices, size_t* nOutVertices, uint32_t** ppOutIndices, size_t* nOutIndices,
+  size_t** nOutLengths, size_t* nOutLevels)
 {
-  size_t nLevels = segments->size();
-  *nLevelSegments = static_cast<size_t*>(malloc(nLevels * sizeof(size_t)));
-  *pnLevels = nLevels;
+  return contour_nothrow(
+    [&]()
+    {
+      return contours_indexed_impl(pData, nYdata, nXdata, pY, nY, pX, nX, pLevels, nLevels,
+        pOptions, eTopology, ppOutVertices, nOutVertices, ppOutIndices, nOutIndices, nOutLengths,
+        nOutLevels);
+    },
+    ppOutVertices, nOutVertices, ppOutIndices, nOutIndices, nOutLengths, nOutLevels);
+}
 
-  size_t nContours = 0;
-  int c = 0;
+int contours_indexed_float(const double* pData, const size_t nYdata, const size_t nXdata,
+  const double* pY, const size_t nY, const double* pX, const size_t nX, const double* pLevels,
+  const size_t nLevels, const contour_options_t* pOptions, contour_topology_t eTopology,
+  float** ppOutVertices, size_t* nOutVertices, uint32_t** ppOutIndices, size_t* nOutIndices,
+  size_t** nOutLengths, size_t* nOutLevels)
+{
+  return contour_nothrow(
+    [&]()
+    {
+      return contours_indexed_impl(pData, nYdata, nXdata, pY, nY, pX, nX, pLevels, nLevels,
+        pOptions, eTopology, ppOutVertices, nOutVertices, ppOutIndices, nOutIndices, nOutLengths,
+        nOutLevels);
+    },
+    ppOutVertices, nOutVertices, ppOutIndices, nOutIndices, nOutLengths, nOutLevels);
+}
 
-  polygons->clear();
+template <typename T>
+int isosurfaces_impl(const double* pData, const size_t nZdata, const size_t nYdata,
+  const size_t nXdata, const double* pZ, const size_t nZ, const double* pY, const size_t nY,
+  const double* pX, const size_t nX, const double* pLevels, const size_t nLevels,
+  const contour_options_t* pOptions, T** ppOutVertices, size_t* nOutVertices,
+  uint32_t** ppOutIndices, size_t* nOutIndices, size_t** nOutLengths, size_t* nOutLevels)
+{
+  *ppOutVertices = nullptr;
+  *nOutVertices = 0;
+  *ppOutIndices = nullptr;
+  *nOutIndices = 0;
+  *nOutLengths = nullptr;
+  *nOutLevels = 0;
 
-  for (size_t iLevel = 0; iLevel < nLevels; iLevel++)
+  if (nZdata != nZ || nYdata != nY || nXdata != nX || nLevels == 0 || nX == 0 || nY == 0 ||
+    nZ == 0)
   {
-    auto& segment = (*segments)[iLevel];
-    //  random access iterator is needed
-    //  std::sort(segment.begin(), segment.end());
+    return -1;
+  }
 
-    std::vector<CContour> contours;
+  // Sample validity
+  contour_vector<unsigned char> valid;
+  const unsigned char* pValid = pOptions ? pOptions->pMask : nullptr;
+  if (pOptions && pOptions->bNaNIsMissing)
+  {
+    const size_t nSamples = nZdata * nYdata * nXdata;
+    valid.resize(nSamples);
+    for (size_t iSample = 0; iSample < nSamples; iSample++)
+    {
+      valid[iSample] = (!pValid || pValid[iSample]) && !std::isnan(pData[iSample]);
+    }
+    pValid = valid.data();
+  }
 
-    segment.sort();
-    while (!segment.empty())
+  // Split cubes along z into slabs
+  const size_t nCubesZ = nZdata > 1 ? nZdata - 1 : 0;
+  const size_t nSlabs = std::max<size_t>(1, std::min<size_t>(thread_count(pOptions), nCubesZ));
+
+  contour_vector<iso_slab_t> slabs(nSlabs);
+  contour_vector<size_t> slabStart(nSlabs + 1);
+  for (size_t iSlab = 0; iSlab <= nSlabs; iSlab++)
+  {
+    slabStart[iSlab] = iSlab * nCubesZ / nSlabs;
+  }
+
+  auto extract = [&](size_t iSlab)
+  {
+    iso_slab_t& slab = slabs[iSlab];
+    slab.edges.resize(nLevels);
+    slab.vertices.resize(nLevels);
+    slab.vertexEdges.resize(nLevels);
+    slab.indices.resize(nLevels);
+    Isosurface(pData, pValid, static_cast<int>(nZdata), static_cast<int>(nYdata),
+      static_cast<int>(nXdata), static_cast<int>(slabStart[iSlab]),
+      static_cast<int>(slabStart[iSlab + 1]), pZ, pY, pX, static_cast<int>(nLevels), pLevels,
+      iso_triangle_add, &slab);
+    if (slab.bFailed)
     {
-      nContours++;
-      auto it = segment.begin();
-      CContour polygon;
-      auto seg = *it;
-      polygon.add_vector(seg[0], seg[1]);
-      it = segment.erase(it);
-      while (it != segment.end())
+      throw std::bad_alloc();
+    }
+    // Edge maps are only needed during extraction
+    slab.edges.clear();
+  };
+
+  if (!run_parallel(nSlabs, extract))
+  {
+    return -1;
+  }
+
+  // Join slabs. Only vertices on edges or samples in the plane between
+  // two slabs can be shared, both are numbered by their lower sample
+  // index.
+  const size_t nPlane = nYdata * nXdata;
+  const size_t zEdge = 4;
+  auto on_plane = [&](size_t edge, size_t iZ)
+  { return ((edge / 8) / nPlane) == iZ && !(((edge % 8) + 1) & zEdge); };
+
+  size_t nVertices = 0;
+  size_t nIndices = 0;
+
+  *nOutLengths = contour_alloc_array<size_t>(nLevels);
+  if (!*nOutLengths)
+  {
+    return -1;
+  }
+
+  // Global vertex index for each slab-local vertex
+  contour_vector<contour_vector<contour_vector<size_t>>> globals(
+    nSlabs, contour_vector<contour_vector<size_t>>(nLevels));
+
+  for (size_t iLevel = 0; iLevel < nLevels; iLevel++)
+  {
+    size_t nTriangleIndices = 0;
+    index_map_t shared;
+    for (size_t iSlab = 0; iSlab < nSlabs; iSlab++)
+    {
+      const auto& vertexEdges = slabs[iSlab].vertexEdges[iLevel];
+      auto& global = globals[iSlab][iLevel];
+      global.resize(vertexEdges.size());
+      for (size_t iVertex = 0; iVertex < vertexEdges.size(); iVertex++)
       {
-        if ((*it)[0] == polygon.end())
+        const size_t edge = vertexEdges[iVertex];
+        if (iSlab > 0 && on_plane(edge, slabStart[iSlab]))
         {
-          polygon.add_vector((*it)[0], (*it)[1]);
-          segment.erase(it);
-          it = segment.begin();
+          auto it = shared.find(edge);
+          if (it != shared.end())
+          {
+            global[iVertex] = it->second;
+            continue;
+          }
         }
-        else
+        else if (iSlab + 1 < nSlabs && on_plane(edge, slabStart[iSlab + 1]))
         {
-          it++;
+          shared.emplace(edge, nVertices);
         }
+        global[iVertex] = nVertices++;
       }
-      contours.push_back(polygon);
-    }
-    c -= merge(&contours);
-    auto it0 = contours.begin();
-    while (it0 != contours.end())
-    {
-      (*it0).condense();
-      it0++;
+      nTriangleIndices += slabs[iSlab].indices[iLevel].size();
     }
+    (*nOutLengths)[iLevel] = nTriangleIndices / 3;
+    nIndices += nTriangleIndices;
+  }
+  if (nVertices > std::numeric_limits<uint32_t>::max())
+  {
+    contour_deallocate(*nOutLengths);
+    *nOutLengths = nullptr;
+    return -1;
+  }
 
-    size_t nContoursAtLevel = 0;
+  *ppOutVertices = contour_alloc_array<T>(3 * nVertices);
+  *ppOutIndices = contour_alloc_array<uint32_t>(nIndices);
+  if ((nVertices && !*ppOutVertices) || (nIndices && !*ppOutIndices))
+  {
+    contour_deallocate(*ppOutVertices);
+    contour_deallocate(*ppOutIndices);
+    contour_deallocate(*nOutLengths);
+    *ppOutVertices = nullptr;
+    *ppOutIndices = nullptr;
+    *nOutLengths = nullptr;
+    return -1;
+  }
 
-    // Move contours to output - dump
-    for (auto tmp : contours)
+  size_t iIndex = 0;
+  for (size_t iLevel = 0; iLevel < nLevels; iLevel++)
+  {
+    for (size_t iSlab = 0; iSlab < nSlabs; iSlab++)
     {
-      std::list<point2_t<double>> nextContour;
-      auto p0 = tmp.begin();
-      nextContour.push_back(p0);
-      auto it1 = tmp.m_contour.begin();
-      while (it1 != tmp.m_contour.end())
+      const auto& global = globals[iSlab][iLevel];
+      const auto& vertices = slabs[iSlab].vertices[iLevel];
+      for (size_t iVertex = 0; iVertex < vertices.size(); iVertex++)
       {
-        p0[0] += (*it1)[0];
-        p0[1] += (*it1)[1];
-        nextContour.push_back(p0);
-        it1++;
+        T* pVertex = &(*ppOutVertices)[3 * global[iVertex]];
+        pVertex[0] = static_cast<T>(vertices[iVertex][0]);
+        pVertex[1] = static_cast<T>(vertices[iVertex][1]);
+        pVertex[2] = static_cast<T>(vertices[iVertex][2]);
+      }
+      for (size_t index : slabs[iSlab].indices[iLevel])
+      {
+        (*ppOutIndices)[iIndex++] = static_cast<uint32_t>(global[index]);
       }
-      polygons->push_back(nextContour);
-      nContoursAtLevel++;
     }
-    (*nLevelSegments)[iLevel] = nContoursAtLevel;
   }
+
+  *nOutVertices = 3 * nVertices;
+  *nOutIndices = nIndices;
+  *nOutLevels = nLevels;
+  return 0;
+}
+
+int isosurfaces(const double* pData, const size_t nZdata, const size_t nYdata, const size_t nXdata,
+  const double* pZ, const size_t nZ, const double* pY, const size_t nY, const double* pX,
+  const size_t nX, const double* pLevels, const size_t nLevels, const contour_options_t* pOptions,
+  double** ppOutVertices, size_t* nOutVertices, uint32_t** ppOutIndices, size_t* nOutIndices,
+  size_t** nOutLengths, size_t* nOutLevels)
+{
+  return contour_nothrow(
+    [&]()
+    {
+      return isosurfaces_impl(pData, nZdata, nYdata, nXdata, pZ, nZ, pY, nY, pX, nX, pLevels,
+        nLevels, pOptions, ppOutVertices, nOutVertices, ppOutIndices, nOutIndices, nOutLengths,
+        nOutLevels);
+    },
+    ppOutVertices, nOutVertices, ppOutIndices, nOutIndices, nOutLengths, nOutLevels);
+}
+
+int isosurfaces_float(const double* pData, const size_t nZdata, const size_t nYdata,
+  const size_t nXdata, const double* pZ, const size_t nZ, const double* pY, const size_t nY,
+  const double* pX, const size_t nX, const double* pLevels, const size_t nLevels,
+  const contour_options_t* pOptions, float** ppOutVertices, size_t* nOutVertices,
+  uint32_t** ppOutIndices, size_t* nOutIndices, size_t** nOutLengths, size_t* nOutLevels)
+{
+  return contour_nothrow(
+    [&]()
+    {
+      return isosurfaces_impl(pData, nZdata, nYdata, nXdata, pZ, nZ, pY, nY, pX, nX, pLevels,
+        nLevels, pOptions, ppOutVertices, nOutVertices, ppOutIndices, nOutIndices, nOutLengths,
+        nOutLevels);
+    },
+    ppOutVertices, nOutVertices, ppOutIndices, nOutIndices, nOutLengths, nOutLevels);
 }
 
 /* Local variables: */
@@ -16,6 +16,8 @@
 #define CONTOUR_EXPORT
 #endif
 
+#include <contour/contour_options.h>
+
 /**
  * Sorted contours
  *
@@ -77,3 +79,470 @@ CONTOUR_EXPORT int contours(const double* pData, const size_t nYdata, const size
   const double* pY, const size_t nY, const double* pX, const size_t nX, const double* pLevels,
   const size_t nLevels, double** ppOutY, size_t* nOutY, double** ppOutX, size_t* nOutX,
   size_t** nOutLengths, size_t* nOutSegments);
+
+/**
+ * Sorted contours with quantized (fixed-point) coordinates
+ *
+ * Same as contours_sorted(), but every vertex is returned as an
+ * integer relative to the grid origin (\p pY[0], \p pX[0]) in units
+ * of the grid spacing scaled by 2^\p nFractionBits, i.e.
+ *
+ *   q = round((x - pX[0]) / (pX[1] - pX[0]) * 2^nFractionBits)
+ *
+ * The unit is the spacing of the first cell, so on a non-uniform grid
+ * q measures distance rather than cells.
+ *
+ * @param[in]  pData
+ * @param[in]  nYdata
+ * @param[in]  nXdata
+ * @param[in]  pY
+ * @param[in]  nY
+ * @param[in]  pX
+ * @param[in]  nX
+ * @param[in]  pLevels
+ * @param[in]  nLevels
+ * @param[in]  nFractionBits Number of sub-cell bits
+ * @param[out] ppOutY Quantized y-coordinates
+ * @param[out] nOutY
+ * @param[out] ppOutX Quantized x-coordinates
+ * @param[out] nOutX
+ * @param[out] nOutLengths  Points per polyline
+ * @param[out] nOutSegments Number of polylines
+ * @param[out] nLevelSegments Polylines per level
+ * @param[out] nLevels2
+ *
+ * @return 0 on success, -1 on error or if the extents of \p pY or \p
+ *         pX are too large to be represented using \p nFractionBits
+ */
+CONTOUR_EXPORT int contours_sorted_quantized(const double* pData, const size_t nYdata,
+  const size_t nXdata, const double* pY, const size_t nY, const double* pX, const size_t nX,
+  const double* pLevels, const size_t nLevels, const unsigned int nFractionBits, int** ppOutY,
+  size_t* nOutY, int** ppOutX, size_t* nOutX, size_t** nOutLengths, size_t* nOutSegments,
+  size_t** nLevelSegments, size_t* nLevels2);
+
+/**
+ * Sorted contours with quantized, delta-encoded coordinates
+ *
+ * Coordinates are quantized as for contours_sorted_quantized(). For
+ * each polyline, the vertices are written as (x, y) pairs of
+ * differences to the previous vertex (the first vertex relative to
+ * 0), zigzag-encoded and stored as unsigned LEB128 varints.
+ *
+ * @param[in]  pData
+ * @param[in]  nYdata
+ * @param[in]  nXdata
+ * @param[in]  pY
+ * @param[in]  nY
+ * @param[in]  pX
+ * @param[in]  nX
+ * @param[in]  pLevels
+ * @param[in]  nLevels
+ * @param[in]  nFractionBits Number of sub-cell bits
+ * @param[out] ppOutBytes Encoded vertices
+ * @param[out] nOutBytes  Number of bytes
+ * @param[out] nOutLengths  Points per polyline
+ * @param[out] nOutSegments Number of polylines
+ * @param[out] nLevelSegments Polylines per level
+ * @param[out] nLevels2
+ *
+ * @return 0 on success, -1 on error
+ */
+CONTOUR_EXPORT int contours_sorted_encoded(const double* pData, const size_t nYdata,
+  const size_t nXdata, const double* pY, const size_t nY, const double* pX, const size_t nX,
+  const double* pLevels, const size_t nLevels, const unsigned int nFractionBits,
+  unsigned char** ppOutBytes, size_t* nOutBytes, size_t** nOutLengths, size_t* nOutSegments,
+  size_t** nLevelSegments, size_t* nLevels2);
+
+/**
+ * Compute contours using options
+ *
+ * Same as contours(), but with options, see contour_options_t. If
+ * \p pOptions is NULL, defaults are used.
+ *
+ * @param[in] pData
+ * @param[in] nYdata
+ * @param[in] nXdata
+ * @param[in] pY
+ * @param[in] nY
+ * @param[in] pX
+ * @param[in] nX
+ * @param[in] pLevels
+ * @param[in] nLevels
+ * @param[in] pOptions Options (may be NULL)
+ * @param[out] ppOutY
+ * @param[out] nOutY
+ * @param[out] ppOutX
+ * @param[out] nOutX
+ * @param[out] nOutLengths
+ * @param[out] nOutSegments
+ *
+ * @return 0 on success, -1 on error, CONTOUR_CANCELLED if cancelled
+ */
+CONTOUR_EXPORT int contours_ex(const double* pData, const size_t nYdata, const size_t nXdata,
+  const double* pY, const size_t nY, const double* pX, const size_t nX, const double* pLevels,
+  const size_t nLevels, const contour_options_t* pOptions, double** ppOutY, size_t* nOutY,
+  double** ppOutX, size_t* nOutX, size_t** nOutLengths, size_t* nOutSegments);
+
+/**
+ * Sorted contours using options
+ *
+ * Same as contours_sorted(), but with options, see
+ * contour_options_t. If \p pOptions is NULL, defaults are used. With
+ * \p pOptions->eEngine set to CONTOUR_ENGINE_TRACE, the lines are
+ * traced directly into the output without storing any segments.
+ * Otherwise the segments of each level are connected in chunks on
+ * \p pOptions->nThreads threads, and the output is the same for any
+ * number of threads.
+ *
+ * @param[in]  pData
+ * @param[in]  nYdata
+ * @param[in]  nXdata
+ * @param[in]  pY
+ * @param[in]  nY
+ * @param[in]  pX
+ * @param[in]  nX
+ * @param[in]  pLevels
+ * @param[in]  nLevels
+ * @param[in]  pOptions Options (may be NULL)
+ * @param[out] ppOutY
+ * @param[out] nOutY
+ * @param[out] ppOutX
+ * @param[out] nOutX
+ * @param[out] nOutLengths
+ * @param[out] nOutSegments
+ * @param[out] nLevelSegments
+ * @param[out] nLevels2
+ *
+ * @return 0 on success, -1 on error, CONTOUR_CANCELLED if cancelled
+ */
+CONTOUR_EXPORT int contours_sorted_ex(const double* pData, const size_t nYdata,
+  const size_t nXdata, const double* pY, const size_t nY, const double* pX, const size_t nX,
+  const double* pLevels, const size_t nLevels, const contour_options_t* pOptions,
+  double** ppOutY, size_t* nOutY, double** ppOutX, size_t* nOutX, size_t** nOutLengths,
+  size_t* nOutSegments, size_t** nLevelSegments, size_t* nLevels2);
+
+/**
+ * Contour segments through a callback
+ *
+ * Same as contours_visit() in contour_visit.hpp, but with a function
+ * pointer and a user pointer for use through a C API. The callback
+ * receives (x1, y1, x2, y2, level, pUser) for each segment.
+ *
+ * @param[in]  pData
+ * @param[in]  nYdata
+ * @param[in]  nXdata
+ * @param[in]  pY
+ * @param[in]  nY
+ * @param[in]  pX
+ * @param[in]  nX
+ * @param[in]  pLevels
+ * @param[in]  nLevels
+ * @param[in]  pOptions  Options (may be NULL)
+ * @param[in]  pCallback Called for each segment
+ * @param[in]  pUser     Passed to the callback
+ *
+ * @return 0 on success, -1 on error, CONTOUR_CANCELLED if cancelled
+ */
+CONTOUR_EXPORT int contours_callback(const double* pData, const size_t nYdata,
+  const size_t nXdata, const double* pY, const size_t nY, const double* pX, const size_t nX,
+  const double* pLevels, const size_t nLevels, const contour_options_t* pOptions,
+  void (*pCallback)(double x1, double y1, double x2, double y2, int level, void* pUser),
+  void* pUser);
+
+/**
+ * Contour statistics without geometry
+ *
+ * Walks the cells as contours() does, accumulating the total length
+ * of the segments of each level and the area of each band of the
+ * piecewise linear interpolant over the triangles of the cells. Band
+ * k holds the values in [pLevels[k - 1], pLevels[k]), with band 0
+ * below the first level and band \p nLevels above the last, so the
+ * area above level k is the sum of the bands above k. Cells touching
+ * missing samples are excluded. Rows are processed by \p
+ * pOptions->nThreads threads, and memory is independent of the grid
+ * size.
+ *
+ * @param[in]  pData
+ * @param[in]  nYdata
+ * @param[in]  nXdata
+ * @param[in]  pY
+ * @param[in]  nY
+ * @param[in]  pX
+ * @param[in]  nX
+ * @param[in]  pLevels
+ * @param[in]  nLevels
+ * @param[in]  pOptions     Options (may be NULL)
+ * @param[out] ppOutLengths Contour length of each level
+ * @param[out] nOutLengths  Number of lengths (equals nLevels)
+ * @param[out] ppOutAreas   Area of each band
+ * @param[out] nOutAreas    Number of areas (equals nLevels + 1)
+ *
+ * @return 0 on success, -1 on error
+ */
+CONTOUR_EXPORT int contours_statistics(const double* pData, const size_t nYdata,
+  const size_t nXdata, const double* pY, const size_t nY, const double* pX, const size_t nX,
+  const double* pLevels, const size_t nLevels, const contour_options_t* pOptions,
+  double** ppOutLengths, size_t* nOutLengths, double** ppOutAreas, size_t* nOutAreas);
+
+/**
+ * Contour levels from the data
+ *
+ * Chooses up to \p nLevels levels as selected by \p
+ * pOptions->eLevels, see contour_options_t. Only valid, finite
+ * samples in the window of the options are used, so no separate
+ * pass over the data is needed for the range. The
+ * minimum, the maximum and a histogram of the samples are gathered
+ * in a single sweep using \p pOptions->nThreads threads. Quantiles
+ * are refined by a second sweep over the rows holding them, and are
+ * accurate to a 4096th of the data range or better.
+ *
+ * @param[in]  pData
+ * @param[in]  nYdata
+ * @param[in]  nXdata
+ * @param[in]  nLevels     Maximum number of levels
+ * @param[in]  pOptions    Options (may be NULL)
+ * @param[out] ppOutLevels Increasing levels
+ * @param[out] nOutLevels  Number of levels
+ *
+ * @return 0 on success, -1 on error or if no levels can be chosen,
+ *         e.g. if all samples are equal
+ */
+CONTOUR_EXPORT int contour_levels(const double* pData, const size_t nYdata,
+  const size_t nXdata, const size_t nLevels, const contour_options_t* pOptions,
+  double** ppOutLevels, size_t* nOutLevels);
+
+/**
+ * Sorted contours at levels chosen from the data
+ *
+ * Same as contours_sorted_ex() at the levels of contour_levels(),
+ * which are returned with the contours. Levels are chosen from the
+ * samples in the clip box if one is given. Rows at the top and bottom
+ * of the window that no level passes through are skipped using the
+ * ranges gathered while choosing the levels.
+ *
+ * @param[in]  pData
+ * @param[in]  nYdata
+ * @param[in]  nXdata
+ * @param[in]  pY
+ * @param[in]  nY
+ * @param[in]  pX
+ * @param[in]  nX
+ * @param[in]  nLevels        Maximum number of levels
+ * @param[in]  pOptions       Options (may be NULL)
+ * @param[out] ppOutLevels    Levels
+ * @param[out] nOutLevels     Number of levels
+ * @param[out] ppOutY
+ * @param[out] nOutY
+ * @param[out] ppOutX
+ * @param[out] nOutX
+ * @param[out] nOutLengths
+ * @param[out] nOutSegments
+ * @param[out] nLevelSegments
+ * @param[out] nLevels2
+ *
+ * @return 0 on success, -1 on error, CONTOUR_CANCELLED if cancelled
+ */
+CONTOUR_EXPORT int contours_sorted_auto(const double* pData, const size_t nYdata,
+  const size_t nXdata, const double* pY, const size_t nY, const double* pX, const size_t nX,
+  const size_t nLevels, const contour_options_t* pOptions, double** ppOutLevels,
+  size_t* nOutLevels, double** ppOutY, size_t* nOutY, double** ppOutX, size_t* nOutX,
+  size_t** nOutLengths, size_t* nOutSegments, size_t** nLevelSegments, size_t* nLevels2);
+
+/**
+ * Contours as shared vertices and an index buffer
+ *
+ * Vertices are identified by the cell edge they lie on while the
+ * segments are extracted, so each vertex of a level is stored once
+ * however many segments meet at it. With CONTOUR_TOPOLOGY_LINES, the
+ * indices are the segments of contours(), two per segment. With
+ * CONTOUR_TOPOLOGY_STRIPS, the lines are traced as by the trace
+ * engine of contours_sorted_ex() and each polyline is followed by
+ * CONTOUR_RESTART_INDEX. Indices are 32 bits wide, so the buffers can
+ * be uploaded as they are, and at most 0xFFFFFFFF vertices are
+ * supported.
+ * Consecutive points sharing a vertex are merged, so polylines along
+ * samples on a level may be shorter or dropped. Closed polylines end
+ * with the index of their first vertex. The vertices of each level are
+ * consecutive and the indices refer to the whole vertex array. The
+ * transforms of the options are applied to the vertices, and the clip
+ * box is not supported.
+ *
+ * @param[in]  pData
+ * @param[in]  nYdata
+ * @param[in]  nXdata
+ * @param[in]  pY
+ * @param[in]  nY
+ * @param[in]  pX
+ * @param[in]  nX
+ * @param[in]  pLevels
+ * @param[in]  nLevels
+ * @param[in]  pOptions      Options (may be NULL), pClip must be NULL
+ * @param[in]  eTopology     Layout of the indices
+ * @param[out] ppOutVertices Vertices as (x, y) pairs
+ * @param[out] nOutVertices  Number of values (2 times number of vertices)
+ * @param[out] ppOutIndices  Vertex indices
+ * @param[out] nOutIndices   Number of indices
+ * @param[out] nOutLengths   Number of indices for each level
+ * @param[out] nOutLevels    Number of levels (equals nLevels)
+ *
+ * @return 0 on success, -1 on error or if there are too many vertices,
+ *         CONTOUR_CANCELLED if cancelled
+ */
+CONTOUR_EXPORT int contours_indexed(const double* pData, const size_t nYdata,
+  const size_t nXdata, const double* pY, const size_t nY, const double* pX, const size_t nX,
+  const double* pLevels, const size_t nLevels, const contour_options_t* pOptions,
+  contour_topology_t eTopology, double** ppOutVertices, size_t* nOutVertices,
+  uint32_t** ppOutIndices, size_t* nOutIndices, size_t** nOutLengths, size_t* nOutLevels);
+
+/**
+ * Compute isosurfaces for a 3D double-precision floating point volume
+ *
+ * The volume \p pData is row-major with dimensions (\p nZdata, \p
+ * nYdata, \p nXdata) and rectilinear coordinates \p pZ, \p pY and \p
+ * pX. Each cube is split into six tetrahedra (marching tetrahedra),
+ * the 3D counterpart of the triangles used for contours(). The
+ * volume is processed in slabs along z using \p pOptions->nThreads
+ * threads.
+ *
+ * The output is an indexed triangle mesh per level. Vertices lying on
+ * the same lattice edge are shared between triangles of the same
+ * level. Triangles are oriented with normals towards lower values.
+ *
+ * @param[in] pData  Volume data
+ * @param[in] nZdata Dimension z (major index)
+ * @param[in] nYdata Dimension y
+ * @param[in] nXdata Dimension x (minor index)
+ * @param[in] pZ     Z-coordinates
+ * @param[in] nZ     Number of z-coordinates
+ * @param[in] pY     Y-coordinates
+ * @param[in] nY     Number of y-coordinates
+ * @param[in] pX     X-coordinates
+ * @param[in] nX     Number of x-coordinates
+ * @param[in] pLevels Contour levels (increasing)
+ * @param[in] nLevels Number of levels
+ * @param[in] pOptions Options (may be NULL), mask has the dimensions of the volume
+ * @param[out] ppOutVertices Vertices as (x, y, z) triplets
+ * @param[out] nOutVertices  Number of values (3 times number of vertices)
+ * @param[out] ppOutIndices  Vertex indices, three per triangle
+ * @param[out] nOutIndices   Number of indices (3 times number of triangles)
+ * @param[out] nOutLengths   Number of triangles for each level
+ * @param[out] nOutLevels    Number of levels (equals nLevels)
+ *
+ * @return 0 on success, -1 on error or if there are too many vertices
+ *         for 32-bit indices
+ */
+CONTOUR_EXPORT int isosurfaces(const double* pData, const size_t nZdata, const size_t nYdata,
+  const size_t nXdata, const double* pZ, const size_t nZ, const double* pY, const size_t nY,
+  const double* pX, const size_t nX, const double* pLevels, const size_t nLevels,
+  const contour_options_t* pOptions, double** ppOutVertices, size_t* nOutVertices,
+  uint32_t** ppOutIndices, size_t* nOutIndices, size_t** nOutLengths, size_t* nOutLevels);
+
+/**
+ * Sorted contours for an unstructured triangle mesh
+ *
+ * The nodal values \p pData are given at vertices with coordinates
+ * \p pY and \p pX. The triangles are given as an array \p pTriangles
+ * of vertex indices, three per triangle. Each triangle is classified
+ * as the triangles used by contours() and the resulting lines are
+ * joined through shared mesh edges. The output is organized as for
+ * contours_sorted().
+ *
+ * @param[in]  pData    Nodal values
+ * @param[in]  nData    Number of vertices
+ * @param[in]  pY       Y-coordinates of vertices
+ * @param[in]  nY       Number of y-coordinates (equals nData)
+ * @param[in]  pX       X-coordinates of vertices
+ * @param[in]  nX       Number of x-coordinates (equals nData)
+ * @param[in]  pTriangles Vertex indices, three per triangle
+ * @param[in]  nTriangleIndices Number of indices (3 times number of triangles)
+ * @param[in]  pLevels  Contour levels (increasing)
+ * @param[in]  nLevels  Number of levels
+ * @param[in]  pOptions Options (may be NULL), mask has one value per vertex
+ * @param[out] ppOutY
+ * @param[out] nOutY
+ * @param[out] ppOutX
+ * @param[out] nOutX
+ * @param[out] nOutLengths  Points per polyline
+ * @param[out] nOutSegments Number of polylines
+ * @param[out] nLevelSegments Polylines per level
+ * @param[out] nLevels2
+ *
+ * @return 0 on success, -1 on error
+ */
+CONTOUR_EXPORT int contours_mesh(const double* pData, const size_t nData, const double* pY,
+  const size_t nY, const double* pX, const size_t nX, const size_t* pTriangles,
+  const size_t nTriangleIndices, const double* pLevels, const size_t nLevels,
+  const contour_options_t* pOptions, double** ppOutY, size_t* nOutY, double** ppOutX,
+  size_t* nOutX, size_t** nOutLengths, size_t* nOutSegments, size_t** nLevelSegments,
+  size_t* nLevels2);
+
+/**
+ * Contours with single-precision output coordinates
+ *
+ * Same as contours_ex(), but the coordinates are written as float,
+ * which halves the size of the output. Computation is carried out in
+ * double precision and rounded once when writing the output.
+ *
+ * @return 0 on success, -1 on error, CONTOUR_CANCELLED if cancelled
+ */
+CONTOUR_EXPORT int contours_float(const double* pData, const size_t nYdata, const size_t nXdata,
+  const double* pY, const size_t nY, const double* pX, const size_t nX, const double* pLevels,
+  const size_t nLevels, const contour_options_t* pOptions, float** ppOutY, size_t* nOutY,
+  float** ppOutX, size_t* nOutX, size_t** nOutLengths, size_t* nOutSegments);
+
+/**
+ * Sorted contours with single-precision output coordinates
+ *
+ * Same as contours_sorted_ex(), but the coordinates are written as
+ * float.
+ *
+ * @return 0 on success, -1 on error, CONTOUR_CANCELLED if cancelled
+ */
+CONTOUR_EXPORT int contours_sorted_float(const double* pData, const size_t nYdata,
+  const size_t nXdata, const double* pY, const size_t nY, const double* pX, const size_t nX,
+  const double* pLevels, const size_t nLevels, const contour_options_t* pOptions,
+  float** ppOutY, size_t* nOutY, float** ppOutX, size_t* nOutX, size_t** nOutLengths,
+  size_t* nOutSegments, size_t** nLevelSegments, size_t* nLevels2);
+
+/**
+ * Indexed contours with single-precision vertices
+ *
+ * Same as contours_indexed(), but the vertices are written as float.
+ *
+ * @return 0 on success, -1 on error or if there are too many vertices,
+ *         CONTOUR_CANCELLED if cancelled
+ */
+CONTOUR_EXPORT int contours_indexed_float(const double* pData, const size_t nYdata,
+  const size_t nXdata, const double* pY, const size_t nY, const double* pX, const size_t nX,
+  const double* pLevels, const size_t nLevels, const contour_options_t* pOptions,
+  contour_topology_t eTopology, float** ppOutVertices, size_t* nOutVertices,
+  uint32_t** ppOutIndices, size_t* nOutIndices, size_t** nOutLengths, size_t* nOutLevels);
+
+/**
+ * Isosurfaces with single-precision vertices
+ *
+ * Same as isosurfaces(), but the vertices are written as float.
+ *
+ * @return 0 on success, -1 on error or if there are too many vertices
+ *         for 32-bit indices
+ */
+CONTOUR_EXPORT int isosurfaces_float(const double* pData, const size_t nZdata,
+  const size_t nYdata, const size_t nXdata, const double* pZ, const size_t nZ, const double* pY,
+  const size_t nY, const double* pX, const size_t nX, const double* pLevels,
+  const size_t nLevels, const contour_options_t* pOptions, float** ppOutVertices,
+  size_t* nOutVertices, uint32_t** ppOutIndices, size_t* nOutIndices, size_t** nOutLengths,
+  size_t* nOutLevels);
+
+/**
+ * Mesh contours with single-precision output coordinates
+ *
+ * Same as contours_mesh(), but the coordinates are written as float.
+ *
+ * @return 0 on success, -1 on error
+ */
+CONTOUR_EXPORT int contours_mesh_float(const double* pData, const size_t nData,
+  const double* pY, const size_t nY, const double* pX, const size_t nX, const size_t* pTriangles,
+  const size_t nTriangleIndices, const double* pLevels, const size_t nLevels,
+  const contour_options_t* pOptions, float** ppOutY, size_t* nOutY, float** ppOutX,
+  size_t* nOutX, size_t** nOutLengths, size_t* nOutSegments, size_t** nLevelSegments,
+  size_t* nLevels2);
@@ -0,0 +1,73 @@
+/**
+ * @file   contour_alloc.cpp
+ * @brief  Allocator hooks used for all library allocations
+ *
+ * Copyright 2018 Jens Munk Hansen
+ */
+
+#include <contour/contour_alloc.hpp>
+
+#include <cstdlib>
+
+namespace
+{
+// malloc is suitably aligned for any alignment requested by the library
+void* default_allocate(size_t nBytes, size_t, void*)
+{
+  return malloc(nBytes);
+}
+
+void* default_reallocate(void* ptr, size_t nBytes, size_t, void*)
+{
+  return realloc(ptr, nBytes);
+}
+
+void default_free(void* ptr, void*)
+{
+  free(ptr);
+}
+
+constexpr contour_allocator_t g_defaultAllocator = { default_allocate, default_reallocate,
+  default_free, nullptr };
+
+contour_allocator_t g_allocator = g_defaultAllocator;
+
+} // namespace
+
+extern "C" {
+
+void contour_set_allocator(const contour_allocator_t* pAllocator)
+{
+  g_allocator = (pAllocator && pAllocator->pAllocate && pAllocator->pFree) ? *pAllocator
+                                                                          : g_defaultAllocator;
+}
+
+void contour_get_allocator(contour_allocator_t* pAllocator)
+{
+  *pAllocator = g_allocator;
+}
+
+} // extern "C"
+
+void* contour_allocate(size_t nBytes, size_t nAlignment)
+{
+  // Zero-sized requests yield a unique pointer like malloc on most platforms
+  return g_allocator.pAllocate(nBytes ? nBytes : 1, nAlignment, g_allocator.pUser);
+}
+
+void* contour_reallocate(void* ptr, size_t nBytes, size_t nAlignment)
+{
+  if (!g_allocator.pReallocate)
+  {
+    return nullptr;
+  }
+  return g_allocator.pReallocate(ptr, nBytes ? nBytes : 1, nAlignment, g_allocator.pUser);
+}
+
+void contour_deallocate(void* ptr)
+{
+  if (ptr)
+  {
+    g_allocator.pFree(ptr, g_allocator.pUser);
+  }
+}
@@ -0,0 +1,69 @@
+/**
+ * @file   contour_alloc.h
+ * @brief  Allocator hooks used for all library allocations
+ *
+ * Copyright 2018 Jens Munk Hansen
+ */
+
+#ifndef CONTOUR_ALLOC_H
+#define CONTOUR_ALLOC_H
+
+#include <stddef.h>
+
+#ifdef USE_CMAKE
+#include <contour/contour_export.h>
+#else
+#define CONTOUR_EXPORT
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Allocator hooks. The alignment is a power of two no larger than
+ * the alignment of max_align_t.
+ */
+typedef struct contour_allocator
+{
+  /** Allocate nBytes, return NULL on failure */
+  void* (*pAllocate)(size_t nBytes, size_t nAlignment, void* pUser);
+
+  /**
+   * Resize a block, return NULL on failure leaving the block
+   * untouched. May be NULL, in which case blocks are never resized.
+   */
+  void* (*pReallocate)(void* ptr, size_t nBytes, size_t nAlignment, void* pUser);
+
+  /** Free a block, ptr may be NULL */
+  void (*pFree)(void* ptr, void* pUser);
+
+  /** User context passed to the hooks */
+  void* pUser;
+} contour_allocator_t;
+
+/**
+ * Set the allocator used for all library allocations, including
+ * output arrays, handles and internal containers. Output arrays are
+ * freed through it by contour_free().
+ *
+ * The allocator is global. It must be set while no library call is
+ * running, and blocks must be freed with the allocator that
+ * allocated them, so set it before the first call. The Python
+ * bindings release output arrays with contour_free() as well.
+ *
+ * @param pAllocator Allocator or NULL to restore malloc, realloc and free
+ */
+CONTOUR_EXPORT void contour_set_allocator(const contour_allocator_t* pAllocator);
+
+/**
+ * Get the allocator currently in use.
+ * @param pAllocator [out] Allocator
+ */
+CONTOUR_EXPORT void contour_get_allocator(contour_allocator_t* pAllocator);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CONTOUR_ALLOC_H */
@@ -0,0 +1,146 @@
+/**
+ * @file   contour_alloc.hpp
+ * @brief  Allocation through the hooks of contour_alloc.h
+ *
+ * Copyright 2018 Jens Munk Hansen
+ */
+
+#pragma once
+
+#include <contour/contour_alloc.h>
+
+#include <cstddef>
+#include <exception>
+#include <list>
+#include <new>
+#include <utility>
+#include <vector>
+
+CONTOUR_EXPORT void* contour_allocate(size_t nBytes, size_t nAlignment);
+
+// Returns nullptr if resizing fails or is not supported
+CONTOUR_EXPORT void* contour_reallocate(void* ptr, size_t nBytes, size_t nAlignment);
+
+CONTOUR_EXPORT void contour_deallocate(void* ptr);
+
+// Array of n uninitialized elements, free with contour_deallocate
+template <typename T>
+T* contour_alloc_array(size_t n)
+{
+  return static_cast<T*>(contour_allocate(n * sizeof(T), alignof(T)));
+}
+
+// Replacement for new, destroy with contour_delete
+template <typename T, typename... Args>
+T* contour_new(Args&&... args)
+{
+  void* p = contour_allocate(sizeof(T), alignof(T));
+  if (!p)
+  {
+    throw std::bad_alloc();
+  }
+  try
+  {
+    return new (p) T(std::forward<Args>(args)...);
+  }
+  catch (...)
+  {
+    contour_deallocate(p);
+    throw;
+  }
+}
+
+template <typename T>
+void contour_delete(T* p)
+{
+  if (p)
+  {
+    p->~T();
+    contour_deallocate(const_cast<void*>(static_cast<const void*>(p)));
+  }
+}
+
+// Standard allocator using the hooks
+template <typename T>
+class contour_stl_allocator
+{
+public:
+  using value_type = T;
+
+  contour_stl_allocator() noexcept = default;
+
+  template <typename U>
+  contour_stl_allocator(const contour_stl_allocator<U>&) noexcept
+  {
+  }
+
+  T* allocate(size_t n)
+  {
+    T* p = contour_alloc_array<T>(n);
+    if (!p)
+    {
+      throw std::bad_alloc();
+    }
+    return p;
+  }
+
+  void deallocate(T* p, size_t)
+  {
+    contour_deallocate(p);
+  }
+};
+
+template <typename T, typename U>
+bool operator==(const contour_stl_allocator<T>&, const contour_stl_allocator<U>&)
+{
+  return true;
+}
+
+template <typename T, typename U>
+bool operator!=(const contour_stl_allocator<T>&, const contour_stl_allocator<U>&)
+{
+  return false;
+}
+
+template <typename T>
+using contour_vector = std::vector<T, contour_stl_allocator<T>>;
+
+template <typename T>
+using contour_list = std::list<T, contour_stl_allocator<T>>;
+
+// Clear the outputs of an exported function, pairs of an array and its
+// length, freeing the arrays if bFree
+inline void contour_clear_outputs(bool)
+{
+}
+
+template <typename T, typename... Outputs>
+void contour_clear_outputs(bool bFree, T** ppOut, size_t* nOut, Outputs... outputs)
+{
+  if (bFree)
+  {
+    contour_deallocate(*ppOut);
+  }
+  *ppOut = nullptr;
+  *nOut = 0;
+  contour_clear_outputs(bFree, outputs...);
+}
+
+// Call f of an exported function returning a status. Hooks returning
+// NULL make containers throw std::bad_alloc, which must not cross the C
+// interface, so exceptions are turned into -1. The outputs are cleared
+// before the call and freed if it throws.
+template <typename F, typename... Outputs>
+int contour_nothrow(F&& f, Outputs... outputs) noexcept
+{
+  contour_clear_outputs(false, outputs...);
+  try
+  {
+    return f();
+  }
+  catch (const std::exception&)
+  {
+    contour_clear_outputs(true, outputs...);
+    return -1;
+  }
+}
@@ -0,0 +1,157 @@
+/**
+ * @file   contour_bench.cpp
+ * @brief  Timings of segment extraction and connection
+ *
+ * Usage: contour_bench [size] [repetitions]
+ *
+ * Contours a size x size grid (default 6000) at 9 levels and prints
+ * the best time of each case over the repetitions (default 3).
+ *
+ * Copyright 2018 Jens Munk Hansen
+ */
+
+#include <contour/contour.hpp>
+#include <contour/contour_capi.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <vector>
+
+namespace
+{
+struct grid_t
+{
+  std::vector<double> data;
+  std::vector<double> y;
+  std::vector<double> x;
+  std::vector<double> levels;
+};
+
+grid_t make_grid(size_t n, bool bNaN)
+{
+  grid_t grid;
+  grid.y.resize(n);
+  grid.x.resize(n);
+  for (size_t i = 0; i < n; i++)
+  {
+    grid.y[i] = 0.01 * static_cast<double>(i);
+    grid.x[i] = 0.01 * static_cast<double>(i);
+  }
+  grid.data.resize(n * n);
+  for (size_t i = 0; i < n; i++)
+  {
+    for (size_t j = 0; j < n; j++)
+    {
+      grid.data[i * n + j] = std::sin(0.7 * grid.y[i]) * std::cos(0.5 * grid.x[j]) +
+        0.1 * std::sin(0.05 * grid.x[j] * grid.y[i]);
+    }
+  }
+  if (bNaN)
+  {
+    // One sample in 97 is missing
+    for (size_t k = 0; k < grid.data.size(); k += 97)
+    {
+      grid.data[k] = std::numeric_limits<double>::quiet_NaN();
+    }
+  }
+  for (int k = 0; k < 9; k++)
+  {
+    grid.levels.push_back(-0.8 + 0.2 * k);
+  }
+  return grid;
+}
+
+void count_segment(double, double, double, double, int, void* pUser)
+{
+  (*static_cast<size_t*>(pUser))++;
+}
+
+// Best time in seconds of f over the repetitions
+template <typename F>
+double best_of(int nRepetitions, F&& f)
+{
+  double best = std::numeric_limits<double>::max();
+  for (int r = 0; r < nRepetitions; r++)
+  {
+    const auto start = std::chrono::steady_clock::now();
+    f();
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    best = std::min(best, elapsed.count());
+  }
+  return best;
+}
+
+void time_callback(
+  const char* label, const grid_t& grid, const contour_options_t& options, int nRepetitions)
+{
+  const size_t n = grid.x.size();
+  size_t nSegments = 0;
+  const double seconds = best_of(nRepetitions,
+    [&]()
+    {
+      nSegments = 0;
+      contours_callback(grid.data.data(), n, n, grid.y.data(), n, grid.x.data(), n,
+        grid.levels.data(), grid.levels.size(), &options, count_segment, &nSegments);
+    });
+  printf("%s: %.3f s, %zu segments\n", label, seconds, nSegments);
+}
+
+void time_sorted(
+  const char* label, const grid_t& grid, const contour_options_t& options, int nRepetitions)
+{
+  const size_t n = grid.x.size();
+  size_t nPoints = 0;
+  size_t nPolylines = 0;
+  const double seconds = best_of(nRepetitions,
+    [&]()
+    {
+      double* pOutY = nullptr;
+      double* pOutX = nullptr;
+      size_t* pLengths = nullptr;
+      size_t* pLevelSegments = nullptr;
+      size_t nOutY = 0;
+      size_t nLevels = 0;
+      contours_sorted_ex(grid.data.data(), n, n, grid.y.data(), n, grid.x.data(), n,
+        grid.levels.data(), grid.levels.size(), &options, &pOutY, &nOutY, &pOutX, &nPoints,
+        &pLengths, &nPolylines, &pLevelSegments, &nLevels);
+      contour_free(pOutY);
+      contour_free(pOutX);
+      contour_free(pLengths);
+      contour_free(pLevelSegments);
+    });
+  printf("%s: %.3f s, %zu points, %zu polylines\n", label, seconds, nPoints, nPolylines);
+}
+} // namespace
+
+int main(int argc, char* argv[])
+{
+  const size_t n = argc > 1 ? static_cast<size_t>(std::atol(argv[1])) : 6000;
+  const int nRepetitions = argc > 2 ? std::atoi(argv[2]) : 3;
+  if (n < 2 || nRepetitions < 1)
+  {
+    fprintf(stderr, "Usage: %s [size] [repetitions]\n", argv[0]);
+    return 1;
+  }
+
+  const grid_t grid = make_grid(n, false);
+  const grid_t missing = make_grid(n, true);
+
+  contour_options_t options;
+  contour_options_init(&options);
+  options.nThreads = 1;
+  contour_options_t nanOptions = options;
+  nanOptions.bNaNIsMissing = 1;
+  contour_options_t threadOptions = options;
+  threadOptions.nThreads = 0;
+
+  printf("%zu x %zu grid, %zu levels, best of %d\n", n, n, grid.levels.size(), nRepetitions);
+  time_callback("callback, no mask", grid, options, nRepetitions);
+  time_callback("callback, NaN mask", missing, nanOptions, nRepetitions);
+  time_sorted("sorted, one thread", grid, options, nRepetitions);
+  time_sorted("sorted, all threads", grid, threadOptions, nRepetitions);
+  return 0;
+}
@@ -0,0 +1,458 @@
+/**
+ * @file   contour_cache.cpp
+ * @brief  Content-addressed LRU cache of sorted contours
+ *
+ * Copyright 2018 Jens Munk Hansen
+ */
+
+#include <contour/contour.hpp>
+#include <contour/contour_alloc.hpp>
+#include <contour/contour_cache.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+namespace
+{
+// Two-lane 64-bit hash over the bytes of all inputs
+class hasher_t
+{
+public:
+  hasher_t()
+    : m_h0(0x9E3779B97F4A7C15ULL)
+    , m_h1(0xC2B2AE3D27D4EB4FULL)
+  {
+  }
+
+  void update(const void* pBytes, size_t nBytes)
+  {
+    const unsigned char* p = static_cast<const unsigned char*>(pBytes);
+    const size_t nWords = nBytes / 8;
+    for (size_t iWord = 0; iWord < nWords; iWord++)
+    {
+      uint64_t w;
+      memcpy(&w, p + 8 * iWord, 8);
+      mix(w);
+    }
+    uint64_t tail = 0;
+    memcpy(&tail, p + 8 * nWords, nBytes - 8 * nWords);
+    mix(tail ^ (uint64_t(nBytes) << 56));
+  }
+
+  void update(size_t value)
+  {
+    mix(static_cast<uint64_t>(value));
+  }
+
+  std::pair<uint64_t, uint64_t> digest() const
+  {
+    return { finalize(m_h0), finalize(m_h1 ^ m_h0) };
+  }
+
+private:
+  static uint64_t rotl(uint64_t x, int r)
+  {
+    return (x << r) | (x >> (64 - r));
+  }
+
+  static uint64_t finalize(uint64_t h)
+  {
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDULL;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ULL;
+    h ^= h >> 33;
+    return h;
+  }
+
+  void mix(uint64_t w)
+  {
+    m_h0 = rotl(m_h0 ^ (w * 0x87C37B91114253D5ULL), 31) * 0x4CF5AD432745937FULL;
+    m_h1 = rotl(m_h1 ^ (w * 0x4CF5AD432745937FULL), 29) * 0x87C37B91114253D5ULL + 0x52DCE729;
+  }
+
+  uint64_t m_h0;
+  uint64_t m_h1;
+};
+
+struct key_hash_t
+{
+  size_t operator()(const std::pair<uint64_t, uint64_t>& key) const
+  {
+    return static_cast<size_t>(key.first);
+  }
+};
+
+// Output of contours_sorted_ex, owned
+struct entry_t
+{
+  double* pY = nullptr;
+  size_t nY = 0;
+  double* pX = nullptr;
+  size_t nX = 0;
+  size_t* pLengths = nullptr;
+  size_t nSegments = 0;
+  size_t* pLevelSegments = nullptr;
+  size_t nLevels = 0;
+
+  ~entry_t()
+  {
+    contour_deallocate(pY);
+    contour_deallocate(pX);
+    contour_deallocate(pLengths);
+    contour_deallocate(pLevelSegments);
+  }
+
+  size_t bytes() const
+  {
+    return sizeof(entry_t) + (nY + nX) * sizeof(double) + (nSegments + nLevels) * sizeof(size_t);
+  }
+};
+
+template <typename T>
+T* copy_array(const T* pIn, size_t n)
+{
+  T* pOut = contour_alloc_array<T>(std::max<size_t>(1, n));
+  if (pOut && n > 0)
+  {
+    memcpy(pOut, pIn, n * sizeof(T));
+  }
+  return pOut;
+}
+
+} // namespace
+
+struct contour_cached
+{
+  std::shared_ptr<const entry_t> entry;
+};
+
+struct contour_cache
+{
+  using key_t = std::pair<uint64_t, uint64_t>;
+  struct slot_t
+  {
+    std::shared_ptr<const entry_t> entry;
+    contour_list<key_t>::iterator lru;
+  };
+
+  size_t nMaxBytes = 0;
+  std::mutex mutex;
+  contour_list<key_t> lru; // Most recently used first
+  std::unordered_map<key_t, slot_t, key_hash_t, std::equal_to<key_t>,
+    contour_stl_allocator<std::pair<const key_t, slot_t>>>
+    slots;
+  // Results being computed, null on failure
+  using pending_t = std::shared_future<std::shared_ptr<const entry_t>>;
+  std::unordered_map<key_t, pending_t, key_hash_t, std::equal_to<key_t>,
+    contour_stl_allocator<std::pair<const key_t, pending_t>>>
+    pending;
+  contour_cache_stats_t stats = {};
+
+  // Look up and mark as most recently used, must hold mutex
+  std::shared_ptr<const entry_t> find(const key_t& key)
+  {
+    auto it = slots.find(key);
+    if (it == slots.end())
+    {
+      return nullptr;
+    }
+    lru.splice(lru.begin(), lru, it->second.lru);
+    return it->second.entry;
+  }
+
+  // Insert and evict least recently used entries, must hold mutex
+  void insert(const key_t& key, const std::shared_ptr<const entry_t>& entry)
+  {
+    const size_t nBytes = entry->bytes();
+    if (nBytes > nMaxBytes || slots.count(key))
+    {
+      return;
+    }
+    while (stats.nBytes + nBytes > nMaxBytes && !lru.empty())
+    {
+      auto it = slots.find(lru.back());
+      stats.nBytes -= it->second.entry->bytes();
+      slots.erase(it);
+      lru.pop_back();
+      stats.nEvictions++;
+    }
+    lru.push_front(key);
+    slots[key] = { entry, lru.begin() };
+    stats.nBytes += nBytes;
+    stats.nEntries = slots.size();
+  }
+};
+
+namespace
+{
+// Computes and inserts on a miss. Throws std::bad_alloc if memory runs
+// out.
+int cache_acquire(contour_cache_t* pCache, const double* pData, const size_t nYdata,
+  const size_t nXdata, const double* pY, const size_t nY, const double* pX, const size_t nX,
+  const double* pLevels, const size_t nLevels, const contour_options_t* pOptions,
+  const contour_cached_t** ppResult)
+{
+  *ppResult = nullptr;
+  if (nXdata != nX || nYdata != nY || nLevels == 0 || nX == 0 || nY == 0)
+  {
+    return -1;
+  }
+
+  // Key from everything affecting the output
+  hasher_t hasher;
+  hasher.update(nYdata);
+  hasher.update(nXdata);
+  hasher.update(nLevels);
+  hasher.update(pData, nYdata * nXdata * sizeof(double));
+  hasher.update(pY, nY * sizeof(double));
+  hasher.update(pX, nX * sizeof(double));
+  hasher.update(pLevels, nLevels * sizeof(double));
+  const bool bMask = pOptions && pOptions->pMask;
+  hasher.update(static_cast<size_t>(bMask));
+  if (bMask)
+  {
+    hasher.update(pOptions->pMask, nYdata * nXdata);
+  }
+  hasher.update(static_cast<size_t>(pOptions && pOptions->bNaNIsMissing));
+  const bool bAffine = pOptions && pOptions->pAffine;
+  hasher.update(static_cast<size_t>(bAffine));
+  if (bAffine)
+  {
+    hasher.update(pOptions->pAffine, 6 * sizeof(double));
+  }
+  hasher.update(pOptions ? pOptions->iRowBegin : 0);
+  hasher.update(pOptions && pOptions->iRowEnd ? pOptions->iRowEnd : nYdata);
+  hasher.update(pOptions ? pOptions->iColumnBegin : 0);
+  hasher.update(pOptions && pOptions->iColumnEnd ? pOptions->iColumnEnd : nXdata);
+  const bool bClip = pOptions && pOptions->pClip;
+  hasher.update(static_cast<size_t>(bClip));
+  if (bClip)
+  {
+    hasher.update(pOptions->pClip, 4 * sizeof(double));
+  }
+  hasher.update(static_cast<size_t>(pOptions ? pOptions->eEngine : CONTOUR_ENGINE_STITCH));
+  // A callback is identified by its address and user data
+  hasher.update(reinterpret_cast<size_t>(pOptions ? pOptions->pTransform : nullptr));
+  hasher.update(reinterpret_cast<size_t>(pOptions ? pOptions->pTransformUser : nullptr));
+  const contour_cache::key_t key = hasher.digest();
+
+  // Concurrent requests for the same key wait for a single computation
+  using promise_t = std::promise<std::shared_ptr<const entry_t>>;
+  std::shared_ptr<const entry_t> entry;
+  std::shared_ptr<promise_t> promise;
+  contour_cache::pending_t computing;
+  {
+    std::lock_guard<std::mutex> lock(pCache->mutex);
+    entry = pCache->find(key);
+    if (!entry)
+    {
+      auto it = pCache->pending.find(key);
+      if (it == pCache->pending.end())
+      {
+        promise = std::allocate_shared<promise_t>(contour_stl_allocator<promise_t>(),
+          std::allocator_arg, contour_stl_allocator<entry_t>());
+        pCache->pending.emplace(key, promise->get_future().share());
+      }
+      else
+      {
+        computing = it->second;
+      }
+    }
+    if (entry || computing.valid())
+    {
+      pCache->stats.nHits++;
+    }
+  }
+
+  if (computing.valid())
+  {
+    entry = computing.get();
+    if (!entry)
+    {
+      return -1;
+    }
+  }
+  else if (!entry)
+  {
+    // Waiters are released, also if computing throws
+    int retval = -1;
+    try
+    {
+      std::shared_ptr<entry_t> computed =
+        std::allocate_shared<entry_t>(contour_stl_allocator<entry_t>());
+      retval = contours_sorted_ex(pData, nYdata, nXdata, pY, nY, pX, nX, pLevels, nLevels,
+        pOptions, &computed->pY, &computed->nY, &computed->pX, &computed->nX,
+        &computed->pLengths, &computed->nSegments, &computed->pLevelSegments, &computed->nLevels);
+      if (retval == 0)
+      {
+        entry = computed;
+      }
+    }
+    catch (const std::exception&)
+    {
+      std::lock_guard<std::mutex> lock(pCache->mutex);
+      pCache->pending.erase(key);
+      promise->set_value(nullptr);
+      throw;
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(pCache->mutex);
+      if (entry)
+      {
+        pCache->stats.nMisses++;
+        pCache->insert(key, entry);
+      }
+      pCache->pending.erase(key);
+    }
+    promise->set_value(entry);
+    if (retval != 0)
+    {
+      return retval;
+    }
+  }
+
+  *ppResult = contour_new<contour_cached_t>(contour_cached_t{ entry });
+  return 0;
+}
+} // namespace
+
+extern "C" {
+
+contour_cache_t* contour_cache_create(size_t nMaxBytes)
+{
+  contour_cache_t* pCache = nullptr;
+  try
+  {
+    pCache = contour_new<contour_cache_t>();
+  }
+  catch (const std::exception&)
+  {
+    return nullptr;
+  }
+  if (pCache)
+  {
+    pCache->nMaxBytes = nMaxBytes;
+  }
+  return pCache;
+}
+
+void contour_cache_destroy(contour_cache_t* pCache)
+{
+  contour_delete(pCache);
+}
+
+void contour_cache_clear(contour_cache_t* pCache)
+{
+  std::lock_guard<std::mutex> lock(pCache->mutex);
+  pCache->slots.clear();
+  pCache->lru.clear();
+  pCache->stats = {};
+}
+
+void contour_cache_get_stats(contour_cache_t* pCache, contour_cache_stats_t* pStats)
+{
+  std::lock_guard<std::mutex> lock(pCache->mutex);
+  *pStats = pCache->stats;
+  pStats->nEntries = pCache->slots.size();
+}
+
+int contour_cache_acquire(contour_cache_t* pCache, const double* pData, const size_t nYdata,
+  const size_t nXdata, const double* pY, const size_t nY, const double* pX, const size_t nX,
+  const double* pLevels, const size_t nLevels, const contour_options_t* pOptions,
+  const contour_cached_t** ppResult)
+{
+  try
+  {
+    return cache_acquire(
+      pCache, pData, nYdata, nXdata, pY, nY, pX, nX, pLevels, nLevels, pOptions, ppResult);
+  }
+  catch (const std::exception&)
+  {
+    *ppResult = nullptr;
+    return -1;
+  }
+}
+
+
+void contour_cached_release(const contour_cached_t* pResult)
+{
+  contour_delete(pResult);
+}
+
+void contour_cached_sorted(const contour_cached_t* pResult, const double** ppY, size_t* nY,
+  const double** ppX, size_t* nX, const size_t** ppLengths, size_t* nSegments,
+  const size_t** ppLevelSegments, size_t* nLevels)
+{
+  const entry_t& entry = *pResult->entry;
+  *ppY = entry.pY;
+  *nY = entry.nY;
+  *ppX = entry.pX;
+  *nX = entry.nX;
+  *ppLengths = entry.pLengths;
+  *nSegments = entry.nSegments;
+  *ppLevelSegments = entry.pLevelSegments;
+  *nLevels = entry.nLevels;
+}
+
+int contour_cache_sorted(contour_cache_t* pCache, const double* pData, const size_t nYdata,
+  const size_t nXdata, const double* pY, const size_t nY, const double* pX, const size_t nX,
+  const double* pLevels, const size_t nLevels, const contour_options_t* pOptions,
+  double** ppOutY, size_t* nOutY, double** ppOutX, size_t* nOutX, size_t** nOutLengths,
+  size_t* nOutSegments, size_t** nLevelSegments, size_t* nLevels2)
+{
+  *ppOutY = nullptr;
+  *nOutY = 0;
+  *ppOutX = nullptr;
+  *nOutX = 0;
+  *nOutLengths = nullptr;
+  *nOutSegments = 0;
+  *nLevelSegments = nullptr;
+  *nLevels2 = 0;
+
+  const contour_cached_t* pResult;
+  const int retval = contour_cache_acquire(
+    pCache, pData, nYdata, nXdata, pY, nY, pX, nX, pLevels, nLevels, pOptions, &pResult);
+  if (retval != 0)
+  {
+    return retval;
+  }
+
+  const entry_t& entry = *pResult->entry;
+  *ppOutY = copy_array(entry.pY, entry.nY);
+  *ppOutX = copy_array(entry.pX, entry.nX);
+  *nOutLengths = copy_array(entry.pLengths, entry.nSegments);
+  *nLevelSegments = copy_array(entry.pLevelSegments, entry.nLevels);
+  *nOutY = entry.nY;
+  *nOutX = entry.nX;
+  *nOutSegments = entry.nSegments;
+  *nLevels2 = entry.nLevels;
+  contour_cached_release(pResult);
+
+  if (!*ppOutY || !*ppOutX || !*nOutLengths || !*nLevelSegments)
+  {
+    contour_deallocate(*ppOutY);
+    contour_deallocate(*ppOutX);
+    contour_deallocate(*nOutLengths);
+    contour_deallocate(*nLevelSegments);
+    *ppOutY = nullptr;
+    *ppOutX = nullptr;
+    *nOutLengths = nullptr;
+    *nLevelSegments = nullptr;
+    *nOutY = 0;
+    *nOutX = 0;
+    *nOutSegments = 0;
+    *nLevels2 = 0;
+    return -1;
+  }
+  return 0;
+}
+
+} // extern "C"
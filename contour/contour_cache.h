@@ -0,0 +1,172 @@
+/**
+ * @file   contour_cache.h
+ * @brief  Content-addressed LRU cache of sorted contours
+ *
+ * Copyright 2018 Jens Munk Hansen
+ */
+
+#ifndef CONTOUR_CACHE_H
+#define CONTOUR_CACHE_H
+
+#include <stddef.h>
+
+#ifdef USE_CMAKE
+#include <contour/contour_export.h>
+#else
+#define CONTOUR_EXPORT
+#endif
+
+#include <contour/contour_options.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Opaque cache */
+typedef struct contour_cache contour_cache_t;
+
+/** Opaque, shared and read-only cached result */
+typedef struct contour_cached contour_cached_t;
+
+/** Cache statistics */
+typedef struct contour_cache_stats
+{
+  size_t nHits;      /**< Requests served from the cache */
+  size_t nMisses;    /**< Requests computed */
+  size_t nEvictions; /**< Results evicted to stay within the budget */
+  size_t nEntries;   /**< Results currently cached */
+  size_t nBytes;     /**< Bytes currently cached */
+} contour_cache_stats_t;
+
+/**
+ * Create a cache.
+ *
+ * Results are keyed by a 128-bit hash of the data, the coordinates,
+ * the levels and the options affecting the output, so results
+ * computed with any nThreads and nMaxBytes are shared. A transform
+ * callback is keyed by its address and user data, so it must give
+ * the same vertices for as long as results are cached. The least
+ * recently used results are evicted when the cached bytes exceed the
+ * budget. Results larger than the budget are computed but not
+ * cached. All functions taking a cache can be called concurrently,
+ * and concurrent requests for the same result compute it once.
+ *
+ * @param nMaxBytes Byte budget
+ * @return Cache (destroy with contour_cache_destroy) or NULL on error
+ */
+CONTOUR_EXPORT contour_cache_t* contour_cache_create(size_t nMaxBytes);
+
+/**
+ * Destroy a cache. Acquired results remain valid until released.
+ * @param pCache Cache to destroy (NULL is safe)
+ */
+CONTOUR_EXPORT void contour_cache_destroy(contour_cache_t* pCache);
+
+/**
+ * Remove all results from a cache and reset the statistics.
+ * @param pCache Cache
+ */
+CONTOUR_EXPORT void contour_cache_clear(contour_cache_t* pCache);
+
+/**
+ * Get cache statistics.
+ * @param pCache Cache
+ * @param pStats [out] Statistics
+ */
+CONTOUR_EXPORT void contour_cache_get_stats(contour_cache_t* pCache,
+    contour_cache_stats_t* pStats);
+
+/**
+ * Acquire sorted contours, computing them with contours_sorted_ex()
+ * if not cached. The result is shared and must not be modified.
+ *
+ * @param pCache    Cache
+ * @param pData     Image data (row-major)
+ * @param nYdata    Y dimension (rows)
+ * @param nXdata    X dimension (columns)
+ * @param pY        Y-coordinates array
+ * @param nY        Number of Y-coordinates (must equal nYdata)
+ * @param pX        X-coordinates array
+ * @param nX        Number of X-coordinates (must equal nXdata)
+ * @param pLevels   Contour levels
+ * @param nLevels   Number of contour levels
+ * @param pOptions  Options or NULL for defaults
+ * @param ppResult  [out] Result (release with contour_cached_release)
+ * @return 0 on success, -1 on error, CONTOUR_CANCELLED if cancelled
+ */
+CONTOUR_EXPORT int contour_cache_acquire(contour_cache_t* pCache,
+    const double* pData, const size_t nYdata, const size_t nXdata,
+    const double* pY, const size_t nY,
+    const double* pX, const size_t nX,
+    const double* pLevels, const size_t nLevels,
+    const contour_options_t* pOptions,
+    const contour_cached_t** ppResult);
+
+/**
+ * Release a result acquired with contour_cache_acquire().
+ * @param pResult Result to release (NULL is safe)
+ */
+CONTOUR_EXPORT void contour_cached_release(const contour_cached_t* pResult);
+
+/**
+ * Access the arrays of a cached result. The arrays have the layout of
+ * the output of contours_sorted() and remain valid until the result
+ * is released.
+ *
+ * @param pResult         Result
+ * @param ppY             [out] Y-coordinates
+ * @param nY              [out] Number of Y-coordinates
+ * @param ppX             [out] X-coordinates
+ * @param nX              [out] Number of X-coordinates
+ * @param ppLengths       [out] Points per polygon
+ * @param nSegments       [out] Number of polygons
+ * @param ppLevelSegments [out] Polygons per level
+ * @param nLevels         [out] Number of levels
+ */
+CONTOUR_EXPORT void contour_cached_sorted(const contour_cached_t* pResult,
+    const double** ppY, size_t* nY,
+    const double** ppX, size_t* nX,
+    const size_t** ppLengths, size_t* nSegments,
+    const size_t** ppLevelSegments, size_t* nLevels);
+
+/**
+ * Compute sorted contours through a cache, returning copies with the
+ * same ownership as contours_sorted_ex().
+ *
+ * @param pCache         Cache
+ * @param pData          Image data (row-major)
+ * @param nYdata         Y dimension (rows)
+ * @param nXdata         X dimension (columns)
+ * @param pY             Y-coordinates array
+ * @param nY             Number of Y-coordinates (must equal nYdata)
+ * @param pX             X-coordinates array
+ * @param nX             Number of X-coordinates (must equal nXdata)
+ * @param pLevels        Contour levels
+ * @param nLevels        Number of contour levels
+ * @param pOptions       Options or NULL for defaults
+ * @param ppOutY         [out] Y-coordinates (caller must free with contour_free)
+ * @param nOutY          [out] Number of Y-coordinates
+ * @param ppOutX         [out] X-coordinates (caller must free with contour_free)
+ * @param nOutX          [out] Number of X-coordinates
+ * @param nOutLengths    [out] Points per polygon (caller must free with contour_free)
+ * @param nOutSegments   [out] Number of polygons
+ * @param nLevelSegments [out] Polygons per level (caller must free with contour_free)
+ * @param nLevels2       [out] Number of levels
+ * @return 0 on success, -1 on error, CONTOUR_CANCELLED if cancelled
+ */
+CONTOUR_EXPORT int contour_cache_sorted(contour_cache_t* pCache,
+    const double* pData, const size_t nYdata, const size_t nXdata,
+    const double* pY, const size_t nY,
+    const double* pX, const size_t nX,
+    const double* pLevels, const size_t nLevels,
+    const contour_options_t* pOptions,
+    double** ppOutY, size_t* nOutY,
+    double** ppOutX, size_t* nOutX,
+    size_t** nOutLengths, size_t* nOutSegments,
+    size_t** nLevelSegments, size_t* nLevels2);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CONTOUR_CACHE_H */
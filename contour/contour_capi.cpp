@@ -7,13 +7,13 @@
 
 #include <contour/contour_capi.h>
 #include <contour/contour.hpp>
-#include <cstdlib>
+#include <contour/contour_alloc.hpp>
 
 extern "C" {
 
 void contour_free(void* ptr)
 {
-    free(ptr);
+    contour_deallocate(ptr);
 }
 
 int contour_compute(
@@ -50,4 +50,311 @@ int contour_compute_sorted(
                            nLevelSegments, nLevels2);
 }
 
+int contour_compute_sorted_quantized(
+    const double* pData, size_t nYdata, size_t nXdata,
+    const double* pY, size_t nY,
+    const double* pX, size_t nX,
+    const double* pLevels, size_t nLevels,
+    unsigned int nFractionBits,
+    int** ppOutY, size_t* nOutY,
+    int** ppOutX, size_t* nOutX,
+    size_t** nOutLengths, size_t* nOutSegments,
+    size_t** nLevelSegments, size_t* nLevels2)
+{
+    return contours_sorted_quantized(pData, nYdata, nXdata,
+                                     pY, nY, pX, nX,
+                                     pLevels, nLevels,
+                                     nFractionBits,
+                                     ppOutY, nOutY, ppOutX, nOutX,
+                                     nOutLengths, nOutSegments,
+                                     nLevelSegments, nLevels2);
+}
+
+int contour_compute_sorted_encoded(
+    const double* pData, size_t nYdata, size_t nXdata,
+    const double* pY, size_t nY,
+    const double* pX, size_t nX,
+    const double* pLevels, size_t nLevels,
+    unsigned int nFractionBits,
+    unsigned char** ppOutBytes, size_t* nOutBytes,
+    size_t** nOutLengths, size_t* nOutSegments,
+    size_t** nLevelSegments, size_t* nLevels2)
+{
+    return contours_sorted_encoded(pData, nYdata, nXdata,
+                                   pY, nY, pX, nX,
+                                   pLevels, nLevels,
+                                   nFractionBits,
+                                   ppOutBytes, nOutBytes,
+                                   nOutLengths, nOutSegments,
+                                   nLevelSegments, nLevels2);
+}
+
+int contour_compute_ex(
+    const double* pData, size_t nYdata, size_t nXdata,
+    const double* pY, size_t nY,
+    const double* pX, size_t nX,
+    const double* pLevels, size_t nLevels,
+    const contour_options_t* pOptions,
+    double** ppOutY, size_t* nOutY,
+    double** ppOutX, size_t* nOutX,
+    size_t** nOutLengths, size_t* nOutSegments)
+{
+    return contours_ex(pData, nYdata, nXdata,
+                       pY, nY, pX, nX,
+                       pLevels, nLevels,
+                       pOptions,
+                       ppOutY, nOutY, ppOutX, nOutX,
+                       nOutLengths, nOutSegments);
+}
+
+int contour_compute_sorted_ex(
+    const double* pData, size_t nYdata, size_t nXdata,
+    const double* pY, size_t nY,
+    const double* pX, size_t nX,
+    const double* pLevels, size_t nLevels,
+    const contour_options_t* pOptions,
+    double** ppOutY, size_t* nOutY,
+    double** ppOutX, size_t* nOutX,
+    size_t** nOutLengths, size_t* nOutSegments,
+    size_t** nLevelSegments, size_t* nLevels2)
+{
+    return contours_sorted_ex(pData, nYdata, nXdata,
+                              pY, nY, pX, nX,
+                              pLevels, nLevels,
+                              pOptions,
+                              ppOutY, nOutY, ppOutX, nOutX,
+                              nOutLengths, nOutSegments,
+                              nLevelSegments, nLevels2);
+}
+
+int contour_compute_visit(
+    const double* pData, size_t nYdata, size_t nXdata,
+    const double* pY, size_t nY,
+    const double* pX, size_t nX,
+    const double* pLevels, size_t nLevels,
+    const contour_options_t* pOptions,
+    contour_segment_callback_t pCallback, void* pUser)
+{
+    return contours_callback(pData, nYdata, nXdata,
+                             pY, nY, pX, nX,
+                             pLevels, nLevels,
+                             pOptions,
+                             pCallback, pUser);
+}
+
+int contour_compute_statistics(
+    const double* pData, size_t nYdata, size_t nXdata,
+    const double* pY, size_t nY,
+    const double* pX, size_t nX,
+    const double* pLevels, size_t nLevels,
+    const contour_options_t* pOptions,
+    double** ppOutLengths, size_t* nOutLengths,
+    double** ppOutAreas, size_t* nOutAreas)
+{
+    return contours_statistics(pData, nYdata, nXdata,
+                               pY, nY, pX, nX,
+                               pLevels, nLevels,
+                               pOptions,
+                               ppOutLengths, nOutLengths,
+                               ppOutAreas, nOutAreas);
+}
+
+int contour_compute_levels(
+    const double* pData, size_t nYdata, size_t nXdata,
+    size_t nLevels,
+    const contour_options_t* pOptions,
+    double** ppOutLevels, size_t* nOutLevels)
+{
+    return contour_levels(pData, nYdata, nXdata,
+                          nLevels,
+                          pOptions,
+                          ppOutLevels, nOutLevels);
+}
+
+int contour_compute_sorted_auto(
+    const double* pData, size_t nYdata, size_t nXdata,
+    const double* pY, size_t nY,
+    const double* pX, size_t nX,
+    size_t nLevels,
+    const contour_options_t* pOptions,
+    double** ppOutLevels, size_t* nOutLevels,
+    double** ppOutY, size_t* nOutY,
+    double** ppOutX, size_t* nOutX,
+    size_t** nOutLengths, size_t* nOutSegments,
+    size_t** nLevelSegments, size_t* nLevels2)
+{
+    return contours_sorted_auto(pData, nYdata, nXdata,
+                                pY, nY, pX, nX,
+                                nLevels,
+                                pOptions,
+                                ppOutLevels, nOutLevels,
+                                ppOutY, nOutY, ppOutX, nOutX,
+                                nOutLengths, nOutSegments,
+                                nLevelSegments, nLevels2);
+}
+
+int contour_compute_indexed(
+    const double* pData, size_t nYdata, size_t nXdata,
+    const double* pY, size_t nY,
+    const double* pX, size_t nX,
+    const double* pLevels, size_t nLevels,
+    const contour_options_t* pOptions,
+    contour_topology_t eTopology,
+    double** ppOutVertices, size_t* nOutVertices,
+    uint32_t** ppOutIndices, size_t* nOutIndices,
+    size_t** nOutLengths, size_t* nOutLevels)
+{
+    return contours_indexed(pData, nYdata, nXdata,
+                            pY, nY, pX, nX,
+                            pLevels, nLevels,
+                            pOptions,
+                            eTopology,
+                            ppOutVertices, nOutVertices,
+                            ppOutIndices, nOutIndices,
+                            nOutLengths, nOutLevels);
+}
+
+int contour_compute_isosurfaces(
+    const double* pData, size_t nZdata, size_t nYdata, size_t nXdata,
+    const double* pZ, size_t nZ,
+    const double* pY, size_t nY,
+    const double* pX, size_t nX,
+    const double* pLevels, size_t nLevels,
+    const contour_options_t* pOptions,
+    double** ppOutVertices, size_t* nOutVertices,
+    uint32_t** ppOutIndices, size_t* nOutIndices,
+    size_t** nOutLengths, size_t* nOutLevels)
+{
+    return isosurfaces(pData, nZdata, nYdata, nXdata,
+                       pZ, nZ, pY, nY, pX, nX,
+                       pLevels, nLevels,
+                       pOptions,
+                       ppOutVertices, nOutVertices,
+                       ppOutIndices, nOutIndices,
+                       nOutLengths, nOutLevels);
+}
+
+int contour_compute_mesh(
+    const double* pData, size_t nData,
+    const double* pY, size_t nY,
+    const double* pX, size_t nX,
+    const size_t* pTriangles, size_t nTriangleIndices,
+    const double* pLevels, size_t nLevels,
+    const contour_options_t* pOptions,
+    double** ppOutY, size_t* nOutY,
+    double** ppOutX, size_t* nOutX,
+    size_t** nOutLengths, size_t* nOutSegments,
+    size_t** nLevelSegments, size_t* nLevels2)
+{
+    return contours_mesh(pData, nData,
+                         pY, nY, pX, nX,
+                         pTriangles, nTriangleIndices,
+                         pLevels, nLevels,
+                         pOptions,
+                         ppOutY, nOutY, ppOutX, nOutX,
+                         nOutLengths, nOutSegments,
+                         nLevelSegments, nLevels2);
+}
+
+int contour_compute_float(
+    const double* pData, size_t nYdata, size_t nXdata,
+    const double* pY, size_t nY,
+    const double* pX, size_t nX,
+    const double* pLevels, size_t nLevels,
+    const contour_options_t* pOptions,
+    float** ppOutY, size_t* nOutY,
+    float** ppOutX, size_t* nOutX,
+    size_t** nOutLengths, size_t* nOutSegments)
+{
+    return contours_float(pData, nYdata, nXdata,
+                          pY, nY, pX, nX,
+                          pLevels, nLevels,
+                          pOptions,
+                          ppOutY, nOutY, ppOutX, nOutX,
+                          nOutLengths, nOutSegments);
+}
+
+int contour_compute_sorted_float(
+    const double* pData, size_t nYdata, size_t nXdata,
+    const double* pY, size_t nY,
+    const double* pX, size_t nX,
+    const double* pLevels, size_t nLevels,
+    const contour_options_t* pOptions,
+    float** ppOutY, size_t* nOutY,
+    float** ppOutX, size_t* nOutX,
+    size_t** nOutLengths, size_t* nOutSegments,
+    size_t** nLevelSegments, size_t* nLevels2)
+{
+    return contours_sorted_float(pData, nYdata, nXdata,
+                                 pY, nY, pX, nX,
+                                 pLevels, nLevels,
+                                 pOptions,
+                                 ppOutY, nOutY, ppOutX, nOutX,
+                                 nOutLengths, nOutSegments,
+                                 nLevelSegments, nLevels2);
+}
+
+int contour_compute_indexed_float(
+    const double* pData, size_t nYdata, size_t nXdata,
+    const double* pY, size_t nY,
+    const double* pX, size_t nX,
+    const double* pLevels, size_t nLevels,
+    const contour_options_t* pOptions,
+    contour_topology_t eTopology,
+    float** ppOutVertices, size_t* nOutVertices,
+    uint32_t** ppOutIndices, size_t* nOutIndices,
+    size_t** nOutLengths, size_t* nOutLevels)
+{
+    return contours_indexed_float(pData, nYdata, nXdata,
+                                  pY, nY, pX, nX,
+                                  pLevels, nLevels,
+                                  pOptions,
+                                  eTopology,
+                                  ppOutVertices, nOutVertices,
+                                  ppOutIndices, nOutIndices,
+                                  nOutLengths, nOutLevels);
+}
+
+int contour_compute_isosurfaces_float(
+    const double* pData, size_t nZdata, size_t nYdata, size_t nXdata,
+    const double* pZ, size_t nZ,
+    const double* pY, size_t nY,
+    const double* pX, size_t nX,
+    const double* pLevels, size_t nLevels,
+    const contour_options_t* pOptions,
+    float** ppOutVertices, size_t* nOutVertices,
+    uint32_t** ppOutIndices, size_t* nOutIndices,
+    size_t** nOutLengths, size_t* nOutLevels)
+{
+    return isosurfaces_float(pData, nZdata, nYdata, nXdata,
+                             pZ, nZ, pY, nY, pX, nX,
+                             pLevels, nLevels,
+                             pOptions,
+                             ppOutVertices, nOutVertices,
+                             ppOutIndices, nOutIndices,
+                             nOutLengths, nOutLevels);
+}
+
+int contour_compute_mesh_float(
+    const double* pData, size_t nData,
+    const double* pY, size_t nY,
+    const double* pX, size_t nX,
+    const size_t* pTriangles, size_t nTriangleIndices,
+    const double* pLevels, size_t nLevels,
+    const contour_options_t* pOptions,
+    float** ppOutY, size_t* nOutY,
+    float** ppOutX, size_t* nOutX,
+    size_t** nOutLengths, size_t* nOutSegments,
+    size_t** nLevelSegments, size_t* nLevels2)
+{
+    return contours_mesh_float(pData, nData,
+                               pY, nY, pX, nX,
+                               pTriangles, nTriangleIndices,
+                               pLevels, nLevels,
+                               pOptions,
+                               ppOutY, nOutY, ppOutX, nOutX,
+                               nOutLengths, nOutSegments,
+                               nLevelSegments, nLevels2);
+}
+
 } // extern "C"
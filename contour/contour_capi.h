@@ -16,12 +16,16 @@
 #define CONTOUR_EXPORT
 #endif
 
+#include <contour/contour_alloc.h>
+#include <contour/contour_options.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 /**
- * Free memory allocated by contour functions.
+ * Free memory allocated by contour functions, using the allocator set
+ * with contour_set_allocator().
  * @param ptr Pointer to free (NULL is safe)
  */
 CONTOUR_EXPORT void contour_free(void* ptr);
@@ -87,6 +91,472 @@ CONTOUR_EXPORT int contour_compute_sorted(
     size_t** nOutLengths, size_t* nOutSegments,
     size_t** nLevelSegments, size_t* nLevels2);
 
+/**
+ * Compute sorted contours with quantized (fixed-point) coordinates.
+ *
+ * Vertices are returned relative to the grid origin (pY[0], pX[0]) in
+ * units of the spacing of the first cell scaled by 2^nFractionBits.
+ *
+ * @param pData          Image data (row-major)
+ * @param nYdata         Y dimension (rows)
+ * @param nXdata         X dimension (columns)
+ * @param pY             Y-coordinates array
+ * @param nY             Number of Y-coordinates (must equal nYdata)
+ * @param pX             X-coordinates array
+ * @param nX             Number of X-coordinates (must equal nXdata)
+ * @param pLevels        Contour levels (must be increasing)
+ * @param nLevels        Number of levels
+ * @param nFractionBits  Number of sub-cell bits (at most 24)
+ * @param ppOutY         [out] Quantized Y-coordinates (caller must free with contour_free)
+ * @param nOutY          [out] Number of Y-coordinates
+ * @param ppOutX         [out] Quantized X-coordinates (caller must free with contour_free)
+ * @param nOutX          [out] Number of X-coordinates
+ * @param nOutLengths    [out] Points per polygon (caller must free with contour_free)
+ * @param nOutSegments   [out] Number of polygons
+ * @param nLevelSegments [out] Polygons per level (caller must free with contour_free)
+ * @param nLevels2       [out] Number of levels
+ * @return 0 on success, -1 on error
+ */
+CONTOUR_EXPORT int contour_compute_sorted_quantized(
+    const double* pData, size_t nYdata, size_t nXdata,
+    const double* pY, size_t nY,
+    const double* pX, size_t nX,
+    const double* pLevels, size_t nLevels,
+    unsigned int nFractionBits,
+    int** ppOutY, size_t* nOutY,
+    int** ppOutX, size_t* nOutX,
+    size_t** nOutLengths, size_t* nOutSegments,
+    size_t** nLevelSegments, size_t* nLevels2);
+
+/**
+ * Compute sorted contours as quantized, delta-encoded byte stream.
+ *
+ * For each polygon, the quantized vertices are written as (x, y)
+ * differences to the previous vertex (the first relative to 0),
+ * zigzag-encoded as unsigned LEB128 varints.
+ *
+ * @param pData          Image data (row-major)
+ * @param nYdata         Y dimension (rows)
+ * @param nXdata         X dimension (columns)
+ * @param pY             Y-coordinates array
+ * @param nY             Number of Y-coordinates (must equal nYdata)
+ * @param pX             X-coordinates array
+ * @param nX             Number of X-coordinates (must equal nXdata)
+ * @param pLevels        Contour levels (must be increasing)
+ * @param nLevels        Number of levels
+ * @param nFractionBits  Number of sub-cell bits (at most 24)
+ * @param ppOutBytes     [out] Encoded vertices (caller must free with contour_free)
+ * @param nOutBytes      [out] Number of bytes
+ * @param nOutLengths    [out] Points per polygon (caller must free with contour_free)
+ * @param nOutSegments   [out] Number of polygons
+ * @param nLevelSegments [out] Polygons per level (caller must free with contour_free)
+ * @param nLevels2       [out] Number of levels
+ * @return 0 on success, -1 on error
+ */
+CONTOUR_EXPORT int contour_compute_sorted_encoded(
+    const double* pData, size_t nYdata, size_t nXdata,
+    const double* pY, size_t nY,
+    const double* pX, size_t nX,
+    const double* pLevels, size_t nLevels,
+    unsigned int nFractionBits,
+    unsigned char** ppOutBytes, size_t* nOutBytes,
+    size_t** nOutLengths, size_t* nOutSegments,
+    size_t** nLevelSegments, size_t* nLevels2);
+
+/**
+ * Compute contours using options.
+ *
+ * Same as contour_compute(), see contour_options_t for options.
+ *
+ * @param pData       Image data (row-major)
+ * @param nYdata      Y dimension (rows)
+ * @param nXdata      X dimension (columns)
+ * @param pY          Y-coordinates array
+ * @param nY          Number of Y-coordinates (must equal nYdata)
+ * @param pX          X-coordinates array
+ * @param nX          Number of X-coordinates (must equal nXdata)
+ * @param pLevels     Contour levels (must be increasing)
+ * @param nLevels     Number of levels
+ * @param pOptions    Options initialized using contour_options_init (NULL for defaults)
+ * @param ppOutY      [out] Y-coordinates of contour segments (caller must free with contour_free)
+ * @param nOutY       [out] Number of Y-coordinates
+ * @param ppOutX      [out] X-coordinates of contour segments (caller must free with contour_free)
+ * @param nOutX       [out] Number of X-coordinates
+ * @param nOutLengths [out] Number of segments per level (caller must free with contour_free)
+ * @param nOutSegments [out] Number of levels
+ * @return 0 on success, -1 on error, CONTOUR_CANCELLED if cancelled
+ */
+CONTOUR_EXPORT int contour_compute_ex(
+    const double* pData, size_t nYdata, size_t nXdata,
+    const double* pY, size_t nY,
+    const double* pX, size_t nX,
+    const double* pLevels, size_t nLevels,
+    const contour_options_t* pOptions,
+    double** ppOutY, size_t* nOutY,
+    double** ppOutX, size_t* nOutX,
+    size_t** nOutLengths, size_t* nOutSegments);
+
+/**
+ * Compute sorted contours using options.
+ *
+ * Same as contour_compute_sorted(), see contour_options_t for options.
+ *
+ * @param pData          Image data (row-major)
+ * @param nYdata         Y dimension (rows)
+ * @param nXdata         X dimension (columns)
+ * @param pY             Y-coordinates array
+ * @param nY             Number of Y-coordinates (must equal nYdata)
+ * @param pX             X-coordinates array
+ * @param nX             Number of X-coordinates (must equal nXdata)
+ * @param pLevels        Contour levels (must be increasing)
+ * @param nLevels        Number of levels
+ * @param pOptions       Options initialized using contour_options_init (NULL for defaults)
+ * @param ppOutY         [out] Y-coordinates (caller must free with contour_free)
+ * @param nOutY          [out] Number of Y-coordinates
+ * @param ppOutX         [out] X-coordinates (caller must free with contour_free)
+ * @param nOutX          [out] Number of X-coordinates
+ * @param nOutLengths    [out] Points per polygon (caller must free with contour_free)
+ * @param nOutSegments   [out] Number of polygons
+ * @param nLevelSegments [out] Polygons per level (caller must free with contour_free)
+ * @param nLevels2       [out] Number of levels
+ * @return 0 on success, -1 on error, CONTOUR_CANCELLED if cancelled
+ */
+CONTOUR_EXPORT int contour_compute_sorted_ex(
+    const double* pData, size_t nYdata, size_t nXdata,
+    const double* pY, size_t nY,
+    const double* pX, size_t nX,
+    const double* pLevels, size_t nLevels,
+    const contour_options_t* pOptions,
+    double** ppOutY, size_t* nOutY,
+    double** ppOutX, size_t* nOutX,
+    size_t** nOutLengths, size_t* nOutSegments,
+    size_t** nLevelSegments, size_t* nLevels2);
+
+/**
+ * Callback receiving a contour segment from (x1, y1) to (x2, y2),
+ * where x is the column coordinate and y is the row coordinate.
+ */
+typedef void (*contour_segment_callback_t)(double x1, double y1, double x2, double y2,
+    int level, void* pUser);
+
+/**
+ * Compute contour segments, passing each to a callback instead of
+ * storing them. Segments are not connected. Concurrent calls are safe.
+ *
+ * @param pData          Image data (row-major)
+ * @param nYdata         Y dimension (rows)
+ * @param nXdata         X dimension (columns)
+ * @param pY             Y-coordinates array
+ * @param nY             Number of Y-coordinates (must equal nYdata)
+ * @param pX             X-coordinates array
+ * @param nX             Number of X-coordinates (must equal nXdata)
+ * @param pLevels        Contour levels (must be increasing)
+ * @param nLevels        Number of levels
+ * @param pOptions       Options initialized using contour_options_init (NULL for defaults)
+ * @param pCallback      Called for each segment
+ * @param pUser          Passed to the callback
+ * @return 0 on success, -1 on error, CONTOUR_CANCELLED if cancelled
+ */
+CONTOUR_EXPORT int contour_compute_visit(
+    const double* pData, size_t nYdata, size_t nXdata,
+    const double* pY, size_t nY,
+    const double* pX, size_t nX,
+    const double* pLevels, size_t nLevels,
+    const contour_options_t* pOptions,
+    contour_segment_callback_t pCallback, void* pUser);
+
+/**
+ * Compute the contour length of each level and the area of each band
+ * between levels, without producing any geometry. Band k holds the
+ * values between levels k - 1 and k, band 0 those below the first
+ * level and band nLevels those above the last.
+ *
+ * @param pData          Image data (row-major)
+ * @param nYdata         Y dimension (rows)
+ * @param nXdata         X dimension (columns)
+ * @param pY             Y-coordinates array
+ * @param nY             Number of Y-coordinates (must equal nYdata)
+ * @param pX             X-coordinates array
+ * @param nX             Number of X-coordinates (must equal nXdata)
+ * @param pLevels        Contour levels (must be increasing)
+ * @param nLevels        Number of levels
+ * @param pOptions       Options initialized using contour_options_init (NULL for defaults)
+ * @param ppOutLengths   Output: contour length of each level (free with contour_free)
+ * @param nOutLengths    Output: number of lengths (nLevels)
+ * @param ppOutAreas     Output: area of each band (free with contour_free)
+ * @param nOutAreas      Output: number of areas (nLevels + 1)
+ * @return 0 on success, -1 on error
+ */
+CONTOUR_EXPORT int contour_compute_statistics(
+    const double* pData, size_t nYdata, size_t nXdata,
+    const double* pY, size_t nY,
+    const double* pX, size_t nX,
+    const double* pLevels, size_t nLevels,
+    const contour_options_t* pOptions,
+    double** ppOutLengths, size_t* nOutLengths,
+    double** ppOutAreas, size_t* nOutAreas);
+
+/**
+ * Choose contour levels from the data, as nice multiples of a round
+ * interval or as quantiles of the samples, see contour_options_t.
+ *
+ * @param pData          Image data (row-major)
+ * @param nYdata         Y dimension (rows)
+ * @param nXdata         X dimension (columns)
+ * @param nLevels        Maximum number of levels
+ * @param pOptions       Options initialized using contour_options_init (NULL for defaults)
+ * @param ppOutLevels    Output: increasing levels (free with contour_free)
+ * @param nOutLevels     Output: number of levels
+ * @return 0 on success, -1 on error or if no levels can be chosen
+ */
+CONTOUR_EXPORT int contour_compute_levels(
+    const double* pData, size_t nYdata, size_t nXdata,
+    size_t nLevels,
+    const contour_options_t* pOptions,
+    double** ppOutLevels, size_t* nOutLevels);
+
+/**
+ * Compute sorted contours at levels chosen from the data, returning
+ * the levels with the contours. Same as contour_compute_sorted_ex() at
+ * the levels of contour_compute_levels().
+ *
+ * @param pData          Image data (row-major)
+ * @param nYdata         Y dimension (rows)
+ * @param nXdata         X dimension (columns)
+ * @param pY             Y-coordinates array
+ * @param nY             Number of Y-coordinates (must equal nYdata)
+ * @param pX             X-coordinates array
+ * @param nX             Number of X-coordinates (must equal nXdata)
+ * @param nLevels        Maximum number of levels
+ * @param pOptions       Options initialized using contour_options_init (NULL for defaults)
+ * @param ppOutLevels    [out] Levels (caller must free with contour_free)
+ * @param nOutLevels     [out] Number of levels
+ * @param ppOutY         [out] Y-coordinates (caller must free with contour_free)
+ * @param nOutY          [out] Number of Y-coordinates
+ * @param ppOutX         [out] X-coordinates (caller must free with contour_free)
+ * @param nOutX          [out] Number of X-coordinates
+ * @param nOutLengths    [out] Points per polygon (caller must free with contour_free)
+ * @param nOutSegments   [out] Number of polygons
+ * @param nLevelSegments [out] Polygons per level (caller must free with contour_free)
+ * @param nLevels2       [out] Number of levels
+ * @return 0 on success, -1 on error, CONTOUR_CANCELLED if cancelled
+ */
+CONTOUR_EXPORT int contour_compute_sorted_auto(
+    const double* pData, size_t nYdata, size_t nXdata,
+    const double* pY, size_t nY,
+    const double* pX, size_t nX,
+    size_t nLevels,
+    const contour_options_t* pOptions,
+    double** ppOutLevels, size_t* nOutLevels,
+    double** ppOutY, size_t* nOutY,
+    double** ppOutX, size_t* nOutX,
+    size_t** nOutLengths, size_t* nOutSegments,
+    size_t** nLevelSegments, size_t* nLevels2);
+
+/**
+ * Compute contours as shared vertices and an index buffer.
+ *
+ * @param pData       Input data matrix (row-major)
+ * @param nYdata      Number of rows
+ * @param nXdata      Number of columns
+ * @param pY          Y-coordinates array
+ * @param nY          Number of Y-coordinates (must equal nYdata)
+ * @param pX          X-coordinates array
+ * @param nX          Number of X-coordinates (must equal nXdata)
+ * @param pLevels     Contour levels (must be increasing)
+ * @param nLevels     Number of levels
+ * @param pOptions    Options initialized using contour_options_init (NULL for defaults),
+ *                    the clip box is not supported
+ * @param eTopology   CONTOUR_TOPOLOGY_LINES for two indices per segment, or
+ *                    CONTOUR_TOPOLOGY_STRIPS for polylines ended by CONTOUR_RESTART_INDEX
+ * @param ppOutVertices [out] Vertices as (x, y) pairs (caller must free with contour_free)
+ * @param nOutVertices  [out] Number of values (2 times number of vertices)
+ * @param ppOutIndices  [out] 32-bit vertex indices (caller must free with contour_free)
+ * @param nOutIndices   [out] Number of indices
+ * @param nOutLengths   [out] Number of indices per level (caller must free with contour_free)
+ * @param nOutLevels    [out] Number of levels
+ * @return 0 on success, -1 on error or if there are too many vertices,
+ *         CONTOUR_CANCELLED if cancelled
+ */
+CONTOUR_EXPORT int contour_compute_indexed(
+    const double* pData, size_t nYdata, size_t nXdata,
+    const double* pY, size_t nY,
+    const double* pX, size_t nX,
+    const double* pLevels, size_t nLevels,
+    const contour_options_t* pOptions,
+    contour_topology_t eTopology,
+    double** ppOutVertices, size_t* nOutVertices,
+    uint32_t** ppOutIndices, size_t* nOutIndices,
+    size_t** nOutLengths, size_t* nOutLevels);
+
+/**
+ * Compute isosurfaces (indexed triangle meshes) for a 3D volume.
+ *
+ * @param pData       Volume data (row-major)
+ * @param nZdata      Z dimension (slices)
+ * @param nYdata      Y dimension (rows)
+ * @param nXdata      X dimension (columns)
+ * @param pZ          Z-coordinates array
+ * @param nZ          Number of Z-coordinates (must equal nZdata)
+ * @param pY          Y-coordinates array
+ * @param nY          Number of Y-coordinates (must equal nYdata)
+ * @param pX          X-coordinates array
+ * @param nX          Number of X-coordinates (must equal nXdata)
+ * @param pLevels     Contour levels (must be increasing)
+ * @param nLevels     Number of levels
+ * @param pOptions    Options initialized using contour_options_init (NULL for defaults)
+ * @param ppOutVertices [out] Vertices as (x, y, z) triplets (caller must free with contour_free)
+ * @param nOutVertices  [out] Number of values (3 times number of vertices)
+ * @param ppOutIndices  [out] 32-bit vertex indices, three per triangle (caller must free
+ *                      with contour_free)
+ * @param nOutIndices   [out] Number of indices
+ * @param nOutLengths   [out] Number of triangles per level (caller must free with contour_free)
+ * @param nOutLevels    [out] Number of levels
+ * @return 0 on success, -1 on error or if there are too many vertices for 32-bit indices
+ */
+CONTOUR_EXPORT int contour_compute_isosurfaces(
+    const double* pData, size_t nZdata, size_t nYdata, size_t nXdata,
+    const double* pZ, size_t nZ,
+    const double* pY, size_t nY,
+    const double* pX, size_t nX,
+    const double* pLevels, size_t nLevels,
+    const contour_options_t* pOptions,
+    double** ppOutVertices, size_t* nOutVertices,
+    uint32_t** ppOutIndices, size_t* nOutIndices,
+    size_t** nOutLengths, size_t* nOutLevels);
+
+/**
+ * Compute sorted contours (connected polylines) on an unstructured triangle mesh.
+ *
+ * @param pData          Nodal values
+ * @param nData          Number of vertices
+ * @param pY             Y-coordinates of vertices
+ * @param nY             Number of Y-coordinates (must equal nData)
+ * @param pX             X-coordinates of vertices
+ * @param nX             Number of X-coordinates (must equal nData)
+ * @param pTriangles     Vertex indices, three per triangle
+ * @param nTriangleIndices Number of indices (3 times number of triangles)
+ * @param pLevels        Contour levels (must be increasing)
+ * @param nLevels        Number of levels
+ * @param pOptions       Options initialized using contour_options_init (NULL for defaults)
+ * @param ppOutY         [out] Y-coordinates (caller must free with contour_free)
+ * @param nOutY          [out] Number of Y-coordinates
+ * @param ppOutX         [out] X-coordinates (caller must free with contour_free)
+ * @param nOutX          [out] Number of X-coordinates
+ * @param nOutLengths    [out] Points per polyline (caller must free with contour_free)
+ * @param nOutSegments   [out] Number of polylines
+ * @param nLevelSegments [out] Polylines per level (caller must free with contour_free)
+ * @param nLevels2       [out] Number of levels
+ * @return 0 on success, -1 on error
+ */
+CONTOUR_EXPORT int contour_compute_mesh(
+    const double* pData, size_t nData,
+    const double* pY, size_t nY,
+    const double* pX, size_t nX,
+    const size_t* pTriangles, size_t nTriangleIndices,
+    const double* pLevels, size_t nLevels,
+    const contour_options_t* pOptions,
+    double** ppOutY, size_t* nOutY,
+    double** ppOutX, size_t* nOutX,
+    size_t** nOutLengths, size_t* nOutSegments,
+    size_t** nLevelSegments, size_t* nLevels2);
+
+/**
+ * Compute contours with single-precision output coordinates.
+ *
+ * Same as contour_compute_ex(), but the coordinates are written as
+ * float. Computation is carried out in double precision.
+ *
+ * @return 0 on success, -1 on error, CONTOUR_CANCELLED if cancelled
+ */
+CONTOUR_EXPORT int contour_compute_float(
+    const double* pData, size_t nYdata, size_t nXdata,
+    const double* pY, size_t nY,
+    const double* pX, size_t nX,
+    const double* pLevels, size_t nLevels,
+    const contour_options_t* pOptions,
+    float** ppOutY, size_t* nOutY,
+    float** ppOutX, size_t* nOutX,
+    size_t** nOutLengths, size_t* nOutSegments);
+
+/**
+ * Compute sorted contours with single-precision output coordinates.
+ *
+ * Same as contour_compute_sorted_ex(), but the coordinates are written
+ * as float.
+ *
+ * @return 0 on success, -1 on error, CONTOUR_CANCELLED if cancelled
+ */
+CONTOUR_EXPORT int contour_compute_sorted_float(
+    const double* pData, size_t nYdata, size_t nXdata,
+    const double* pY, size_t nY,
+    const double* pX, size_t nX,
+    const double* pLevels, size_t nLevels,
+    const contour_options_t* pOptions,
+    float** ppOutY, size_t* nOutY,
+    float** ppOutX, size_t* nOutX,
+    size_t** nOutLengths, size_t* nOutSegments,
+    size_t** nLevelSegments, size_t* nLevels2);
+
+/**
+ * Compute indexed contours with single-precision vertices.
+ *
+ * Same as contour_compute_indexed(), but the vertices are written as
+ * float.
+ *
+ * @return 0 on success, -1 on error or if there are too many vertices,
+ *         CONTOUR_CANCELLED if cancelled
+ */
+CONTOUR_EXPORT int contour_compute_indexed_float(
+    const double* pData, size_t nYdata, size_t nXdata,
+    const double* pY, size_t nY,
+    const double* pX, size_t nX,
+    const double* pLevels, size_t nLevels,
+    const contour_options_t* pOptions,
+    contour_topology_t eTopology,
+    float** ppOutVertices, size_t* nOutVertices,
+    uint32_t** ppOutIndices, size_t* nOutIndices,
+    size_t** nOutLengths, size_t* nOutLevels);
+
+/**
+ * Compute isosurfaces with single-precision vertices.
+ *
+ * Same as contour_compute_isosurfaces(), but the vertices are written
+ * as float.
+ *
+ * @return 0 on success, -1 on error or if there are too many vertices
+ */
+CONTOUR_EXPORT int contour_compute_isosurfaces_float(
+    const double* pData, size_t nZdata, size_t nYdata, size_t nXdata,
+    const double* pZ, size_t nZ,
+    const double* pY, size_t nY,
+    const double* pX, size_t nX,
+    const double* pLevels, size_t nLevels,
+    const contour_options_t* pOptions,
+    float** ppOutVertices, size_t* nOutVertices,
+    uint32_t** ppOutIndices, size_t* nOutIndices,
+    size_t** nOutLengths, size_t* nOutLevels);
+
+/**
+ * Compute mesh contours with single-precision output coordinates.
+ *
+ * Same as contour_compute_mesh(), but the coordinates are written as
+ * float.
+ *
+ * @return 0 on success, -1 on error
+ */
+CONTOUR_EXPORT int contour_compute_mesh_float(
+    const double* pData, size_t nData,
+    const double* pY, size_t nY,
+    const double* pX, size_t nX,
+    const size_t* pTriangles, size_t nTriangleIndices,
+    const double* pLevels, size_t nLevels,
+    const contour_options_t* pOptions,
+    float** ppOutY, size_t* nOutY,
+    float** ppOutX, size_t* nOutX,
+    size_t** nOutLengths, size_t* nOutSegments,
+    size_t** nLevelSegments, size_t* nLevels2);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,652 @@
+/**
+ * @file   contour_index.cpp
+ * @brief  Packed R-tree over polyline segments of sorted contours
+ *
+ * The tree is built once, bottom-up, from segments sorted along a
+ * Hilbert curve. Nodes are stored level by level in flat arrays, with
+ * the leaves (segments) first and the root last.
+ *
+ * Copyright 2018 Jens Munk Hansen
+ */
+
+#include <contour/contour_alloc.hpp>
+#include <contour/contour_index.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <queue>
+
+namespace
+{
+const size_t nodeSize = 16;
+
+// Hilbert curve index of (x, y) on a 2^16 x 2^16 grid
+uint32_t hilbert(uint32_t x, uint32_t y)
+{
+  uint32_t a = x ^ y;
+  uint32_t b = 0xFFFF ^ a;
+  uint32_t c = 0xFFFF ^ (x | y);
+  uint32_t d = x & (y ^ 0xFFFF);
+
+  uint32_t A = a | (b >> 1);
+  uint32_t B = (a >> 1) ^ a;
+  uint32_t C = ((c >> 1) ^ (b & (d >> 1))) ^ c;
+  uint32_t D = ((a & (c >> 1)) ^ (d >> 1)) ^ d;
+
+  a = A;
+  b = B;
+  c = C;
+  d = D;
+  A = ((a & (a >> 2)) ^ (b & (b >> 2)));
+  B = ((a & (b >> 2)) ^ (b & ((a ^ b) >> 2)));
+  C ^= ((a & (c >> 2)) ^ (b & (d >> 2)));
+  D ^= ((b & (c >> 2)) ^ ((a ^ b) & (d >> 2)));
+
+  a = A;
+  b = B;
+  c = C;
+  d = D;
+  A = ((a & (a >> 4)) ^ (b & (b >> 4)));
+  B = ((a & (b >> 4)) ^ (b & ((a ^ b) >> 4)));
+  C ^= ((a & (c >> 4)) ^ (b & (d >> 4)));
+  D ^= ((b & (c >> 4)) ^ ((a ^ b) & (d >> 4)));
+
+  a = A;
+  b = B;
+  c = C;
+  d = D;
+  C ^= ((a & (c >> 8)) ^ (b & (d >> 8)));
+  D ^= ((b & (c >> 8)) ^ ((a ^ b) & (d >> 8)));
+
+  a = C ^ (C >> 1);
+  b = D ^ (D >> 1);
+
+  uint32_t i0 = x ^ y;
+  uint32_t i1 = b | (0xFFFF ^ (i0 | a));
+
+  i0 = (i0 | (i0 << 8)) & 0x00FF00FF;
+  i0 = (i0 | (i0 << 4)) & 0x0F0F0F0F;
+  i0 = (i0 | (i0 << 2)) & 0x33333333;
+  i0 = (i0 | (i0 << 1)) & 0x55555555;
+
+  i1 = (i1 | (i1 << 8)) & 0x00FF00FF;
+  i1 = (i1 | (i1 << 4)) & 0x0F0F0F0F;
+  i1 = (i1 | (i1 << 2)) & 0x33333333;
+  i1 = (i1 | (i1 << 1)) & 0x55555555;
+
+  return (i1 << 1) | i0;
+}
+
+// Locate v in monotonic coordinates, returns false if outside
+bool locate(const double* p, size_t n, double v, size_t* i, double* t)
+{
+  if (n < 2)
+  {
+    return false;
+  }
+  const bool bAscending = p[n - 1] > p[0];
+  const double* it = bAscending ? std::upper_bound(p, p + n, v)
+                                : std::upper_bound(p, p + n, v, std::greater<double>());
+  size_t index = static_cast<size_t>(it - p);
+  index = std::min(std::max<size_t>(index, 1), n - 1) - 1;
+  const double s = (v - p[index]) / (p[index + 1] - p[index]);
+  if (!(s >= 0.0 && s <= 1.0))
+  {
+    return false;
+  }
+  *i = index;
+  *t = s;
+  return true;
+}
+
+// Value at (y, x) using the same four triangles per cell as Contour()
+bool conrec_value(const double* pData, size_t nYdata, size_t nXdata, const double* pY,
+  const double* pX, double y, double x, double* value)
+{
+  size_t i, j;
+  double u, v;
+  if (!locate(pY, nYdata, y, &i, &u) || !locate(pX, nXdata, x, &j, &v))
+  {
+    return false;
+  }
+
+  // Corners (u, v, value) in the order of Contour(), centre last
+  const double d1 = pData[i * nXdata + j];
+  const double d2 = pData[(i + 1) * nXdata + j];
+  const double d3 = pData[(i + 1) * nXdata + j + 1];
+  const double d4 = pData[i * nXdata + j + 1];
+  const double corners[4][3] = { { 0.0, 0.0, d1 }, { 1.0, 0.0, d2 }, { 1.0, 1.0, d3 },
+    { 0.0, 1.0, d4 } };
+  const double centre[3] = { 0.5, 0.5, 0.25 * (d1 + d2 + d3 + d4) };
+
+  size_t m;
+  if (v <= u && v <= 1.0 - u)
+  {
+    m = 0;
+  }
+  else if (u >= v && u >= 1.0 - v)
+  {
+    m = 1;
+  }
+  else if (v >= u && v >= 1.0 - u)
+  {
+    m = 2;
+  }
+  else
+  {
+    m = 3;
+  }
+  const double* a = corners[m];
+  const double* b = corners[(m + 1) % 4];
+  const double* c = centre;
+
+  // Barycentric interpolation
+  const double det = (b[1] - c[1]) * (a[0] - c[0]) + (c[0] - b[0]) * (a[1] - c[1]);
+  const double la = ((b[1] - c[1]) * (u - c[0]) + (c[0] - b[0]) * (v - c[1])) / det;
+  const double lb = ((c[1] - a[1]) * (u - c[0]) + (a[0] - c[0]) * (v - c[1])) / det;
+  *value = la * a[2] + lb * b[2] + (1.0 - la - lb) * c[2];
+  return true;
+}
+
+inline double cross(double ax, double ay, double bx, double by)
+{
+  return ax * by - ay * bx;
+}
+
+} // namespace
+
+struct contour_index
+{
+  // Polylines
+  contour_vector<double> y;
+  contour_vector<double> x;
+  contour_vector<size_t> polylineStart;
+  contour_vector<size_t> polylineLevel;
+  // +1 if values are higher to the left of the polyline, -1 if to the right
+  contour_vector<signed char> higherLeft;
+  bool bBands = false;
+  size_t defaultBand = 0;
+
+  // Segment for each item, polyline for each segment
+  contour_vector<size_t> segments;
+  contour_vector<size_t> segmentPolyline;
+
+  // Packed R-tree, boxes are (minY, minX, maxY, maxX)
+  size_t nItems = 0;
+  contour_vector<double> boxes;
+  contour_vector<size_t> indices;
+  contour_vector<size_t> levelBounds;
+
+  // End of the children of the node at position pos
+  size_t children_end(size_t pos) const
+  {
+    auto it = std::upper_bound(levelBounds.begin(), levelBounds.end(), pos);
+    return std::min(indices[pos] + nodeSize, *(it - 1));
+  }
+
+  double box_distance2(size_t pos, double py, double px) const
+  {
+    const double* b = &boxes[4 * pos];
+    const double dy = std::max(std::max(b[0] - py, 0.0), py - b[2]);
+    const double dx = std::max(std::max(b[1] - px, 0.0), px - b[3]);
+    return dy * dy + dx * dx;
+  }
+
+  // Squared distance to segment and parameter of nearest point
+  double segment_distance2(size_t segment, double py, double px, double* pt) const
+  {
+    const double ay = y[segment];
+    const double ax = x[segment];
+    const double dy = y[segment + 1] - ay;
+    const double dx = x[segment + 1] - ax;
+    const double len2 = dy * dy + dx * dx;
+    double t = len2 > 0.0 ? ((py - ay) * dy + (px - ax) * dx) / len2 : 0.0;
+    t = std::min(std::max(t, 0.0), 1.0);
+    const double ey = ay + t * dy - py;
+    const double ex = ax + t * dx - px;
+    *pt = t;
+    return ey * ey + ex * ex;
+  }
+
+  bool segment_intersects(
+    size_t segment, double minY, double minX, double maxY, double maxX) const
+  {
+    // Liang-Barsky clipping
+    const double ay = y[segment];
+    const double ax = x[segment];
+    const double dy = y[segment + 1] - ay;
+    const double dx = x[segment + 1] - ax;
+    const double p[4] = { -dx, dx, -dy, dy };
+    const double q[4] = { ax - minX, maxX - ax, ay - minY, maxY - ay };
+    double t0 = 0.0;
+    double t1 = 1.0;
+    for (size_t k = 0; k < 4; k++)
+    {
+      if (p[k] == 0.0)
+      {
+        if (q[k] < 0.0)
+        {
+          return false;
+        }
+      }
+      else
+      {
+        const double r = q[k] / p[k];
+        if (p[k] < 0.0)
+        {
+          t0 = std::max(t0, r);
+        }
+        else
+        {
+          t1 = std::min(t1, r);
+        }
+        if (t0 > t1)
+        {
+          return false;
+        }
+      }
+    }
+    return true;
+  }
+
+  // Nearest segment and parameter of nearest point on it
+  bool nearest(double py, double px, size_t* pSegment, double* pt, double* pDistance2) const
+  {
+    if (nItems == 0)
+    {
+      return false;
+    }
+
+    // Queue of (squared distance, position), items are marked using the
+    // top bit and carry exact distances
+    const size_t itemBit = size_t(1) << (std::numeric_limits<size_t>::digits - 1);
+    using entry_t = std::pair<double, size_t>;
+    std::priority_queue<entry_t, contour_vector<entry_t>, std::greater<entry_t>> queue;
+
+    size_t pos = boxes.size() / 4 - 1;
+    while (true)
+    {
+      const size_t end = children_end(pos);
+      for (size_t child = indices[pos]; child < end; child++)
+      {
+        if (child < nItems)
+        {
+          double t;
+          queue.emplace(segment_distance2(segments[indices[child]], py, px, &t), child | itemBit);
+        }
+        else
+        {
+          queue.emplace(box_distance2(child, py, px), child);
+        }
+      }
+
+      if (!queue.empty() && (queue.top().second & itemBit))
+      {
+        const size_t item = queue.top().second & ~itemBit;
+        *pSegment = segments[indices[item]];
+        *pDistance2 = segment_distance2(*pSegment, py, px, pt);
+        return true;
+      }
+      if (queue.empty())
+      {
+        return false;
+      }
+      pos = queue.top().second;
+      queue.pop();
+    }
+  }
+
+  // True if (py, px) is left of the polyline near the nearest point
+  bool is_left(size_t segment, double t, double py, double px) const
+  {
+    const size_t polyline = segmentPolyline[segment];
+    const size_t first = polylineStart[polyline];
+    const size_t last = polylineStart[polyline + 1] - 1;
+    const bool bClosed = last > first + 1 && y[first] == y[last] && x[first] == x[last];
+
+    // Vertex at nearest point, if any
+    size_t vertex = (t <= 0.0) ? segment : (t >= 1.0 ? segment + 1 : last + 1);
+    size_t previous = vertex - 1;
+    size_t next = vertex + 1;
+    if (vertex <= last && bClosed && (vertex == first || vertex == last))
+    {
+      previous = last - 1;
+      next = first + 1;
+    }
+    else if (vertex <= last && (vertex == first || vertex == last))
+    {
+      vertex = last + 1;
+    }
+
+    if (vertex > last)
+    {
+      // Interior of segment
+      return cross(x[segment + 1] - x[segment], y[segment + 1] - y[segment], px - x[segment],
+               py - y[segment]) > 0.0;
+    }
+
+    const double c1 = cross(x[vertex] - x[previous], y[vertex] - y[previous], px - x[vertex],
+      py - y[vertex]);
+    const double c2 =
+      cross(x[next] - x[vertex], y[next] - y[vertex], px - x[vertex], py - y[vertex]);
+    const bool bTurnLeft = cross(x[vertex] - x[previous], y[vertex] - y[previous],
+                             x[next] - x[vertex], y[next] - y[vertex]) > 0.0;
+    return bTurnLeft ? (c1 > 0.0 && c2 > 0.0) : (c1 > 0.0 || c2 > 0.0);
+  }
+};
+
+extern "C" {
+
+contour_index_t* contour_index_create(const double* pContourY, size_t nContourY,
+  const double* pContourX, size_t nContourX, const size_t* pLengths, size_t nLengths,
+  const size_t* pLevelSegments, size_t nLevelSegments, const double* pLevels, size_t nLevels,
+  const double* pData, size_t nYdata, size_t nXdata, const double* pY, size_t nY,
+  const double* pX, size_t nX)
+{
+  if (nContourY != nContourX || nLevelSegments != nLevels)
+  {
+    return nullptr;
+  }
+
+  size_t nPoints = 0;
+  for (size_t iPolyline = 0; iPolyline < nLengths; iPolyline++)
+  {
+    nPoints += pLengths[iPolyline];
+  }
+  size_t nPolylines = 0;
+  for (size_t iLevel = 0; iLevel < nLevels; iLevel++)
+  {
+    nPolylines += pLevelSegments[iLevel];
+  }
+  if (nPoints != nContourY || nPolylines != nLengths)
+  {
+    return nullptr;
+  }
+
+  contour_index_t* pIndex = nullptr;
+  try
+  {
+    pIndex = contour_new<contour_index_t>();
+    pIndex->y.assign(pContourY, pContourY + nContourY);
+    pIndex->x.assign(pContourX, pContourX + nContourX);
+
+    pIndex->polylineStart.resize(nPolylines + 1);
+    pIndex->polylineLevel.resize(nPolylines);
+    size_t iPolyline = 0;
+    for (size_t iLevel = 0; iLevel < nLevels; iLevel++)
+    {
+      for (size_t iLevelPolyline = 0; iLevelPolyline < pLevelSegments[iLevel]; iLevelPolyline++)
+      {
+        pIndex->polylineLevel[iPolyline++] = iLevel;
+      }
+    }
+    pIndex->polylineStart[0] = 0;
+    for (iPolyline = 0; iPolyline < nPolylines; iPolyline++)
+    {
+      pIndex->polylineStart[iPolyline + 1] = pIndex->polylineStart[iPolyline] + pLengths[iPolyline];
+      for (size_t iPoint = pIndex->polylineStart[iPolyline];
+           iPoint + 1 < pIndex->polylineStart[iPolyline + 1]; iPoint++)
+      {
+        pIndex->segments.push_back(iPoint);
+      }
+    }
+
+    const size_t nItems = pIndex->segments.size();
+    pIndex->nItems = nItems;
+    pIndex->segmentPolyline.resize(nPoints);
+    for (iPolyline = 0; iPolyline < nPolylines; iPolyline++)
+    {
+      std::fill(pIndex->segmentPolyline.begin() + pIndex->polylineStart[iPolyline],
+        pIndex->segmentPolyline.begin() + pIndex->polylineStart[iPolyline + 1], iPolyline);
+    }
+
+    // Number of nodes for all levels of the tree
+    size_t n = nItems;
+    size_t nNodes = n;
+    pIndex->levelBounds.push_back(n);
+    do
+    {
+      n = (n + nodeSize - 1) / nodeSize;
+      nNodes += n;
+      pIndex->levelBounds.push_back(nNodes);
+    } while (n > 1);
+
+    pIndex->boxes.resize(4 * nNodes);
+    pIndex->indices.resize(nNodes);
+
+    // Leaves sorted along a Hilbert curve
+    double minY = std::numeric_limits<double>::infinity();
+    double minX = minY;
+    double maxY = -minY;
+    double maxX = -minY;
+    contour_vector<double> leaves(4 * nItems);
+    for (size_t iItem = 0; iItem < nItems; iItem++)
+    {
+      const size_t segment = pIndex->segments[iItem];
+      double* b = &leaves[4 * iItem];
+      b[0] = std::min(pIndex->y[segment], pIndex->y[segment + 1]);
+      b[1] = std::min(pIndex->x[segment], pIndex->x[segment + 1]);
+      b[2] = std::max(pIndex->y[segment], pIndex->y[segment + 1]);
+      b[3] = std::max(pIndex->x[segment], pIndex->x[segment + 1]);
+      minY = std::min(minY, b[0]);
+      minX = std::min(minX, b[1]);
+      maxY = std::max(maxY, b[2]);
+      maxX = std::max(maxX, b[3]);
+    }
+
+    contour_vector<uint32_t> keys(nItems);
+    const double hilbertMax = 0xFFFF;
+    const double scaleY = maxY > minY ? hilbertMax / (maxY - minY) : 0.0;
+    const double scaleX = maxX > minX ? hilbertMax / (maxX - minX) : 0.0;
+    for (size_t iItem = 0; iItem < nItems; iItem++)
+    {
+      const double* b = &leaves[4 * iItem];
+      const uint32_t hy = static_cast<uint32_t>(0.5 * (b[0] + b[2] - 2.0 * minY) * scaleY);
+      const uint32_t hx = static_cast<uint32_t>(0.5 * (b[1] + b[3] - 2.0 * minX) * scaleX);
+      keys[iItem] = hilbert(hx, hy);
+    }
+    contour_vector<size_t> order(nItems);
+    for (size_t iItem = 0; iItem < nItems; iItem++)
+    {
+      order[iItem] = iItem;
+    }
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return keys[a] < keys[b]; });
+    for (size_t pos = 0; pos < nItems; pos++)
+    {
+      std::copy(&leaves[4 * order[pos]], &leaves[4 * order[pos]] + 4, &pIndex->boxes[4 * pos]);
+      pIndex->indices[pos] = order[pos];
+    }
+
+    // Build parent levels
+    size_t pos = 0;
+    size_t parent = nItems;
+    for (size_t iLevel = 0; iLevel + 1 < pIndex->levelBounds.size(); iLevel++)
+    {
+      const size_t end = pIndex->levelBounds[iLevel];
+      while (pos < end)
+      {
+        double b[4] = { std::numeric_limits<double>::infinity(),
+          std::numeric_limits<double>::infinity(), -std::numeric_limits<double>::infinity(),
+          -std::numeric_limits<double>::infinity() };
+        pIndex->indices[parent] = pos;
+        for (size_t iChild = 0; iChild < nodeSize && pos < end; iChild++, pos++)
+        {
+          const double* c = &pIndex->boxes[4 * pos];
+          b[0] = std::min(b[0], c[0]);
+          b[1] = std::min(b[1], c[1]);
+          b[2] = std::max(b[2], c[2]);
+          b[3] = std::max(b[3], c[3]);
+        }
+        std::copy(b, b + 4, &pIndex->boxes[4 * parent]);
+        parent++;
+      }
+    }
+
+    // Side with higher values for each polyline
+    if (pData && pY && pX && nYdata == nY && nXdata == nX)
+    {
+      pIndex->bBands = true;
+      pIndex->higherLeft.assign(nPolylines, 0);
+      for (iPolyline = 0; iPolyline < nPolylines; iPolyline++)
+      {
+        const double level = pLevels[pIndex->polylineLevel[iPolyline]];
+        for (size_t iPoint = pIndex->polylineStart[iPolyline];
+             iPoint + 1 < pIndex->polylineStart[iPolyline + 1]; iPoint++)
+        {
+          const double dy = pIndex->y[iPoint + 1] - pIndex->y[iPoint];
+          const double dx = pIndex->x[iPoint + 1] - pIndex->x[iPoint];
+          if (dy == 0.0 && dx == 0.0)
+          {
+            continue;
+          }
+          // Points just left and right of the middle of the segment
+          const double eps = 0.01;
+          const double my = pIndex->y[iPoint] + 0.5 * dy;
+          const double mx = pIndex->x[iPoint] + 0.5 * dx;
+          double value;
+          if (conrec_value(pData, nYdata, nXdata, pY, pX, my + eps * dx, mx - eps * dy, &value) &&
+            value != level)
+          {
+            pIndex->higherLeft[iPolyline] = value > level ? 1 : -1;
+            break;
+          }
+          if (conrec_value(pData, nYdata, nXdata, pY, pX, my - eps * dx, mx + eps * dy, &value) &&
+            value != level)
+          {
+            pIndex->higherLeft[iPolyline] = value > level ? -1 : 1;
+            break;
+          }
+        }
+      }
+
+      // Band used when there are no polylines
+      if (nYdata > 0 && nXdata > 0)
+      {
+        pIndex->defaultBand =
+          static_cast<size_t>(std::upper_bound(pLevels, pLevels + nLevels, pData[0]) - pLevels);
+      }
+    }
+  }
+  catch (const std::exception&)
+  {
+    contour_delete(pIndex);
+    return nullptr;
+  }
+  return pIndex;
+}
+
+void contour_index_destroy(contour_index_t* pIndex)
+{
+  contour_delete(pIndex);
+}
+
+int contour_index_nearest(const contour_index_t* pIndex, double y, double x, size_t* pPolyline,
+  size_t* pLevel, double* pDistance)
+{
+  return contour_nothrow(
+    [&]()
+    {
+      size_t segment;
+      double t, distance2;
+      if (!pIndex->nearest(y, x, &segment, &t, &distance2))
+      {
+        return -1;
+      }
+      *pPolyline = pIndex->segmentPolyline[segment];
+      *pLevel = pIndex->polylineLevel[*pPolyline];
+      *pDistance = std::sqrt(distance2);
+      return 0;
+    });
+}
+
+int contour_index_band(const contour_index_t* pIndex, double y, double x, size_t* pBand)
+{
+  return contour_nothrow(
+    [&]()
+    {
+      if (!pIndex->bBands)
+      {
+        return -1;
+      }
+
+      size_t segment;
+      double t, distance2;
+      if (!pIndex->nearest(y, x, &segment, &t, &distance2))
+      {
+        *pBand = pIndex->defaultBand;
+        return 0;
+      }
+
+      const size_t polyline = pIndex->segmentPolyline[segment];
+      const size_t level = pIndex->polylineLevel[polyline];
+      const signed char higherLeft = pIndex->higherLeft[polyline];
+      if (distance2 == 0.0)
+      {
+        *pBand = level + 1;
+        return 0;
+      }
+      if (higherLeft == 0)
+      {
+        return -1;
+      }
+      const bool bHigher = pIndex->is_left(segment, t, y, x) == (higherLeft > 0);
+      *pBand = bHigher ? level + 1 : level;
+      return 0;
+    });
+}
+
+int contour_index_query_box(const contour_index_t* pIndex, double minY, double minX, double maxY,
+  double maxX, size_t** ppPolylines, size_t* nPolylines)
+{
+  return contour_nothrow(
+    [&]()
+    {
+      contour_vector<size_t> polylines;
+      if (pIndex->nItems > 0)
+      {
+        contour_vector<size_t> stack(1, pIndex->boxes.size() / 4 - 1);
+        while (!stack.empty())
+        {
+          const size_t pos = stack.back();
+          stack.pop_back();
+          const size_t end = pIndex->children_end(pos);
+          for (size_t child = pIndex->indices[pos]; child < end; child++)
+          {
+            const double* b = &pIndex->boxes[4 * child];
+            if (b[0] > maxY || b[1] > maxX || b[2] < minY || b[3] < minX)
+            {
+              continue;
+            }
+            if (child >= pIndex->nItems)
+            {
+              stack.push_back(child);
+              continue;
+            }
+            const size_t segment = pIndex->segments[pIndex->indices[child]];
+            if (pIndex->segment_intersects(segment, minY, minX, maxY, maxX))
+            {
+              polylines.push_back(pIndex->segmentPolyline[segment]);
+            }
+          }
+        }
+      }
+
+      std::sort(polylines.begin(), polylines.end());
+      polylines.erase(std::unique(polylines.begin(), polylines.end()), polylines.end());
+
+      *ppPolylines = contour_alloc_array<size_t>(std::max<size_t>(1, polylines.size()));
+      if (!*ppPolylines)
+      {
+        return -1;
+      }
+      std::copy(polylines.begin(), polylines.end(), *ppPolylines);
+      *nPolylines = polylines.size();
+      return 0;
+    },
+    ppPolylines, nPolylines);
+}
+
+} // extern "C"
@@ -0,0 +1,120 @@
+/**
+ * @file   contour_index.h
+ * @brief  Spatial index over sorted contours for hit-testing
+ *
+ * Copyright 2018 Jens Munk Hansen
+ */
+
+#ifndef CONTOUR_INDEX_H
+#define CONTOUR_INDEX_H
+
+#include <stddef.h>
+
+#ifdef USE_CMAKE
+#include <contour/contour_export.h>
+#else
+#define CONTOUR_EXPORT
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Opaque spatial index (packed R-tree over polyline segments) */
+typedef struct contour_index contour_index_t;
+
+/**
+ * Create a spatial index over the output of contours_sorted().
+ *
+ * The polylines are copied, so the arrays can be released after the
+ * call. The grid used for computing the contours is optional. If
+ * given, it is used for determining which side of each polyline has
+ * the higher values, which is needed for contour_index_band(). The
+ * grid is not retained.
+ *
+ * @param pContourY      Y-coordinates of polylines
+ * @param nContourY      Number of Y-coordinates
+ * @param pContourX      X-coordinates of polylines
+ * @param nContourX      Number of X-coordinates (must equal nContourY)
+ * @param pLengths       Points per polyline
+ * @param nLengths       Number of polylines
+ * @param pLevelSegments Polylines per level
+ * @param nLevelSegments Number of levels
+ * @param pLevels        Contour levels (must be increasing)
+ * @param nLevels        Number of levels (must equal nLevelSegments)
+ * @param pData          Image data (row-major) or NULL
+ * @param nYdata         Y dimension (rows)
+ * @param nXdata         X dimension (columns)
+ * @param pY             Y-coordinates of grid or NULL
+ * @param nY             Number of Y-coordinates (must equal nYdata)
+ * @param pX             X-coordinates of grid or NULL
+ * @param nX             Number of X-coordinates (must equal nXdata)
+ * @return Index (destroy with contour_index_destroy) or NULL on error
+ */
+CONTOUR_EXPORT contour_index_t* contour_index_create(
+    const double* pContourY, size_t nContourY,
+    const double* pContourX, size_t nContourX,
+    const size_t* pLengths, size_t nLengths,
+    const size_t* pLevelSegments, size_t nLevelSegments,
+    const double* pLevels, size_t nLevels,
+    const double* pData, size_t nYdata, size_t nXdata,
+    const double* pY, size_t nY,
+    const double* pX, size_t nX);
+
+/**
+ * Destroy a spatial index.
+ * @param pIndex Index to destroy (NULL is safe)
+ */
+CONTOUR_EXPORT void contour_index_destroy(contour_index_t* pIndex);
+
+/**
+ * Find the polyline nearest to a point.
+ *
+ * @param pIndex     Index
+ * @param y          Y-coordinate of point
+ * @param x          X-coordinate of point
+ * @param pPolyline  [out] Index of nearest polyline
+ * @param pLevel     [out] Level of nearest polyline
+ * @param pDistance  [out] Distance to nearest polyline
+ * @return 0 on success, -1 if the index is empty
+ */
+CONTOUR_EXPORT int contour_index_nearest(const contour_index_t* pIndex,
+    double y, double x,
+    size_t* pPolyline, size_t* pLevel, double* pDistance);
+
+/**
+ * Find the band containing a point.
+ *
+ * Band i is between levels i - 1 and i, such that band 0 is below
+ * the first level and band nLevels is above the last.
+ *
+ * @param pIndex Index
+ * @param y      Y-coordinate of point
+ * @param x      X-coordinate of point
+ * @param pBand  [out] Band containing the point
+ * @return 0 on success, -1 if the index was created without a grid
+ */
+CONTOUR_EXPORT int contour_index_band(const contour_index_t* pIndex,
+    double y, double x, size_t* pBand);
+
+/**
+ * Find polylines intersecting an axis-aligned box.
+ *
+ * @param pIndex      Index
+ * @param minY        Lower Y-coordinate of box
+ * @param minX        Lower X-coordinate of box
+ * @param maxY        Upper Y-coordinate of box
+ * @param maxX        Upper X-coordinate of box
+ * @param ppPolylines [out] Increasing polyline indices (caller must free with contour_free)
+ * @param nPolylines  [out] Number of polylines
+ * @return 0 on success, -1 on error
+ */
+CONTOUR_EXPORT int contour_index_query_box(const contour_index_t* pIndex,
+    double minY, double minX, double maxY, double maxX,
+    size_t** ppPolylines, size_t* nPolylines);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CONTOUR_INDEX_H */
@@ -0,0 +1,207 @@
+/**
+ * @file   contour_options.h
+ * @brief  Options for the extended contour entry points
+ *
+ * Copyright 2018 Jens Munk Hansen
+ */
+
+#ifndef CONTOUR_OPTIONS_H
+#define CONTOUR_OPTIONS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef USE_CMAKE
+#include <contour/contour_export.h>
+#else
+#define CONTOUR_EXPORT
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Returned by calls cancelled through contour_options_t */
+#define CONTOUR_CANCELLED (-2)
+
+/** Phases reported to the progress callback */
+typedef enum contour_phase
+{
+  CONTOUR_PHASE_EXTRACT = 0, /**< Extracting segments, progress in grid lines */
+  CONTOUR_PHASE_CONNECT = 1  /**< Connecting segments, progress in segments */
+} contour_phase_t;
+
+/** Engines connecting segments into polylines, see contour_options_t */
+typedef enum contour_engine
+{
+  CONTOUR_ENGINE_STITCH = 0, /**< Extract all segments, then connect them */
+  CONTOUR_ENGINE_TRACE = 1   /**< Follow each line from cell to cell */
+} contour_engine_t;
+
+/** Index buffer layouts of contours_indexed() */
+typedef enum contour_topology
+{
+  CONTOUR_TOPOLOGY_LINES = 0, /**< Two indices per segment */
+  CONTOUR_TOPOLOGY_STRIPS = 1 /**< Polylines, each ended by CONTOUR_RESTART_INDEX */
+} contour_topology_t;
+
+/**
+ * Index ending each polyline of CONTOUR_TOPOLOGY_STRIPS, the primitive
+ * restart index of 32-bit index buffers
+ */
+#define CONTOUR_RESTART_INDEX 0xFFFFFFFFu
+
+/** Levels chosen by contour_levels(), see contour_options_t */
+typedef enum contour_level_mode
+{
+  CONTOUR_LEVELS_NICE = 0,    /**< Multiples of a round interval */
+  CONTOUR_LEVELS_QUANTILE = 1 /**< Equally spaced quantiles of the samples */
+} contour_level_mode_t;
+
+/**
+ * Progress callback, invoked whenever another percent of a phase is
+ * done and when it completes. Return non-zero to cancel the call.
+ */
+typedef int (*contour_progress_callback_t)(contour_phase_t phase, size_t nDone, size_t nTotal,
+    void* pUser);
+
+/**
+ * Vertex transform callback, invoked on consecutive chunks of output
+ * vertices and transforming them in place. Vertices that cannot be
+ * transformed should be set to NaN.
+ */
+typedef void (*contour_transform_callback_t)(double* pX, double* pY, size_t nPoints,
+    void* pUser);
+
+/**
+ * Options for contours_ex(), contours_sorted_ex() and
+ * isosurfaces(). Always
+ * initialize using contour_options_init() before setting fields.
+ */
+typedef struct contour_options
+{
+  /**
+   * Validity mask with the same dimensions as the data (row-major),
+   * non-zero for valid samples. Cells touching an invalid sample are
+   * not contoured. May be NULL.
+   */
+  const unsigned char* pMask;
+
+  /** Treat NaN samples as missing (default 0) */
+  int bNaNIsMissing;
+
+  /** Number of worker threads, 0 for one per hardware thread (default 0) */
+  unsigned int nThreads;
+
+  /**
+   * Memory budget in bytes for the extracted segments of
+   * contours_ex() and contours_sorted_ex(), 0 for unlimited (default
+   * 0). Segments exceeding the budget are spilled to temporary files
+   * and read back one level at a time in the chunks they are
+   * connected in, and the polylines of the chunks are spilled until
+   * they are joined. The working set is bounded by the budget plus
+   * the ends of the chunk polylines of a single level. The output is
+   * unchanged.
+   */
+  size_t nMaxBytes;
+
+  /**
+   * Progress callback of contours_ex() and contours_sorted_ex() and
+   * their variants, may be NULL. Cancelled calls return
+   * CONTOUR_CANCELLED and no output.
+   */
+  contour_progress_callback_t pProgress;
+
+  /** User data passed to pProgress */
+  void* pProgressUser;
+
+  /**
+   * Cancellation flag polled by the same calls, cancelled when set
+   * to non-zero from another thread. May be NULL.
+   */
+  const volatile int* pCancel;
+
+  /**
+   * Affine transform of the output coordinates of contours_ex(),
+   * contours_sorted_ex(), contours_mesh(), contours_indexed() and the
+   * float variants, 6 coefficients {a, b, c, d, e, f} mapping (x, y)
+   * to (a x + b y + c, d x + e y + f). Applied in double precision as
+   * the vertices are written. May be NULL.
+   */
+  const double* pAffine;
+
+  /**
+   * Transform callback of the same calls, applied after pAffine to
+   * chunks of vertices before they are written. May be NULL.
+   */
+  contour_transform_callback_t pTransform;
+
+  /** User data passed to pTransform */
+  void* pTransformUser;
+
+  /**
+   * Window of the samples to contour, rows [iRowBegin, iRowEnd) and
+   * columns [iColumnBegin, iColumnEnd) of the full arrays, where an
+   * end of 0 is the end of the array (default 0 for all). Only cells
+   * inside the window are accessed. Cells are contoured as in the
+   * full grid, so windows sharing a row or column of samples give
+   * identical vertices along it. Used by all calls on rectilinear
+   * grids.
+   */
+  size_t iRowBegin;
+  size_t iRowEnd;
+  size_t iColumnBegin;
+  size_t iColumnEnd;
+
+  /**
+   * Clip box {xmin, ymin, xmax, ymax} in coordinates, where x is the
+   * column and y the row coordinate. Segments are clipped to the box
+   * and cells outside it are skipped. Points on a box edge are exact,
+   * so boxes sharing an edge line up. Ignored by
+   * contours_statistics(). May be NULL.
+   */
+  const double* pClip;
+
+  /**
+   * Engine of contours_sorted_ex() and contours_sorted_float()
+   * (default CONTOUR_ENGINE_STITCH). CONTOUR_ENGINE_TRACE follows
+   * each line through the triangles of CONREC using a bitmap of
+   * visited triangles, and writes the vertices in order directly to
+   * the output, so no segments are stored or connected and nMaxBytes
+   * is not needed. Samples equal to a level are treated as below it,
+   * so lines through samples may differ from those of the default
+   * engine, which connects the segments of CONREC. Otherwise the
+   * vertices are the same, but polylines are ordered by the cell
+   * where they are first met. Progress is reported in grid lines per
+   * level as CONTOUR_PHASE_EXTRACT.
+   */
+  contour_engine_t eEngine;
+
+  /**
+   * Levels chosen by contour_levels() and contours_sorted_auto()
+   * (default CONTOUR_LEVELS_NICE). Nice levels are the multiples of
+   * dLevelInterval strictly between the smallest and the largest
+   * sample. Quantile levels split the samples into equally large
+   * groups.
+   */
+  contour_level_mode_t eLevels;
+
+  /**
+   * Interval of CONTOUR_LEVELS_NICE, 0 for the smallest of 1, 2, 2.5
+   * and 5 times a power of 10 giving at most the requested number of
+   * levels (default 0)
+   */
+  double dLevelInterval;
+} contour_options_t;
+
+/**
+ * Initialize options to defaults.
+ * @param pOptions Options to initialize
+ */
+CONTOUR_EXPORT void contour_options_init(contour_options_t* pOptions);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CONTOUR_OPTIONS_H */
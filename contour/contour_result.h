@@ -0,0 +1,120 @@
+/**
+ * @file   contour_result.h
+ * @brief  Lazy, per-level access to sorted contours
+ *
+ * Copyright 2018 Jens Munk Hansen
+ */
+
+#ifndef CONTOUR_RESULT_H
+#define CONTOUR_RESULT_H
+
+#include <stddef.h>
+
+#ifdef USE_CMAKE
+#include <contour/contour_export.h>
+#else
+#define CONTOUR_EXPORT
+#endif
+
+#include <contour/contour_options.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Opaque result handle holding extracted segments for each level */
+typedef struct contour_result contour_result_t;
+
+/**
+ * Extract contour segments for all levels without connecting them.
+ *
+ * Segments of a level are connected into polylines the first time
+ * the level is requested and kept for later requests. The polylines
+ * are identical to those returned by contours_sorted_ex(). A handle
+ * must not be used concurrently from several threads.
+ *
+ * @param pData    Image data (row-major)
+ * @param nYdata   Y dimension (rows)
+ * @param nXdata   X dimension (columns)
+ * @param pY       Y-coordinates array
+ * @param nY       Number of Y-coordinates (must equal nYdata)
+ * @param pX       X-coordinates array
+ * @param nX       Number of X-coordinates (must equal nXdata)
+ * @param pLevels  Contour levels
+ * @param nLevels  Number of contour levels
+ * @param pOptions Options or NULL for defaults
+ * @return Result (destroy with contour_result_destroy) or NULL on error
+ *         or cancellation
+ */
+CONTOUR_EXPORT contour_result_t* contour_result_create(
+    const double* pData, const size_t nYdata, const size_t nXdata,
+    const double* pY, const size_t nY,
+    const double* pX, const size_t nX,
+    const double* pLevels, const size_t nLevels,
+    const contour_options_t* pOptions);
+
+/**
+ * Destroy a result handle.
+ * @param pResult Result to destroy (NULL is safe)
+ */
+CONTOUR_EXPORT void contour_result_destroy(contour_result_t* pResult);
+
+/**
+ * Number of levels.
+ * @param pResult Result
+ * @return Number of levels
+ */
+CONTOUR_EXPORT size_t contour_result_levels(const contour_result_t* pResult);
+
+/**
+ * Number of polylines for a level, connecting its segments if needed.
+ *
+ * If memory runs out while connecting, the level is lost: this and the
+ * other accessors report an error for it from then on.
+ *
+ * @param pResult Result
+ * @param iLevel  Level index
+ * @return Number of polylines (0 for an invalid or lost level)
+ */
+CONTOUR_EXPORT size_t contour_result_polylines(contour_result_t* pResult, size_t iLevel);
+
+/**
+ * Access a single polyline without copying.
+ *
+ * The coordinates remain valid until the result is destroyed.
+ *
+ * @param pResult   Result
+ * @param iLevel    Level index
+ * @param iPolyline Polyline index within the level
+ * @param ppY       [out] Y-coordinates of polyline
+ * @param ppX       [out] X-coordinates of polyline
+ * @param nPoints   [out] Number of points
+ * @return 0 on success, -1 on invalid indices or a lost level
+ */
+CONTOUR_EXPORT int contour_result_polyline(contour_result_t* pResult,
+    size_t iLevel, size_t iPolyline,
+    const double** ppY, const double** ppX, size_t* nPoints);
+
+/**
+ * Copy all polylines of a single level.
+ *
+ * @param pResult      Result
+ * @param iLevel       Level index
+ * @param ppOutY       [out] Y-coordinates (caller must free with contour_free)
+ * @param nOutY        [out] Number of Y-coordinates
+ * @param ppOutX       [out] X-coordinates (caller must free with contour_free)
+ * @param nOutX        [out] Number of X-coordinates
+ * @param nOutLengths  [out] Points per polyline (caller must free with contour_free)
+ * @param nOutSegments [out] Number of polylines
+ * @return 0 on success, -1 on error
+ */
+CONTOUR_EXPORT int contour_result_level(contour_result_t* pResult, size_t iLevel,
+    double** ppOutY, size_t* nOutY,
+    double** ppOutX, size_t* nOutX,
+    size_t** nOutLengths, size_t* nOutSegments);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CONTOUR_RESULT_H */
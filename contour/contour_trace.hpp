@@ -0,0 +1,352 @@
+/**
+ * @file   contour_trace.hpp
+ * @brief  Trace contour lines cell to cell into ordered polylines
+ *
+ * Copyright 2018 Jens Munk Hansen
+ */
+
+#pragma once
+
+#include <contour/contour_alloc.hpp>
+#include <contour/contour_options.h>
+#include <contour/contour_visit.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+/*
+   Each cell is split into the four triangles of CONREC, where triangle
+   t has the corners t and t + 1 (mod 4) and the centre as vertices.
+   The corners are numbered
+
+      0: (i, j)  1: (i + 1, j)  2: (i + 1, j + 1)  3: (i, j + 1)
+
+   and the centre is vertex 4, with the average height of the corners.
+   The edges of triangle t are numbered
+
+      0: corner t to corner t + 1, the cell edge
+      1: corner t to the centre, shared with triangle t - 1
+      2: corner t + 1 to the centre, shared with triangle t + 1
+
+   A vertex is above a level if its height is strictly greater, so
+   every triangle is crossed by at most one line through two of its
+   edges. The lines are followed from triangle to triangle without any
+   search. Points are interpolated as in CONREC, with the end points
+   of every edge in a fixed order, so a point is identical from either
+   side of an edge and a generic line passes through exactly the end
+   points of the segments of CONREC.
+*/
+class level_tracer_t
+{
+public:
+  level_tracer_t(const double* const* d, const uint64_t* const* mask, const cell_window_t& window,
+    const double* pY, const double* pX, contour_vector<uint64_t>* visited)
+    : m_d(d)
+    , m_mask(mask)
+    , m_iBegin(static_cast<int>(window.iRowBegin))
+    , m_iEnd(static_cast<int>(window.iRowEnd) - 1)
+    , m_jBegin(static_cast<int>(window.iColumnBegin))
+    , m_jEnd(static_cast<int>(window.iColumnEnd) - 1)
+    , m_pY(pY)
+    , m_pX(pX)
+    , m_visited(visited)
+    , m_level(0.0)
+    , m_iCell(-1)
+    , m_jCell(-1)
+  {
+  }
+
+  /**
+   * Trace all lines of a level, seeding at the crossed triangles in
+   * row-major order of the cells. For each line, polylines.begin() is
+   * called, followed by polylines.put(x, y, key) for each point and
+   * polylines.end(bClosed), where key is the cell_point_key() of the
+   * point for a grid as wide as the window ends. Open lines start and
+   * end at the boundary of the valid cells, and closed lines end with
+   * their first point.
+   *
+   * @param level     Contour level
+   * @param poll      Called as poll() before each row, false stops
+   * @param polylines Receiver of the lines
+   *
+   * @return false if stopped by poll
+   */
+  template <typename Poll, typename Polylines>
+  bool trace(double level, Poll&& poll, Polylines& polylines)
+  {
+    m_level = level;
+    m_iCell = -1;
+    const size_t nColumns = static_cast<size_t>(std::max(m_jEnd - m_jBegin, 0));
+    const size_t nRows = static_cast<size_t>(std::max(m_iEnd - m_iBegin, 0));
+    m_visited->assign((4 * nRows * nColumns + 63) / 64, 0);
+
+    for (int i = m_iBegin; i < m_iEnd; i++)
+    {
+      if (!poll())
+      {
+        return false;
+      }
+      const uint64_t* bits = m_mask ? m_mask[i] : nullptr;
+      if (m_mask && !bits)
+      {
+        continue;
+      }
+      const double* d0 = m_d[i];
+      const double* d1 = m_d[i + 1];
+      for (int j = m_jBegin; j < m_jEnd; j++)
+      {
+        const int jj = j - m_jBegin;
+        if (bits && !((bits[jj >> 6] >> (jj & 63)) & 1))
+        {
+          continue;
+        }
+        // Only cells with corners on both sides of the level are crossed
+        const double dmin = std::min(std::min(d0[j], d1[j]), std::min(d1[j + 1], d0[j + 1]));
+        const double dmax = std::max(std::max(d0[j], d1[j]), std::max(d1[j + 1], d0[j + 1]));
+        if (dmin > level || dmax <= level)
+        {
+          continue;
+        }
+        for (int t = 0; t < 4; t++)
+        {
+          if (!visited(i, j, t) && crossed(i, j, t))
+          {
+            trace_line(i, j, t, polylines);
+          }
+        }
+      }
+    }
+    return true;
+  }
+
+private:
+  // Triangle with the edge through which a line enters or leaves
+  struct step_t
+  {
+    int i;
+    int j;
+    int t;
+    int e;
+  };
+
+  bool valid(int i, int j) const
+  {
+    if (i < m_iBegin || i >= m_iEnd || j < m_jBegin || j >= m_jEnd)
+    {
+      return false;
+    }
+    if (!m_mask)
+    {
+      return true;
+    }
+    const int jj = j - m_jBegin;
+    return m_mask[i] && ((m_mask[i][jj >> 6] >> (jj & 63)) & 1);
+  }
+
+  size_t bit(int i, int j, int t) const
+  {
+    const size_t nColumns = static_cast<size_t>(m_jEnd - m_jBegin);
+    return 4 * (static_cast<size_t>(i - m_iBegin) * nColumns + static_cast<size_t>(j - m_jBegin)) +
+      static_cast<size_t>(t);
+  }
+
+  bool visited(int i, int j, int t) const
+  {
+    const size_t b = bit(i, j, t);
+    return ((*m_visited)[b >> 6] >> (b & 63)) & 1;
+  }
+
+  void visit(int i, int j, int t)
+  {
+    const size_t b = bit(i, j, t);
+    (*m_visited)[b >> 6] |= uint64_t(1) << (b & 63);
+  }
+
+  // Heights relative to the level, in the order of Contour()
+  void load(int i, int j)
+  {
+    if (i == m_iCell && j == m_jCell)
+    {
+      return;
+    }
+    m_iCell = i;
+    m_jCell = j;
+    m_h[0] = m_d[i][j] - m_level;
+    m_h[1] = m_d[i + 1][j] - m_level;
+    m_h[2] = m_d[i + 1][j + 1] - m_level;
+    m_h[3] = m_d[i][j + 1] - m_level;
+    m_h[4] = 0.25 * (m_h[0] + m_h[1] + m_h[2] + m_h[3]);
+  }
+
+  // End points of edge e of triangle t, in a fixed order
+  static void edge_vertices(int t, int e, int* p1, int* p2)
+  {
+    switch (e)
+    {
+      case 0:
+        // Cell edges start at their lower row and column
+        *p1 = t < 2 ? t : (t == 2 ? 3 : 0);
+        *p2 = t < 2 ? t + 1 : (t == 2 ? 2 : 3);
+        break;
+      case 1:
+        *p1 = t;
+        *p2 = 4;
+        break;
+      default:
+        *p1 = (t + 1) & 3;
+        *p2 = 4;
+        break;
+    }
+  }
+
+  bool edge_crossed(int t, int e) const
+  {
+    int p1, p2;
+    edge_vertices(t, e, &p1, &p2);
+    return (m_h[p1] > 0.0) != (m_h[p2] > 0.0);
+  }
+
+  bool crossed(int i, int j, int t)
+  {
+    load(i, j);
+    return edge_crossed(t, 0) || edge_crossed(t, 1);
+  }
+
+  // The other crossed edge of a triangle entered through edge e
+  int exit_edge(int t, int e) const
+  {
+    for (int e2 = 0; e2 < 3; e2++)
+    {
+      if (e2 != e && edge_crossed(t, e2))
+      {
+        return e2;
+      }
+    }
+    return e;
+  }
+
+  // Move through the edge a line leaves by, returns false at the boundary
+  bool cross(step_t* s) const
+  {
+    if (s->e == 1)
+    {
+      s->t = (s->t + 3) & 3;
+      s->e = 2;
+      return true;
+    }
+    if (s->e == 2)
+    {
+      s->t = (s->t + 1) & 3;
+      s->e = 1;
+      return true;
+    }
+    static const int di[4] = { 0, 1, 0, -1 };
+    static const int dj[4] = { -1, 0, 1, 0 };
+    const int i = s->i + di[s->t];
+    const int j = s->j + dj[s->t];
+    if (!valid(i, j))
+    {
+      return false;
+    }
+    s->i = i;
+    s->j = j;
+    s->t = (s->t + 2) & 3;
+    return true;
+  }
+
+  template <typename Polylines>
+  void put(const step_t& s, Polylines& polylines)
+  {
+    int p1, p2;
+    edge_vertices(s.t, s.e, &p1, &p2);
+    const double xh[5] = { m_pX[s.j], m_pX[s.j], m_pX[s.j + 1], m_pX[s.j + 1],
+      0.50 * (m_pX[s.j] + m_pX[s.j + 1]) };
+    const double yh[5] = { m_pY[s.i], m_pY[s.i + 1], m_pY[s.i + 1], m_pY[s.i],
+      0.50 * (m_pY[s.i] + m_pY[s.i + 1]) };
+    // Points interpolated from a vertex on the level are on the vertex
+    int a = p1;
+    int b = p2;
+    if (m_h[p1] == 0.0)
+    {
+      b = p1;
+    }
+    else if (m_h[p2] == 0.0)
+    {
+      a = p2;
+    }
+    polylines.put((m_h[p2] * xh[p1] - m_h[p1] * xh[p2]) / (m_h[p2] - m_h[p1]),
+      (m_h[p2] * yh[p1] - m_h[p1] * yh[p2]) / (m_h[p2] - m_h[p1]),
+      cell_point_key(static_cast<size_t>(s.i), static_cast<size_t>(s.j),
+        static_cast<size_t>(m_jEnd) + 1, a, b));
+  }
+
+  // Trace the line through a crossed triangle. The line is first
+  // followed backwards to its start, which is the seed itself for a
+  // closed line.
+  template <typename Polylines>
+  void trace_line(int i, int j, int t, Polylines& polylines)
+  {
+    load(i, j);
+    int eForward = 0;
+    while (!edge_crossed(t, eForward))
+    {
+      eForward++;
+    }
+    const int eBackward = exit_edge(t, eForward);
+
+    step_t start = { i, j, t, eBackward };
+    bool bClosed = false;
+    step_t s = start;
+    while (true)
+    {
+      step_t next = s;
+      if (!cross(&next))
+      {
+        // Enter the start triangle through the boundary edge
+        start = s;
+        break;
+      }
+      if (next.i == i && next.j == j && next.t == t)
+      {
+        bClosed = true;
+        break;
+      }
+      load(next.i, next.j);
+      next.e = exit_edge(next.t, next.e);
+      s = next;
+    }
+
+    // Follow the line forwards, writing points as edges are crossed
+    polylines.begin();
+    s = start;
+    load(s.i, s.j);
+    put(s, polylines);
+    while (true)
+    {
+      visit(s.i, s.j, s.t);
+      s.e = exit_edge(s.t, s.e);
+      put(s, polylines);
+      if (!cross(&s) || (bClosed && s.i == start.i && s.j == start.j && s.t == start.t))
+      {
+        break;
+      }
+      load(s.i, s.j);
+    }
+    polylines.end(bClosed);
+  }
+
+  const double* const* m_d;
+  const uint64_t* const* m_mask;
+  const int m_iBegin;
+  const int m_iEnd;
+  const int m_jBegin;
+  const int m_jEnd;
+  const double* m_pY;
+  const double* m_pX;
+  contour_vector<uint64_t>* m_visited;
+  double m_level;
+  int m_iCell;
+  int m_jCell;
+  double m_h[5];
+};
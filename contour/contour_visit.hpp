@@ -0,0 +1,404 @@
+/**
+ * @file   contour_visit.hpp
+ * @brief  Visit contour segments as they are produced
+ *
+ * Copyright 2018 Jens Munk Hansen
+ */
+
+#pragma once
+
+#include <contour/conrec.hpp>
+#include <contour/contour_alloc.hpp>
+#include <contour/contour_options.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+// Window of samples [iRowBegin, iRowEnd) x [iColumnBegin, iColumnEnd)
+struct cell_window_t
+{
+  size_t iRowBegin;
+  size_t iRowEnd;
+  size_t iColumnBegin;
+  size_t iColumnEnd;
+
+  // Number of cell rows
+  size_t rows() const
+  {
+    return iRowEnd - iRowBegin > 1 ? iRowEnd - iRowBegin - 1 : 0;
+  }
+
+  // Number of cell columns
+  size_t columns() const
+  {
+    return iColumnEnd - iColumnBegin > 1 ? iColumnEnd - iColumnBegin - 1 : 0;
+  }
+};
+
+// Identity of a point of a contour line in cell (i, j) of a grid with
+// nColumns columns, on the edge between vertices a and b of the cell,
+// or on vertex a if they are equal. Vertices 0 to 3 are the corners
+// (i, j), (i + 1, j), (i + 1, j + 1) and (i, j + 1) and vertex 4 is the
+// centre. A point on the edge between two cells has the same key in
+// both.
+inline uint64_t cell_point_key(size_t i, size_t j, size_t nColumns, int a, int b)
+{
+  static const size_t di[5] = { 0, 1, 1, 0, 0 };
+  static const size_t dj[5] = { 0, 0, 1, 1, 0 };
+  if (a > b)
+  {
+    std::swap(a, b);
+  }
+  if (b == 4)
+  {
+    // Centre, or the line from a corner to the centre
+    return 8 * (i * nColumns + j) + (a == 4 ? 3 : 4 + static_cast<uint64_t>(a));
+  }
+  const size_t i1 = i + std::min(di[a], di[b]);
+  const size_t j1 = j + std::min(dj[a], dj[b]);
+  if (a == b)
+  {
+    return 8 * (i1 * nColumns + j1);
+  }
+  // Edges along a row or a column of samples
+  return 8 * (i1 * nColumns + j1) + (di[a] == di[b] ? 1 : 2);
+}
+
+// Window of the options, returns false if it exceeds the grid
+inline bool get_cell_window(const size_t nYdata, const size_t nXdata,
+  const contour_options_t* pOptions, cell_window_t* window)
+{
+  window->iRowBegin = pOptions ? pOptions->iRowBegin : 0;
+  window->iRowEnd = pOptions && pOptions->iRowEnd ? pOptions->iRowEnd : nYdata;
+  window->iColumnBegin = pOptions ? pOptions->iColumnBegin : 0;
+  window->iColumnEnd = pOptions && pOptions->iColumnEnd ? pOptions->iColumnEnd : nXdata;
+  return window->iRowBegin < window->iRowEnd && window->iRowEnd <= nYdata &&
+    window->iColumnBegin < window->iColumnEnd && window->iColumnEnd <= nXdata;
+}
+
+// Shrink a window to the cells between the first and the last one
+// intersecting [lower, upper] along a dimension
+inline void clip_cell_range(
+  const double* pCoordinates, double lower, double upper, size_t* iBegin, size_t* iEnd)
+{
+  size_t iFirst = *iEnd;
+  size_t iLast = *iBegin;
+  for (size_t i = *iBegin; i + 1 < *iEnd; i++)
+  {
+    const double a = std::min(pCoordinates[i], pCoordinates[i + 1]);
+    const double b = std::max(pCoordinates[i], pCoordinates[i + 1]);
+    if (b >= lower && a <= upper)
+    {
+      iFirst = std::min(iFirst, i);
+      iLast = i;
+    }
+  }
+  if (iFirst == *iEnd)
+  {
+    // No cells
+    *iEnd = *iBegin;
+    return;
+  }
+  *iBegin = iFirst;
+  *iEnd = iLast + 2;
+}
+
+// Clip a segment to the box {xmin, ymin, xmax, ymax}, returns false if
+// nothing is left. Points on the box are computed from the original
+// segment, so a segment split by the box edge shared by two windows
+// gets the same point in both.
+inline bool clip_segment(const double* pClip, double* x1, double* y1, double* x2, double* y2)
+{
+  const double dx = *x2 - *x1;
+  const double dy = *y2 - *y1;
+  double t0 = 0.0;
+  double t1 = 1.0;
+  int edge0 = -1;
+  int edge1 = -1;
+
+  // Edges as p t <= q, in the order xmin, ymin, xmax, ymax
+  const double p[4] = { -dx, -dy, dx, dy };
+  const double q[4] = { *x1 - pClip[0], *y1 - pClip[1], pClip[2] - *x1, pClip[3] - *y1 };
+  for (int edge = 0; edge < 4; edge++)
+  {
+    if (p[edge] == 0.0)
+    {
+      if (q[edge] < 0.0)
+      {
+        return false;
+      }
+      continue;
+    }
+    const double t = q[edge] / p[edge];
+    if (p[edge] < 0.0 && t > t0)
+    {
+      t0 = t;
+      edge0 = edge;
+    }
+    else if (p[edge] > 0.0 && t < t1)
+    {
+      t1 = t;
+      edge1 = edge;
+    }
+  }
+  if (t0 > t1 || (t0 == t1 && dx * dx + dy * dy > 0.0))
+  {
+    return false;
+  }
+
+  // Points on an edge get the coordinate of the edge exactly
+  const double x0 = *x1;
+  const double y0 = *y1;
+  auto point = [&](double t, int edge, double* x, double* y)
+  {
+    *x = (edge & 1) ? x0 + t * dx : pClip[edge];
+    *y = (edge & 1) ? pClip[edge] : y0 + t * dy;
+  };
+  if (edge0 >= 0)
+  {
+    point(t0, edge0, x1, y1);
+  }
+  if (edge1 >= 0)
+  {
+    point(t1, edge1, x2, y2);
+  }
+  return true;
+}
+
+// Cell validity mask (row-wise bits, see Contour)
+struct cell_mask_t
+{
+  contour_vector<uint64_t> bits;
+  contour_vector<const uint64_t*> rows;
+};
+
+// Mask of the cells in a window, bits are relative to the first column
+// of the window. Returns false if all cells are valid, in which case no
+// mask is needed.
+inline bool build_cell_mask(const double* pData, const size_t nXdata, const cell_window_t& window,
+  const contour_options_t* pOptions, cell_mask_t* mask)
+{
+  if (!pOptions || (!pOptions->pMask && !pOptions->bNaNIsMissing) || window.rows() == 0 ||
+    window.columns() == 0)
+  {
+    return false;
+  }
+
+  const size_t nRows = window.rows();
+  const size_t nColumns = window.columns();
+  const size_t nWords = (nColumns + 63) / 64;
+  const size_t iX0 = window.iColumnBegin;
+  const unsigned char* pMask = pOptions->pMask;
+  const bool bNaN = pOptions->bNaNIsMissing != 0;
+
+  // Sample validity for current and next row of the window
+  contour_vector<unsigned char> valid0(nColumns + 1);
+  contour_vector<unsigned char> valid1(nColumns + 1);
+  auto sample_validity = [&](size_t iY, unsigned char* pValid)
+  {
+    for (size_t iX = 0; iX <= nColumns; iX++)
+    {
+      const size_t index = iY * nXdata + iX0 + iX;
+      pValid[iX] = (!pMask || pMask[index]) && !(bNaN && std::isnan(pData[index]));
+    }
+  };
+
+  mask->bits.assign(nRows * nWords, 0);
+  mask->rows.assign(window.iRowEnd - 1, nullptr);
+
+  bool bInvalid = false;
+  sample_validity(window.iRowBegin, valid0.data());
+  for (size_t iY = 0; iY < nRows; iY++)
+  {
+    sample_validity(window.iRowBegin + iY + 1, valid1.data());
+    uint64_t* pWords = &mask->bits[iY * nWords];
+    bool bAny = false;
+    for (size_t iX = 0; iX < nColumns; iX++)
+    {
+      if (valid0[iX] && valid0[iX + 1] && valid1[iX] && valid1[iX + 1])
+      {
+        pWords[iX >> 6] |= uint64_t(1) << (iX & 63);
+        bAny = true;
+      }
+      else
+      {
+        bInvalid = true;
+      }
+    }
+    // Rows without valid cells are skipped entirely
+    if (bAny)
+    {
+      mask->rows[window.iRowBegin + iY] = pWords;
+    }
+    std::swap(valid0, valid1);
+  }
+  return bInvalid;
+}
+
+// Progress reporting and cancellation of a call, see contour_options_t
+class contour_progress_t
+{
+public:
+  explicit contour_progress_t(const contour_options_t* pOptions)
+    : m_pCallback(pOptions ? pOptions->pProgress : nullptr)
+    , m_pUser(pOptions ? pOptions->pProgressUser : nullptr)
+    , m_pCancel(pOptions ? pOptions->pCancel : nullptr)
+    , m_phase(CONTOUR_PHASE_EXTRACT)
+    , m_nDone(0)
+    , m_nTotal(0)
+    , m_nNextReport(0)
+    , m_bCancelled(false)
+  {
+  }
+
+  void begin(contour_phase_t phase, size_t nTotal)
+  {
+    m_phase = phase;
+    m_nDone = 0;
+    m_nTotal = nTotal;
+    m_nNextReport = 0;
+  }
+
+  // Returns false once cancelled
+  bool advance(size_t nDone = 1)
+  {
+    return update(m_nDone + nDone);
+  }
+
+  bool update(size_t nDone)
+  {
+    if (m_bCancelled)
+    {
+      return false;
+    }
+    m_nDone = nDone;
+    if (m_pCancel && *m_pCancel)
+    {
+      m_bCancelled = true;
+    }
+    else if (m_pCallback && (m_nDone >= m_nNextReport || m_nDone == m_nTotal))
+    {
+      m_bCancelled = m_pCallback(m_phase, m_nDone, m_nTotal, m_pUser) != 0;
+      m_nNextReport = m_nDone + std::max<size_t>(1, m_nTotal / 100);
+    }
+    return !m_bCancelled;
+  }
+
+  bool cancelled() const
+  {
+    return m_bCancelled;
+  }
+
+  // Polls the cancellation flag only, safe from any thread
+  bool cancel_requested() const
+  {
+    return m_pCancel && *m_pCancel;
+  }
+
+  size_t done() const
+  {
+    return m_nDone;
+  }
+
+private:
+  contour_progress_callback_t m_pCallback;
+  void* m_pUser;
+  const volatile int* m_pCancel;
+  contour_phase_t m_phase;
+  size_t m_nDone;
+  size_t m_nTotal;
+  size_t m_nNextReport;
+  bool m_bCancelled;
+};
+
+/**
+ * Visit contour segments without storing them
+ *
+ * The sink is invoked as sink(x1, y1, x2, y2, level) for each segment,
+ * where x is the column coordinate (from pX) and y is the row
+ * coordinate (from pY). Segments are not connected and are visited in
+ * the order produced by CONREC. Only cells in the window of the
+ * options are visited, and segments are clipped to its clip box. The
+ * call is inlined into the kernel, and no global state is used, so
+ * concurrent calls are safe.
+ *
+ * @param[in]  pData     Image data (row-major)
+ * @param[in]  nYdata    Y dimension (rows)
+ * @param[in]  nXdata    X dimension (columns)
+ * @param[in]  pY        Y-coordinates
+ * @param[in]  nY        Number of Y-coordinates (must equal nYdata)
+ * @param[in]  pX        X-coordinates
+ * @param[in]  nX        Number of X-coordinates (must equal nXdata)
+ * @param[in]  pLevels   Contour levels (must be increasing)
+ * @param[in]  nLevels   Number of levels
+ * @param[in]  pOptions  Options or nullptr for defaults
+ * @param[in]  sink      Callable receiving the segments
+ *
+ * @return 0 on success, -1 on error, CONTOUR_CANCELLED if cancelled
+ */
+template <typename Sink>
+int contours_visit(const double* pData, const size_t nYdata, const size_t nXdata,
+  const double* pY, const size_t nY, const double* pX, const size_t nX, const double* pLevels,
+  const size_t nLevels, const contour_options_t* pOptions, Sink&& sink)
+{
+  if (nXdata != nX || nYdata != nY || nLevels == 0 || nX == 0 || nY == 0)
+  {
+    return -1;
+  }
+
+  cell_window_t window;
+  if (!get_cell_window(nYdata, nXdata, pOptions, &window))
+  {
+    return -1;
+  }
+  const double* pClip = pOptions ? pOptions->pClip : nullptr;
+  if (pClip)
+  {
+    clip_cell_range(pY, pClip[1], pClip[3], &window.iRowBegin, &window.iRowEnd);
+    clip_cell_range(pX, pClip[0], pClip[2], &window.iColumnBegin, &window.iColumnEnd);
+  }
+
+  cell_mask_t mask;
+  const bool bMask = build_cell_mask(pData, nXdata, window, pOptions, &mask);
+
+  // Establish row pointers, only rows of the window are accessed
+  contour_vector<const double*> rows(nYdata);
+  for (size_t iY = window.iRowBegin; iY < window.iRowEnd; iY++)
+  {
+    rows[iY] = &pData[iY * nXdata];
+  }
+
+  int ilb = static_cast<int>(window.iRowBegin);
+  int iub = static_cast<int>(window.iRowEnd) - 1;
+  int jlb = static_cast<int>(window.iColumnBegin);
+  int jub = static_cast<int>(window.iColumnEnd) - 1;
+
+  // The kernel polls before each row of each strip of columns
+  const size_t nStrips = (window.columns() + ConrecBlockColumns - 1) / ConrecBlockColumns;
+  const size_t nLines = window.rows() * nStrips;
+  contour_progress_t progress(pOptions);
+  progress.begin(CONTOUR_PHASE_EXTRACT, nLines);
+
+  // Data is accessed according to rows[i][j], so CONREC reports the
+  // row coordinate first
+  size_t nLinesDone = 0;
+  Contour(rows.data(), bMask ? mask.rows.data() : nullptr, ilb, iub, jlb, jub, pY, pX,
+    static_cast<int>(nLevels), pLevels,
+    [&sink, pClip](double y1, double x1, double y2, double x2, int level)
+    {
+      if (!pClip || clip_segment(pClip, &x1, &y1, &x2, &y2))
+      {
+        sink(x1, y1, x2, y2, level);
+      }
+    },
+    [&progress, &nLinesDone]() { return progress.update(nLinesDone++); });
+
+  if (progress.cancelled() || !progress.update(nLines))
+  {
+    return CONTOUR_CANCELLED;
+  }
+  return 0;
+}
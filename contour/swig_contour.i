@@ -2,7 +2,12 @@
 #pragma SWIG nowarn=320
 %{
   #define SWIG_FILE_WITH_INIT
+  #include <contour/contour_options.h>
   #include <contour/contour.hpp>
+  #include <contour/contour_index.h>
+  #include <contour/contour_result.h>
+  #include <contour/contour_cache.h>
+  #include <contour/contour_capi.h>
 %}
 
 // SWIG 4.1+ compatibility - SWIG_Python_AppendOutput now requires 3 args
@@ -15,6 +20,8 @@
 %}
 
 %include "windows.i"
+%include "typemaps.i"
+%include "stdint.i"
 
 #ifdef SWIGPYTHON
   %include "numpy.i"
@@ -22,6 +29,45 @@
   %init {
     import_array();
   }
+
+  // Output arrays come from the allocator hooks, so the arrays viewing
+  // them must release them with contour_free rather than free
+  %fragment("Contour_Free_Capsule", "header") %{
+    void contour_free_capsule(PyObject* cap)
+    {
+      contour_free(PyCapsule_GetPointer(cap, SWIGPY_CAPSULE_NAME));
+    }
+  %}
+
+  %define %contour_argout_view(DATA_TYPE, DATA_TYPECODE)
+  %typemap(argout, fragment="Contour_Free_Capsule")
+    (DATA_TYPE** ARGOUTVIEWM_ARRAY1, size_t* DIM1)
+  {
+    npy_intp dims[1] = { (npy_intp)*$2 };
+    // Outputs are NULL on error
+    PyObject* obj = *$1 ? PyArray_SimpleNewFromData(1, dims, DATA_TYPECODE, (void*)(*$1))
+                        : PyArray_SimpleNew(1, dims, DATA_TYPECODE);
+    if (!obj) SWIG_fail;
+    if (*$1)
+    {
+      PyObject* cap = PyCapsule_New((void*)(*$1), SWIGPY_CAPSULE_NAME, contour_free_capsule);
+      if (!cap)
+      {
+        Py_DECREF(obj);
+        SWIG_fail;
+      }
+      PyArray_SetBaseObject((PyArrayObject*)obj, cap);
+    }
+    $result = SWIG_AppendOutput($result, obj);
+  }
+  %enddef
+
+  %contour_argout_view(double, NPY_DOUBLE)
+  %contour_argout_view(float, NPY_FLOAT)
+  %contour_argout_view(int, NPY_INT)
+  %contour_argout_view(unsigned int, NPY_UINT)
+  %contour_argout_view(unsigned char, NPY_UBYTE)
+  %contour_argout_view(size_t, NPY_UINTP)
 #endif
 
 #define CONTOUR_EXPORT
@@ -50,5 +96,97 @@
 %apply (size_t** ARGOUTVIEWM_ARRAY1, size_t* DIM1) \
 {(size_t** nLevelSegments, size_t* nLevels2)};
 
+%apply (int** ARGOUTVIEWM_ARRAY1, size_t* DIM1) \
+{(int** ppOutY, size_t* nOutY)};
+
+%apply (int** ARGOUTVIEWM_ARRAY1, size_t* DIM1) \
+{(int** ppOutX, size_t* nOutX)};
+
+%apply (unsigned char** ARGOUTVIEWM_ARRAY1, size_t* DIM1) \
+{(unsigned char** ppOutBytes, size_t* nOutBytes)};
+
+%apply (double* IN_ARRAY3, int DIM1, int DIM2, int DIM3) \
+{(const double* pData, const size_t nZdata, const size_t nYdata, const size_t nXdata)};
+
+%apply (double* IN_ARRAY1, int DIM1) \
+{(const double* pZ, const size_t nZ)};
+
+%apply (double** ARGOUTVIEWM_ARRAY1, size_t* DIM1) \
+{(double** ppOutVertices, size_t* nOutVertices)};
+
+%apply (unsigned int** ARGOUTVIEWM_ARRAY1, size_t* DIM1) \
+{(uint32_t** ppOutIndices, size_t* nOutIndices)};
+
+%apply (size_t** ARGOUTVIEWM_ARRAY1, size_t* DIM1) \
+{(size_t** nOutLengths, size_t* nOutLevels)};
+
+%apply (float** ARGOUTVIEWM_ARRAY1, size_t* DIM1) \
+{(float** ppOutY, size_t* nOutY)};
+
+%apply (float** ARGOUTVIEWM_ARRAY1, size_t* DIM1) \
+{(float** ppOutX, size_t* nOutX)};
+
+%apply (float** ARGOUTVIEWM_ARRAY1, size_t* DIM1) \
+{(float** ppOutVertices, size_t* nOutVertices)};
+
+%apply (double** ARGOUTVIEWM_ARRAY1, size_t* DIM1) \
+{(double** ppOutLengths, size_t* nOutLengths)};
+
+%apply (double** ARGOUTVIEWM_ARRAY1, size_t* DIM1) \
+{(double** ppOutAreas, size_t* nOutAreas)};
+
+%apply (double** ARGOUTVIEWM_ARRAY1, size_t* DIM1) \
+{(double** ppOutLevels, size_t* nOutLevels)};
+
+%apply (double* IN_ARRAY1, int DIM1) \
+{(const double* pData, const size_t nData)};
+
+%apply (size_t* IN_ARRAY1, int DIM1) \
+{(const size_t* pTriangles, const size_t nTriangleIndices)};
+
+%apply (double* IN_ARRAY1, int DIM1) \
+{(const double* pContourY, size_t nContourY)};
+
+%apply (double* IN_ARRAY1, int DIM1) \
+{(const double* pContourX, size_t nContourX)};
+
+%apply (size_t* IN_ARRAY1, int DIM1) \
+{(const size_t* pLengths, size_t nLengths)};
+
+%apply (size_t* IN_ARRAY1, int DIM1) \
+{(const size_t* pLevelSegments, size_t nLevelSegments)};
 
+%apply (double* IN_ARRAY1, int DIM1) \
+{(const double* pLevels, size_t nLevels)};
+
+%apply (double* IN_ARRAY2, int DIM1, int DIM2) \
+{(const double* pData, size_t nYdata, size_t nXdata)};
+
+%apply (double* IN_ARRAY1, int DIM1) \
+{(const double* pY, size_t nY)};
+
+%apply (double* IN_ARRAY1, int DIM1) \
+{(const double* pX, size_t nX)};
+
+%apply size_t* OUTPUT {size_t* pPolyline, size_t* pLevel, size_t* pBand};
+%apply double* OUTPUT {double* pDistance};
+
+%apply (size_t** ARGOUTVIEWM_ARRAY1, size_t* DIM1) \
+{(size_t** ppPolylines, size_t* nPolylines)};
+
+%include <contour/contour_options.h>
+
+// Function pointers cannot be passed from Python
+%ignore contours_callback;
 %include <contour/contour.hpp>
+%include <contour/contour_index.h>
+
+// Views into the result are not exposed, use contour_result_level
+%ignore contour_result_polyline;
+%include <contour/contour_result.h>
+
+// Shared results are only exposed as copies, use contour_cache_sorted
+%ignore contour_cache_acquire;
+%ignore contour_cached_release;
+%ignore contour_cached_sorted;
+%include <contour/contour_cache.h>
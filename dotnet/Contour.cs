@@ -1,5 +1,6 @@
 using System;
 using System.Runtime.InteropServices;
+using System.Threading;
 
 namespace Contour
 {
@@ -7,113 +8,2115 @@ namespace Contour
     /// P/Invoke wrapper for the contour native library.
     /// Computes contour lines from 2D gridded data using Paul Bourke's CONREC algorithm.
     /// </summary>
+    /// <summary>
+    /// Phases reported by progress callbacks.
+    /// </summary>
+    public enum ContourPhase
+    {
+        /// <summary>Extracting segments, progress in grid lines.</summary>
+        Extract = 0,
+        /// <summary>Connecting segments, progress in segments.</summary>
+        Connect = 1
+    }
+
+    /// <summary>
+    /// Engines connecting segments into polylines.
+    /// </summary>
+    public enum ContourEngine
+    {
+        /// <summary>Extract all segments, then connect them.</summary>
+        Stitch = 0,
+        /// <summary>Follow each line from cell to cell, writing vertices in order.</summary>
+        Trace = 1
+    }
+
+    /// <summary>
+    /// Levels chosen from the data.
+    /// </summary>
+    public enum ContourLevelMode
+    {
+        /// <summary>Multiples of a round interval.</summary>
+        Nice = 0,
+        /// <summary>Equally spaced quantiles of the samples.</summary>
+        Quantile = 1
+    }
+
+    /// <summary>
+    /// Index buffer layouts of indexed contours.
+    /// </summary>
+    public enum ContourTopology
+    {
+        /// <summary>Two indices per segment.</summary>
+        Lines = 0,
+        /// <summary>Polylines, each ended by the restart index.</summary>
+        Strips = 1
+    }
+
+    /// <summary>
+    /// Progress of a contour computation.
+    /// </summary>
+    public readonly struct ContourProgress
+    {
+        /// <summary>Create a progress report.</summary>
+        public ContourProgress(ContourPhase phase, ulong done, ulong total)
+        {
+            Phase = phase;
+            Done = done;
+            Total = total;
+        }
+
+        /// <summary>Current phase.</summary>
+        public ContourPhase Phase { get; }
+        /// <summary>Units of work done in the phase.</summary>
+        public ulong Done { get; }
+        /// <summary>Units of work in the phase.</summary>
+        public ulong Total { get; }
+    }
+
     public static class ContourNative
     {
-        private const string LibraryName = "contour";
+        private const string LibraryName = "contour";
+
+        /// <summary>
+        /// Options for the extended entry points (mirrors contour_options_t).
+        /// </summary>
+        [StructLayout(LayoutKind.Sequential)]
+        public struct ContourOptions
+        {
+            /// <summary>Validity mask (one byte per sample, non-zero is valid), may be IntPtr.Zero.</summary>
+            public IntPtr pMask;
+            /// <summary>Treat NaN samples as missing.</summary>
+            public int bNaNIsMissing;
+            /// <summary>Number of worker threads, 0 for one per hardware thread.</summary>
+            public uint nThreads;
+            /// <summary>Memory budget in bytes for extracted segments, 0 for unlimited.</summary>
+            public nuint nMaxBytes;
+            /// <summary>Progress callback (a ContourProgressCallback), may be IntPtr.Zero.</summary>
+            public IntPtr pProgress;
+            /// <summary>User data passed to the progress callback.</summary>
+            public IntPtr pProgressUser;
+            /// <summary>Cancellation flag (pointer to an int, non-zero cancels), may be IntPtr.Zero.</summary>
+            public IntPtr pCancel;
+            /// <summary>Affine transform (pointer to 6 doubles {a, b, c, d, e, f}), may be IntPtr.Zero.</summary>
+            public IntPtr pAffine;
+            /// <summary>Vertex transform callback (a ContourTransformCallback), may be IntPtr.Zero.</summary>
+            public IntPtr pTransform;
+            /// <summary>User data passed to the transform callback.</summary>
+            public IntPtr pTransformUser;
+            /// <summary>First row of the window.</summary>
+            public nuint iRowBegin;
+            /// <summary>End of the rows of the window, 0 for all rows.</summary>
+            public nuint iRowEnd;
+            /// <summary>First column of the window.</summary>
+            public nuint iColumnBegin;
+            /// <summary>End of the columns of the window, 0 for all columns.</summary>
+            public nuint iColumnEnd;
+            /// <summary>Clip box (pointer to 4 doubles {xmin, ymin, xmax, ymax}), may be IntPtr.Zero.</summary>
+            public IntPtr pClip;
+            /// <summary>Engine of the sorted entry points.</summary>
+            public ContourEngine eEngine;
+            /// <summary>Levels chosen from the data by the automatic entry points.</summary>
+            public ContourLevelMode eLevels;
+            /// <summary>Interval of nice levels, 0 for a round interval from the number of levels.</summary>
+            public double dLevelInterval;
+        }
+
+        /// <summary>
+        /// Returned by cancelled computations.
+        /// </summary>
+        public const int CONTOUR_CANCELLED = -2;
+
+        /// <summary>
+        /// Progress callback, return non-zero to cancel.
+        /// </summary>
+        [UnmanagedFunctionPointer(CallingConvention.Cdecl)]
+        public delegate int ContourProgressCallback(ContourPhase phase, nuint nDone, nuint nTotal, IntPtr pUser);
+
+        /// <summary>
+        /// Vertex transform callback, transforms nPoints vertices in place.
+        /// </summary>
+        [UnmanagedFunctionPointer(CallingConvention.Cdecl)]
+        public delegate void ContourTransformCallback(IntPtr pX, IntPtr pY, nuint nPoints, IntPtr pUser);
+
+        /// <summary>
+        /// Initialize options to defaults.
+        /// </summary>
+        [DllImport(LibraryName, CallingConvention = CallingConvention.Cdecl)]
+        public static extern void contour_options_init(out ContourOptions pOptions);
+
+        /// <summary>
+        /// Allocator hooks as native function pointers, see contour_alloc.h.
+        /// </summary>
+        [StructLayout(LayoutKind.Sequential)]
+        public struct ContourAllocator
+        {
+            /// <summary>void* (*)(size_t nBytes, size_t nAlignment, void* pUser)</summary>
+            public IntPtr pAllocate;
+            /// <summary>void* (*)(void* ptr, size_t nBytes, size_t nAlignment, void* pUser), may be IntPtr.Zero.</summary>
+            public IntPtr pReallocate;
+            /// <summary>void (*)(void* ptr, void* pUser)</summary>
+            public IntPtr pFree;
+            /// <summary>User context passed to the hooks.</summary>
+            public IntPtr pUser;
+        }
+
+        /// <summary>
+        /// Set the allocator used for all library allocations (before the first call).
+        /// </summary>
+        [DllImport(LibraryName, CallingConvention = CallingConvention.Cdecl)]
+        public static extern void contour_set_allocator(ref ContourAllocator pAllocator);
+
+        /// <summary>
+        /// Get the allocator currently in use.
+        /// </summary>
+        [DllImport(LibraryName, CallingConvention = CallingConvention.Cdecl)]
+        public static extern void contour_get_allocator(out ContourAllocator pAllocator);
+
+        /// <summary>
+        /// Free memory allocated by contour functions.
+        /// </summary>
+        [DllImport(LibraryName, CallingConvention = CallingConvention.Cdecl)]
+        public static extern void contour_free(IntPtr ptr);
+
+        /// <summary>
+        /// Compute contours for a 2D double-precision floating point image.
+        /// </summary>
+        [DllImport(LibraryName, CallingConvention = CallingConvention.Cdecl)]
+        public static extern int contour_compute(
+            [In] double[] pData, nuint nYdata, nuint nXdata,
+            [In] double[] pY, nuint nY,
+            [In] double[] pX, nuint nX,
+            [In] double[] pLevels, nuint nLevels,
+            out IntPtr ppOutY, out nuint nOutY,
+            out IntPtr ppOutX, out nuint nOutX,
+            out IntPtr nOutLengths, out nuint nOutSegments);
+
+        /// <summary>
+        /// Compute sorted contours (connected polygons) for a 2D double-precision floating point image.
+        /// </summary>
+        [DllImport(LibraryName, CallingConvention = CallingConvention.Cdecl)]
+        public static extern int contour_compute_sorted(
+            [In] double[] pData, nuint nYdata, nuint nXdata,
+            [In] double[] pY, nuint nY,
+            [In] double[] pX, nuint nX,
+            [In] double[] pLevels, nuint nLevels,
+            out IntPtr ppOutY, out nuint nOutY,
+            out IntPtr ppOutX, out nuint nOutX,
+            out IntPtr nOutLengths, out nuint nOutSegments,
+            out IntPtr nLevelSegments, out nuint nLevels2);
+
+        /// <summary>
+        /// Compute contours using options.
+        /// </summary>
+        [DllImport(LibraryName, CallingConvention = CallingConvention.Cdecl)]
+        public static extern int contour_compute_ex(
+            [In] double[] pData, nuint nYdata, nuint nXdata,
+            [In] double[] pY, nuint nY,
+            [In] double[] pX, nuint nX,
+            [In] double[] pLevels, nuint nLevels,
+            ref ContourOptions pOptions,
+            out IntPtr ppOutY, out nuint nOutY,
+            out IntPtr ppOutX, out nuint nOutX,
+            out IntPtr nOutLengths, out nuint nOutSegments);
+
+        /// <summary>
+        /// Compute sorted contours using options.
+        /// </summary>
+        [DllImport(LibraryName, CallingConvention = CallingConvention.Cdecl)]
+        public static extern int contour_compute_sorted_ex(
+            [In] double[] pData, nuint nYdata, nuint nXdata,
+            [In] double[] pY, nuint nY,
+            [In] double[] pX, nuint nX,
+            [In] double[] pLevels, nuint nLevels,
+            ref ContourOptions pOptions,
+            out IntPtr ppOutY, out nuint nOutY,
+            out IntPtr ppOutX, out nuint nOutX,
+            out IntPtr nOutLengths, out nuint nOutSegments,
+            out IntPtr nLevelSegments, out nuint nLevels2);
+
+        /// <summary>
+        /// Callback receiving a contour segment (x is the column coordinate, y the row coordinate).
+        /// </summary>
+        [UnmanagedFunctionPointer(CallingConvention.Cdecl)]
+        public delegate void ContourSegmentCallback(double x1, double y1, double x2, double y2, int level, IntPtr pUser);
+
+        /// <summary>
+        /// Compute contour segments, passing each to a callback instead of storing them.
+        /// </summary>
+        [DllImport(LibraryName, CallingConvention = CallingConvention.Cdecl)]
+        public static extern int contour_compute_visit(
+            [In] double[] pData, nuint nYdata, nuint nXdata,
+            [In] double[] pY, nuint nY,
+            [In] double[] pX, nuint nX,
+            [In] double[] pLevels, nuint nLevels,
+            ref ContourOptions pOptions,
+            ContourSegmentCallback pCallback, IntPtr pUser);
+
+        /// <summary>
+        /// Compute the contour length of each level and the area of each band between levels.
+        /// </summary>
+        [DllImport(LibraryName, CallingConvention = CallingConvention.Cdecl)]
+        public static extern int contour_compute_statistics(
+            [In] double[] pData, nuint nYdata, nuint nXdata,
+            [In] double[] pY, nuint nY,
+            [In] double[] pX, nuint nX,
+            [In] double[] pLevels, nuint nLevels,
+            ref ContourOptions pOptions,
+            out IntPtr ppOutLengths, out nuint nOutLengths,
+            out IntPtr ppOutAreas, out nuint nOutAreas);
+
+        /// <summary>
+        /// Choose contour levels from the data.
+        /// </summary>
+        [DllImport(LibraryName, CallingConvention = CallingConvention.Cdecl)]
+        public static extern int contour_compute_levels(
+            [In] double[] pData, nuint nYdata, nuint nXdata,
+            nuint nLevels,
+            ref ContourOptions pOptions,
+            out IntPtr ppOutLevels, out nuint nOutLevels);
+
+        /// <summary>
+        /// Compute sorted contours at levels chosen from the data.
+        /// </summary>
+        [DllImport(LibraryName, CallingConvention = CallingConvention.Cdecl)]
+        public static extern int contour_compute_sorted_auto(
+            [In] double[] pData, nuint nYdata, nuint nXdata,
+            [In] double[] pY, nuint nY,
+            [In] double[] pX, nuint nX,
+            nuint nLevels,
+            ref ContourOptions pOptions,
+            out IntPtr ppOutLevels, out nuint nOutLevels,
+            out IntPtr ppOutY, out nuint nOutY,
+            out IntPtr ppOutX, out nuint nOutX,
+            out IntPtr nOutLengths, out nuint nOutSegments,
+            out IntPtr nLevelSegments, out nuint nLevels2);
+
+        /// <summary>
+        /// Compute sorted contours on an unstructured triangle mesh.
+        /// </summary>
+        [DllImport(LibraryName, CallingConvention = CallingConvention.Cdecl)]
+        public static extern int contour_compute_mesh(
+            [In] double[] pData, nuint nData,
+            [In] double[] pY, nuint nY,
+            [In] double[] pX, nuint nX,
+            [In] nuint[] pTriangles, nuint nTriangleIndices,
+            [In] double[] pLevels, nuint nLevels,
+            ref ContourOptions pOptions,
+            out IntPtr ppOutY, out nuint nOutY,
+            out IntPtr ppOutX, out nuint nOutX,
+            out IntPtr nOutLengths, out nuint nOutSegments,
+            out IntPtr nLevelSegments, out nuint nLevels2);
+
+        /// <summary>
+        /// Compute contours as shared vertices and an index buffer.
+        /// </summary>
+        [DllImport(LibraryName, CallingConvention = CallingConvention.Cdecl)]
+        public static extern int contour_compute_indexed(
+            [In] double[] pData, nuint nYdata, nuint nXdata,
+            [In] double[] pY, nuint nY,
+            [In] double[] pX, nuint nX,
+            [In] double[] pLevels, nuint nLevels,
+            ref ContourOptions pOptions,
+            ContourTopology eTopology,
+            out IntPtr ppOutVertices, out nuint nOutVertices,
+            out IntPtr ppOutIndices, out nuint nOutIndices,
+            out IntPtr nOutLengths, out nuint nOutLevels);
+
+        /// <summary>
+        /// Compute isosurfaces (indexed triangle meshes) for a 3D volume.
+        /// </summary>
+        [DllImport(LibraryName, CallingConvention = CallingConvention.Cdecl)]
+        public static extern int contour_compute_isosurfaces(
+            [In] double[] pData, nuint nZdata, nuint nYdata, nuint nXdata,
+            [In] double[] pZ, nuint nZ,
+            [In] double[] pY, nuint nY,
+            [In] double[] pX, nuint nX,
+            [In] double[] pLevels, nuint nLevels,
+            ref ContourOptions pOptions,
+            out IntPtr ppOutVertices, out nuint nOutVertices,
+            out IntPtr ppOutIndices, out nuint nOutIndices,
+            out IntPtr nOutLengths, out nuint nOutLevels);
+
+        /// <summary>
+        /// Compute contours with single-precision output coordinates.
+        /// </summary>
+        [DllImport(LibraryName, CallingConvention = CallingConvention.Cdecl)]
+        public static extern int contour_compute_float(
+            [In] double[] pData, nuint nYdata, nuint nXdata,
+            [In] double[] pY, nuint nY,
+            [In] double[] pX, nuint nX,
+            [In] double[] pLevels, nuint nLevels,
+            ref ContourOptions pOptions,
+            out IntPtr ppOutY, out nuint nOutY,
+            out IntPtr ppOutX, out nuint nOutX,
+            out IntPtr nOutLengths, out nuint nOutSegments);
+
+        /// <summary>
+        /// Compute sorted contours with single-precision output coordinates.
+        /// </summary>
+        [DllImport(LibraryName, CallingConvention = CallingConvention.Cdecl)]
+        public static extern int contour_compute_sorted_float(
+            [In] double[] pData, nuint nYdata, nuint nXdata,
+            [In] double[] pY, nuint nY,
+            [In] double[] pX, nuint nX,
+            [In] double[] pLevels, nuint nLevels,
+            ref ContourOptions pOptions,
+            out IntPtr ppOutY, out nuint nOutY,
+            out IntPtr ppOutX, out nuint nOutX,
+            out IntPtr nOutLengths, out nuint nOutSegments,
+            out IntPtr nLevelSegments, out nuint nLevels2);
+
+        /// <summary>
+        /// Compute sorted mesh contours with single-precision output coordinates.
+        /// </summary>
+        [DllImport(LibraryName, CallingConvention = CallingConvention.Cdecl)]
+        public static extern int contour_compute_mesh_float(
+            [In] double[] pData, nuint nData,
+            [In] double[] pY, nuint nY,
+            [In] double[] pX, nuint nX,
+            [In] nuint[] pTriangles, nuint nTriangleIndices,
+            [In] double[] pLevels, nuint nLevels,
+            ref ContourOptions pOptions,
+            out IntPtr ppOutY, out nuint nOutY,
+            out IntPtr ppOutX, out nuint nOutX,
+            out IntPtr nOutLengths, out nuint nOutSegments,
+            out IntPtr nLevelSegments, out nuint nLevels2);
+
+        /// <summary>
+        /// Compute indexed contours with single-precision vertices.
+        /// </summary>
+        [DllImport(LibraryName, CallingConvention = CallingConvention.Cdecl)]
+        public static extern int contour_compute_indexed_float(
+            [In] double[] pData, nuint nYdata, nuint nXdata,
+            [In] double[] pY, nuint nY,
+            [In] double[] pX, nuint nX,
+            [In] double[] pLevels, nuint nLevels,
+            ref ContourOptions pOptions,
+            ContourTopology eTopology,
+            out IntPtr ppOutVertices, out nuint nOutVertices,
+            out IntPtr ppOutIndices, out nuint nOutIndices,
+            out IntPtr nOutLengths, out nuint nOutLevels);
+
+        /// <summary>
+        /// Compute isosurfaces with single-precision vertices.
+        /// </summary>
+        [DllImport(LibraryName, CallingConvention = CallingConvention.Cdecl)]
+        public static extern int contour_compute_isosurfaces_float(
+            [In] double[] pData, nuint nZdata, nuint nYdata, nuint nXdata,
+            [In] double[] pZ, nuint nZ,
+            [In] double[] pY, nuint nY,
+            [In] double[] pX, nuint nX,
+            [In] double[] pLevels, nuint nLevels,
+            ref ContourOptions pOptions,
+            out IntPtr ppOutVertices, out nuint nOutVertices,
+            out IntPtr ppOutIndices, out nuint nOutIndices,
+            out IntPtr nOutLengths, out nuint nOutLevels);
+
+        /// <summary>
+        /// Compute sorted contours with quantized (fixed-point) coordinates.
+        /// </summary>
+        [DllImport(LibraryName, CallingConvention = CallingConvention.Cdecl)]
+        public static extern int contour_compute_sorted_quantized(
+            [In] double[] pData, nuint nYdata, nuint nXdata,
+            [In] double[] pY, nuint nY,
+            [In] double[] pX, nuint nX,
+            [In] double[] pLevels, nuint nLevels,
+            uint nFractionBits,
+            out IntPtr ppOutY, out nuint nOutY,
+            out IntPtr ppOutX, out nuint nOutX,
+            out IntPtr nOutLengths, out nuint nOutSegments,
+            out IntPtr nLevelSegments, out nuint nLevels2);
+
+        /// <summary>
+        /// Compute sorted contours as quantized, delta- and zigzag-varint-encoded bytes.
+        /// </summary>
+        [DllImport(LibraryName, CallingConvention = CallingConvention.Cdecl)]
+        public static extern int contour_compute_sorted_encoded(
+            [In] double[] pData, nuint nYdata, nuint nXdata,
+            [In] double[] pY, nuint nY,
+            [In] double[] pX, nuint nX,
+            [In] double[] pLevels, nuint nLevels,
+            uint nFractionBits,
+            out IntPtr ppOutBytes, out nuint nOutBytes,
+            out IntPtr nOutLengths, out nuint nOutSegments,
+            out IntPtr nLevelSegments, out nuint nLevels2);
+
+        /// <summary>
+        /// Create a spatial index over sorted contours. The grid arrays may be null.
+        /// </summary>
+        [DllImport(LibraryName, CallingConvention = CallingConvention.Cdecl)]
+        public static extern IntPtr contour_index_create(
+            [In] double[] pContourY, nuint nContourY,
+            [In] double[] pContourX, nuint nContourX,
+            [In] nuint[] pLengths, nuint nLengths,
+            [In] nuint[] pLevelSegments, nuint nLevelSegments,
+            [In] double[] pLevels, nuint nLevels,
+            [In] double[] pData, nuint nYdata, nuint nXdata,
+            [In] double[] pY, nuint nY,
+            [In] double[] pX, nuint nX);
+
+        /// <summary>
+        /// Destroy a spatial index.
+        /// </summary>
+        [DllImport(LibraryName, CallingConvention = CallingConvention.Cdecl)]
+        public static extern void contour_index_destroy(IntPtr pIndex);
+
+        /// <summary>
+        /// Find the polyline nearest to a point.
+        /// </summary>
+        [DllImport(LibraryName, CallingConvention = CallingConvention.Cdecl)]
+        public static extern int contour_index_nearest(IntPtr pIndex, double y, double x,
+            out nuint pPolyline, out nuint pLevel, out double pDistance);
+
+        /// <summary>
+        /// Find the band containing a point.
+        /// </summary>
+        [DllImport(LibraryName, CallingConvention = CallingConvention.Cdecl)]
+        public static extern int contour_index_band(IntPtr pIndex, double y, double x, out nuint pBand);
+
+        /// <summary>
+        /// Find polylines intersecting an axis-aligned box.
+        /// </summary>
+        [DllImport(LibraryName, CallingConvention = CallingConvention.Cdecl)]
+        public static extern int contour_index_query_box(IntPtr pIndex,
+            double minY, double minX, double maxY, double maxX,
+            out IntPtr ppPolylines, out nuint nPolylines);
+
+        /// <summary>
+        /// Extract contour segments for all levels, deferring connection into polylines.
+        /// </summary>
+        [DllImport(LibraryName, CallingConvention = CallingConvention.Cdecl)]
+        public static extern IntPtr contour_result_create(
+            [In] double[] pData, nuint nYdata, nuint nXdata,
+            [In] double[] pY, nuint nY,
+            [In] double[] pX, nuint nX,
+            [In] double[] pLevels, nuint nLevels,
+            ref ContourOptions pOptions);
+
+        /// <summary>
+        /// Destroy a result handle.
+        /// </summary>
+        [DllImport(LibraryName, CallingConvention = CallingConvention.Cdecl)]
+        public static extern void contour_result_destroy(IntPtr pResult);
+
+        /// <summary>
+        /// Number of levels of a result handle.
+        /// </summary>
+        [DllImport(LibraryName, CallingConvention = CallingConvention.Cdecl)]
+        public static extern nuint contour_result_levels(IntPtr pResult);
+
+        /// <summary>
+        /// Number of polylines for a level, connecting its segments if needed.
+        /// </summary>
+        [DllImport(LibraryName, CallingConvention = CallingConvention.Cdecl)]
+        public static extern nuint contour_result_polylines(IntPtr pResult, nuint iLevel);
+
+        /// <summary>
+        /// Access a single polyline without copying.
+        /// </summary>
+        [DllImport(LibraryName, CallingConvention = CallingConvention.Cdecl)]
+        public static extern int contour_result_polyline(IntPtr pResult, nuint iLevel, nuint iPolyline,
+            out IntPtr ppY, out IntPtr ppX, out nuint nPoints);
+
+        /// <summary>
+        /// Copy all polylines of a single level.
+        /// </summary>
+        [DllImport(LibraryName, CallingConvention = CallingConvention.Cdecl)]
+        public static extern int contour_result_level(IntPtr pResult, nuint iLevel,
+            out IntPtr ppOutY, out nuint nOutY,
+            out IntPtr ppOutX, out nuint nOutX,
+            out IntPtr nOutLengths, out nuint nOutSegments);
+
+        /// <summary>
+        /// Cache statistics.
+        /// </summary>
+        [StructLayout(LayoutKind.Sequential)]
+        public struct ContourCacheStats
+        {
+            /// <summary>Requests served from the cache.</summary>
+            public nuint nHits;
+            /// <summary>Requests computed.</summary>
+            public nuint nMisses;
+            /// <summary>Results evicted to stay within the budget.</summary>
+            public nuint nEvictions;
+            /// <summary>Results currently cached.</summary>
+            public nuint nEntries;
+            /// <summary>Bytes currently cached.</summary>
+            public nuint nBytes;
+        }
+
+        /// <summary>
+        /// Create a content-addressed LRU cache of sorted contours.
+        /// </summary>
+        [DllImport(LibraryName, CallingConvention = CallingConvention.Cdecl)]
+        public static extern IntPtr contour_cache_create(nuint nMaxBytes);
+
+        /// <summary>
+        /// Destroy a cache.
+        /// </summary>
+        [DllImport(LibraryName, CallingConvention = CallingConvention.Cdecl)]
+        public static extern void contour_cache_destroy(IntPtr pCache);
+
+        /// <summary>
+        /// Remove all results from a cache and reset the statistics.
+        /// </summary>
+        [DllImport(LibraryName, CallingConvention = CallingConvention.Cdecl)]
+        public static extern void contour_cache_clear(IntPtr pCache);
+
+        /// <summary>
+        /// Get cache statistics.
+        /// </summary>
+        [DllImport(LibraryName, CallingConvention = CallingConvention.Cdecl)]
+        public static extern void contour_cache_get_stats(IntPtr pCache, out ContourCacheStats pStats);
+
+        /// <summary>
+        /// Compute sorted contours through a cache.
+        /// </summary>
+        [DllImport(LibraryName, CallingConvention = CallingConvention.Cdecl)]
+        public static extern int contour_cache_sorted(IntPtr pCache,
+            [In] double[] pData, nuint nYdata, nuint nXdata,
+            [In] double[] pY, nuint nY,
+            [In] double[] pX, nuint nX,
+            [In] double[] pLevels, nuint nLevels,
+            ref ContourOptions pOptions,
+            out IntPtr ppOutY, out nuint nOutY,
+            out IntPtr ppOutX, out nuint nOutX,
+            out IntPtr nOutLengths, out nuint nOutSegments,
+            out IntPtr nLevelSegments, out nuint nLevels2);
+    }
+
+    /// <summary>
+    /// High-level managed wrapper for contour computation with automatic memory management.
+    /// </summary>
+    public static class ContourCompute
+    {
+        /// <summary>
+        /// Result of contour computation.
+        /// </summary>
+        public class ContourResult
+        {
+            /// <summary>X-coordinates of all contour points.</summary>
+            public double[] X { get; set; } = Array.Empty<double>();
+            /// <summary>Y-coordinates of all contour points.</summary>
+            public double[] Y { get; set; } = Array.Empty<double>();
+            /// <summary>Number of points (or segments) per level.</summary>
+            public nuint[] SegmentLengths { get; set; } = Array.Empty<nuint>();
+        }
+
+        /// <summary>
+        /// Result of sorted contour computation.
+        /// </summary>
+        public class SortedContourResult : ContourResult
+        {
+            /// <summary>Number of polygons per level.</summary>
+            public nuint[] LevelSegments { get; set; } = Array.Empty<nuint>();
+        }
+
+        /// <summary>
+        /// Result of sorted contour computation at levels chosen from the data.
+        /// </summary>
+        public class AutoSortedContourResult : SortedContourResult
+        {
+            /// <summary>Chosen levels.</summary>
+            public double[] Levels { get; set; } = Array.Empty<double>();
+        }
+
+        /// <summary>
+        /// Result of quantized sorted contour computation.
+        /// </summary>
+        public class QuantizedContourResult
+        {
+            /// <summary>Quantized X-coordinates of all contour points.</summary>
+            public int[] X { get; set; } = Array.Empty<int>();
+            /// <summary>Quantized Y-coordinates of all contour points.</summary>
+            public int[] Y { get; set; } = Array.Empty<int>();
+            /// <summary>Number of points per polygon.</summary>
+            public nuint[] SegmentLengths { get; set; } = Array.Empty<nuint>();
+            /// <summary>Number of polygons per level.</summary>
+            public nuint[] LevelSegments { get; set; } = Array.Empty<nuint>();
+        }
+
+        /// <summary>
+        /// Result of encoded sorted contour computation.
+        /// </summary>
+        public class EncodedContourResult
+        {
+            /// <summary>Delta- and zigzag-varint-encoded (x, y) pairs.</summary>
+            public byte[] Bytes { get; set; } = Array.Empty<byte>();
+            /// <summary>Number of points per polygon.</summary>
+            public nuint[] SegmentLengths { get; set; } = Array.Empty<nuint>();
+            /// <summary>Number of polygons per level.</summary>
+            public nuint[] LevelSegments { get; set; } = Array.Empty<nuint>();
+        }
+
+        /// <summary>
+        /// Result of isosurface computation.
+        /// </summary>
+        public class IsosurfaceResult
+        {
+            /// <summary>Vertices as (x, y, z) triplets.</summary>
+            public double[] Vertices { get; set; } = Array.Empty<double>();
+            /// <summary>32-bit vertex indices, three per triangle.</summary>
+            public uint[] Indices { get; set; } = Array.Empty<uint>();
+            /// <summary>Number of triangles per level.</summary>
+            public nuint[] LevelTriangles { get; set; } = Array.Empty<nuint>();
+        }
+
+        /// <summary>
+        /// Result of indexed contour computation.
+        /// </summary>
+        public class IndexedContourResult
+        {
+            /// <summary>Index ending each polyline of <see cref="ContourTopology.Strips"/>.</summary>
+            public const uint RestartIndex = uint.MaxValue;
+            /// <summary>Vertices as (x, y) pairs.</summary>
+            public double[] Vertices { get; set; } = Array.Empty<double>();
+            /// <summary>32-bit vertex indices.</summary>
+            public uint[] Indices { get; set; } = Array.Empty<uint>();
+            /// <summary>Number of indices per level.</summary>
+            public nuint[] LevelIndices { get; set; } = Array.Empty<nuint>();
+        }
+
+        /// <summary>
+        /// Result of indexed contour computation with single-precision vertices.
+        /// </summary>
+        public class FloatIndexedContourResult
+        {
+            /// <summary>Vertices as (x, y) pairs.</summary>
+            public float[] Vertices { get; set; } = Array.Empty<float>();
+            /// <summary>32-bit vertex indices, polylines are ended by <see cref="IndexedContourResult.RestartIndex"/>.</summary>
+            public uint[] Indices { get; set; } = Array.Empty<uint>();
+            /// <summary>Number of indices per level.</summary>
+            public nuint[] LevelIndices { get; set; } = Array.Empty<nuint>();
+        }
+
+        /// <summary>
+        /// Result of contour computation with single-precision coordinates.
+        /// </summary>
+        public class FloatContourResult
+        {
+            /// <summary>X-coordinates of all contour points.</summary>
+            public float[] X { get; set; } = Array.Empty<float>();
+            /// <summary>Y-coordinates of all contour points.</summary>
+            public float[] Y { get; set; } = Array.Empty<float>();
+            /// <summary>Number of points (or segments) per level.</summary>
+            public nuint[] SegmentLengths { get; set; } = Array.Empty<nuint>();
+        }
+
+        /// <summary>
+        /// Result of sorted contour computation with single-precision coordinates.
+        /// </summary>
+        public class FloatSortedContourResult : FloatContourResult
+        {
+            /// <summary>Number of polygons per level.</summary>
+            public nuint[] LevelSegments { get; set; } = Array.Empty<nuint>();
+        }
+
+        /// <summary>
+        /// Result of isosurface computation with single-precision vertices.
+        /// </summary>
+        public class FloatIsosurfaceResult
+        {
+            /// <summary>Vertices as (x, y, z) triplets.</summary>
+            public float[] Vertices { get; set; } = Array.Empty<float>();
+            /// <summary>32-bit vertex indices, three per triangle.</summary>
+            public uint[] Indices { get; set; } = Array.Empty<uint>();
+            /// <summary>Number of triangles per level.</summary>
+            public nuint[] LevelTriangles { get; set; } = Array.Empty<nuint>();
+        }
+
+        /// <summary>
+        /// Contour statistics without geometry.
+        /// </summary>
+        public class ContourStatistics
+        {
+            /// <summary>Contour length of each level.</summary>
+            public double[] Lengths { get; set; } = Array.Empty<double>();
+            /// <summary>Area of each band, band k between levels k - 1 and k (levels.Length + 1 bands).</summary>
+            public double[] Areas { get; set; } = Array.Empty<double>();
+        }
+
+        /// <summary>
+        /// Compute contours for 2D data.
+        /// </summary>
+        /// <param name="data">2D data array (row-major, dimensions [nY, nX])</param>
+        /// <param name="y">Y-coordinates array</param>
+        /// <param name="x">X-coordinates array</param>
+        /// <param name="levels">Contour levels (must be increasing)</param>
+        /// <returns>Contour result with coordinates and segment information</returns>
+        public static ContourResult Compute(double[,] data, double[] y, double[] x, double[] levels)
+        {
+            return Compute(data, y, x, levels, null, false);
+        }
+
+        /// <summary>
+        /// Compute contours for 2D data with missing samples.
+        /// </summary>
+        /// <param name="data">2D data array (row-major, dimensions [nY, nX])</param>
+        /// <param name="y">Y-coordinates array</param>
+        /// <param name="x">X-coordinates array</param>
+        /// <param name="levels">Contour levels (must be increasing)</param>
+        /// <param name="mask">Validity mask (non-zero is valid, dimensions [nY, nX]) or null</param>
+        /// <param name="nanIsMissing">Treat NaN samples as missing</param>
+        /// <returns>Contour result with coordinates and segment information</returns>
+        public static ContourResult Compute(double[,] data, double[] y, double[] x, double[] levels,
+            byte[,] mask, bool nanIsMissing)
+        {
+            int nY = data.GetLength(0);
+            int nX = data.GetLength(1);
+
+            // Flatten 2D array to 1D (row-major)
+            double[] flatData = new double[nY * nX];
+            Buffer.BlockCopy(data, 0, flatData, 0, nY * nX * sizeof(double));
+
+            int result;
+            IntPtr pOutY, pOutX, pLengths;
+            nuint nOutY, nOutX, nSegments;
+            GCHandle maskHandle = PinMask(mask, nY, nX);
+            try
+            {
+                ContourNative.contour_options_init(out var options);
+                options.pMask = mask != null ? maskHandle.AddrOfPinnedObject() : IntPtr.Zero;
+                options.bNaNIsMissing = nanIsMissing ? 1 : 0;
+
+                result = ContourNative.contour_compute_ex(
+                    flatData, (nuint)nY, (nuint)nX,
+                    y, (nuint)y.Length,
+                    x, (nuint)x.Length,
+                    levels, (nuint)levels.Length,
+                    ref options,
+                    out pOutY, out nOutY,
+                    out pOutX, out nOutX,
+                    out pLengths, out nSegments);
+            }
+            finally
+            {
+                if (maskHandle.IsAllocated)
+                    maskHandle.Free();
+            }
+
+            if (result != 0)
+                throw new InvalidOperationException("Contour computation failed");
+
+            try
+            {
+                var contourResult = new ContourResult
+                {
+                    X = new double[(int)nOutX],
+                    Y = new double[(int)nOutY],
+                    SegmentLengths = new nuint[(int)nSegments]
+                };
+
+                Marshal.Copy(pOutX, contourResult.X, 0, (int)nOutX);
+                Marshal.Copy(pOutY, contourResult.Y, 0, (int)nOutY);
+
+                // Copy segment lengths (nuint array)
+                for (int i = 0; i < (int)nSegments; i++)
+                {
+                    contourResult.SegmentLengths[i] = (nuint)Marshal.ReadIntPtr(pLengths, i * IntPtr.Size);
+                }
+
+                return contourResult;
+            }
+            finally
+            {
+                ContourNative.contour_free(pOutX);
+                ContourNative.contour_free(pOutY);
+                ContourNative.contour_free(pLengths);
+            }
+        }
+
+        /// <summary>
+        /// Compute sorted contours (connected polygons) for 2D data.
+        /// </summary>
+        /// <param name="data">2D data array (row-major, dimensions [nY, nX])</param>
+        /// <param name="y">Y-coordinates array</param>
+        /// <param name="x">X-coordinates array</param>
+        /// <param name="levels">Contour levels (must be increasing)</param>
+        /// <returns>Sorted contour result with coordinates, segment lengths, and level information</returns>
+        public static SortedContourResult ComputeSorted(double[,] data, double[] y, double[] x, double[] levels)
+        {
+            return ComputeSorted(data, y, x, levels, null, false);
+        }
+
+        /// <summary>
+        /// Compute sorted contours (connected polygons) for 2D data with missing samples.
+        /// </summary>
+        /// <param name="data">2D data array (row-major, dimensions [nY, nX])</param>
+        /// <param name="y">Y-coordinates array</param>
+        /// <param name="x">X-coordinates array</param>
+        /// <param name="levels">Contour levels (must be increasing)</param>
+        /// <param name="mask">Validity mask (non-zero is valid, dimensions [nY, nX]) or null</param>
+        /// <param name="nanIsMissing">Treat NaN samples as missing</param>
+        /// <returns>Sorted contour result with coordinates, segment lengths, and level information</returns>
+        public static SortedContourResult ComputeSorted(double[,] data, double[] y, double[] x, double[] levels,
+            byte[,] mask, bool nanIsMissing)
+        {
+            ContourNative.contour_options_init(out var options);
+            return ComputeSortedCore(data, y, x, levels, mask, nanIsMissing, options, CancellationToken.None);
+        }
+
+        /// <summary>
+        /// Compute sorted contours (connected polygons) for 2D data using the given engine.
+        /// The trace engine follows each line without storing or connecting segments.
+        /// </summary>
+        /// <param name="data">2D data array (row-major, dimensions [nY, nX])</param>
+        /// <param name="y">Y-coordinates array</param>
+        /// <param name="x">X-coordinates array</param>
+        /// <param name="levels">Contour levels (must be increasing)</param>
+        /// <param name="engine">Engine connecting the segments</param>
+        /// <returns>Sorted contour result with coordinates, segment lengths, and level information</returns>
+        public static SortedContourResult ComputeSorted(double[,] data, double[] y, double[] x, double[] levels,
+            ContourEngine engine)
+        {
+            ContourNative.contour_options_init(out var options);
+            options.eEngine = engine;
+            return ComputeSortedCore(data, y, x, levels, null, false, options, CancellationToken.None);
+        }
+
+        /// <summary>
+        /// Compute sorted contours (connected polygons) for 2D data, with the output vertices
+        /// mapped from (x, y) to (a x + b y + c, d x + e y + f).
+        /// </summary>
+        /// <param name="data">2D data array (row-major, dimensions [nY, nX])</param>
+        /// <param name="y">Y-coordinates array</param>
+        /// <param name="x">X-coordinates array</param>
+        /// <param name="levels">Contour levels (must be increasing)</param>
+        /// <param name="affine">Coefficients {a, b, c, d, e, f}</param>
+        /// <returns>Sorted contour result with coordinates, segment lengths, and level information</returns>
+        public static SortedContourResult ComputeSorted(double[,] data, double[] y, double[] x, double[] levels,
+            double[] affine)
+        {
+            if (affine == null || affine.Length != 6)
+                throw new ArgumentException("Affine transform must have 6 coefficients", nameof(affine));
+
+            GCHandle affineHandle = GCHandle.Alloc(affine, GCHandleType.Pinned);
+            try
+            {
+                ContourNative.contour_options_init(out var options);
+                options.pAffine = affineHandle.AddrOfPinnedObject();
+                return ComputeSortedCore(data, y, x, levels, null, false, options, CancellationToken.None);
+            }
+            finally
+            {
+                affineHandle.Free();
+            }
+        }
+
+        /// <summary>
+        /// Compute sorted contours (connected polygons) for a window of 2D data, optionally clipped to a box.
+        /// Windows sharing a row or column of samples, or boxes sharing an edge, line up exactly.
+        /// </summary>
+        /// <param name="data">2D data array (row-major, dimensions [nY, nX])</param>
+        /// <param name="y">Y-coordinates array</param>
+        /// <param name="x">X-coordinates array</param>
+        /// <param name="levels">Contour levels (must be increasing)</param>
+        /// <param name="rowBegin">First row of the window</param>
+        /// <param name="rowEnd">End of the rows of the window (exclusive)</param>
+        /// <param name="columnBegin">First column of the window</param>
+        /// <param name="columnEnd">End of the columns of the window (exclusive)</param>
+        /// <param name="clip">Clip box {xmin, ymin, xmax, ymax} or null</param>
+        /// <returns>Sorted contour result with coordinates, segment lengths, and level information</returns>
+        public static SortedContourResult ComputeSortedWindow(double[,] data, double[] y, double[] x, double[] levels,
+            int rowBegin, int rowEnd, int columnBegin, int columnEnd, double[] clip = null)
+        {
+            if (clip != null && clip.Length != 4)
+                throw new ArgumentException("Clip box must have 4 values", nameof(clip));
+
+            GCHandle clipHandle = clip != null ? GCHandle.Alloc(clip, GCHandleType.Pinned) : default;
+            try
+            {
+                ContourNative.contour_options_init(out var options);
+                options.iRowBegin = (nuint)rowBegin;
+                options.iRowEnd = (nuint)rowEnd;
+                options.iColumnBegin = (nuint)columnBegin;
+                options.iColumnEnd = (nuint)columnEnd;
+                options.pClip = clip != null ? clipHandle.AddrOfPinnedObject() : IntPtr.Zero;
+                return ComputeSortedCore(data, y, x, levels, null, false, options, CancellationToken.None);
+            }
+            finally
+            {
+                if (clipHandle.IsAllocated)
+                    clipHandle.Free();
+            }
+        }
+
+        /// <summary>
+        /// Compute sorted contours (connected polygons) for 2D data with progress reporting and cancellation.
+        /// </summary>
+        /// <param name="data">2D data array (row-major, dimensions [nY, nX])</param>
+        /// <param name="y">Y-coordinates array</param>
+        /// <param name="x">X-coordinates array</param>
+        /// <param name="levels">Contour levels (must be increasing)</param>
+        /// <param name="progress">Receives progress reports, may be null</param>
+        /// <param name="cancellationToken">Cancels the computation</param>
+        /// <returns>Sorted contour result with coordinates, segment lengths, and level information</returns>
+        /// <exception cref="OperationCanceledException">The computation was cancelled</exception>
+        public static SortedContourResult ComputeSorted(double[,] data, double[] y, double[] x, double[] levels,
+            IProgress<ContourProgress> progress, CancellationToken cancellationToken)
+        {
+            cancellationToken.ThrowIfCancellationRequested();
+
+            ContourNative.ContourProgressCallback callback = null;
+            if (progress != null)
+            {
+                callback = (phase, done, total, user) =>
+                {
+                    progress.Report(new ContourProgress(phase, done, total));
+                    return 0;
+                };
+            }
+
+            // Polled by the native code, set when the token is cancelled
+            IntPtr cancelFlag = Marshal.AllocHGlobal(sizeof(int));
+            try
+            {
+                Marshal.WriteInt32(cancelFlag, 0);
+                using (cancellationToken.Register(() => Marshal.WriteInt32(cancelFlag, 1)))
+                {
+                    ContourNative.contour_options_init(out var options);
+                    options.pProgress = callback != null ? Marshal.GetFunctionPointerForDelegate(callback) : IntPtr.Zero;
+                    options.pCancel = cancelFlag;
+                    var result = ComputeSortedCore(data, y, x, levels, null, false, options, cancellationToken);
+                    GC.KeepAlive(callback);
+                    return result;
+                }
+            }
+            finally
+            {
+                Marshal.FreeHGlobal(cancelFlag);
+            }
+        }
+
+        private static SortedContourResult ComputeSortedCore(double[,] data, double[] y, double[] x, double[] levels,
+            byte[,] mask, bool nanIsMissing, ContourNative.ContourOptions options, CancellationToken cancellationToken)
+        {
+            int nY = data.GetLength(0);
+            int nX = data.GetLength(1);
+
+            // Flatten 2D array to 1D (row-major)
+            double[] flatData = new double[nY * nX];
+            Buffer.BlockCopy(data, 0, flatData, 0, nY * nX * sizeof(double));
+
+            int result;
+            IntPtr pOutY, pOutX, pLengths, pLevelSegments;
+            nuint nOutY, nOutX, nSegments, nLevels;
+            GCHandle maskHandle = PinMask(mask, nY, nX);
+            try
+            {
+                options.pMask = mask != null ? maskHandle.AddrOfPinnedObject() : IntPtr.Zero;
+                options.bNaNIsMissing = nanIsMissing ? 1 : 0;
+
+                result = ContourNative.contour_compute_sorted_ex(
+                    flatData, (nuint)nY, (nuint)nX,
+                    y, (nuint)y.Length,
+                    x, (nuint)x.Length,
+                    levels, (nuint)levels.Length,
+                    ref options,
+                    out pOutY, out nOutY,
+                    out pOutX, out nOutX,
+                    out pLengths, out nSegments,
+                    out pLevelSegments, out nLevels);
+            }
+            finally
+            {
+                if (maskHandle.IsAllocated)
+                    maskHandle.Free();
+            }
+
+            if (result == ContourNative.CONTOUR_CANCELLED)
+                throw new OperationCanceledException(cancellationToken);
+            if (result != 0)
+                throw new InvalidOperationException("Contour computation failed");
+
+            try
+            {
+                var contourResult = new SortedContourResult
+                {
+                    X = new double[(int)nOutX],
+                    Y = new double[(int)nOutY],
+                    SegmentLengths = new nuint[(int)nSegments],
+                    LevelSegments = new nuint[(int)nLevels]
+                };
+
+                Marshal.Copy(pOutX, contourResult.X, 0, (int)nOutX);
+                Marshal.Copy(pOutY, contourResult.Y, 0, (int)nOutY);
+
+                // Copy segment lengths (nuint array)
+                for (int i = 0; i < (int)nSegments; i++)
+                {
+                    contourResult.SegmentLengths[i] = (nuint)Marshal.ReadIntPtr(pLengths, i * IntPtr.Size);
+                }
+
+                // Copy level segments (nuint array)
+                for (int i = 0; i < (int)nLevels; i++)
+                {
+                    contourResult.LevelSegments[i] = (nuint)Marshal.ReadIntPtr(pLevelSegments, i * IntPtr.Size);
+                }
+
+                return contourResult;
+            }
+            finally
+            {
+                ContourNative.contour_free(pOutX);
+                ContourNative.contour_free(pOutY);
+                ContourNative.contour_free(pLengths);
+                ContourNative.contour_free(pLevelSegments);
+            }
+        }
+
+        /// <summary>
+        /// Visit contour segments as they are produced, without storing them.
+        /// </summary>
+        /// <param name="data">2D data array (row-major, dimensions [nY, nX])</param>
+        /// <param name="y">Y-coordinates array</param>
+        /// <param name="x">X-coordinates array</param>
+        /// <param name="levels">Contour levels (must be increasing)</param>
+        /// <param name="visitor">Called with (x1, y1, x2, y2, level) for each segment</param>
+        public static void Visit(double[,] data, double[] y, double[] x, double[] levels,
+            Action<double, double, double, double, int> visitor)
+        {
+            int nY = data.GetLength(0);
+            int nX = data.GetLength(1);
+
+            double[] flatData = new double[nY * nX];
+            Buffer.BlockCopy(data, 0, flatData, 0, nY * nX * sizeof(double));
+
+            ContourNative.ContourSegmentCallback callback =
+                (x1, y1, x2, y2, level, user) => visitor(x1, y1, x2, y2, level);
+
+            ContourNative.contour_options_init(out var options);
+            int result = ContourNative.contour_compute_visit(
+                flatData, (nuint)nY, (nuint)nX,
+                y, (nuint)y.Length,
+                x, (nuint)x.Length,
+                levels, (nuint)levels.Length,
+                ref options,
+                callback, IntPtr.Zero);
+            GC.KeepAlive(callback);
+
+            if (result != 0)
+                throw new InvalidOperationException("Contour computation failed");
+        }
+
+        /// <summary>
+        /// Compute the contour length of each level and the area of each band between levels,
+        /// without producing any geometry.
+        /// </summary>
+        /// <param name="data">2D data array (row-major, dimensions [nY, nX])</param>
+        /// <param name="y">Y-coordinates array</param>
+        /// <param name="x">X-coordinates array</param>
+        /// <param name="levels">Contour levels (must be increasing)</param>
+        /// <param name="threads">Number of threads, 0 for one per hardware thread</param>
+        /// <returns>Lengths per level and areas per band</returns>
+        public static ContourStatistics ComputeStatistics(double[,] data, double[] y, double[] x, double[] levels,
+            uint threads = 0)
+        {
+            int nY = data.GetLength(0);
+            int nX = data.GetLength(1);
+
+            double[] flatData = new double[nY * nX];
+            Buffer.BlockCopy(data, 0, flatData, 0, nY * nX * sizeof(double));
+
+            ContourNative.contour_options_init(out var options);
+            options.nThreads = threads;
+            int result = ContourNative.contour_compute_statistics(
+                flatData, (nuint)nY, (nuint)nX,
+                y, (nuint)y.Length,
+                x, (nuint)x.Length,
+                levels, (nuint)levels.Length,
+                ref options,
+                out IntPtr pLengths, out nuint nLengths,
+                out IntPtr pAreas, out nuint nAreas);
+
+            if (result != 0)
+                throw new InvalidOperationException("Contour computation failed");
+
+            try
+            {
+                var statistics = new ContourStatistics
+                {
+                    Lengths = new double[(int)nLengths],
+                    Areas = new double[(int)nAreas]
+                };
+                Marshal.Copy(pLengths, statistics.Lengths, 0, (int)nLengths);
+                Marshal.Copy(pAreas, statistics.Areas, 0, (int)nAreas);
+                return statistics;
+            }
+            finally
+            {
+                ContourNative.contour_free(pLengths);
+                ContourNative.contour_free(pAreas);
+            }
+        }
+
+        /// <summary>
+        /// Choose contour levels from the data in a single sweep.
+        /// </summary>
+        /// <param name="data">2D data array (row-major, dimensions [nY, nX])</param>
+        /// <param name="count">Maximum number of levels</param>
+        /// <param name="mode">Nice multiples of a round interval or quantiles</param>
+        /// <param name="interval">Interval of nice levels, 0 for a round interval from the count</param>
+        /// <returns>Increasing levels</returns>
+        public static double[] ComputeLevels(double[,] data, int count,
+            ContourLevelMode mode = ContourLevelMode.Nice, double interval = 0.0)
+        {
+            int nY = data.GetLength(0);
+            int nX = data.GetLength(1);
+
+            double[] flatData = new double[nY * nX];
+            Buffer.BlockCopy(data, 0, flatData, 0, nY * nX * sizeof(double));
+
+            ContourNative.contour_options_init(out var options);
+            options.eLevels = mode;
+            options.dLevelInterval = interval;
+            int result = ContourNative.contour_compute_levels(
+                flatData, (nuint)nY, (nuint)nX,
+                (nuint)count,
+                ref options,
+                out IntPtr pLevels, out nuint nLevels);
+
+            if (result != 0)
+                throw new InvalidOperationException("Level selection failed");
+
+            try
+            {
+                var levels = new double[(int)nLevels];
+                Marshal.Copy(pLevels, levels, 0, (int)nLevels);
+                return levels;
+            }
+            finally
+            {
+                ContourNative.contour_free(pLevels);
+            }
+        }
+
+        /// <summary>
+        /// Compute sorted contours at levels chosen from the data.
+        /// </summary>
+        /// <param name="data">2D data array (row-major, dimensions [nY, nX])</param>
+        /// <param name="y">Y-coordinates array</param>
+        /// <param name="x">X-coordinates array</param>
+        /// <param name="count">Maximum number of levels</param>
+        /// <param name="mode">Nice multiples of a round interval or quantiles</param>
+        /// <param name="interval">Interval of nice levels, 0 for a round interval from the count</param>
+        /// <returns>Sorted contour result with the chosen levels</returns>
+        public static AutoSortedContourResult ComputeSortedAuto(double[,] data, double[] y, double[] x, int count,
+            ContourLevelMode mode = ContourLevelMode.Nice, double interval = 0.0)
+        {
+            int nY = data.GetLength(0);
+            int nX = data.GetLength(1);
+
+            double[] flatData = new double[nY * nX];
+            Buffer.BlockCopy(data, 0, flatData, 0, nY * nX * sizeof(double));
+
+            ContourNative.contour_options_init(out var options);
+            options.eLevels = mode;
+            options.dLevelInterval = interval;
+            int result = ContourNative.contour_compute_sorted_auto(
+                flatData, (nuint)nY, (nuint)nX,
+                y, (nuint)y.Length,
+                x, (nuint)x.Length,
+                (nuint)count,
+                ref options,
+                out IntPtr pLevels, out nuint nLevels,
+                out IntPtr pOutY, out nuint nOutY,
+                out IntPtr pOutX, out nuint nOutX,
+                out IntPtr pLengths, out nuint nSegments,
+                out IntPtr pLevelSegments, out nuint nLevels2);
+
+            if (result != 0)
+                throw new InvalidOperationException("Contour computation failed");
+
+            try
+            {
+                var contourResult = new AutoSortedContourResult
+                {
+                    Levels = new double[(int)nLevels],
+                    X = new double[(int)nOutX],
+                    Y = new double[(int)nOutY],
+                    SegmentLengths = new nuint[(int)nSegments],
+                    LevelSegments = new nuint[(int)nLevels2]
+                };
+
+                Marshal.Copy(pLevels, contourResult.Levels, 0, (int)nLevels);
+                Marshal.Copy(pOutX, contourResult.X, 0, (int)nOutX);
+                Marshal.Copy(pOutY, contourResult.Y, 0, (int)nOutY);
+                for (int i = 0; i < (int)nSegments; i++)
+                {
+                    contourResult.SegmentLengths[i] = (nuint)Marshal.ReadIntPtr(pLengths, i * IntPtr.Size);
+                }
+                for (int i = 0; i < (int)nLevels2; i++)
+                {
+                    contourResult.LevelSegments[i] = (nuint)Marshal.ReadIntPtr(pLevelSegments, i * IntPtr.Size);
+                }
+                return contourResult;
+            }
+            finally
+            {
+                ContourNative.contour_free(pLevels);
+                ContourNative.contour_free(pOutX);
+                ContourNative.contour_free(pOutY);
+                ContourNative.contour_free(pLengths);
+                ContourNative.contour_free(pLevelSegments);
+            }
+        }
+
+        /// <summary>
+        /// Compute contours as shared vertices and an index buffer.
+        /// </summary>
+        /// <param name="data">2D data array (row-major, dimensions [nY, nX])</param>
+        /// <param name="y">Y-coordinates array</param>
+        /// <param name="x">X-coordinates array</param>
+        /// <param name="levels">Contour levels (must be increasing)</param>
+        /// <param name="topology">Segments as index pairs or polylines ended by the restart index</param>
+        /// <returns>Vertices and indices for all levels</returns>
+        public static IndexedContourResult ComputeIndexed(double[,] data, double[] y, double[] x, double[] levels,
+            ContourTopology topology = ContourTopology.Lines)
+        {
+            int nY = data.GetLength(0);
+            int nX = data.GetLength(1);
+
+            double[] flatData = new double[nY * nX];
+            Buffer.BlockCopy(data, 0, flatData, 0, nY * nX * sizeof(double));
+
+            ContourNative.contour_options_init(out var options);
+            int result = ContourNative.contour_compute_indexed(
+                flatData, (nuint)nY, (nuint)nX,
+                y, (nuint)y.Length,
+                x, (nuint)x.Length,
+                levels, (nuint)levels.Length,
+                ref options,
+                topology,
+                out IntPtr pVertices, out nuint nVertices,
+                out IntPtr pIndices, out nuint nIndices,
+                out IntPtr pLengths, out nuint nLevels);
+
+            if (result != 0)
+                throw new InvalidOperationException("Contour computation failed");
+
+            try
+            {
+                var indexedResult = new IndexedContourResult
+                {
+                    Vertices = new double[(int)nVertices],
+                    Indices = CopyIndices(pIndices, nIndices),
+                    LevelIndices = new nuint[(int)nLevels]
+                };
+
+                if (nVertices > 0)
+                    Marshal.Copy(pVertices, indexedResult.Vertices, 0, (int)nVertices);
+
+                for (int i = 0; i < (int)nLevels; i++)
+                {
+                    indexedResult.LevelIndices[i] = (nuint)Marshal.ReadIntPtr(pLengths, i * IntPtr.Size);
+                }
+
+                return indexedResult;
+            }
+            finally
+            {
+                ContourNative.contour_free(pVertices);
+                ContourNative.contour_free(pIndices);
+                ContourNative.contour_free(pLengths);
+            }
+        }
+
+        /// <summary>
+        /// Compute contours as shared single-precision vertices and an index buffer.
+        /// </summary>
+        /// <param name="data">2D data array (row-major, dimensions [nY, nX])</param>
+        /// <param name="y">Y-coordinates array</param>
+        /// <param name="x">X-coordinates array</param>
+        /// <param name="levels">Contour levels (must be increasing)</param>
+        /// <param name="topology">Segments as index pairs or polylines ended by the restart index</param>
+        /// <returns>Vertices and indices for all levels</returns>
+        public static FloatIndexedContourResult ComputeIndexedFloat(double[,] data, double[] y, double[] x,
+            double[] levels, ContourTopology topology = ContourTopology.Lines)
+        {
+            int nY = data.GetLength(0);
+            int nX = data.GetLength(1);
+
+            double[] flatData = new double[nY * nX];
+            Buffer.BlockCopy(data, 0, flatData, 0, nY * nX * sizeof(double));
+
+            ContourNative.contour_options_init(out var options);
+            int result = ContourNative.contour_compute_indexed_float(
+                flatData, (nuint)nY, (nuint)nX,
+                y, (nuint)y.Length,
+                x, (nuint)x.Length,
+                levels, (nuint)levels.Length,
+                ref options,
+                topology,
+                out IntPtr pVertices, out nuint nVertices,
+                out IntPtr pIndices, out nuint nIndices,
+                out IntPtr pLengths, out nuint nLevels);
+
+            if (result != 0)
+                throw new InvalidOperationException("Contour computation failed");
+
+            try
+            {
+                var indexedResult = new FloatIndexedContourResult
+                {
+                    Vertices = new float[(int)nVertices],
+                    Indices = CopyIndices(pIndices, nIndices),
+                    LevelIndices = new nuint[(int)nLevels]
+                };
+
+                if (nVertices > 0)
+                    Marshal.Copy(pVertices, indexedResult.Vertices, 0, (int)nVertices);
+
+                for (int i = 0; i < (int)nLevels; i++)
+                {
+                    indexedResult.LevelIndices[i] = (nuint)Marshal.ReadIntPtr(pLengths, i * IntPtr.Size);
+                }
+
+                return indexedResult;
+            }
+            finally
+            {
+                ContourNative.contour_free(pVertices);
+                ContourNative.contour_free(pIndices);
+                ContourNative.contour_free(pLengths);
+            }
+        }
+
+        /// <summary>
+        /// Copy native 32-bit indices.
+        /// </summary>
+        private static uint[] CopyIndices(IntPtr pIndices, nuint nIndices)
+        {
+            var indices = new uint[(int)nIndices];
+            if (nIndices > 0)
+            {
+                var raw = new int[(int)nIndices];
+                Marshal.Copy(pIndices, raw, 0, (int)nIndices);
+                Buffer.BlockCopy(raw, 0, indices, 0, (int)nIndices * sizeof(int));
+            }
+            return indices;
+        }
+
+        /// <summary>
+        /// Compute sorted contours (connected polylines) on an unstructured triangle mesh.
+        /// </summary>
+        /// <param name="values">Nodal values</param>
+        /// <param name="y">Y-coordinates of vertices</param>
+        /// <param name="x">X-coordinates of vertices</param>
+        /// <param name="triangles">Vertex indices, three per triangle</param>
+        /// <param name="levels">Contour levels (must be increasing)</param>
+        /// <returns>Sorted contour result with coordinates, polyline lengths, and level information</returns>
+        public static SortedContourResult ComputeMesh(double[] values, double[] y, double[] x, nuint[] triangles,
+            double[] levels)
+        {
+            ContourNative.contour_options_init(out var options);
+
+            int result = ContourNative.contour_compute_mesh(
+                values, (nuint)values.Length,
+                y, (nuint)y.Length,
+                x, (nuint)x.Length,
+                triangles, (nuint)triangles.Length,
+                levels, (nuint)levels.Length,
+                ref options,
+                out IntPtr pOutY, out nuint nOutY,
+                out IntPtr pOutX, out nuint nOutX,
+                out IntPtr pLengths, out nuint nSegments,
+                out IntPtr pLevelSegments, out nuint nLevels);
+
+            if (result != 0)
+                throw new InvalidOperationException("Contour computation failed");
+
+            try
+            {
+                var contourResult = new SortedContourResult
+                {
+                    X = new double[(int)nOutX],
+                    Y = new double[(int)nOutY],
+                    SegmentLengths = new nuint[(int)nSegments],
+                    LevelSegments = new nuint[(int)nLevels]
+                };
+
+                if (nOutX > 0)
+                {
+                    Marshal.Copy(pOutX, contourResult.X, 0, (int)nOutX);
+                    Marshal.Copy(pOutY, contourResult.Y, 0, (int)nOutY);
+                }
+
+                for (int i = 0; i < (int)nSegments; i++)
+                {
+                    contourResult.SegmentLengths[i] = (nuint)Marshal.ReadIntPtr(pLengths, i * IntPtr.Size);
+                }
+
+                for (int i = 0; i < (int)nLevels; i++)
+                {
+                    contourResult.LevelSegments[i] = (nuint)Marshal.ReadIntPtr(pLevelSegments, i * IntPtr.Size);
+                }
+
+                return contourResult;
+            }
+            finally
+            {
+                ContourNative.contour_free(pOutX);
+                ContourNative.contour_free(pOutY);
+                ContourNative.contour_free(pLengths);
+                ContourNative.contour_free(pLevelSegments);
+            }
+        }
+
+        /// <summary>
+        /// Compute isosurfaces for 3D data.
+        /// </summary>
+        /// <param name="data">3D data array (row-major, dimensions [nZ, nY, nX])</param>
+        /// <param name="z">Z-coordinates array</param>
+        /// <param name="y">Y-coordinates array</param>
+        /// <param name="x">X-coordinates array</param>
+        /// <param name="levels">Contour levels (must be increasing)</param>
+        /// <param name="threads">Number of worker threads, 0 for one per hardware thread</param>
+        /// <returns>Indexed triangle meshes for all levels</returns>
+        public static IsosurfaceResult ComputeIsosurfaces(double[,,] data, double[] z, double[] y, double[] x,
+            double[] levels, uint threads = 0)
+        {
+            int nZ = data.GetLength(0);
+            int nY = data.GetLength(1);
+            int nX = data.GetLength(2);
+
+            // Flatten 3D array to 1D (row-major)
+            double[] flatData = new double[nZ * nY * nX];
+            Buffer.BlockCopy(data, 0, flatData, 0, nZ * nY * nX * sizeof(double));
+
+            ContourNative.contour_options_init(out var options);
+            options.nThreads = threads;
+
+            int result = ContourNative.contour_compute_isosurfaces(
+                flatData, (nuint)nZ, (nuint)nY, (nuint)nX,
+                z, (nuint)z.Length,
+                y, (nuint)y.Length,
+                x, (nuint)x.Length,
+                levels, (nuint)levels.Length,
+                ref options,
+                out IntPtr pVertices, out nuint nVertices,
+                out IntPtr pIndices, out nuint nIndices,
+                out IntPtr pLengths, out nuint nLevels);
+
+            if (result != 0)
+                throw new InvalidOperationException("Isosurface computation failed");
+
+            try
+            {
+                var isosurfaceResult = new IsosurfaceResult
+                {
+                    Vertices = new double[(int)nVertices],
+                    Indices = CopyIndices(pIndices, nIndices),
+                    LevelTriangles = new nuint[(int)nLevels]
+                };
+
+                if (nVertices > 0)
+                    Marshal.Copy(pVertices, isosurfaceResult.Vertices, 0, (int)nVertices);
+
+                for (int i = 0; i < (int)nLevels; i++)
+                {
+                    isosurfaceResult.LevelTriangles[i] = (nuint)Marshal.ReadIntPtr(pLengths, i * IntPtr.Size);
+                }
+
+                return isosurfaceResult;
+            }
+            finally
+            {
+                ContourNative.contour_free(pVertices);
+                ContourNative.contour_free(pIndices);
+                ContourNative.contour_free(pLengths);
+            }
+        }
+
+        /// <summary>
+        /// Compute contours for 2D data with single-precision output coordinates.
+        /// </summary>
+        /// <param name="data">2D data array (row-major, dimensions [nY, nX])</param>
+        /// <param name="y">Y-coordinates array</param>
+        /// <param name="x">X-coordinates array</param>
+        /// <param name="levels">Contour levels (must be increasing)</param>
+        /// <returns>Contour result with coordinates and segment information</returns>
+        public static FloatContourResult ComputeFloat(double[,] data, double[] y, double[] x, double[] levels)
+        {
+            int nY = data.GetLength(0);
+            int nX = data.GetLength(1);
+
+            double[] flatData = new double[nY * nX];
+            Buffer.BlockCopy(data, 0, flatData, 0, nY * nX * sizeof(double));
+
+            ContourNative.contour_options_init(out var options);
+
+            int result = ContourNative.contour_compute_float(
+                flatData, (nuint)nY, (nuint)nX,
+                y, (nuint)y.Length,
+                x, (nuint)x.Length,
+                levels, (nuint)levels.Length,
+                ref options,
+                out IntPtr pOutY, out nuint nOutY,
+                out IntPtr pOutX, out nuint nOutX,
+                out IntPtr pLengths, out nuint nSegments);
+
+            if (result != 0)
+                throw new InvalidOperationException("Contour computation failed");
+
+            try
+            {
+                var contourResult = new FloatContourResult
+                {
+                    X = new float[(int)nOutX],
+                    Y = new float[(int)nOutY],
+                    SegmentLengths = new nuint[(int)nSegments]
+                };
+
+                if (nOutX > 0)
+                {
+                    Marshal.Copy(pOutX, contourResult.X, 0, (int)nOutX);
+                    Marshal.Copy(pOutY, contourResult.Y, 0, (int)nOutY);
+                }
+
+                for (int i = 0; i < (int)nSegments; i++)
+                {
+                    contourResult.SegmentLengths[i] = (nuint)Marshal.ReadIntPtr(pLengths, i * IntPtr.Size);
+                }
+
+                return contourResult;
+            }
+            finally
+            {
+                ContourNative.contour_free(pOutX);
+                ContourNative.contour_free(pOutY);
+                ContourNative.contour_free(pLengths);
+            }
+        }
+
+        /// <summary>
+        /// Compute sorted contours (connected polygons) for 2D data with single-precision output coordinates.
+        /// </summary>
+        /// <param name="data">2D data array (row-major, dimensions [nY, nX])</param>
+        /// <param name="y">Y-coordinates array</param>
+        /// <param name="x">X-coordinates array</param>
+        /// <param name="levels">Contour levels (must be increasing)</param>
+        /// <returns>Sorted contour result with coordinates, segment lengths, and level information</returns>
+        public static FloatSortedContourResult ComputeSortedFloat(double[,] data, double[] y, double[] x,
+            double[] levels)
+        {
+            int nY = data.GetLength(0);
+            int nX = data.GetLength(1);
+
+            double[] flatData = new double[nY * nX];
+            Buffer.BlockCopy(data, 0, flatData, 0, nY * nX * sizeof(double));
+
+            ContourNative.contour_options_init(out var options);
+
+            int result = ContourNative.contour_compute_sorted_float(
+                flatData, (nuint)nY, (nuint)nX,
+                y, (nuint)y.Length,
+                x, (nuint)x.Length,
+                levels, (nuint)levels.Length,
+                ref options,
+                out IntPtr pOutY, out nuint nOutY,
+                out IntPtr pOutX, out nuint nOutX,
+                out IntPtr pLengths, out nuint nSegments,
+                out IntPtr pLevelSegments, out nuint nLevels);
+
+            if (result != 0)
+                throw new InvalidOperationException("Contour computation failed");
+
+            return CopyFloatSorted(pOutY, nOutY, pOutX, nOutX, pLengths, nSegments, pLevelSegments, nLevels);
+        }
+
+        /// <summary>
+        /// Compute sorted contours on an unstructured triangle mesh with single-precision output coordinates.
+        /// </summary>
+        /// <param name="values">Nodal values</param>
+        /// <param name="y">Y-coordinates of vertices</param>
+        /// <param name="x">X-coordinates of vertices</param>
+        /// <param name="triangles">Vertex indices, three per triangle</param>
+        /// <param name="levels">Contour levels (must be increasing)</param>
+        /// <returns>Sorted contour result with coordinates, polyline lengths, and level information</returns>
+        public static FloatSortedContourResult ComputeMeshFloat(double[] values, double[] y, double[] x,
+            nuint[] triangles, double[] levels)
+        {
+            ContourNative.contour_options_init(out var options);
+
+            int result = ContourNative.contour_compute_mesh_float(
+                values, (nuint)values.Length,
+                y, (nuint)y.Length,
+                x, (nuint)x.Length,
+                triangles, (nuint)triangles.Length,
+                levels, (nuint)levels.Length,
+                ref options,
+                out IntPtr pOutY, out nuint nOutY,
+                out IntPtr pOutX, out nuint nOutX,
+                out IntPtr pLengths, out nuint nSegments,
+                out IntPtr pLevelSegments, out nuint nLevels);
+
+            if (result != 0)
+                throw new InvalidOperationException("Contour computation failed");
+
+            return CopyFloatSorted(pOutY, nOutY, pOutX, nOutX, pLengths, nSegments, pLevelSegments, nLevels);
+        }
+
+        /// <summary>
+        /// Compute isosurfaces for 3D data with single-precision vertices.
+        /// </summary>
+        /// <param name="data">3D data array (row-major, dimensions [nZ, nY, nX])</param>
+        /// <param name="z">Z-coordinates array</param>
+        /// <param name="y">Y-coordinates array</param>
+        /// <param name="x">X-coordinates array</param>
+        /// <param name="levels">Contour levels (must be increasing)</param>
+        /// <param name="threads">Number of worker threads, 0 for one per hardware thread</param>
+        /// <returns>Indexed triangle meshes for all levels</returns>
+        public static FloatIsosurfaceResult ComputeIsosurfacesFloat(double[,,] data, double[] z, double[] y,
+            double[] x, double[] levels, uint threads = 0)
+        {
+            int nZ = data.GetLength(0);
+            int nY = data.GetLength(1);
+            int nX = data.GetLength(2);
+
+            double[] flatData = new double[nZ * nY * nX];
+            Buffer.BlockCopy(data, 0, flatData, 0, nZ * nY * nX * sizeof(double));
+
+            ContourNative.contour_options_init(out var options);
+            options.nThreads = threads;
+
+            int result = ContourNative.contour_compute_isosurfaces_float(
+                flatData, (nuint)nZ, (nuint)nY, (nuint)nX,
+                z, (nuint)z.Length,
+                y, (nuint)y.Length,
+                x, (nuint)x.Length,
+                levels, (nuint)levels.Length,
+                ref options,
+                out IntPtr pVertices, out nuint nVertices,
+                out IntPtr pIndices, out nuint nIndices,
+                out IntPtr pLengths, out nuint nLevels);
+
+            if (result != 0)
+                throw new InvalidOperationException("Isosurface computation failed");
+
+            try
+            {
+                var isosurfaceResult = new FloatIsosurfaceResult
+                {
+                    Vertices = new float[(int)nVertices],
+                    Indices = CopyIndices(pIndices, nIndices),
+                    LevelTriangles = new nuint[(int)nLevels]
+                };
+
+                if (nVertices > 0)
+                    Marshal.Copy(pVertices, isosurfaceResult.Vertices, 0, (int)nVertices);
+
+                for (int i = 0; i < (int)nLevels; i++)
+                {
+                    isosurfaceResult.LevelTriangles[i] = (nuint)Marshal.ReadIntPtr(pLengths, i * IntPtr.Size);
+                }
+
+                return isosurfaceResult;
+            }
+            finally
+            {
+                ContourNative.contour_free(pVertices);
+                ContourNative.contour_free(pIndices);
+                ContourNative.contour_free(pLengths);
+            }
+        }
+
+        /// <summary>
+        /// Copy and free native single-precision sorted contours.
+        /// </summary>
+        private static FloatSortedContourResult CopyFloatSorted(IntPtr pOutY, nuint nOutY, IntPtr pOutX, nuint nOutX,
+            IntPtr pLengths, nuint nSegments, IntPtr pLevelSegments, nuint nLevels)
+        {
+            try
+            {
+                var contourResult = new FloatSortedContourResult
+                {
+                    X = new float[(int)nOutX],
+                    Y = new float[(int)nOutY],
+                    SegmentLengths = new nuint[(int)nSegments],
+                    LevelSegments = new nuint[(int)nLevels]
+                };
+
+                if (nOutX > 0)
+                {
+                    Marshal.Copy(pOutX, contourResult.X, 0, (int)nOutX);
+                    Marshal.Copy(pOutY, contourResult.Y, 0, (int)nOutY);
+                }
+
+                for (int i = 0; i < (int)nSegments; i++)
+                {
+                    contourResult.SegmentLengths[i] = (nuint)Marshal.ReadIntPtr(pLengths, i * IntPtr.Size);
+                }
+
+                for (int i = 0; i < (int)nLevels; i++)
+                {
+                    contourResult.LevelSegments[i] = (nuint)Marshal.ReadIntPtr(pLevelSegments, i * IntPtr.Size);
+                }
+
+                return contourResult;
+            }
+            finally
+            {
+                ContourNative.contour_free(pOutX);
+                ContourNative.contour_free(pOutY);
+                ContourNative.contour_free(pLengths);
+                ContourNative.contour_free(pLevelSegments);
+            }
+        }
+
+        /// <summary>
+        /// Pin a validity mask for the duration of a native call.
+        /// </summary>
+        private static GCHandle PinMask(byte[,] mask, int nY, int nX)
+        {
+            if (mask == null)
+                return default;
+            if (mask.GetLength(0) != nY || mask.GetLength(1) != nX)
+                throw new ArgumentException("Mask dimensions must match data dimensions", nameof(mask));
+            return GCHandle.Alloc(mask, GCHandleType.Pinned);
+        }
+
+        /// <summary>
+        /// Compute sorted contours with quantized (fixed-point) coordinates relative to the grid origin.
+        /// </summary>
+        /// <param name="data">2D data array (row-major, dimensions [nY, nX])</param>
+        /// <param name="y">Y-coordinates array (the first cell gives the unit)</param>
+        /// <param name="x">X-coordinates array (the first cell gives the unit)</param>
+        /// <param name="levels">Contour levels (must be increasing)</param>
+        /// <param name="fractionBits">Number of sub-cell bits</param>
+        /// <returns>Quantized contour result</returns>
+        public static QuantizedContourResult ComputeSortedQuantized(double[,] data, double[] y, double[] x, double[] levels, uint fractionBits)
+        {
+            int nY = data.GetLength(0);
+            int nX = data.GetLength(1);
+
+            // Flatten 2D array to 1D (row-major)
+            double[] flatData = new double[nY * nX];
+            Buffer.BlockCopy(data, 0, flatData, 0, nY * nX * sizeof(double));
+
+            int result = ContourNative.contour_compute_sorted_quantized(
+                flatData, (nuint)nY, (nuint)nX,
+                y, (nuint)y.Length,
+                x, (nuint)x.Length,
+                levels, (nuint)levels.Length,
+                fractionBits,
+                out IntPtr pOutY, out nuint nOutY,
+                out IntPtr pOutX, out nuint nOutX,
+                out IntPtr pLengths, out nuint nSegments,
+                out IntPtr pLevelSegments, out nuint nLevels);
+
+            if (result != 0)
+                throw new InvalidOperationException("Contour computation failed");
+
+            try
+            {
+                var contourResult = new QuantizedContourResult
+                {
+                    X = new int[(int)nOutX],
+                    Y = new int[(int)nOutY],
+                    SegmentLengths = new nuint[(int)nSegments],
+                    LevelSegments = new nuint[(int)nLevels]
+                };
+
+                Marshal.Copy(pOutX, contourResult.X, 0, (int)nOutX);
+                Marshal.Copy(pOutY, contourResult.Y, 0, (int)nOutY);
+
+                for (int i = 0; i < (int)nSegments; i++)
+                {
+                    contourResult.SegmentLengths[i] = (nuint)Marshal.ReadIntPtr(pLengths, i * IntPtr.Size);
+                }
+
+                for (int i = 0; i < (int)nLevels; i++)
+                {
+                    contourResult.LevelSegments[i] = (nuint)Marshal.ReadIntPtr(pLevelSegments, i * IntPtr.Size);
+                }
+
+                return contourResult;
+            }
+            finally
+            {
+                ContourNative.contour_free(pOutX);
+                ContourNative.contour_free(pOutY);
+                ContourNative.contour_free(pLengths);
+                ContourNative.contour_free(pLevelSegments);
+            }
+        }
+
+        /// <summary>
+        /// Compute sorted contours as quantized, delta- and zigzag-varint-encoded bytes.
+        /// </summary>
+        /// <param name="data">2D data array (row-major, dimensions [nY, nX])</param>
+        /// <param name="y">Y-coordinates array (the first cell gives the unit)</param>
+        /// <param name="x">X-coordinates array (the first cell gives the unit)</param>
+        /// <param name="levels">Contour levels (must be increasing)</param>
+        /// <param name="fractionBits">Number of sub-cell bits</param>
+        /// <returns>Encoded contour result</returns>
+        public static EncodedContourResult ComputeSortedEncoded(double[,] data, double[] y, double[] x, double[] levels, uint fractionBits)
+        {
+            int nY = data.GetLength(0);
+            int nX = data.GetLength(1);
+
+            // Flatten 2D array to 1D (row-major)
+            double[] flatData = new double[nY * nX];
+            Buffer.BlockCopy(data, 0, flatData, 0, nY * nX * sizeof(double));
+
+            int result = ContourNative.contour_compute_sorted_encoded(
+                flatData, (nuint)nY, (nuint)nX,
+                y, (nuint)y.Length,
+                x, (nuint)x.Length,
+                levels, (nuint)levels.Length,
+                fractionBits,
+                out IntPtr pBytes, out nuint nBytes,
+                out IntPtr pLengths, out nuint nSegments,
+                out IntPtr pLevelSegments, out nuint nLevels);
+
+            if (result != 0)
+                throw new InvalidOperationException("Contour computation failed");
+
+            try
+            {
+                var contourResult = new EncodedContourResult
+                {
+                    Bytes = new byte[(int)nBytes],
+                    SegmentLengths = new nuint[(int)nSegments],
+                    LevelSegments = new nuint[(int)nLevels]
+                };
+
+                Marshal.Copy(pBytes, contourResult.Bytes, 0, (int)nBytes);
+
+                for (int i = 0; i < (int)nSegments; i++)
+                {
+                    contourResult.SegmentLengths[i] = (nuint)Marshal.ReadIntPtr(pLengths, i * IntPtr.Size);
+                }
+
+                for (int i = 0; i < (int)nLevels; i++)
+                {
+                    contourResult.LevelSegments[i] = (nuint)Marshal.ReadIntPtr(pLevelSegments, i * IntPtr.Size);
+                }
+
+                return contourResult;
+            }
+            finally
+            {
+                ContourNative.contour_free(pBytes);
+                ContourNative.contour_free(pLengths);
+                ContourNative.contour_free(pLevelSegments);
+            }
+        }
+    }
+
+    /// <summary>
+    /// Spatial index over sorted contours for hover and hit-testing.
+    /// </summary>
+    public sealed class ContourIndex : IDisposable
+    {
+        private IntPtr _handle;
 
         /// <summary>
-        /// Free memory allocated by contour functions.
+        /// Create an index over sorted contours.
         /// </summary>
-        [DllImport(LibraryName, CallingConvention = CallingConvention.Cdecl)]
-        public static extern void contour_free(IntPtr ptr);
+        /// <param name="contours">Result of ContourCompute.ComputeSorted</param>
+        /// <param name="levels">Contour levels used for computing the contours</param>
+        /// <param name="data">2D data array used for computing the contours, or null</param>
+        /// <param name="y">Y-coordinates of the grid, or null</param>
+        /// <param name="x">X-coordinates of the grid, or null</param>
+        /// <remarks>The grid is only needed for <see cref="Band"/>.</remarks>
+        public ContourIndex(ContourCompute.SortedContourResult contours, double[] levels,
+            double[,] data = null, double[] y = null, double[] x = null)
+        {
+            double[] flatData = null;
+            int nY = 0;
+            int nX = 0;
+            if (data != null)
+            {
+                nY = data.GetLength(0);
+                nX = data.GetLength(1);
+                flatData = new double[nY * nX];
+                Buffer.BlockCopy(data, 0, flatData, 0, nY * nX * sizeof(double));
+            }
+
+            _handle = ContourNative.contour_index_create(
+                contours.Y, (nuint)contours.Y.Length,
+                contours.X, (nuint)contours.X.Length,
+                contours.SegmentLengths, (nuint)contours.SegmentLengths.Length,
+                contours.LevelSegments, (nuint)contours.LevelSegments.Length,
+                levels, (nuint)levels.Length,
+                flatData, (nuint)nY, (nuint)nX,
+                y, (nuint)(y?.Length ?? 0),
+                x, (nuint)(x?.Length ?? 0));
+
+            if (_handle == IntPtr.Zero)
+                throw new ArgumentException("Invalid contours for spatial index");
+        }
 
         /// <summary>
-        /// Compute contours for a 2D double-precision floating point image.
+        /// Find the polyline nearest to a point.
         /// </summary>
-        [DllImport(LibraryName, CallingConvention = CallingConvention.Cdecl)]
-        public static extern int contour_compute(
-            [In] double[] pData, nuint nYdata, nuint nXdata,
-            [In] double[] pY, nuint nY,
-            [In] double[] pX, nuint nX,
-            [In] double[] pLevels, nuint nLevels,
-            out IntPtr ppOutY, out nuint nOutY,
-            out IntPtr ppOutX, out nuint nOutX,
-            out IntPtr nOutLengths, out nuint nOutSegments);
+        /// <returns>False if there are no polylines</returns>
+        public bool Nearest(double y, double x, out nuint polyline, out nuint level, out double distance)
+        {
+            ThrowIfDisposed();
+            return ContourNative.contour_index_nearest(_handle, y, x, out polyline, out level, out distance) == 0;
+        }
 
         /// <summary>
-        /// Compute sorted contours (connected polygons) for a 2D double-precision floating point image.
+        /// Find the band containing a point. Band i is between levels i - 1 and i.
         /// </summary>
-        [DllImport(LibraryName, CallingConvention = CallingConvention.Cdecl)]
-        public static extern int contour_compute_sorted(
-            [In] double[] pData, nuint nYdata, nuint nXdata,
-            [In] double[] pY, nuint nY,
-            [In] double[] pX, nuint nX,
-            [In] double[] pLevels, nuint nLevels,
-            out IntPtr ppOutY, out nuint nOutY,
-            out IntPtr ppOutX, out nuint nOutX,
-            out IntPtr nOutLengths, out nuint nOutSegments,
-            out IntPtr nLevelSegments, out nuint nLevels2);
-    }
+        public nuint Band(double y, double x)
+        {
+            ThrowIfDisposed();
+            if (ContourNative.contour_index_band(_handle, y, x, out nuint band) != 0)
+                throw new InvalidOperationException("Index was created without a grid");
+            return band;
+        }
 
-    /// <summary>
-    /// High-level managed wrapper for contour computation with automatic memory management.
-    /// </summary>
-    public static class ContourCompute
-    {
         /// <summary>
-        /// Result of contour computation.
+        /// Find polylines intersecting an axis-aligned box.
         /// </summary>
-        public class ContourResult
+        /// <returns>Increasing polyline indices</returns>
+        public nuint[] QueryBox(double minY, double minX, double maxY, double maxX)
         {
-            /// <summary>X-coordinates of all contour points.</summary>
-            public double[] X { get; set; } = Array.Empty<double>();
-            /// <summary>Y-coordinates of all contour points.</summary>
-            public double[] Y { get; set; } = Array.Empty<double>();
-            /// <summary>Number of points (or segments) per level.</summary>
-            public nuint[] SegmentLengths { get; set; } = Array.Empty<nuint>();
+            ThrowIfDisposed();
+            if (ContourNative.contour_index_query_box(_handle, minY, minX, maxY, maxX,
+                out IntPtr pPolylines, out nuint nPolylines) != 0)
+                throw new InvalidOperationException("Box query failed");
+
+            try
+            {
+                var polylines = new nuint[(int)nPolylines];
+                for (int i = 0; i < (int)nPolylines; i++)
+                {
+                    polylines[i] = (nuint)Marshal.ReadIntPtr(pPolylines, i * IntPtr.Size);
+                }
+                return polylines;
+            }
+            finally
+            {
+                ContourNative.contour_free(pPolylines);
+            }
         }
 
         /// <summary>
-        /// Result of sorted contour computation.
+        /// Release the native index.
         /// </summary>
-        public class SortedContourResult : ContourResult
+        public void Dispose()
         {
-            /// <summary>Number of polygons per level.</summary>
-            public nuint[] LevelSegments { get; set; } = Array.Empty<nuint>();
+            if (_handle != IntPtr.Zero)
+            {
+                ContourNative.contour_index_destroy(_handle);
+                _handle = IntPtr.Zero;
+            }
+            GC.SuppressFinalize(this);
+        }
+
+        ~ContourIndex()
+        {
+            Dispose();
+        }
+
+        private void ThrowIfDisposed()
+        {
+            if (_handle == IntPtr.Zero)
+                throw new ObjectDisposedException(nameof(ContourIndex));
         }
+    }
+
+    /// <summary>
+    /// Contours with polylines connected per level on first access.
+    /// </summary>
+    public sealed class LazyContourResult : IDisposable
+    {
+        private IntPtr _handle;
 
         /// <summary>
-        /// Compute contours for 2D data.
+        /// Extract contour segments for all levels.
         /// </summary>
         /// <param name="data">2D data array (row-major, dimensions [nY, nX])</param>
         /// <param name="y">Y-coordinates array</param>
         /// <param name="x">X-coordinates array</param>
         /// <param name="levels">Contour levels (must be increasing)</param>
-        /// <returns>Contour result with coordinates and segment information</returns>
-        public static ContourResult Compute(double[,] data, double[] y, double[] x, double[] levels)
+        public LazyContourResult(double[,] data, double[] y, double[] x, double[] levels)
         {
             int nY = data.GetLength(0);
             int nX = data.GetLength(1);
 
-            // Flatten 2D array to 1D (row-major)
             double[] flatData = new double[nY * nX];
             Buffer.BlockCopy(data, 0, flatData, 0, nY * nX * sizeof(double));
 
-            int result = ContourNative.contour_compute(
+            ContourNative.contour_options_init(out var options);
+            _handle = ContourNative.contour_result_create(
                 flatData, (nuint)nY, (nuint)nX,
                 y, (nuint)y.Length,
                 x, (nuint)x.Length,
                 levels, (nuint)levels.Length,
-                out IntPtr pOutY, out nuint nOutY,
-                out IntPtr pOutX, out nuint nOutX,
-                out IntPtr pLengths, out nuint nSegments);
+                ref options);
 
-            if (result != 0)
+            if (_handle == IntPtr.Zero)
                 throw new InvalidOperationException("Contour computation failed");
+        }
+
+        /// <summary>Number of levels.</summary>
+        public int LevelCount
+        {
+            get
+            {
+                ThrowIfDisposed();
+                return (int)ContourNative.contour_result_levels(_handle);
+            }
+        }
+
+        /// <summary>
+        /// Number of polylines for a level.
+        /// </summary>
+        public int PolylineCount(int level)
+        {
+            ThrowIfDisposed();
+            return (int)ContourNative.contour_result_polylines(_handle, (nuint)level);
+        }
+
+        /// <summary>
+        /// Coordinates of a single polyline.
+        /// </summary>
+        public (double[] Y, double[] X) GetPolyline(int level, int polyline)
+        {
+            ThrowIfDisposed();
+            if (ContourNative.contour_result_polyline(_handle, (nuint)level, (nuint)polyline,
+                out IntPtr pY, out IntPtr pX, out nuint nPoints) != 0)
+                throw new ArgumentOutOfRangeException(nameof(polyline));
+
+            var y = new double[(int)nPoints];
+            var x = new double[(int)nPoints];
+            Marshal.Copy(pY, y, 0, (int)nPoints);
+            Marshal.Copy(pX, x, 0, (int)nPoints);
+            return (y, x);
+        }
+
+        /// <summary>
+        /// All polylines of a single level.
+        /// </summary>
+        /// <returns>Sorted contour result with a single level</returns>
+        public ContourCompute.SortedContourResult GetLevel(int level)
+        {
+            ThrowIfDisposed();
+            if (ContourNative.contour_result_level(_handle, (nuint)level,
+                out IntPtr pOutY, out nuint nOutY,
+                out IntPtr pOutX, out nuint nOutX,
+                out IntPtr pLengths, out nuint nSegments) != 0)
+                throw new ArgumentOutOfRangeException(nameof(level));
 
             try
             {
-                var contourResult = new ContourResult
+                var contourResult = new ContourCompute.SortedContourResult
                 {
                     X = new double[(int)nOutX],
                     Y = new double[(int)nOutY],
-                    SegmentLengths = new nuint[(int)nSegments]
+                    SegmentLengths = new nuint[(int)nSegments],
+                    LevelSegments = new nuint[] { nSegments }
                 };
 
                 Marshal.Copy(pOutX, contourResult.X, 0, (int)nOutX);
                 Marshal.Copy(pOutY, contourResult.Y, 0, (int)nOutY);
 
-                // Copy segment lengths (nuint array)
                 for (int i = 0; i < (int)nSegments; i++)
                 {
                     contourResult.SegmentLengths[i] = (nuint)Marshal.ReadIntPtr(pLengths, i * IntPtr.Size);
@@ -130,27 +2133,92 @@ namespace Contour
         }
 
         /// <summary>
-        /// Compute sorted contours (connected polygons) for 2D data.
+        /// Release the native result.
+        /// </summary>
+        public void Dispose()
+        {
+            if (_handle != IntPtr.Zero)
+            {
+                ContourNative.contour_result_destroy(_handle);
+                _handle = IntPtr.Zero;
+            }
+            GC.SuppressFinalize(this);
+        }
+
+        ~LazyContourResult()
+        {
+            Dispose();
+        }
+
+        private void ThrowIfDisposed()
+        {
+            if (_handle == IntPtr.Zero)
+                throw new ObjectDisposedException(nameof(LazyContourResult));
+        }
+    }
+
+    /// <summary>
+    /// Content-addressed LRU cache of sorted contours, safe for concurrent use.
+    /// </summary>
+    public sealed class ContourCache : IDisposable
+    {
+        private IntPtr _handle;
+
+        /// <summary>
+        /// Create a cache.
+        /// </summary>
+        /// <param name="maxBytes">Byte budget for cached results</param>
+        public ContourCache(ulong maxBytes)
+        {
+            _handle = ContourNative.contour_cache_create((nuint)maxBytes);
+            if (_handle == IntPtr.Zero)
+                throw new InvalidOperationException("Failed to create cache");
+        }
+
+        /// <summary>Cache statistics.</summary>
+        public ContourNative.ContourCacheStats Stats
+        {
+            get
+            {
+                ThrowIfDisposed();
+                ContourNative.contour_cache_get_stats(_handle, out var stats);
+                return stats;
+            }
+        }
+
+        /// <summary>
+        /// Remove all results and reset the statistics.
+        /// </summary>
+        public void Clear()
+        {
+            ThrowIfDisposed();
+            ContourNative.contour_cache_clear(_handle);
+        }
+
+        /// <summary>
+        /// Compute sorted contours, reusing a cached result for identical input.
         /// </summary>
         /// <param name="data">2D data array (row-major, dimensions [nY, nX])</param>
         /// <param name="y">Y-coordinates array</param>
         /// <param name="x">X-coordinates array</param>
         /// <param name="levels">Contour levels (must be increasing)</param>
         /// <returns>Sorted contour result with coordinates, segment lengths, and level information</returns>
-        public static SortedContourResult ComputeSorted(double[,] data, double[] y, double[] x, double[] levels)
+        public ContourCompute.SortedContourResult ComputeSorted(double[,] data, double[] y, double[] x, double[] levels)
         {
+            ThrowIfDisposed();
             int nY = data.GetLength(0);
             int nX = data.GetLength(1);
 
-            // Flatten 2D array to 1D (row-major)
             double[] flatData = new double[nY * nX];
             Buffer.BlockCopy(data, 0, flatData, 0, nY * nX * sizeof(double));
 
-            int result = ContourNative.contour_compute_sorted(
+            ContourNative.contour_options_init(out var options);
+            int result = ContourNative.contour_cache_sorted(_handle,
                 flatData, (nuint)nY, (nuint)nX,
                 y, (nuint)y.Length,
                 x, (nuint)x.Length,
                 levels, (nuint)levels.Length,
+                ref options,
                 out IntPtr pOutY, out nuint nOutY,
                 out IntPtr pOutX, out nuint nOutX,
                 out IntPtr pLengths, out nuint nSegments,
@@ -161,7 +2229,7 @@ namespace Contour
 
             try
             {
-                var contourResult = new SortedContourResult
+                var contourResult = new ContourCompute.SortedContourResult
                 {
                     X = new double[(int)nOutX],
                     Y = new double[(int)nOutY],
@@ -172,13 +2240,11 @@ namespace Contour
                 Marshal.Copy(pOutX, contourResult.X, 0, (int)nOutX);
                 Marshal.Copy(pOutY, contourResult.Y, 0, (int)nOutY);
 
-                // Copy segment lengths (nuint array)
                 for (int i = 0; i < (int)nSegments; i++)
                 {
                     contourResult.SegmentLengths[i] = (nuint)Marshal.ReadIntPtr(pLengths, i * IntPtr.Size);
                 }
 
-                // Copy level segments (nuint array)
                 for (int i = 0; i < (int)nLevels; i++)
                 {
                     contourResult.LevelSegments[i] = (nuint)Marshal.ReadIntPtr(pLevelSegments, i * IntPtr.Size);
@@ -194,5 +2260,29 @@ namespace Contour
                 ContourNative.contour_free(pLevelSegments);
             }
         }
+
+        /// <summary>
+        /// Release the native cache.
+        /// </summary>
+        public void Dispose()
+        {
+            if (_handle != IntPtr.Zero)
+            {
+                ContourNative.contour_cache_destroy(_handle);
+                _handle = IntPtr.Zero;
+            }
+            GC.SuppressFinalize(this);
+        }
+
+        ~ContourCache()
+        {
+            Dispose();
+        }
+
+        private void ThrowIfDisposed()
+        {
+            if (_handle == IntPtr.Zero)
+                throw new ObjectDisposedException(nameof(ContourCache));
+        }
     }
 }
@@ -1,9 +1,58 @@
 using System;
+using System.Collections.Generic;
+using System.Runtime.InteropServices;
+using System.Threading;
 using Contour;
 
 class Program
 {
-    static int Main()
+    static int failures = 0;
+
+    static void Check(bool condition, string message)
+    {
+        if (!condition)
+            throw new Exception(message);
+    }
+
+    static void Run(string name, Action test)
+    {
+        try
+        {
+            test();
+            Console.WriteLine($"PASS {name}");
+        }
+        catch (Exception ex)
+        {
+            failures++;
+            Console.WriteLine($"FAIL {name}: {ex.Message}");
+        }
+    }
+
+    // Samples of f(y, x) on the grid
+    static double[,] Sample(double[] y, double[] x, Func<double, double, double> f)
+    {
+        var data = new double[y.Length, x.Length];
+        for (int i = 0; i < y.Length; i++)
+            for (int j = 0; j < x.Length; j++)
+                data[i, j] = f(y[i], x[j]);
+        return data;
+    }
+
+    static double[] Range(int n, double start, double step)
+    {
+        var values = new double[n];
+        for (int i = 0; i < n; i++)
+            values[i] = start + i * step;
+        return values;
+    }
+
+    // Uniform grid with a few closed and open lines per level
+    static readonly double[] gridY = Range(40, -2.0, 0.5);
+    static readonly double[] gridX = Range(50, 1.0, 0.25);
+    static readonly double[,] waves = Sample(gridY, gridX, (y, x) => Math.Sin(0.4 * y) * Math.Cos(0.7 * x) + 0.02 * x);
+    static readonly double[] waveLevels = { -0.5, 0.0, 0.3, 0.6 };
+
+    static void TestCompute()
     {
         // Simple 3x3 test data with a peak in the center
         double[,] data = {
@@ -16,29 +65,1247 @@ class Program
         double[] x = { 0.0, 1.0, 2.0 };
         double[] levels = { 0.5 };
 
+        var result = ContourCompute.Compute(data, y, x, levels);
+
+        Console.WriteLine($"  Points: {result.X.Length}");
+        Console.WriteLine($"  Segments per level: {result.SegmentLengths.Length}");
+        Check(result.X.Length > 0, "no points");
+        for (int i = 0; i < Math.Min(4, result.X.Length); i++)
+        {
+            Console.WriteLine($"    ({result.X[i]:F2}, {result.Y[i]:F2})");
+        }
+    }
+
+    static void TestQuantizedRoundTrip()
+    {
+        const int bits = 8;
+        double dy = gridY[1] - gridY[0];
+        double dx = gridX[1] - gridX[0];
+        var sorted = ContourCompute.ComputeSorted(waves, gridY, gridX, waveLevels);
+        var quantized = ContourCompute.ComputeSortedQuantized(waves, gridY, gridX, waveLevels, bits);
+        var encoded = ContourCompute.ComputeSortedEncoded(waves, gridY, gridX, waveLevels, bits);
+
+        Check(quantized.X.Length == sorted.X.Length, "quantized point count");
+        Check(string.Join(",", quantized.SegmentLengths) == string.Join(",", sorted.SegmentLengths), "quantized lengths");
+        Check(string.Join(",", quantized.LevelSegments) == string.Join(",", sorted.LevelSegments), "quantized levels");
+        double scale = 1 << bits;
+        for (int i = 0; i < sorted.X.Length; i++)
+        {
+            Check(Math.Abs(gridX[0] + quantized.X[i] * dx / scale - sorted.X[i]) <= 0.5 * dx / scale + 1e-12, $"x of point {i}");
+            Check(Math.Abs(gridY[0] + quantized.Y[i] * dy / scale - sorted.Y[i]) <= 0.5 * dy / scale + 1e-12, $"y of point {i}");
+        }
+
+        // Decode the zigzag varint deltas, restarting at 0 for each polyline
+        Check(string.Join(",", encoded.SegmentLengths) == string.Join(",", quantized.SegmentLengths), "encoded lengths");
+        int offset = 0;
+        int iPoint = 0;
+        long ReadVarint()
+        {
+            ulong value = 0;
+            int shift = 0;
+            byte b;
+            do
+            {
+                b = encoded.Bytes[offset++];
+                value |= (ulong)(b & 0x7F) << shift;
+                shift += 7;
+            } while ((b & 0x80) != 0);
+            return (long)(value >> 1) ^ -(long)(value & 1);
+        }
+        foreach (nuint length in encoded.SegmentLengths)
+        {
+            long px = 0, py = 0;
+            for (nuint k = 0; k < length; k++, iPoint++)
+            {
+                px += ReadVarint();
+                py += ReadVarint();
+                Check(px == quantized.X[iPoint] && py == quantized.Y[iPoint], $"decoded point {iPoint}");
+            }
+        }
+        Check(offset == encoded.Bytes.Length, "trailing bytes");
+
+        // A small first cell sets the unit, the extent must still fit
+        double[] stretched = { 0.0, 1e-6, 1e3 };
+        double[,] plane = { { 0.0, 1.0, 2.0 }, { 1.0, 2.0, 3.0 }, { 2.0, 3.0, 4.0 } };
+        bool rejected = false;
         try
         {
-            var result = ContourCompute.Compute(data, y, x, levels);
+            ContourCompute.ComputeSortedQuantized(plane, gridY[..3], stretched, new[] { 1.5 }, bits);
+        }
+        catch (InvalidOperationException)
+        {
+            rejected = true;
+        }
+        Check(rejected, "extent overflowing int not rejected");
+    }
+
+    // Cells (i, j) containing the midpoints of the segments of Compute()
+    static HashSet<(int, int)> SegmentCells(ContourCompute.ContourResult result, double[] y, double[] x)
+    {
+        var cells = new HashSet<(int, int)>();
+        for (int k = 0; k + 1 < result.X.Length; k += 2)
+        {
+            double my = 0.5 * (result.Y[k] + result.Y[k + 1]);
+            double mx = 0.5 * (result.X[k] + result.X[k + 1]);
+            cells.Add(((int)Math.Floor((my - y[0]) / (y[1] - y[0])), (int)Math.Floor((mx - x[0]) / (x[1] - x[0]))));
+        }
+        return cells;
+    }
+
+    static void TestMissingSamples()
+    {
+        var full = ContourCompute.Compute(waves, gridY, gridX, waveLevels);
+        var cells = SegmentCells(full, gridY, gridX);
+        Check(cells.Count > 0, "no segments");
+
+        // Remove a sample at a corner of a crossed cell
+        var (iCell, jCell) = new List<(int, int)>(cells)[cells.Count / 2];
+        int iSample = iCell + 1, jSample = jCell + 1;
+        var mask = new byte[gridY.Length, gridX.Length];
+        var data = (double[,])waves.Clone();
+        for (int i = 0; i < gridY.Length; i++)
+            for (int j = 0; j < gridX.Length; j++)
+                mask[i, j] = 1;
+        mask[iSample, jSample] = 0;
+        data[iSample, jSample] = double.NaN;
+
+        var masked = ContourCompute.Compute(waves, gridY, gridX, waveLevels, mask, false);
+        var missing = ContourCompute.Compute(data, gridY, gridX, waveLevels, null, true);
+        var maskedCells = SegmentCells(masked, gridY, gridX);
+        for (int i = iSample - 1; i <= iSample; i++)
+            for (int j = jSample - 1; j <= jSample; j++)
+                Check(!maskedCells.Contains((i, j)), $"segment in cell ({i}, {j})");
+
+        // Only the cells touching the sample are dropped
+        var expected = new HashSet<(int, int)>(cells);
+        expected.RemoveWhere(c => c.Item1 >= iSample - 1 && c.Item1 <= iSample && c.Item2 >= jSample - 1 && c.Item2 <= jSample);
+        Check(expected.SetEquals(maskedCells), "other cells changed");
+        Check(masked.X.Length < full.X.Length, "nothing suppressed");
+
+        // NaN samples treated as missing give the same segments as the mask
+        Check(string.Join(",", masked.X) == string.Join(",", missing.X), "NaN x differs from mask");
+        Check(string.Join(",", masked.Y) == string.Join(",", missing.Y), "NaN y differs from mask");
+    }
+
+    static void TestIsosurfaceSphere()
+    {
+        var axis = Range(31, -1.55, 0.1);
+        int n = axis.Length;
+        var data = new double[n, n, n];
+        for (int k = 0; k < n; k++)
+            for (int i = 0; i < n; i++)
+                for (int j = 0; j < n; j++)
+                    data[k, i, j] = Math.Sqrt(axis[k] * axis[k] + axis[i] * axis[i] + axis[j] * axis[j]);
 
-            Console.WriteLine($"Contour computation succeeded");
-            Console.WriteLine($"  Points: {result.X.Length}");
-            Console.WriteLine($"  Segments per level: {result.SegmentLengths.Length}");
+        var result = ContourCompute.ComputeIsosurfaces(data, axis, axis, axis, new[] { 1.0 }, 3);
+        Check(result.LevelTriangles.Length == 1 && result.LevelTriangles[0] > 0, "no triangles");
+        Check(result.Indices.Length == 3 * (int)result.LevelTriangles[0], "index count");
+
+        // Vertices lie on the sphere, up to the interpolation error
+        for (int v = 0; v < result.Vertices.Length; v += 3)
+        {
+            double r = Math.Sqrt(result.Vertices[v] * result.Vertices[v] + result.Vertices[v + 1] * result.Vertices[v + 1] +
+                result.Vertices[v + 2] * result.Vertices[v + 2]);
+            Check(Math.Abs(r - 1.0) < 0.01, $"vertex {v / 3} at radius {r}");
+        }
 
-            if (result.X.Length > 0)
+        // Closed: every edge is shared by exactly two triangles
+        var edges = new Dictionary<(uint, uint), int>();
+        for (int t = 0; t < result.Indices.Length; t += 3)
+        {
+            for (int e = 0; e < 3; e++)
             {
-                Console.WriteLine("  First few points:");
-                for (int i = 0; i < Math.Min(4, result.X.Length); i++)
+                uint a = result.Indices[t + e], b = result.Indices[t + (e + 1) % 3];
+                var key = a < b ? (a, b) : (b, a);
+                edges[key] = edges.GetValueOrDefault(key) + 1;
+            }
+        }
+        foreach (var edge in edges)
+            Check(edge.Value == 2, $"edge {edge.Key} used by {edge.Value} triangles");
+    }
+
+    static void TestIsosurfaceOnSamples()
+    {
+        // Level 5 passes exactly through lattice samples such as (2, 1, 0),
+        // including samples in the planes between slabs
+        var axis = Range(7, -3.0, 1.0);
+        int n = axis.Length;
+        var data = new double[n, n, n];
+        for (int k = 0; k < n; k++)
+            for (int i = 0; i < n; i++)
+                for (int j = 0; j < n; j++)
+                    data[k, i, j] = axis[k] * axis[k] + axis[i] * axis[i] + axis[j] * axis[j];
+
+        var result = ContourCompute.ComputeIsosurfaces(data, axis, axis, axis, new[] { 5.0 }, 3);
+        Check(result.LevelTriangles.Length == 1 && result.LevelTriangles[0] > 0, "no triangles");
+
+        // A sample on the level is a single vertex
+        var positions = new HashSet<(double, double, double)>();
+        int onSamples = 0;
+        for (int v = 0; v < result.Vertices.Length; v += 3)
+        {
+            var position = (result.Vertices[v], result.Vertices[v + 1], result.Vertices[v + 2]);
+            Check(positions.Add(position), $"vertex {v / 3} at {position} repeated");
+            if (position.Item1 == Math.Round(position.Item1) && position.Item2 == Math.Round(position.Item2) &&
+                position.Item3 == Math.Round(position.Item3))
+                onSamples++;
+        }
+        Check(onSamples == 24, $"{onSamples} vertices on samples");
+
+        // Closed, without degenerate triangles
+        var edges = new Dictionary<(uint, uint), int>();
+        for (int t = 0; t < result.Indices.Length; t += 3)
+        {
+            for (int e = 0; e < 3; e++)
+            {
+                uint a = result.Indices[t + e], b = result.Indices[t + (e + 1) % 3];
+                Check(a != b, $"triangle {t / 3} is degenerate");
+                var key = a < b ? (a, b) : (b, a);
+                edges[key] = edges.GetValueOrDefault(key) + 1;
+            }
+        }
+        foreach (var edge in edges)
+            Check(edge.Value == 2, $"edge {edge.Key} used by {edge.Value} triangles");
+    }
+
+    static void TestMeshPlane()
+    {
+        // Unit square with jittered interior nodes, two triangles per quad
+        const int n = 11;
+        var px = new double[n * n];
+        var py = new double[n * n];
+        var values = new double[n * n];
+        var random = new Random(7);
+        for (int i = 0; i < n; i++)
+        {
+            for (int j = 0; j < n; j++)
+            {
+                bool interior = i > 0 && i < n - 1 && j > 0 && j < n - 1;
+                py[i * n + j] = (i + (interior ? 0.3 * (random.NextDouble() - 0.5) : 0.0)) / (n - 1);
+                px[i * n + j] = (j + (interior ? 0.3 * (random.NextDouble() - 0.5) : 0.0)) / (n - 1);
+                values[i * n + j] = 2.0 * px[i * n + j] + 3.0 * py[i * n + j];
+            }
+        }
+        var triangles = new List<nuint>();
+        for (int i = 0; i + 1 < n; i++)
+        {
+            for (int j = 0; j + 1 < n; j++)
+            {
+                nuint a = (nuint)(i * n + j), b = a + 1, c = a + (nuint)n, d = c + 1;
+                triangles.AddRange(new[] { a, b, d, a, d, c });
+            }
+        }
+
+        // Each level is a single straight line across the square
+        double[] levels = { 0.7, 2.5, 4.1 };
+        var result = ContourCompute.ComputeMesh(values, py, px, triangles.ToArray(), levels);
+        Check(result.LevelSegments.Length == levels.Length, "level count");
+        int iPoint = 0;
+        for (int k = 0; k < levels.Length; k++)
+        {
+            Check(result.LevelSegments[k] == 1, $"level {k} has {result.LevelSegments[k]} polylines");
+            int length = (int)result.SegmentLengths[k];
+            for (int p = iPoint; p < iPoint + length; p++)
+                Check(Math.Abs(2.0 * result.X[p] + 3.0 * result.Y[p] - levels[k]) < 1e-12, $"point {p} off the line");
+            foreach (int p in new[] { iPoint, iPoint + length - 1 })
+            {
+                double distance = Math.Min(Math.Min(result.X[p], 1.0 - result.X[p]), Math.Min(result.Y[p], 1.0 - result.Y[p]));
+                Check(Math.Abs(distance) < 1e-12, $"end point {p} not on the boundary");
+            }
+            iPoint += length;
+        }
+        Check(iPoint == result.X.Length, "point count");
+    }
+
+    // Value of the CONREC interpolant, linear on the four triangles of a cell
+    // between the centre and each cell edge
+    static double Interpolate(double[,] data, double[] y, double[] x, double py, double px)
+    {
+        double dy = y[1] - y[0], dx = x[1] - x[0];
+        int i = Math.Min((int)Math.Floor((py - y[0]) / dy), y.Length - 2);
+        int j = Math.Min((int)Math.Floor((px - x[0]) / dx), x.Length - 2);
+        double v = (py - y[i]) / dy, u = (px - x[j]) / dx;
+        double centre = 0.25 * (data[i, j] + data[i + 1, j] + data[i + 1, j + 1] + data[i, j + 1]);
+        (double, double, double) a, b;
+        if (v <= u && v <= 1.0 - u)
+            (a, b) = ((0.0, 0.0, data[i, j]), (0.0, 1.0, data[i, j + 1]));
+        else if (v >= u && v >= 1.0 - u)
+            (a, b) = ((1.0, 0.0, data[i + 1, j]), (1.0, 1.0, data[i + 1, j + 1]));
+        else if (u <= v)
+            (a, b) = ((0.0, 0.0, data[i, j]), (1.0, 0.0, data[i + 1, j]));
+        else
+            (a, b) = ((0.0, 1.0, data[i, j + 1]), (1.0, 1.0, data[i + 1, j + 1]));
+
+        // Barycentric coordinates in (v, u)
+        double det = (a.Item1 - 0.5) * (b.Item2 - 0.5) - (b.Item1 - 0.5) * (a.Item2 - 0.5);
+        double wa = ((v - 0.5) * (b.Item2 - 0.5) - (b.Item1 - 0.5) * (u - 0.5)) / det;
+        double wb = ((a.Item1 - 0.5) * (u - 0.5) - (v - 0.5) * (a.Item2 - 0.5)) / det;
+        return centre + wa * (a.Item3 - centre) + wb * (b.Item3 - centre);
+    }
+
+    static double SegmentDistance(double py, double px, double ay, double ax, double by, double bx)
+    {
+        double dy = by - ay, dx = bx - ax;
+        double length2 = dy * dy + dx * dx;
+        double t = length2 > 0.0 ? Math.Clamp(((py - ay) * dy + (px - ax) * dx) / length2, 0.0, 1.0) : 0.0;
+        double ey = ay + t * dy - py, ex = ax + t * dx - px;
+        return Math.Sqrt(ey * ey + ex * ex);
+    }
+
+    static bool SegmentIntersectsBox(double ay, double ax, double by, double bx,
+        double minY, double minX, double maxY, double maxX)
+    {
+        double dy = by - ay, dx = bx - ax;
+        double[] p = { -dx, dx, -dy, dy };
+        double[] q = { ax - minX, maxX - ax, ay - minY, maxY - ay };
+        double t0 = 0.0, t1 = 1.0;
+        for (int k = 0; k < 4; k++)
+        {
+            if (p[k] == 0.0)
+            {
+                if (q[k] < 0.0)
+                    return false;
+            }
+            else if (p[k] < 0.0)
+                t0 = Math.Max(t0, q[k] / p[k]);
+            else
+                t1 = Math.Min(t1, q[k] / p[k]);
+        }
+        return t0 <= t1;
+    }
+
+    static void TestIndexQueries()
+    {
+        var sorted = ContourCompute.ComputeSorted(waves, gridY, gridX, waveLevels);
+        using var index = new ContourIndex(sorted, waveLevels, waves, gridY, gridX);
+
+        // Polyline of each point and level of each polyline
+        var starts = new List<int> { 0 };
+        foreach (nuint length in sorted.SegmentLengths)
+            starts.Add(starts[^1] + (int)length);
+        var polylineLevel = new List<int>();
+        for (int k = 0; k < sorted.LevelSegments.Length; k++)
+            for (nuint p = 0; p < sorted.LevelSegments[k]; p++)
+                polylineLevel.Add(k);
+
+        double PolylineDistance(int polyline, double py, double px)
+        {
+            double best = double.MaxValue;
+            for (int p = starts[polyline]; p + 1 < starts[polyline + 1]; p++)
+                best = Math.Min(best, SegmentDistance(py, px, sorted.Y[p], sorted.X[p], sorted.Y[p + 1], sorted.X[p + 1]));
+            return best;
+        }
+
+        var random = new Random(11);
+        int nBands = 0;
+        for (int n = 0; n < 300; n++)
+        {
+            double py = gridY[0] + random.NextDouble() * (gridY[^1] - gridY[0]);
+            double px = gridX[0] + random.NextDouble() * (gridX[^1] - gridX[0]);
+
+            double nearest = double.MaxValue;
+            for (int polyline = 0; polyline < polylineLevel.Count; polyline++)
+                nearest = Math.Min(nearest, PolylineDistance(polyline, py, px));
+            Check(index.Nearest(py, px, out nuint found, out nuint level, out double distance), "no nearest polyline");
+            Check(Math.Abs(distance - nearest) < 1e-12, $"nearest distance {distance} != {nearest}");
+            Check(Math.Abs(PolylineDistance((int)found, py, px) - nearest) < 1e-12, "not the nearest polyline");
+            Check((int)level == polylineLevel[(int)found], "level of nearest polyline");
+
+            // Away from the lines, the band is given by the interpolated value
+            if (nearest > 1e-3)
+            {
+                double value = Interpolate(waves, gridY, gridX, py, px);
+                int band = 0;
+                while (band < waveLevels.Length && waveLevels[band] < value)
+                    band++;
+                Check((int)index.Band(py, px) == band, $"band at ({py}, {px})");
+                nBands++;
+            }
+        }
+        Check(nBands > 200, "too few band queries");
+
+        int nHits = 0;
+        for (int n = 0; n < 100; n++)
+        {
+            double minY = gridY[0] + random.NextDouble() * (gridY[^1] - gridY[0]);
+            double minX = gridX[0] + random.NextDouble() * (gridX[^1] - gridX[0]);
+            double maxY = minY + random.NextDouble() * 4.0, maxX = minX + random.NextDouble() * 2.0;
+            var expected = new List<nuint>();
+            for (int polyline = 0; polyline < polylineLevel.Count; polyline++)
+            {
+                for (int p = starts[polyline]; p + 1 < starts[polyline + 1]; p++)
                 {
-                    Console.WriteLine($"    ({result.X[i]:F2}, {result.Y[i]:F2})");
+                    if (SegmentIntersectsBox(sorted.Y[p], sorted.X[p], sorted.Y[p + 1], sorted.X[p + 1], minY, minX, maxY, maxX))
+                    {
+                        expected.Add((nuint)polyline);
+                        break;
+                    }
                 }
             }
+            Check(string.Join(",", index.QueryBox(minY, minX, maxY, maxX)) == string.Join(",", expected), $"box {n}");
+            nHits += expected.Count;
+        }
+        Check(nHits > 50, "too few polylines in boxes");
+    }
 
-            return 0;
+    static bool SameSorted(ContourCompute.SortedContourResult a, ContourCompute.SortedContourResult b)
+    {
+        return a.X.AsSpan().SequenceEqual(b.X) && a.Y.AsSpan().SequenceEqual(b.Y) &&
+            a.SegmentLengths.AsSpan().SequenceEqual(b.SegmentLengths) &&
+            a.LevelSegments.AsSpan().SequenceEqual(b.LevelSegments);
+    }
+
+    static void TestConcurrentResults()
+    {
+        // Grids of very different spacing, so connecting either with the
+        // tolerances of the other changes the polylines
+        var grids = new[]
+        {
+            (Y: gridY, X: gridX),
+            (Y: Array.ConvertAll(gridY, v => 1e-6 * v), X: Array.ConvertAll(gridX, v => 1e-6 * v))
+        };
+        var expected = new ContourCompute.SortedContourResult[2, waveLevels.Length];
+        for (int which = 0; which < 2; which++)
+        {
+            using var result = new LazyContourResult(waves, grids[which].Y, grids[which].X, waveLevels);
+            for (int level = 0; level < waveLevels.Length; level++)
+                expected[which, level] = result.GetLevel(level);
         }
-        catch (Exception ex)
+
+        // Levels are connected once per handle, so each round uses new handles
+        int mismatches = 0;
+        var threads = new Thread[4];
+        for (int t = 0; t < threads.Length; t++)
+        {
+            int which = t % 2;
+            threads[t] = new Thread(() =>
+            {
+                for (int n = 0; n < 20; n++)
+                {
+                    using var result = new LazyContourResult(waves, grids[which].Y, grids[which].X, waveLevels);
+                    for (int level = 0; level < waveLevels.Length; level++)
+                    {
+                        if (!SameSorted(result.GetLevel(level), expected[which, level]))
+                            Interlocked.Increment(ref mismatches);
+                    }
+                }
+            });
+            threads[t].Start();
+        }
+        foreach (var thread in threads)
+            thread.Join();
+        Check(mismatches == 0, $"{mismatches} levels differ when connected concurrently");
+    }
+
+    // Sorted contours through a cache with options, returns the number of points
+    static nuint CacheSorted(IntPtr cache, double[,] data, ContourNative.ContourOptions options)
+    {
+        int nY = data.GetLength(0);
+        int nX = data.GetLength(1);
+        double[] flat = new double[nY * nX];
+        Buffer.BlockCopy(data, 0, flat, 0, nY * nX * sizeof(double));
+        int rc = ContourNative.contour_cache_sorted(cache, flat, (nuint)nY, (nuint)nX,
+            gridY, (nuint)gridY.Length, gridX, (nuint)gridX.Length,
+            waveLevels, (nuint)waveLevels.Length, ref options,
+            out IntPtr pY, out nuint nOutY, out IntPtr pX, out nuint nOutX,
+            out IntPtr pLengths, out nuint nSegments, out IntPtr pLevelSegments, out nuint nLevels);
+        Check(rc == 0, "cached computation failed");
+        ContourNative.contour_free(pY);
+        ContourNative.contour_free(pX);
+        ContourNative.contour_free(pLengths);
+        ContourNative.contour_free(pLevelSegments);
+        return nOutX;
+    }
+
+    static void TestCache()
+    {
+        var expected = ContourCompute.ComputeSorted(waves, gridY, gridX, waveLevels);
+        using (var cache = new ContourCache(1 << 24))
+        {
+            Check(SameSorted(cache.ComputeSorted(waves, gridY, gridX, waveLevels), expected), "miss differs");
+            Check(SameSorted(cache.ComputeSorted(waves, gridY, gridX, waveLevels), expected), "hit differs");
+            var stats = cache.Stats;
+            Check(stats.nMisses == 1 && stats.nHits == 1 && stats.nEntries == 1, "hit and miss counts");
+            cache.Clear();
+            stats = cache.Stats;
+            Check(stats.nHits == 0 && stats.nMisses == 0 && stats.nEntries == 0 && stats.nBytes == 0, "clear");
+        }
+
+        // Each input changing the output has its own entry
+        IntPtr handle = ContourNative.contour_cache_create(1 << 24);
+        var mask = new byte[gridY.Length * gridX.Length];
+        Array.Fill(mask, (byte)1);
+        mask[7 * gridX.Length + 9] = 0;
+        double[] affine = { 2.0, 0.0, 1.0, 0.0, 2.0, -1.0 };
+        double[] clip = { 2.0, -1.0, 9.0, 12.0 };
+        var changed = (double[,])waves.Clone();
+        changed[20, 25] += 0.5;
+        var maskHandle = GCHandle.Alloc(mask, GCHandleType.Pinned);
+        var affineHandle = GCHandle.Alloc(affine, GCHandleType.Pinned);
+        var clipHandle = GCHandle.Alloc(clip, GCHandleType.Pinned);
+        try
+        {
+            ContourNative.contour_options_init(out var defaults);
+            var variants = new List<(string Name, double[,] Data, ContourNative.ContourOptions Options)>();
+            variants.Add(("default", waves, defaults));
+            variants.Add(("data", changed, defaults));
+            var options = defaults;
+            options.pMask = maskHandle.AddrOfPinnedObject();
+            variants.Add(("mask", waves, options));
+            options = defaults;
+            options.pAffine = affineHandle.AddrOfPinnedObject();
+            variants.Add(("affine", waves, options));
+            options = defaults;
+            options.iRowBegin = 5;
+            options.iRowEnd = 30;
+            variants.Add(("window", waves, options));
+            options = defaults;
+            options.pClip = clipHandle.AddrOfPinnedObject();
+            variants.Add(("clip", waves, options));
+
+            var points = new nuint[variants.Count];
+            for (int n = 0; n < variants.Count; n++)
+            {
+                points[n] = CacheSorted(handle, variants[n].Data, variants[n].Options);
+                ContourNative.contour_cache_get_stats(handle, out var stats);
+                Check(stats.nMisses == (nuint)(n + 1) && stats.nHits == 0, $"{variants[n].Name} not keyed");
+            }
+            for (int n = 0; n < variants.Count; n++)
+            {
+                Check(CacheSorted(handle, variants[n].Data, variants[n].Options) == points[n], $"{variants[n].Name} hit differs");
+                ContourNative.contour_cache_get_stats(handle, out var stats);
+                Check(stats.nHits == (nuint)(n + 1) && stats.nMisses == (nuint)variants.Count, $"{variants[n].Name} missed");
+            }
+
+            // A window covering the whole grid is the default
+            options = defaults;
+            options.iRowEnd = (nuint)gridY.Length;
+            options.iColumnEnd = (nuint)gridX.Length;
+            CacheSorted(handle, waves, options);
+            ContourNative.contour_cache_get_stats(handle, out var final);
+            Check(final.nMisses == (nuint)variants.Count, "full window missed");
+        }
+        finally
         {
-            Console.WriteLine($"Error: {ex.Message}");
-            return 1;
+            maskHandle.Free();
+            affineHandle.Free();
+            clipHandle.Free();
+            ContourNative.contour_cache_destroy(handle);
+        }
+
+        // Least recently used results are evicted, with a budget just short of three results
+        var inputs = new[] { waves, changed, Sample(gridY, gridX, (y, x) => Math.Cos(0.3 * y) * Math.Sin(0.5 * x)) };
+        var bytes = new ulong[inputs.Length];
+        using (var cache = new ContourCache(1 << 24))
+        {
+            ulong total = 0;
+            for (int n = 0; n < inputs.Length; n++)
+            {
+                cache.ComputeSorted(inputs[n], gridY, gridX, waveLevels);
+                bytes[n] = cache.Stats.nBytes - total;
+                total += bytes[n];
+            }
         }
+        using (var cache = new ContourCache(bytes[0] + bytes[1] + bytes[2] - 1))
+        {
+            cache.ComputeSorted(inputs[0], gridY, gridX, waveLevels);
+            cache.ComputeSorted(inputs[1], gridY, gridX, waveLevels);
+            cache.ComputeSorted(inputs[0], gridY, gridX, waveLevels);
+            Check(cache.Stats.nEvictions == 0 && cache.Stats.nEntries == 2, "evicted within budget");
+            cache.ComputeSorted(inputs[2], gridY, gridX, waveLevels);
+            var stats = cache.Stats;
+            Check(stats.nEvictions == 1 && stats.nEntries == 2 && stats.nBytes == bytes[0] + bytes[2], "least recently used not evicted");
+            cache.ComputeSorted(inputs[0], gridY, gridX, waveLevels);
+            Check(cache.Stats.nHits == stats.nHits + 1, "recently used evicted");
+            cache.ComputeSorted(inputs[1], gridY, gridX, waveLevels);
+            Check(cache.Stats.nMisses == stats.nMisses + 1, "evicted result served");
+        }
+
+        // Results over budget are computed but not cached
+        using (var cache = new ContourCache(bytes[0] - 1))
+        {
+            Check(SameSorted(cache.ComputeSorted(waves, gridY, gridX, waveLevels), expected), "uncached differs");
+            Check(cache.Stats.nEntries == 0 && cache.Stats.nBytes == 0, "result over budget cached");
+        }
+
+        // Concurrent requests compute each result once
+        var concurrent = new[] { expected, ContourCompute.ComputeSorted(changed, gridY, gridX, waveLevels) };
+        using (var cache = new ContourCache(1 << 24))
+        {
+            int mismatches = 0;
+            var threads = new Thread[8];
+            for (int t = 0; t < threads.Length; t++)
+            {
+                int which = t % 2;
+                threads[t] = new Thread(() =>
+                {
+                    if (!SameSorted(cache.ComputeSorted(inputs[which], gridY, gridX, waveLevels), concurrent[which]))
+                        Interlocked.Increment(ref mismatches);
+                });
+                threads[t].Start();
+            }
+            foreach (var thread in threads)
+                thread.Join();
+            Check(mismatches == 0, $"{mismatches} concurrent results differ");
+            var stats = cache.Stats;
+            Check(stats.nMisses == 2 && stats.nHits == (nuint)threads.Length - 2, "concurrent requests computed more than once");
+        }
+    }
+
+    static void TestVisit()
+    {
+        var visited = new List<(int, double, double, double, double)>();
+        ContourCompute.Visit(waves, gridY, gridX, waveLevels,
+            (x1, y1, x2, y2, level) => visited.Add((level, x1, y1, x2, y2)));
+
+        // Compute() writes the same segments, two points each, counted per level
+        var result = ContourCompute.Compute(waves, gridY, gridX, waveLevels);
+        Check(result.SegmentLengths.Length == waveLevels.Length, "levels");
+        var computed = new List<(int, double, double, double, double)>();
+        int k = 0;
+        for (int level = 0; level < waveLevels.Length; level++)
+        {
+            for (nuint n = 0; n < result.SegmentLengths[level]; n++, k += 2)
+                computed.Add((level, result.X[k], result.Y[k], result.X[k + 1], result.Y[k + 1]));
+        }
+        Check(k == result.X.Length, "points beyond the levels");
+        Check(visited.Count > 100, "too few segments");
+        visited.Sort();
+        computed.Sort();
+        Check(visited.Count == computed.Count, $"{visited.Count} segments visited, {computed.Count} computed");
+        for (int n = 0; n < visited.Count; n++)
+            Check(visited[n] == computed[n], $"segment {n} differs");
+    }
+
+    static bool SameRounded(double[] values, float[] rounded)
+    {
+        if (values.Length != rounded.Length)
+            return false;
+        for (int n = 0; n < values.Length; n++)
+        {
+            if ((float)values[n] != rounded[n])
+                return false;
+        }
+        return true;
+    }
+
+    static void TestFloat()
+    {
+        var segments = ContourCompute.Compute(waves, gridY, gridX, waveLevels);
+        var segmentsFloat = ContourCompute.ComputeFloat(waves, gridY, gridX, waveLevels);
+        Check(SameRounded(segments.X, segmentsFloat.X) && SameRounded(segments.Y, segmentsFloat.Y), "segments");
+        Check(segments.SegmentLengths.AsSpan().SequenceEqual(segmentsFloat.SegmentLengths), "segment counts");
+
+        var sorted = ContourCompute.ComputeSorted(waves, gridY, gridX, waveLevels);
+        var sortedFloat = ContourCompute.ComputeSortedFloat(waves, gridY, gridX, waveLevels);
+        Check(SameRounded(sorted.X, sortedFloat.X) && SameRounded(sorted.Y, sortedFloat.Y), "sorted");
+        Check(sorted.SegmentLengths.AsSpan().SequenceEqual(sortedFloat.SegmentLengths) &&
+            sorted.LevelSegments.AsSpan().SequenceEqual(sortedFloat.LevelSegments), "sorted lengths");
+
+        // Grid split into triangles, vertices in row-major order
+        var values = new double[gridY.Length * gridX.Length];
+        var py = new double[values.Length];
+        var px = new double[values.Length];
+        var triangles = new List<nuint>();
+        for (int i = 0; i < gridY.Length; i++)
+        {
+            for (int j = 0; j < gridX.Length; j++)
+            {
+                int v = i * gridX.Length + j;
+                values[v] = waves[i, j];
+                py[v] = gridY[i];
+                px[v] = gridX[j];
+                if (i + 1 < gridY.Length && j + 1 < gridX.Length)
+                {
+                    nuint a = (nuint)v, b = a + 1, c = a + (nuint)gridX.Length, d = c + 1;
+                    triangles.AddRange(new[] { a, b, d, a, d, c });
+                }
+            }
+        }
+        var mesh = ContourCompute.ComputeMesh(values, py, px, triangles.ToArray(), waveLevels);
+        var meshFloat = ContourCompute.ComputeMeshFloat(values, py, px, triangles.ToArray(), waveLevels);
+        Check(mesh.X.Length > 100, "too few mesh points");
+        Check(SameRounded(mesh.X, meshFloat.X) && SameRounded(mesh.Y, meshFloat.Y), "mesh");
+        Check(mesh.SegmentLengths.AsSpan().SequenceEqual(meshFloat.SegmentLengths) &&
+            mesh.LevelSegments.AsSpan().SequenceEqual(meshFloat.LevelSegments), "mesh lengths");
+
+        double[] axis = Range(16, -1.5, 0.2);
+        var volume = new double[axis.Length, axis.Length, axis.Length];
+        for (int k = 0; k < axis.Length; k++)
+            for (int i = 0; i < axis.Length; i++)
+                for (int j = 0; j < axis.Length; j++)
+                    volume[k, i, j] = axis[k] * axis[k] + 2.0 * axis[i] * axis[i] + axis[j] * axis[j];
+        double[] isoLevels = { 0.5, 1.2 };
+        var surfaces = ContourCompute.ComputeIsosurfaces(volume, axis, axis, axis, isoLevels, 2);
+        var surfacesFloat = ContourCompute.ComputeIsosurfacesFloat(volume, axis, axis, axis, isoLevels, 2);
+        Check(surfaces.Vertices.Length > 100, "too few isosurface vertices");
+        Check(SameRounded(surfaces.Vertices, surfacesFloat.Vertices), "isosurface vertices");
+        Check(surfaces.Indices.AsSpan().SequenceEqual(surfacesFloat.Indices) &&
+            surfaces.LevelTriangles.AsSpan().SequenceEqual(surfacesFloat.LevelTriangles), "isosurface indices");
+    }
+
+    // contours_sorted_ex() with options, returns the status and whether all outputs are empty
+    static int SortedEx(double[,] data, double[] y, double[] x, double[] levels,
+        ContourNative.ContourOptions options, out bool empty)
+    {
+        return SortedEx(data, y, x, levels, options, out empty, out _);
+    }
+
+    static int SortedEx(double[,] data, double[] y, double[] x, double[] levels,
+        ContourNative.ContourOptions options, out bool empty, out ContourCompute.SortedContourResult result)
+    {
+        int nY = data.GetLength(0);
+        int nX = data.GetLength(1);
+        double[] flat = new double[nY * nX];
+        Buffer.BlockCopy(data, 0, flat, 0, nY * nX * sizeof(double));
+        int rc = ContourNative.contour_compute_sorted_ex(flat, (nuint)nY, (nuint)nX,
+            y, (nuint)y.Length, x, (nuint)x.Length, levels, (nuint)levels.Length, ref options,
+            out IntPtr pY, out nuint nOutY, out IntPtr pX, out nuint nOutX,
+            out IntPtr pLengths, out nuint nSegments, out IntPtr pLevelSegments, out nuint nLevels);
+        empty = pY == IntPtr.Zero && pX == IntPtr.Zero && pLengths == IntPtr.Zero &&
+            pLevelSegments == IntPtr.Zero && nOutY == 0 && nOutX == 0 && nSegments == 0 && nLevels == 0;
+        result = new ContourCompute.SortedContourResult
+        {
+            X = new double[(int)nOutX],
+            Y = new double[(int)nOutY],
+            SegmentLengths = new nuint[(int)nSegments],
+            LevelSegments = new nuint[(int)nLevels]
+        };
+        if (rc == 0)
+        {
+            Marshal.Copy(pX, result.X, 0, (int)nOutX);
+            Marshal.Copy(pY, result.Y, 0, (int)nOutY);
+            for (int i = 0; i < (int)nSegments; i++)
+                result.SegmentLengths[i] = (nuint)Marshal.ReadIntPtr(pLengths, i * IntPtr.Size);
+            for (int i = 0; i < (int)nLevels; i++)
+                result.LevelSegments[i] = (nuint)Marshal.ReadIntPtr(pLevelSegments, i * IntPtr.Size);
+        }
+        ContourNative.contour_free(pY);
+        ContourNative.contour_free(pX);
+        ContourNative.contour_free(pLengths);
+        ContourNative.contour_free(pLevelSegments);
+        return rc;
+    }
+
+    static void TestCancel()
+    {
+        // Enough segments for many connection chunks on several workers
+        double[] y = Range(300, 0.0, 0.1);
+        double[] x = Range(300, 0.0, 0.1);
+        var data = Sample(y, x, (py, px) => Math.Sin(py) * Math.Cos(1.3 * px) + 0.1 * Math.Sin(0.2 * px * py));
+        double[] levels = { -0.6, -0.2, 0.0, 0.3, 0.7 };
+
+        IntPtr flag = Marshal.AllocHGlobal(sizeof(int));
+        try
+        {
+            ContourNative.contour_options_init(out var options);
+            options.nThreads = 4;
+            options.pCancel = flag;
+            bool empty;
+
+            Marshal.WriteInt32(flag, 1);
+            Check(SortedEx(data, y, x, levels, options, out empty) == ContourNative.CONTOUR_CANCELLED && empty, "flag set before the call");
+
+            // Cancelled by the progress callback in each phase
+            foreach (var phase in new[] { ContourPhase.Extract, ContourPhase.Connect })
+            {
+                Marshal.WriteInt32(flag, 0);
+                int reports = 0;
+                ContourNative.ContourProgressCallback stop = (p, done, total, user) =>
+                {
+                    reports++;
+                    return p == phase ? 1 : 0;
+                };
+                options.pProgress = Marshal.GetFunctionPointerForDelegate(stop);
+                Check(SortedEx(data, y, x, levels, options, out empty) == ContourNative.CONTOUR_CANCELLED && empty, $"callback in {phase}");
+                GC.KeepAlive(stop);
+                Check(reports > 0, "no progress reported");
+            }
+
+            // Flag set while connecting, the callback does not cancel itself
+            Marshal.WriteInt32(flag, 0);
+            ContourNative.ContourProgressCallback raise = (p, done, total, user) =>
+            {
+                if (p == ContourPhase.Connect)
+                    Marshal.WriteInt32(flag, 1);
+                return 0;
+            };
+            options.pProgress = Marshal.GetFunctionPointerForDelegate(raise);
+            Check(SortedEx(data, y, x, levels, options, out empty) == ContourNative.CONTOUR_CANCELLED && empty, "flag set while connecting");
+            GC.KeepAlive(raise);
+
+            // Not cancelled, the same options give the polylines
+            Marshal.WriteInt32(flag, 0);
+            options.pProgress = IntPtr.Zero;
+            Check(SortedEx(data, y, x, levels, options, out empty) == 0 && !empty, "not cancelled");
+        }
+        finally
+        {
+            Marshal.FreeHGlobal(flag);
+        }
+
+        using var source = new CancellationTokenSource();
+        source.Cancel();
+        bool thrown = false;
+        try
+        {
+            ContourCompute.ComputeSorted(data, y, x, levels, null, source.Token);
+        }
+        catch (OperationCanceledException)
+        {
+            thrown = true;
+        }
+        Check(thrown, "cancelled token not thrown");
+    }
+
+    static void TestTransform()
+    {
+        var plain = ContourCompute.ComputeSorted(waves, gridY, gridX, waveLevels);
+        Check(plain.X.Length > 3 * 256, "too few vertices to flush several chunks");
+
+        double[] affine = { 0.5, -2.0, 3.0, 1.5, 0.25, -7.0 };
+        var mapped = ContourCompute.ComputeSorted(waves, gridY, gridX, waveLevels, affine);
+        Check(mapped.SegmentLengths.AsSpan().SequenceEqual(plain.SegmentLengths), "affine lengths");
+        for (int n = 0; n < plain.X.Length; n++)
+        {
+            double px = plain.X[n], py = plain.Y[n];
+            Check(mapped.X[n] == affine[0] * px + affine[1] * py + affine[2] &&
+                mapped.Y[n] == affine[3] * px + affine[4] * py + affine[5], $"affine vertex {n}");
+        }
+
+        // Callback after the affine transform, in chunks of at most 256 vertices
+        var chunks = new List<int>();
+        ContourNative.ContourTransformCallback transform = (pX, pY, nPoints, user) =>
+        {
+            chunks.Add((int)nPoints);
+            var tx = new double[(int)nPoints];
+            var ty = new double[(int)nPoints];
+            Marshal.Copy(pX, tx, 0, tx.Length);
+            Marshal.Copy(pY, ty, 0, ty.Length);
+            for (int i = 0; i < tx.Length; i++)
+            {
+                double r = tx[i];
+                tx[i] = r * Math.Cos(ty[i]);
+                ty[i] = r * Math.Sin(ty[i]);
+            }
+            Marshal.Copy(tx, 0, pX, tx.Length);
+            Marshal.Copy(ty, 0, pY, ty.Length);
+        };
+        var affineHandle = GCHandle.Alloc(affine, GCHandleType.Pinned);
+        try
+        {
+            ContourNative.contour_options_init(out var options);
+            options.pAffine = affineHandle.AddrOfPinnedObject();
+            options.pTransform = Marshal.GetFunctionPointerForDelegate(transform);
+            Check(SortedEx(waves, gridY, gridX, waveLevels, options, out _, out var polar) == 0, "transform failed");
+            GC.KeepAlive(transform);
+            Check(polar.SegmentLengths.AsSpan().SequenceEqual(plain.SegmentLengths), "transform lengths");
+            for (int n = 0; n < plain.X.Length; n++)
+            {
+                Check(polar.X[n] == mapped.X[n] * Math.Cos(mapped.Y[n]) &&
+                    polar.Y[n] == mapped.X[n] * Math.Sin(mapped.Y[n]), $"transformed vertex {n}");
+            }
+            int total = 0;
+            for (int n = 0; n < chunks.Count; n++)
+            {
+                Check(chunks[n] > 0 && chunks[n] <= 256, $"chunk of {chunks[n]} vertices");
+                Check(n + 1 == chunks.Count || chunks[n] == 256, "chunk flushed early");
+                total += chunks[n];
+            }
+            Check(total == plain.X.Length && chunks.Count > 3, "vertices not transformed once");
+        }
+        finally
+        {
+            affineHandle.Free();
+        }
+    }
+
+    static void TestStatistics()
+    {
+        // Levels along cell edges, one on the boundary: edges shared by
+        // two cells are emitted by both, but counted once
+        double[] y = Range(11, 0.0, 0.5);
+        double[] x = Range(10, 0.0, 1.0);
+        var ramp = Sample(y, x, (py, px) => px);
+        foreach (uint threads in new uint[] { 1, 3 })
+        {
+            var edges = ContourCompute.ComputeStatistics(ramp, y, x, new[] { 0.0, 2.0, 3.5, 5.0 }, threads);
+            Check(edges.Lengths.Length == 4 && edges.Areas.Length == 5, "counts");
+            foreach (double length in edges.Lengths)
+                Check(Math.Abs(length - 5.0) < 1e-12, $"edge length {length}");
+            double[] bands = { 0.0, 10.0, 7.5, 7.5, 20.0 };
+            for (int k = 0; k < bands.Length; k++)
+                Check(Math.Abs(edges.Areas[k] - bands[k]) < 1e-12, $"edge band {k} area {edges.Areas[k]}");
+        }
+
+        // Levels across a plane, lengths and areas of the cut rectangle
+        y = Range(21, 0.0, 0.25);
+        x = Range(19, 0.0, 0.5);
+        var plane = Sample(y, x, (py, px) => px + py);
+        var cut = ContourCompute.ComputeStatistics(plane, y, x, new[] { 2.5, 6.5, 11.5 }, 2);
+        double[] lengths = { 2.5 * Math.Sqrt(2.0), 5.0 * Math.Sqrt(2.0), 2.5 * Math.Sqrt(2.0) };
+        double[] areas = { 3.125, 16.875, 21.875, 3.125 };
+        for (int k = 0; k < lengths.Length; k++)
+            Check(Math.Abs(cut.Lengths[k] - lengths[k]) < 1e-9, $"plane length {k}: {cut.Lengths[k]}");
+        for (int k = 0; k < areas.Length; k++)
+            Check(Math.Abs(cut.Areas[k] - areas[k]) < 1e-9, $"plane band {k}: {cut.Areas[k]}");
+
+        // Lengths are those of the segments of Compute(), and the bands cover the grid
+        var stats = ContourCompute.ComputeStatistics(waves, gridY, gridX, waveLevels, 4);
+        var segments = ContourCompute.Compute(waves, gridY, gridX, waveLevels);
+        int n = 0;
+        for (int level = 0; level < waveLevels.Length; level++)
+        {
+            double length = 0.0;
+            for (nuint m = 0; m < segments.SegmentLengths[level]; m++, n += 2)
+                length += Math.Sqrt(Math.Pow(segments.X[n + 1] - segments.X[n], 2) + Math.Pow(segments.Y[n + 1] - segments.Y[n], 2));
+            Check(Math.Abs(stats.Lengths[level] - length) < 1e-9 * length, $"level {level} length");
+        }
+        double total = (gridY[^1] - gridY[0]) * (gridX[^1] - gridX[0]);
+        double sum = 0.0;
+        foreach (double area in stats.Areas)
+            sum += area;
+        Check(Math.Abs(sum - total) < 1e-9 * total, "bands do not cover the grid");
+    }
+
+    // Vertices of a result near the line x = value (or y = value),
+    // compared bit for bit by the callers
+    static HashSet<(double, double)> VerticesOn(ContourCompute.ContourResult result, bool onX, double value)
+    {
+        var vertices = new HashSet<(double, double)>();
+        for (int n = 0; n < result.X.Length; n++)
+        {
+            if (Math.Abs((onX ? result.X[n] : result.Y[n]) - value) < 1e-9)
+                vertices.Add((result.X[n], result.Y[n]));
+        }
+        return vertices;
+    }
+
+    static void TestAdjacentWindows()
+    {
+        int nY = gridY.Length, nX = gridX.Length;
+
+        // Windows sharing row 24 or column 30 of the samples
+        var top = ContourCompute.ComputeSortedWindow(waves, gridY, gridX, waveLevels, 0, 25, 0, nX);
+        var bottom = ContourCompute.ComputeSortedWindow(waves, gridY, gridX, waveLevels, 24, nY, 0, nX);
+        var rowTop = VerticesOn(top, false, gridY[24]);
+        Check(rowTop.Count > 5, "too few vertices on the shared row");
+        Check(rowTop.SetEquals(VerticesOn(bottom, false, gridY[24])), "vertices on the shared row differ");
+        var full = ContourCompute.ComputeSorted(waves, gridY, gridX, waveLevels);
+        Check(rowTop.SetEquals(VerticesOn(full, false, gridY[24])), "shared row differs from the full grid");
+
+        var left = ContourCompute.ComputeSortedWindow(waves, gridY, gridX, waveLevels, 0, nY, 0, 31);
+        var right = ContourCompute.ComputeSortedWindow(waves, gridY, gridX, waveLevels, 0, nY, 30, nX);
+        var column = VerticesOn(left, true, gridX[30]);
+        Check(column.Count > 5, "too few vertices on the shared column");
+        Check(column.SetEquals(VerticesOn(right, true, gridX[30])), "vertices on the shared column differ");
+
+        // Boxes sharing edges between the samples
+        double xs = 6.3, ys = 5.3;
+        double x0 = gridX[0], x1 = gridX[nX - 1], y0 = gridY[0], y1 = gridY[nY - 1];
+        var westBox = ContourCompute.ComputeSortedWindow(waves, gridY, gridX, waveLevels, 0, 0, 0, 0, new[] { x0, y0, xs, y1 });
+        var eastBox = ContourCompute.ComputeSortedWindow(waves, gridY, gridX, waveLevels, 0, 0, 0, 0, new[] { xs, y0, x1, y1 });
+        var edge = VerticesOn(westBox, true, xs);
+        Check(edge.Count > 5, "too few vertices on the shared box edge");
+        Check(edge.SetEquals(VerticesOn(eastBox, true, xs)), "vertices on the shared box edge differ");
+
+        var southBox = ContourCompute.ComputeSortedWindow(waves, gridY, gridX, waveLevels, 0, 0, 0, 0, new[] { x0, y0, x1, ys });
+        var northBox = ContourCompute.ComputeSortedWindow(waves, gridY, gridX, waveLevels, 0, 0, 0, 0, new[] { x0, ys, x1, y1 });
+        edge = VerticesOn(southBox, false, ys);
+        Check(edge.Count > 5, "too few vertices on the shared box edge");
+        Check(edge.SetEquals(VerticesOn(northBox, false, ys)), "vertices on the shared box edge differ");
+
+        // Points on a box edge are exact, and every vertex lies inside its box
+        foreach (var vertex in edge)
+            Check(vertex.Item2 == ys, "vertex off the box edge");
+        for (int n = 0; n < westBox.X.Length; n++)
+            Check(westBox.X[n] <= xs, "vertex outside the box");
+        for (int n = 0; n < eastBox.X.Length; n++)
+            Check(eastBox.X[n] >= xs, "vertex outside the box");
+    }
+
+    // Polylines of each level in a form independent of their order,
+    // direction and, for closed polylines, starting point
+    static List<string>[] CanonicalPolylines(ContourCompute.SortedContourResult result)
+    {
+        var levels = new List<string>[result.LevelSegments.Length];
+        int polyline = 0, point = 0;
+        for (int level = 0; level < levels.Length; level++)
+        {
+            levels[level] = new List<string>();
+            for (nuint n = 0; n < result.LevelSegments[level]; n++, polyline++)
+            {
+                int count = (int)result.SegmentLengths[polyline];
+                var points = new List<string>();
+                for (int m = 0; m < count; m++)
+                    points.Add(result.X[point + m].ToString("R") + " " + result.Y[point + m].ToString("R"));
+                point += count;
+
+                bool closed = count > 2 && points[0] == points[count - 1];
+                if (closed)
+                    points.RemoveAt(count - 1);
+                var candidates = new List<List<string>>();
+                for (int start = 0; start < (closed ? points.Count : 1); start++)
+                {
+                    var rotated = new List<string>(points.Count);
+                    for (int m = 0; m < points.Count; m++)
+                        rotated.Add(points[(start + m) % points.Count]);
+                    candidates.Add(rotated);
+                    var reversed = new List<string>(rotated);
+                    reversed.Reverse();
+                    if (closed)
+                    {
+                        // Same start point, other direction
+                        reversed.Insert(0, reversed[^1]);
+                        reversed.RemoveAt(reversed.Count - 1);
+                    }
+                    candidates.Add(reversed);
+                }
+                string best = null!;
+                foreach (var candidate in candidates)
+                {
+                    string key = (closed ? "closed " : "open ") + string.Join(",", candidate);
+                    if (best == null || string.CompareOrdinal(key, best) < 0)
+                        best = key;
+                }
+                levels[level].Add(best);
+            }
+            levels[level].Sort(string.CompareOrdinal);
+        }
+        return levels;
+    }
+
+    static void TestTraceEngine()
+    {
+        // Clip boxes through closed and open lines, the traced ends of
+        // closed lines cut by the box are joined
+        var boxes = new double[][] { null!, new[] { 3.0, 1.3, 9.1, 12.2 }, new[] { 5.2, -2.0, 13.25, 6.6 } };
+        foreach (var clip in boxes)
+        {
+            var clipHandle = clip != null ? GCHandle.Alloc(clip, GCHandleType.Pinned) : default;
+            try
+            {
+                ContourNative.contour_options_init(out var options);
+                options.pClip = clip != null ? clipHandle.AddrOfPinnedObject() : IntPtr.Zero;
+                Check(SortedEx(waves, gridY, gridX, waveLevels, options, out _, out var stitched) == 0, "stitch failed");
+                options.eEngine = ContourEngine.Trace;
+                Check(SortedEx(waves, gridY, gridX, waveLevels, options, out _, out var traced) == 0, "trace failed");
+                var expected = CanonicalPolylines(stitched);
+                var actual = CanonicalPolylines(traced);
+                string box = clip == null ? "no box" : "box " + string.Join(" ", clip);
+                int open = 0;
+                for (int level = 0; level < waveLevels.Length; level++)
+                {
+                    Check(actual[level].Count == expected[level].Count,
+                        $"{box}, level {level}: {actual[level].Count} traced, {expected[level].Count} stitched");
+                    for (int n = 0; n < expected[level].Count; n++)
+                    {
+                        Check(actual[level][n] == expected[level][n], $"{box}, level {level}: polyline differs");
+                        open += expected[level][n].StartsWith("open") ? 1 : 0;
+                    }
+                }
+                Check(clip == null || open > 0, $"{box} cuts no lines");
+            }
+            finally
+            {
+                if (clipHandle.IsAllocated)
+                    clipHandle.Free();
+            }
+        }
+    }
+
+    static void TestConnectPaths()
+    {
+        // Levels of thousands of segments, connected in many chunks that
+        // are joined, with closed lines spanning several chunks
+        var y = Range(300, -3.0, 0.05);
+        var x = Range(280, 0.5, 0.06);
+        var data = Sample(y, x, (v, u) => Math.Sin(1.3 * v) * Math.Cos(1.1 * u) + 0.05 * u);
+        double[] levels = { -0.4, 0.1, 0.5 };
+
+        ContourNative.contour_options_init(out var options);
+        options.nThreads = 4;
+        Check(SortedEx(data, y, x, levels, options, out _, out var threaded) == 0, "threaded failed");
+        Check(threaded.SegmentLengths.Length > 30, "too few polylines");
+        Check(threaded.X.Length > 3 * 512 * levels.Length, "too few points to connect in chunks");
+
+        options.nThreads = 1;
+        options.nMaxBytes = 4096;
+        Check(SortedEx(data, y, x, levels, options, out _, out var spilled) == 0, "spilled failed");
+        Check(SameSorted(spilled, threaded), "spilled polylines differ");
+
+        using var lazy = new LazyContourResult(data, y, x, levels);
+        var lazyY = new List<double>();
+        var lazyX = new List<double>();
+        var lazyLengths = new List<nuint>();
+        var lazyLevels = new List<nuint>();
+        for (int level = 0; level < levels.Length; level++)
+        {
+            var polylines = lazy.GetLevel(level);
+            lazyY.AddRange(polylines.Y);
+            lazyX.AddRange(polylines.X);
+            lazyLengths.AddRange(polylines.SegmentLengths);
+            lazyLevels.Add((nuint)polylines.SegmentLengths.Length);
+        }
+        var concatenated = new ContourCompute.SortedContourResult
+        {
+            Y = lazyY.ToArray(),
+            X = lazyX.ToArray(),
+            SegmentLengths = lazyLengths.ToArray(),
+            LevelSegments = lazyLevels.ToArray()
+        };
+        Check(SameSorted(concatenated, threaded), "lazy polylines differ");
+    }
+
+    static void TestLevels()
+    {
+        // Nice intervals on a ramp from 0 to 10: the smallest of 1, 2, 2.5
+        // and 5 times a power of 10 giving at most the requested count,
+        // levels strictly inside the range
+        var rampX = Range(11, 0.0, 1.0);
+        var ramp = Sample(Range(3, 0.0, 1.0), rampX, (v, u) => u);
+        var nice = new (int Count, double[] Levels)[]
+        {
+            (1, new[] { 5.0 }),
+            (2, new[] { 5.0 }),
+            (3, new[] { 2.5, 5.0, 7.5 }),
+            (4, new[] { 2.0, 4.0, 6.0, 8.0 }),
+            (9, new[] { 1.0, 2.0, 3.0, 4.0, 5.0, 6.0, 7.0, 8.0, 9.0 }),
+        };
+        foreach (var (count, levels) in nice)
+        {
+            var chosen = ContourCompute.ComputeLevels(ramp, count);
+            Check(chosen.AsSpan().SequenceEqual(levels), $"{count} levels: {string.Join(" ", chosen)}");
+        }
+
+        // Decimal intervals give exact decimals
+        var small = Sample(Range(3, 0.0, 1.0), Range(7, -0.013, 0.01), (v, u) => u);
+        var decimals = ContourCompute.ComputeLevels(small, 5);
+        Check(decimals.AsSpan().SequenceEqual(new[] { 0.0, 0.02, 0.04 }), $"decimal levels: {string.Join(" ", decimals)}");
+        var fixedLevels = ContourCompute.ComputeLevels(ramp, 100, ContourLevelMode.Nice, 0.3);
+        Check(fixedLevels.Length == 33 && fixedLevels[0] == 0.3 && fixedLevels[9] == 3.0 &&
+            fixedLevels[32] == 9.9, "fixed interval levels");
+
+        // Quantiles are within a 4096th of the range of the exact quantiles
+        var sorted = new List<double>();
+        foreach (var value in waves)
+            sorted.Add(value);
+        sorted.Sort();
+        double tolerance = (sorted[sorted.Count - 1] - sorted[0]) / 4096;
+        const int nQuantiles = 7;
+        var quantiles = ContourCompute.ComputeLevels(waves, nQuantiles, ContourLevelMode.Quantile);
+        Check(quantiles.Length == nQuantiles, "quantile count");
+        for (int k = 0; k < nQuantiles; k++)
+        {
+            int below = (int)Math.Ceiling((double)sorted.Count * (k + 1) / (nQuantiles + 1)) - 1;
+            double lower = sorted[below] - tolerance;
+            double upper = sorted[Math.Min(below + 1, sorted.Count - 1)] + tolerance;
+            Check(quantiles[k] >= lower && quantiles[k] <= upper,
+                $"quantile {k}: {quantiles[k]} outside [{lower}, {upper}]");
+        }
+
+        // Rows at the top and bottom are flat, so no level passes through
+        // them and they are trimmed. The polylines are those of
+        // contours_sorted_ex() at the chosen levels.
+        var y = Range(60, 0.0, 0.2);
+        var x = Range(45, 0.0, 0.2);
+        var data = Sample(y, x, (v, u) => Math.Clamp(0.5 * (v - 6.0) + 0.6 * Math.Sin(1.3 * u) * Math.Cos(0.9 * v), -1.0, 1.0));
+        Check(data[0, 0] == -1.0 && data[1, 20] == -1.0 && data[59, 0] == 1.0 && data[58, 20] == 1.0, "no flat rows");
+        foreach (var mode in new[] { ContourLevelMode.Nice, ContourLevelMode.Quantile })
+        {
+            var auto = ContourCompute.ComputeSortedAuto(data, y, x, 7, mode);
+            Check(mode != ContourLevelMode.Nice ||
+                auto.Levels.AsSpan().SequenceEqual(new[] { -0.75, -0.5, -0.25, 0.0, 0.25, 0.5, 0.75 }), "nice levels");
+            ContourNative.contour_options_init(out var options);
+            Check(SortedEx(data, y, x, auto.Levels, options, out _, out var expected) == 0, "sorted failed");
+            Check(expected.SegmentLengths.Length >= auto.Levels.Length, "too few polylines");
+            Check(SameSorted(auto, expected), $"{mode} polylines differ from contours_sorted_ex()");
+        }
+    }
+
+    static void TestIndexed()
+    {
+        // Lines are the segments of Compute() as 32-bit index pairs into
+        // vertices shared by the segments meeting at them
+        var segments = ContourCompute.Compute(waves, gridY, gridX, waveLevels);
+        var lines = ContourCompute.ComputeIndexed(waves, gridY, gridX, waveLevels);
+        int nVertices = lines.Vertices.Length / 2;
+        Check(lines.LevelIndices.Length == waveLevels.Length, "level count");
+        Check(lines.Indices.Length == segments.X.Length, "two indices per segment");
+        Check(2 * nVertices < 3 * (segments.X.Length / 2), $"{nVertices} vertices for {segments.X.Length / 2} segments");
+        int iIndex = 0;
+        for (int level = 0; level < waveLevels.Length; level++)
+        {
+            Check(lines.LevelIndices[level] == 2 * segments.SegmentLengths[level], $"level {level} indices");
+            for (nuint n = 0; n < lines.LevelIndices[level]; n++, iIndex++)
+            {
+                uint index = lines.Indices[iIndex];
+                Check(index < nVertices, "index out of range");
+                Check(Math.Abs(lines.Vertices[2 * index] - segments.X[iIndex]) < 1e-12 &&
+                    Math.Abs(lines.Vertices[2 * index + 1] - segments.Y[iIndex]) < 1e-12, $"vertex of index {iIndex}");
+            }
+        }
+
+        // Strips of at least two vertices, each ended by the restart index
+        var strips = ContourCompute.ComputeIndexed(waves, gridY, gridX, waveLevels, ContourTopology.Strips);
+        int nStrips = 0;
+        int nStripIndices = 0;
+        iIndex = 0;
+        for (int level = 0; level < waveLevels.Length; level++)
+        {
+            for (nuint n = 0; n < strips.LevelIndices[level]; n++, iIndex++)
+            {
+                uint index = strips.Indices[iIndex];
+                if (index == ContourCompute.IndexedContourResult.RestartIndex)
+                {
+                    Check(nStripIndices >= 2, "strip of fewer than two vertices");
+                    nStrips++;
+                    nStripIndices = 0;
+                }
+                else
+                {
+                    Check(index < strips.Vertices.Length / 2, "strip index out of range");
+                    nStripIndices++;
+                }
+            }
+            Check(nStripIndices == 0, $"level {level} does not end with the restart index");
+        }
+        Check(iIndex == strips.Indices.Length && nStrips > 10, "too few strips");
+
+        // Single-precision vertices are the rounded vertices, the indices are the same
+        foreach (var topology in new[] { ContourTopology.Lines, ContourTopology.Strips })
+        {
+            var indexed = topology == ContourTopology.Lines ? lines : strips;
+            var indexedFloat = ContourCompute.ComputeIndexedFloat(waves, gridY, gridX, waveLevels, topology);
+            Check(SameRounded(indexed.Vertices, indexedFloat.Vertices), $"{topology} vertices");
+            Check(indexed.Indices.AsSpan().SequenceEqual(indexedFloat.Indices) &&
+                indexed.LevelIndices.AsSpan().SequenceEqual(indexedFloat.LevelIndices), $"{topology} indices");
+        }
+    }
+
+    static int Main()
+    {
+        Run("Compute", TestCompute);
+        Run("QuantizedRoundTrip", TestQuantizedRoundTrip);
+        Run("MissingSamples", TestMissingSamples);
+        Run("IsosurfaceSphere", TestIsosurfaceSphere);
+        Run("MeshPlane", TestMeshPlane);
+        Run("IndexQueries", TestIndexQueries);
+        Run("ConcurrentResults", TestConcurrentResults);
+        Run("Cache", TestCache);
+        Run("Visit", TestVisit);
+        Run("Float", TestFloat);
+        Run("Cancel", TestCancel);
+        Run("Transform", TestTransform);
+        Run("Statistics", TestStatistics);
+        Run("AdjacentWindows", TestAdjacentWindows);
+        Run("TraceEngine", TestTraceEngine);
+        Run("ConnectPaths", TestConnectPaths);
+        Run("Levels", TestLevels);
+        Run("Indexed", TestIndexed);
+        Run("IsosurfaceOnSamples", TestIsosurfaceOnSamples);
+
+        Console.WriteLine(failures == 0 ? "All tests passed" : $"{failures} test(s) failed");
+        return failures == 0 ? 0 : 1;
     }
 }
@@ -32,6 +32,10 @@ setup(
             sources=[
                 'contour/swig_contour.i',
                 'contour/contour.cpp',
+                'contour/contour_alloc.cpp',
+                'contour/contour_cache.cpp',
+                'contour/contour_capi.cpp',
+                'contour/contour_index.cpp',
                 'contour/conrec.c',
             ],
             include_dirs=[numpy.get_include(), '.'],